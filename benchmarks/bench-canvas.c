@@ -0,0 +1,400 @@
+/*
+ * bench-canvas.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Renders the canvas offscreen and times it.
+ *
+ * A folder is filled with one blank image per point count, and the record
+ * of each image gets that many random points.  For every combination of
+ * point count, zoom factor, radius and hover or selection state the canvas
+ * is snapshotted a number of times and each render node is drawn into a
+ * texture by every renderer that can be realized.  Snapshot time, render
+ * time and the number of render nodes per frame are printed as JSON.
+ *
+ * A display is needed for GTK to start, a headless compositor or Xvfb will
+ * do.  Without one the program exits with 77, which meson reports as a skip.
+ */
+
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include "pan-canvas-private.h"
+
+#define IMAGE_SIZE      2048
+#define VIEWPORT_WIDTH  1280
+#define VIEWPORT_HEIGHT 800
+#define EXIT_SKIP       77
+
+typedef enum
+{
+    STATE_NONE,
+    STATE_HOVER,
+    STATE_SELECTION,
+    N_STATES
+} CanvasState;
+
+static const gchar *state_names[N_STATES] = {"none", "hover", "selection"};
+static const guint  point_counts[]        = {1000, 10000, 100000};
+static const gfloat zoom_factors[]        = {0.5, 1.0, 2.0};
+static const gdouble radii[]              = {5, 10, 25};
+
+static gint         n_frames = 20;
+static gint64       seed     = 1;
+static const gchar *output   = NULL;
+
+static GOptionEntry entries[] =
+{
+    {"frames", 'f', 0, G_OPTION_ARG_INT,      &n_frames, "Frames per configuration", "N"},
+    {"seed",   's', 0, G_OPTION_ARG_INT64,    &seed,     "Random seed", "SEED"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,   "Write the report to FILE", "FILE"},
+    {NULL}
+};
+
+static guint
+count_nodes (GskRenderNode *node)
+{
+    GskRenderNodeType type;
+    guint n = 1;
+
+    type = gsk_render_node_get_node_type (node);
+    if (type == GSK_CONTAINER_NODE) {
+        for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
+            n += count_nodes (gsk_container_node_get_child (node, i));
+    } else if (type == GSK_TRANSFORM_NODE) {
+        n += count_nodes (gsk_transform_node_get_child (node));
+    } else if (type == GSK_CLIP_NODE) {
+        n += count_nodes (gsk_clip_node_get_child (node));
+    } else if (type == GSK_ROUNDED_CLIP_NODE) {
+        n += count_nodes (gsk_rounded_clip_node_get_child (node));
+    } else if (type == GSK_OPACITY_NODE) {
+        n += count_nodes (gsk_opacity_node_get_child (node));
+    } else if (type == GSK_COLOR_MATRIX_NODE) {
+        n += count_nodes (gsk_color_matrix_node_get_child (node));
+    } else if (type == GSK_DEBUG_NODE) {
+        n += count_nodes (gsk_debug_node_get_child (node));
+    } else if (type == GSK_FILL_NODE) {
+        n += count_nodes (gsk_fill_node_get_child (node));
+    } else if (type == GSK_STROKE_NODE) {
+        n += count_nodes (gsk_stroke_node_get_child (node));
+    }
+
+    return n;
+}
+
+static gchar *
+make_folder (GRand *rand)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GdkTexture) texture = NULL;
+    g_autoptr (GBytes) pixels = NULL;
+    g_autoptr (GBytes) png = NULL;
+    g_autofree gchar *path = NULL;
+    guint8 *data;
+    gchar *folder;
+
+    folder = g_dir_make_tmp ("pan-bench-XXXXXX", &error);
+    if (!folder)
+        g_error ("Could not create a temporary folder: %s", error->message);
+
+    data = g_malloc (IMAGE_SIZE * IMAGE_SIZE);
+    for (gsize i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i++)
+        data[i] = g_rand_int_range (rand, 64, 192);
+    pixels = g_bytes_new_take (data, IMAGE_SIZE * IMAGE_SIZE);
+    texture = gdk_memory_texture_new (IMAGE_SIZE, IMAGE_SIZE, GDK_MEMORY_G8,
+                                      pixels, IMAGE_SIZE);
+    png = gdk_texture_save_to_png_bytes (texture);
+
+    for (guint i = 0; i < G_N_ELEMENTS (point_counts); i++) {
+        path = g_strdup_printf ("%s/points-%u.png", folder, point_counts[i]);
+        if (!g_file_set_contents (path, g_bytes_get_data (png, NULL), g_bytes_get_size (png), &error))
+            g_error ("Could not create %s: %s", path, error->message);
+        g_clear_pointer (&path, g_free);
+    }
+
+    return folder;
+}
+
+static void
+remove_folder (const gchar *folder)
+{
+    g_autoptr (GDir) dir = NULL;
+    g_autofree gchar *path = NULL;
+    const gchar *name;
+
+    dir = g_dir_open (folder, 0, NULL);
+    while (dir && (name = g_dir_read_name (dir))) {
+        path = g_build_filename (folder, name, NULL);
+        g_unlink (path);
+        g_clear_pointer (&path, g_free);
+    }
+    g_rmdir (folder);
+}
+
+/* Returns the position of the record for n_points. */
+static guint
+populate (PanDocument *document,
+          guint        n_points,
+          GRand       *rand)
+{
+    g_autofree gchar *filename = NULL;
+    PanRecordList *records;
+    PanRecord *record;
+    GPtrArray *annots;
+    guint n;
+
+    records = pan_document_records (document);
+    filename = g_strdup_printf ("points-%u.png", n_points);
+    n = g_list_model_get_n_items (G_LIST_MODEL (records));
+    for (guint i = 0; i < n; i++) {
+        if (g_strcmp0 (pan_record_list_get_filename (records, i), filename) != 0)
+            continue;
+
+        annots = g_ptr_array_new_with_free_func (g_object_unref);
+        for (guint j = 0; j < n_points; j++)
+            g_ptr_array_add (annots, pan_annot_new (g_rand_int_range (rand, 0, IMAGE_SIZE),
+                                                    g_rand_int_range (rand, 0, IMAGE_SIZE)));
+        record = g_list_model_get_item (G_LIST_MODEL (records), i);
+        g_list_store_splice (pan_record_annots (record), 0, 0, annots->pdata, annots->len);
+        g_object_unref (record);
+        g_ptr_array_unref (annots);
+        return i;
+    }
+
+    g_error ("No record for %s", filename);
+}
+
+static void
+set_state (PanCanvas   *canvas,
+           CanvasState  state,
+           guint        n_points)
+{
+    GtkSelectionModel *selection;
+
+    selection = pan_canvas_get_annot_selection_model (canvas);
+    gtk_selection_model_unselect_all (selection);
+    pan_canvas_set_hover (canvas, GTK_INVALID_LIST_POSITION);
+
+    switch (state) {
+    case STATE_HOVER:
+        pan_canvas_set_hover (canvas, n_points / 2);
+        break;
+    case STATE_SELECTION:
+        /* A tenth of the points, as after a box selection. */
+        gtk_selection_model_select_range (selection, 0, n_points / 10, TRUE);
+        break;
+    case STATE_NONE:
+    case N_STATES:
+    default:
+        break;
+    }
+}
+
+static void
+run_config (PanCanvas    *canvas,
+            GskRenderer **renderers,
+            guint         n_renderers,
+            JsonBuilder  *builder)
+{
+    GtkSnapshot *snapshot;
+    GskRenderNode *node;
+    GdkTexture *texture;
+    graphene_rect_t viewport;
+    gint64 start;
+    gint64 snapshot_us = 0;
+    gint64 render_us[2] = {0, 0};
+    guint n_nodes = 0;
+
+    graphene_rect_init (&viewport, 0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+
+    for (gint frame = 0; frame < n_frames; frame++) {
+        start = g_get_monotonic_time ();
+        snapshot = gtk_snapshot_new ();
+        GTK_WIDGET_GET_CLASS (canvas)->snapshot (GTK_WIDGET (canvas), snapshot);
+        node = gtk_snapshot_free_to_node (snapshot);
+        snapshot_us += g_get_monotonic_time () - start;
+
+        if (!node)
+            continue;
+        n_nodes = count_nodes (node);
+
+        for (guint i = 0; i < n_renderers; i++) {
+            start = g_get_monotonic_time ();
+            texture = gsk_renderer_render_texture (renderers[i], node, &viewport);
+            render_us[i] += g_get_monotonic_time () - start;
+            g_object_unref (texture);
+        }
+        gsk_render_node_unref (node);
+    }
+
+    json_builder_set_member_name (builder, "render_nodes");
+    json_builder_add_int_value (builder, n_nodes);
+    json_builder_set_member_name (builder, "snapshot_us");
+    json_builder_add_double_value (builder, snapshot_us / (gdouble) n_frames);
+    json_builder_set_member_name (builder, "render_us");
+    json_builder_begin_object (builder);
+    for (guint i = 0; i < n_renderers; i++) {
+        json_builder_set_member_name (builder, G_OBJECT_TYPE_NAME (renderers[i]));
+        json_builder_add_double_value (builder, render_us[i] / (gdouble) n_frames);
+    }
+    json_builder_end_object (builder);
+}
+
+static guint
+realize_renderers (GskRenderer **renderers)
+{
+    GskRenderer *candidates[2];
+    g_autoptr (GError) error = NULL;
+    guint n = 0;
+
+    candidates[0] = gsk_cairo_renderer_new ();
+    candidates[1] = gsk_gl_renderer_new ();
+
+    for (guint i = 0; i < G_N_ELEMENTS (candidates); i++) {
+        if (gsk_renderer_realize_for_display (candidates[i], gdk_display_get_default (), &error)) {
+            renderers[n++] = candidates[i];
+        } else {
+            g_printerr ("Skipping %s: %s\n", G_OBJECT_TYPE_NAME (candidates[i]), error->message);
+            g_clear_error (&error);
+            g_object_unref (candidates[i]);
+        }
+    }
+
+    return n;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (GOptionContext) context = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autoptr (JsonBuilder) builder = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autofree gchar *folder = NULL;
+    g_autofree gchar *report = NULL;
+    GskRenderer *renderers[2];
+    GtkSingleSelection *record_selection;
+    PanDocument *document;
+    PanCanvas *canvas;
+    GRand *rand;
+    guint positions[G_N_ELEMENTS (point_counts)];
+    guint n_renderers;
+
+    context = g_option_context_new ("- benchmark canvas rendering");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+    if (n_frames <= 0) {
+        g_printerr ("Need at least one frame\n");
+        return 1;
+    }
+
+    if (!gtk_init_check ()) {
+        g_printerr ("No display available\n");
+        return EXIT_SKIP;
+    }
+    adw_init ();
+
+    n_renderers = realize_renderers (renderers);
+    if (n_renderers == 0)
+        return EXIT_SKIP;
+
+    rand = g_rand_new_with_seed ((guint32) seed);
+    folder = make_folder (rand);
+    file = g_file_new_for_path (folder);
+    document = pan_document_new (file);
+    for (guint i = 0; i < G_N_ELEMENTS (point_counts); i++)
+        positions[i] = populate (document, point_counts[i], rand);
+    g_rand_free (rand);
+
+    canvas = g_object_ref_sink (g_object_new (PAN_TYPE_CANVAS,
+                                              "hadjustment", NULL,
+                                              "vadjustment", NULL,
+                                              NULL));
+    pan_canvas_set_document (canvas, document);
+    record_selection = pan_canvas_get_record_selection_model (canvas);
+
+    builder = json_builder_new ();
+    json_builder_begin_object (builder);
+    json_builder_set_member_name (builder, "frames");
+    json_builder_add_int_value (builder, n_frames);
+    json_builder_set_member_name (builder, "viewport");
+    json_builder_add_string_value (builder, G_STRINGIFY (VIEWPORT_WIDTH) "x" G_STRINGIFY (VIEWPORT_HEIGHT));
+    json_builder_set_member_name (builder, "configs");
+    json_builder_begin_array (builder);
+
+    for (guint p = 0; p < G_N_ELEMENTS (point_counts); p++) {
+        gtk_single_selection_set_selected (record_selection, positions[p]);
+        for (guint z = 0; z < G_N_ELEMENTS (zoom_factors); z++) {
+            pan_canvas_set_zoom_factor (canvas, zoom_factors[z]);
+            for (guint r = 0; r < G_N_ELEMENTS (radii); r++) {
+                pan_canvas_set_radius (canvas, radii[r]);
+                for (CanvasState state = STATE_NONE; state < N_STATES; state++) {
+                    set_state (canvas, state, point_counts[p]);
+
+                    json_builder_begin_object (builder);
+                    json_builder_set_member_name (builder, "points");
+                    json_builder_add_int_value (builder, point_counts[p]);
+                    json_builder_set_member_name (builder, "zoom_factor");
+                    json_builder_add_double_value (builder, zoom_factors[z]);
+                    json_builder_set_member_name (builder, "radius");
+                    json_builder_add_double_value (builder, radii[r]);
+                    json_builder_set_member_name (builder, "state");
+                    json_builder_add_string_value (builder, state_names[state]);
+                    run_config (canvas, renderers, n_renderers, builder);
+                    json_builder_end_object (builder);
+                }
+            }
+        }
+    }
+
+    json_builder_end_array (builder);
+    json_builder_end_object (builder);
+
+    for (guint i = 0; i < n_renderers; i++) {
+        gsk_renderer_unrealize (renderers[i]);
+        g_object_unref (renderers[i]);
+    }
+    g_object_unref (record_selection);
+    g_object_unref (canvas);
+    g_object_unref (document);
+    remove_folder (folder);
+
+    root = json_builder_get_root (builder);
+    generator = json_generator_new ();
+    json_generator_set_pretty (generator, TRUE);
+    json_generator_set_root (generator, root);
+    report = json_generator_to_data (generator, NULL);
+
+    if (output) {
+        if (!g_file_set_contents (output, report, -1, &error)) {
+            g_printerr ("%s\n", error->message);
+            return 1;
+        }
+    } else {
+        g_print ("%s\n", report);
+    }
+
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * bench-document.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Times the document load and save paths on synthetic data.
+ *
+ * A folder of empty image files is created, loaded with pan_document_new(),
+ * filled with randomly placed points, saved, opened again, and finally
+ * every record of the saved file is deserialized on its own.  Each phase
+ * reports its wall time, the peak RSS of the process so far and its
+ * throughput, and the whole run is printed as a single JSON object.
+ * The same seed always produces the same document.
+ */
+
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include <sys/resource.h>
+#include "pan-document.h"
+
+#define IMAGE_WIDTH  4096
+#define IMAGE_HEIGHT 4096
+
+typedef struct
+{
+    gint64 start;
+    JsonBuilder *builder;
+} Bench;
+
+static gint64       n_points  = 100000;
+static gint64       n_records = 1000;
+static gint64       seed      = 1;
+static const gchar *output    = NULL;
+
+static GOptionEntry entries[] =
+{
+    {"points",  'p', 0, G_OPTION_ARG_INT64,    &n_points,  "Number of points", "N"},
+    {"records", 'r', 0, G_OPTION_ARG_INT64,    &n_records, "Number of records", "N"},
+    {"seed",    's', 0, G_OPTION_ARG_INT64,    &seed,      "Random seed", "SEED"},
+    {"output",  'o', 0, G_OPTION_ARG_FILENAME, &output,    "Write the report to FILE", "FILE"},
+    {NULL}
+};
+
+static gint64
+peak_rss_kb (void)
+{
+    struct rusage usage;
+
+    if (getrusage (RUSAGE_SELF, &usage) != 0)
+        return -1;
+
+    /* ru_maxrss is in kilobytes on Linux. */
+    return usage.ru_maxrss;
+}
+
+static void
+bench_begin (Bench *bench)
+{
+    bench->start = g_get_monotonic_time ();
+}
+
+static void
+bench_end (Bench       *bench,
+           const gchar *phase,
+           gint64       items,
+           const gchar *unit)
+{
+    gdouble seconds;
+
+    seconds = (g_get_monotonic_time () - bench->start) / (gdouble) G_USEC_PER_SEC;
+
+    json_builder_begin_object (bench->builder);
+    json_builder_set_member_name (bench->builder, "phase");
+    json_builder_add_string_value (bench->builder, phase);
+    json_builder_set_member_name (bench->builder, "wall_time_s");
+    json_builder_add_double_value (bench->builder, seconds);
+    json_builder_set_member_name (bench->builder, "peak_rss_kb");
+    json_builder_add_int_value (bench->builder, peak_rss_kb ());
+    json_builder_set_member_name (bench->builder, "items");
+    json_builder_add_int_value (bench->builder, items);
+    json_builder_set_member_name (bench->builder, "throughput");
+    json_builder_add_double_value (bench->builder, seconds > 0 ? items / seconds : 0);
+    json_builder_set_member_name (bench->builder, "unit");
+    json_builder_add_string_value (bench->builder, unit);
+    json_builder_end_object (bench->builder);
+}
+
+static gchar *
+make_folder (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *path = NULL;
+    gchar *folder;
+
+    folder = g_dir_make_tmp ("pan-bench-XXXXXX", &error);
+    if (!folder)
+        g_error ("Could not create a temporary folder: %s", error->message);
+
+    for (gint64 i = 0; i < n_records; i++) {
+        path = g_strdup_printf ("%s/image-%07" G_GINT64_FORMAT ".png", folder, i);
+        if (!g_file_set_contents (path, "", 0, &error))
+            g_error ("Could not create %s: %s", path, error->message);
+        g_clear_pointer (&path, g_free);
+    }
+
+    return folder;
+}
+
+static void
+remove_folder (const gchar *folder)
+{
+    g_autoptr (GDir) dir = NULL;
+    g_autofree gchar *path = NULL;
+    const gchar *name;
+
+    dir = g_dir_open (folder, 0, NULL);
+    while (dir && (name = g_dir_read_name (dir))) {
+        path = g_build_filename (folder, name, NULL);
+        g_unlink (path);
+        g_clear_pointer (&path, g_free);
+    }
+    g_rmdir (folder);
+}
+
+/* Spreads the points evenly over the records, the first ones get the rest. */
+static void
+populate (PanDocument *document,
+          GRand       *rand)
+{
+    PanRecordList *records;
+    PanRecord *record;
+    GPtrArray *annots;
+    gint64 per_record;
+    gint64 rest;
+    gint64 n;
+
+    records = pan_document_records (document);
+    per_record = n_points / n_records;
+    rest = n_points % n_records;
+
+    annots = g_ptr_array_new_with_free_func (g_object_unref);
+    for (gint64 i = 0; i < n_records; i++) {
+        n = per_record + (i < rest ? 1 : 0);
+        if (n == 0)
+            continue;
+
+        for (gint64 j = 0; j < n; j++)
+            g_ptr_array_add (annots, pan_annot_new (g_rand_int_range (rand, 0, IMAGE_WIDTH),
+                                                    g_rand_int_range (rand, 0, IMAGE_HEIGHT)));
+
+        record = g_list_model_get_item (G_LIST_MODEL (records), i);
+        g_list_store_splice (pan_record_annots (record), 0, 0, annots->pdata, annots->len);
+        g_object_unref (record);
+        g_ptr_array_set_size (annots, 0);
+    }
+    g_ptr_array_unref (annots);
+}
+
+static void
+deserialize_records (Bench       *bench,
+                     const gchar *path)
+{
+    g_autoptr (JsonParser) parser = NULL;
+    g_autoptr (GError) error = NULL;
+    JsonArray *array;
+    JsonNode *node;
+    GObject *record;
+    guint n;
+
+    parser = json_parser_new ();
+    if (!json_parser_load_from_file (parser, path, &error))
+        g_error ("Could not parse %s: %s", path, error->message);
+
+    array = json_object_get_array_member (json_node_get_object (json_parser_get_root (parser)),
+                                          "records");
+    n = json_array_get_length (array);
+
+    bench_begin (bench);
+    for (guint i = 0; i < n; i++) {
+        node = json_array_get_element (array, i);
+        record = json_gobject_deserialize (PAN_TYPE_RECORD, node);
+        g_object_unref (record);
+    }
+    bench_end (bench, "deserialize_records", n, "records/s");
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (GOptionContext) context = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autofree gchar *folder = NULL;
+    g_autofree gchar *save_path = NULL;
+    g_autofree gchar *report = NULL;
+    PanDocument *document;
+    GStatBuf stat_buf;
+    GRand *rand;
+    Bench bench = {0, };
+
+    context = g_option_context_new ("- benchmark document load and save");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+    if (n_points < 0 || n_records <= 0) {
+        g_printerr ("Need at least one record and no negative point count\n");
+        return 1;
+    }
+
+    bench.builder = json_builder_new ();
+    json_builder_begin_object (bench.builder);
+    json_builder_set_member_name (bench.builder, "points");
+    json_builder_add_int_value (bench.builder, n_points);
+    json_builder_set_member_name (bench.builder, "records");
+    json_builder_add_int_value (bench.builder, n_records);
+    json_builder_set_member_name (bench.builder, "seed");
+    json_builder_add_int_value (bench.builder, seed);
+    json_builder_set_member_name (bench.builder, "phases");
+    json_builder_begin_array (bench.builder);
+
+    folder = make_folder ();
+    file = g_file_new_for_path (folder);
+
+    bench_begin (&bench);
+    document = pan_document_new (file);
+    bench_end (&bench, "document_new", n_records, "records/s");
+
+    rand = g_rand_new_with_seed ((guint32) seed);
+    bench_begin (&bench);
+    populate (document, rand);
+    bench_end (&bench, "populate", n_points, "points/s");
+    g_rand_free (rand);
+
+    save_path = g_build_filename (folder, "document.json", NULL);
+    bench_begin (&bench);
+    pan_document_save (document, save_path);
+    if (g_stat (save_path, &stat_buf) != 0)
+        g_error ("Document was not saved to %s", save_path);
+    bench_end (&bench, "document_save", stat_buf.st_size, "bytes/s");
+    g_object_unref (document);
+
+    bench_begin (&bench);
+    document = pan_document_open (save_path);
+    bench_end (&bench, "document_open", n_points, "points/s");
+    g_clear_object (&document);
+
+    deserialize_records (&bench, save_path);
+
+    json_builder_end_array (bench.builder);
+    json_builder_end_object (bench.builder);
+
+    remove_folder (folder);
+
+    root = json_builder_get_root (bench.builder);
+    g_object_unref (bench.builder);
+    generator = json_generator_new ();
+    json_generator_set_pretty (generator, TRUE);
+    json_generator_set_root (generator, root);
+    report = json_generator_to_data (generator, NULL);
+
+    if (output) {
+        if (!g_file_set_contents (output, report, -1, &error)) {
+            g_printerr ("%s\n", error->message);
+            return 1;
+        }
+    } else {
+        g_print ("%s\n", report);
+    }
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * replay-trace.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Replays an event trace recorded with PAN_EVENT_TRACE against a document
+ * and reports the latency of every event type.
+ *
+ * The canvas is shown in a window so it is laid out as in the application,
+ * but the events are fed straight into its handlers, back to back.  The
+ * latency of an event is the time spent in the handler plus building and
+ * rendering one frame; the handler time alone is reported as well.
+ *
+ *   replay-trace TRACE FOLDER|DOCUMENT
+ *
+ * Like bench-canvas this needs a display and exits with 77 without one.
+ */
+
+#include <json-glib/json-glib.h>
+#include "pan-canvas-private.h"
+
+#define WINDOW_WIDTH   1280
+#define WINDOW_HEIGHT  800
+#define EXIT_SKIP      77
+#define LAYOUT_TIMEOUT (5 * G_USEC_PER_SEC)
+
+static const gchar *output = NULL;
+
+static GOptionEntry entries[] =
+{
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the report to FILE", "FILE"},
+    {NULL}
+};
+
+static gint
+compare_int64 (gconstpointer a,
+               gconstpointer b)
+{
+    gint64 value_a = *(const gint64 *) a;
+    gint64 value_b = *(const gint64 *) b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static gint64
+percentile (GArray  *sorted,
+            gdouble  fraction)
+{
+    return g_array_index (sorted, gint64, (guint) ((sorted->len - 1) * fraction));
+}
+
+static void
+add_distribution (JsonBuilder *builder,
+                  const gchar *name,
+                  GArray      *samples)
+{
+    g_array_sort (samples, compare_int64);
+
+    json_builder_set_member_name (builder, name);
+    json_builder_begin_object (builder);
+    json_builder_set_member_name (builder, "p50_us");
+    json_builder_add_int_value (builder, percentile (samples, 0.5));
+    json_builder_set_member_name (builder, "p99_us");
+    json_builder_add_int_value (builder, percentile (samples, 0.99));
+    json_builder_set_member_name (builder, "max_us");
+    json_builder_add_int_value (builder, g_array_index (samples, gint64, samples->len - 1));
+    json_builder_end_object (builder);
+}
+
+static PanDocument *
+load_document (const gchar *path)
+{
+    g_autoptr (GFile) file = NULL;
+
+    if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+        file = g_file_new_for_path (path);
+        return pan_document_new (file);
+    }
+
+    return pan_document_open ((gchar *) path);
+}
+
+static void
+wait_for_layout (GtkWidget *widget)
+{
+    gint64 deadline;
+
+    deadline = g_get_monotonic_time () + LAYOUT_TIMEOUT;
+    while (gtk_widget_get_width (widget) == 0 && g_get_monotonic_time () < deadline)
+        g_main_context_iteration (NULL, FALSE);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (GOptionContext) context = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanEventTrace) trace = NULL;
+    g_autoptr (JsonBuilder) builder = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    g_autofree gchar *report = NULL;
+    GArray *latency[PAN_N_EVENT_TYPES];
+    GArray *handler[PAN_N_EVENT_TYPES];
+    const PanEvent *event;
+    PanDocument *document;
+    GtkWidget *window;
+    GtkWidget *scrolled_window;
+    GtkWidget *canvas;
+    GskRenderer *renderer;
+    GtkSnapshot *snapshot;
+    GskRenderNode *node;
+    GdkTexture *texture;
+    graphene_rect_t viewport;
+    gint64 start;
+    gint64 handler_us, latency_us;
+    guint n_events;
+
+    context = g_option_context_new ("TRACE FOLDER|DOCUMENT - replay an event trace");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+    if (argc != 3) {
+        g_printerr ("Usage: %s TRACE FOLDER|DOCUMENT\n", g_get_prgname ());
+        return 1;
+    }
+
+    trace = pan_event_trace_load (argv[1], &error);
+    if (!trace) {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+
+    if (!gtk_init_check ()) {
+        g_printerr ("No display available\n");
+        return EXIT_SKIP;
+    }
+    adw_init ();
+
+    document = load_document (argv[2]);
+    if (!document) {
+        g_printerr ("Could not load %s\n", argv[2]);
+        return 1;
+    }
+
+    canvas = g_object_new (PAN_TYPE_CANVAS, NULL);
+    scrolled_window = gtk_scrolled_window_new ();
+    gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (scrolled_window), canvas);
+    window = gtk_window_new ();
+    gtk_window_set_default_size (GTK_WINDOW (window), WINDOW_WIDTH, WINDOW_HEIGHT);
+    gtk_window_set_child (GTK_WINDOW (window), scrolled_window);
+    pan_canvas_set_document (PAN_CANVAS (canvas), document);
+    gtk_window_present (GTK_WINDOW (window));
+    wait_for_layout (canvas);
+
+    renderer = gtk_native_get_renderer (GTK_NATIVE (window));
+    graphene_rect_init (&viewport, 0, 0,
+                        MAX (gtk_widget_get_width (canvas), 1),
+                        MAX (gtk_widget_get_height (canvas), 1));
+
+    for (guint i = 0; i < PAN_N_EVENT_TYPES; i++) {
+        latency[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+        handler[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+    }
+
+    n_events = pan_event_trace_get_n_events (trace);
+    for (guint i = 0; i < n_events; i++) {
+        event = pan_event_trace_get_event (trace, i);
+
+        start = g_get_monotonic_time ();
+        pan_canvas_replay_event (PAN_CANVAS (canvas), event);
+        handler_us = g_get_monotonic_time () - start;
+
+        snapshot = gtk_snapshot_new ();
+        GTK_WIDGET_GET_CLASS (canvas)->snapshot (canvas, snapshot);
+        node = gtk_snapshot_free_to_node (snapshot);
+        if (node && renderer) {
+            texture = gsk_renderer_render_texture (renderer, node, &viewport);
+            g_object_unref (texture);
+        }
+        g_clear_pointer (&node, gsk_render_node_unref);
+
+        latency_us = g_get_monotonic_time () - start;
+        g_array_append_val (handler[event->type], handler_us);
+        g_array_append_val (latency[event->type], latency_us);
+    }
+
+    builder = json_builder_new ();
+    json_builder_begin_object (builder);
+    json_builder_set_member_name (builder, "events");
+    json_builder_add_int_value (builder, n_events);
+    json_builder_set_member_name (builder, "renderer");
+    json_builder_add_string_value (builder, renderer ? G_OBJECT_TYPE_NAME (renderer) : "none");
+    json_builder_set_member_name (builder, "types");
+    json_builder_begin_object (builder);
+    for (guint i = 0; i < PAN_N_EVENT_TYPES; i++) {
+        if (latency[i]->len > 0) {
+            json_builder_set_member_name (builder, pan_event_type_to_string (i));
+            json_builder_begin_object (builder);
+            json_builder_set_member_name (builder, "count");
+            json_builder_add_int_value (builder, latency[i]->len);
+            add_distribution (builder, "latency", latency[i]);
+            add_distribution (builder, "handler", handler[i]);
+            json_builder_end_object (builder);
+        }
+        g_array_unref (latency[i]);
+        g_array_unref (handler[i]);
+    }
+    json_builder_end_object (builder);
+    json_builder_end_object (builder);
+
+    gtk_window_destroy (GTK_WINDOW (window));
+    g_object_unref (document);
+
+    root = json_builder_get_root (builder);
+    generator = json_generator_new ();
+    json_generator_set_pretty (generator, TRUE);
+    json_generator_set_root (generator, root);
+    report = json_generator_to_data (generator, NULL);
+
+    if (output) {
+        if (!g_file_set_contents (output, report, -1, &error)) {
+            g_printerr ("%s\n", error->message);
+            return 1;
+        }
+    } else {
+        g_print ("%s\n", report);
+    }
+
+    return 0;
+}
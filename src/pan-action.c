@@ -20,42 +20,424 @@
  */
 
 #include "pan-action.h"
+#include "pan-annot.h"
 
-G_DEFINE_ABSTRACT_TYPE (PanAction, pan_action, G_TYPE_OBJECT);
+struct _PanActionGroup
+{
+    GArray *children;
+};
+
+static void             insert_annot     (GListStore *annots,
+                                          guint       pos,
+                                          guint       x,
+                                          guint       y);
+static void             move_annot       (GListStore *annots,
+                                          guint       pos,
+                                          guint       x,
+                                          guint       y);
+static gint             compare_children (gconstpointer a,
+                                          gconstpointer b);
+static guint            run_end          (const PanAction *self,
+                                          guint            i);
+static void             move_run         (const PanAction *self,
+                                          guint            i,
+                                          guint            end,
+                                          gboolean         undo,
+                                          GListStore      *annots);
+static void             group_undo       (const PanAction *self,
+                                          GListStore      *annots);
+static void             group_redo       (const PanAction *self,
+                                          GListStore      *annots);
+static gboolean         same_moves       (const PanAction *self,
+                                          const PanAction *next);
+
+PanAction
+pan_action_create (guint pos,
+                   guint x,
+                   guint y)
+{
+    return (PanAction) {
+        .kind  = PAN_ACTION_CREATE,
+        .pos   = pos,
+        .new_x = x,
+        .new_y = y,
+        .time  = g_get_monotonic_time (),
+    };
+}
+
+PanAction
+pan_action_move (guint pos,
+                 guint old_x,
+                 guint old_y,
+                 guint new_x,
+                 guint new_y)
+{
+    return (PanAction) {
+        .kind  = PAN_ACTION_MOVE,
+        .pos   = pos,
+        .old_x = old_x,
+        .old_y = old_y,
+        .new_x = new_x,
+        .new_y = new_y,
+        .time  = g_get_monotonic_time (),
+    };
+}
+
+PanAction
+pan_action_delete (guint pos,
+                   guint x,
+                   guint y)
+{
+    return (PanAction) {
+        .kind  = PAN_ACTION_DELETE,
+        .pos   = pos,
+        .old_x = x,
+        .old_y = y,
+        .time  = g_get_monotonic_time (),
+    };
+}
 
 static void
-pan_action_class_init (PanActionClass *klass)
+insert_annot (GListStore *annots,
+              guint       pos,
+              guint       x,
+              guint       y)
 {
-    klass->undo = NULL;
-    klass->redo = NULL;
+    PanAnnot *annot;
+
+    annot = pan_annot_new (x, y);
+    g_list_store_insert (annots, pos, annot);
+    g_object_unref (annot);
 }
 
 static void
-pan_action_init (PanAction *self)
+move_annot (GListStore *annots,
+            guint       pos,
+            guint       x,
+            guint       y)
+{
+    PanAnnot *annot;
+
+    annot = g_list_model_get_item (G_LIST_MODEL (annots), pos);
+    g_return_if_fail (annot != NULL);
+
+    pan_annot_update (annot, x, y);
+    g_object_unref (annot);
+}
+
+static gint
+compare_children (gconstpointer a,
+                  gconstpointer b)
+{
+    const PanAction *action_a = a;
+    const PanAction *action_b = b;
+
+    if (action_a->pos != action_b->pos)
+        return action_a->pos < action_b->pos ? -1 : 1;
+
+    return (gint) action_a->kind - (gint) action_b->kind;
+}
+
+/* The end of the run of children from i on with one kind and consecutive positions. */
+static guint
+run_end (const PanAction *self,
+         guint            i)
+{
+    guint end = i + 1;
+
+    while (end < self->pos &&
+           self->children[end].kind == self->children[i].kind &&
+           self->children[end].pos == self->children[end - 1].pos + 1)
+        end++;
+
+    return end;
+}
+
+/*
+ * Moves the annotations of children i to end without a notification each,
+ * then puts the same objects back over the run, so that views see a single
+ * items-changed.  Selections keep them, as the objects stay the same.
+ */
+static void
+move_run (const PanAction *self,
+          guint            i,
+          guint            end,
+          gboolean         undo,
+          GListStore      *annots)
+{
+    const PanAction *child;
+    GPtrArray *items;
+    guint first = self->children[i].pos;
+
+    items = g_ptr_array_new_full (end - i, g_object_unref);
+    for (guint j = i; j < end; j++) {
+        child = &self->children[j];
+        g_ptr_array_add (items, g_list_model_get_item (G_LIST_MODEL (annots), child->pos));
+        pan_annot_set_pos (g_ptr_array_index (items, j - i),
+                           undo ? child->old_x : child->new_x,
+                           undo ? child->old_y : child->new_y);
+    }
+    g_list_store_splice (annots, first, items->len, items->pdata, items->len);
+    g_ptr_array_unref (items);
+}
+
+/*
+ * Deleted annotations are put back with one splice per run of consecutive
+ * positions, lowest first so that each run lands where it was.  The work
+ * is proportional to the children, not to the span they cover.
+ */
+static void
+group_undo (const PanAction *self,
+            GListStore      *annots)
+{
+    const PanAction *child;
+    GPtrArray *items;
+    guint end;
+
+    for (guint i = 0; i < self->pos; i = end) {
+        end = run_end (self, i);
+        if (self->children[i].kind != PAN_ACTION_DELETE)
+            continue;
+
+        items = g_ptr_array_new_full (end - i, g_object_unref);
+        for (guint j = i; j < end; j++) {
+            child = &self->children[j];
+            g_ptr_array_add (items, pan_annot_new (child->old_x, child->old_y));
+        }
+        g_list_store_splice (annots, self->children[i].pos, 0, items->pdata, items->len);
+        g_ptr_array_unref (items);
+    }
+
+    for (guint i = 0; i < self->pos; i = end) {
+        end = run_end (self, i);
+        if (self->children[i].kind == PAN_ACTION_MOVE)
+            move_run (self, i, end, TRUE, annots);
+    }
+}
+
+/* Runs of deletions are removed highest first, so the lower positions hold. */
+static void
+group_redo (const PanAction *self,
+            GListStore      *annots)
+{
+    g_autoptr (GArray) runs = NULL;
+    guint end, first;
+
+    runs = g_array_new (FALSE, FALSE, sizeof (guint));
+    for (guint i = 0; i < self->pos; i = end) {
+        end = run_end (self, i);
+        if (self->children[i].kind == PAN_ACTION_MOVE)
+            move_run (self, i, end, FALSE, annots);
+        else
+            g_array_append_vals (runs, (guint[]) { i, end }, 2);
+    }
+
+    for (guint r = runs->len; r > 0; r -= 2) {
+        first = g_array_index (runs, guint, r - 2);
+        end   = g_array_index (runs, guint, r - 1);
+        g_list_store_splice (annots, self->children[first].pos, end - first, NULL, 0);
+    }
+}
+
+void
+pan_action_undo (const PanAction *self,
+                 GListStore      *annots)
 {
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (G_IS_LIST_STORE (annots));
+
+    switch ((PanActionKind) self->kind) {
+    case PAN_ACTION_CREATE:
+        g_list_store_remove (annots, self->pos);
+        break;
+    case PAN_ACTION_MOVE:
+        move_annot (annots, self->pos, self->old_x, self->old_y);
+        break;
+    case PAN_ACTION_DELETE:
+        insert_annot (annots, self->pos, self->old_x, self->old_y);
+        break;
+    case PAN_ACTION_GROUP:
+        group_undo (self, annots);
+        break;
+    default:
+        g_assert_not_reached ();
+    }
 }
 
 void
-pan_action_undo (PanAction *self)
+pan_action_redo (const PanAction *self,
+                 GListStore      *annots)
 {
-    PanActionClass *klass;
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (G_IS_LIST_STORE (annots));
 
-    g_return_if_fail (PAN_IS_ACTION (self));
+    switch ((PanActionKind) self->kind) {
+    case PAN_ACTION_CREATE:
+        insert_annot (annots, self->pos, self->new_x, self->new_y);
+        break;
+    case PAN_ACTION_MOVE:
+        move_annot (annots, self->pos, self->new_x, self->new_y);
+        break;
+    case PAN_ACTION_DELETE:
+        g_list_store_remove (annots, self->pos);
+        break;
+    case PAN_ACTION_GROUP:
+        group_redo (self, annots);
+        break;
+    default:
+        g_assert_not_reached ();
+    }
+}
 
-    klass = PAN_ACTION_GET_CLASS (self);
-    if (klass->undo)
-        klass->undo (self);
+/* Whether both groups only move, and move the same annotations. */
+static gboolean
+same_moves (const PanAction *self,
+            const PanAction *next)
+{
+    if (self->pos != next->pos)
+        return FALSE;
+
+    for (guint i = 0; i < self->pos; i++) {
+        if (self->children[i].kind != PAN_ACTION_MOVE ||
+            next->children[i].kind != PAN_ACTION_MOVE ||
+            self->children[i].pos != next->children[i].pos)
+            return FALSE;
+    }
+
+    return TRUE;
 }
 
+/**
+ * pan_action_merge:
+ * @self: the most recent action in the history
+ * @next: the action about to be pushed after it
+ *
+ * Folds @next into @self when both move the same annotation, or are
+ * groups moving the same annotations, so that they are undone in one
+ * step.  On success @self takes over the timestamp of @next; the children
+ * of @next are left to the caller.
+ *
+ * Returns: %TRUE if @next was merged and can be dropped
+ */
+gboolean
+pan_action_merge (PanAction       *self,
+                  const PanAction *next)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (next != NULL, FALSE);
+
+    if (self->kind == PAN_ACTION_GROUP && next->kind == PAN_ACTION_GROUP) {
+        if (!same_moves (self, next))
+            return FALSE;
+
+        for (guint i = 0; i < self->pos; i++) {
+            self->children[i].new_x = next->children[i].new_x;
+            self->children[i].new_y = next->children[i].new_y;
+        }
+        self->time = next->time;
+
+        return TRUE;
+    }
+
+    if (self->kind != PAN_ACTION_MOVE || next->kind != PAN_ACTION_MOVE ||
+        self->pos != next->pos)
+        return FALSE;
+
+    self->new_x = next->new_x;
+    self->new_y = next->new_y;
+    self->time  = next->time;
+
+    return TRUE;
+}
+
+gsize
+pan_action_get_size (const PanAction *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    if (self->kind == PAN_ACTION_GROUP)
+        return sizeof (PanAction) * (self->pos + 1);
+
+    return sizeof (PanAction);
+}
+
+/**
+ * pan_action_clear:
+ *
+ * Frees what @self owns beyond its own 32 bytes, that is the children of
+ * a group.
+ */
 void
-pan_action_redo (PanAction *self)
+pan_action_clear (PanAction *self)
 {
-    PanActionClass *klass;
+    g_return_if_fail (self != NULL);
 
-    g_return_if_fail (PAN_IS_ACTION (self));
+    if (self->kind != PAN_ACTION_GROUP)
+        return;
 
-    klass = PAN_ACTION_GET_CLASS (self);
-    if (klass->redo)
-        klass->redo (self);
+    g_clear_pointer (&self->children, g_free);
+    self->pos = 0;
 }
 
+PanActionGroup *
+pan_action_group_new (void)
+{
+    PanActionGroup *group;
+
+    group = g_new0 (PanActionGroup, 1);
+    group->children = g_array_new (FALSE, FALSE, sizeof (PanAction));
+
+    return group;
+}
+
+/**
+ * pan_action_group_add:
+ * @self: a #PanActionGroup
+ * @action: a move or delete, with positions in the store before the group
+ *
+ * Adds @action to the group.  Each annotation may appear at most once.
+ */
+void
+pan_action_group_add (PanActionGroup  *self,
+                      const PanAction *action)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (action->kind == PAN_ACTION_MOVE || action->kind == PAN_ACTION_DELETE);
+
+    g_array_append_val (self->children, *action);
+}
+
+/**
+ * pan_action_group_end:
+ * @self: (transfer full): a #PanActionGroup
+ *
+ * Turns the collected actions into a single group action and frees @self.
+ * The group is not applied; call pan_action_redo() to do so.
+ *
+ * Returns: a %PAN_ACTION_GROUP action owning the children
+ */
+PanAction
+pan_action_group_end (PanActionGroup *self)
+{
+    PanAction action = {
+        .kind = PAN_ACTION_GROUP,
+        .time = g_get_monotonic_time (),
+    };
+    g_array_sort (self->children, compare_children);
+    action.pos = self->children->len;
+    action.children = (PanAction *) g_array_free (self->children, FALSE);
+
+    g_free (self);
+
+    return action;
+}
+
+void
+pan_action_group_free (PanActionGroup *self)
+{
+    if (!self)
+        return;
+
+    g_array_unref (self->children);
+    g_free (self);
+}
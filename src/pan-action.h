@@ -21,23 +21,69 @@
 
 #pragma once
 
-#include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
-#define PAN_TYPE_ACTION pan_action_get_type ()
-G_DECLARE_DERIVABLE_TYPE (PanAction, pan_action, PAN, ACTION, GObject)
-
-struct _PanActionClass
+typedef enum
 {
-    GObjectClass parent_class;
+    PAN_ACTION_CREATE,
+    PAN_ACTION_MOVE,
+    PAN_ACTION_DELETE,
+    PAN_ACTION_GROUP
+} PanActionKind;
+
+typedef struct _PanAction      PanAction;
+typedef struct _PanActionGroup PanActionGroup;
 
-    void (*undo) (PanAction *self);
-    void (*redo) (PanAction *self);
+/*
+ * A single edit of a record's annotation store, packed into 32 bytes.
+ * Annotations are addressed by their position in the store, which stays
+ * valid because actions are always undone and redone in order.
+ *
+ * A group holds pos moves and deletions in children, sorted by position.
+ * All positions refer to the store before the group is applied.
+ */
+struct _PanAction
+{
+    guint32 kind;
+    guint32 pos;
+    union {
+        struct {
+            guint32 old_x, old_y;
+            guint32 new_x, new_y;
+        };
+        PanAction *children;
+    };
+    gint64  time;
 };
 
-void pan_action_undo (PanAction *self);
-void pan_action_redo (PanAction *self);
+PanActionGroup *pan_action_group_new  (void);
+void            pan_action_group_add  (PanActionGroup  *self,
+                                       const PanAction *action);
+PanAction       pan_action_group_end  (PanActionGroup  *self);
+void            pan_action_group_free (PanActionGroup  *self);
 
-G_END_DECLS
+PanAction pan_action_create   (guint pos,
+                               guint x,
+                               guint y);
+PanAction pan_action_move     (guint pos,
+                               guint old_x,
+                               guint old_y,
+                               guint new_x,
+                               guint new_y);
+PanAction pan_action_delete   (guint pos,
+                               guint x,
+                               guint y);
+void      pan_action_undo     (const PanAction *self,
+                               GListStore      *annots);
+void      pan_action_redo     (const PanAction *self,
+                               GListStore      *annots);
+gboolean  pan_action_merge    (PanAction       *self,
+                               const PanAction *next);
+gsize     pan_action_get_size (const PanAction *self);
+void      pan_action_clear    (PanAction       *self);
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanActionGroup, pan_action_group_free)
+
+G_END_DECLS
@@ -0,0 +1,712 @@
+/*
+ * pan-agreement.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Compares the points two annotators placed on the same images.  Records
+ * are paired by filename, and within an image every test point is matched
+ * to at most one reference point no further than the threshold.
+ *
+ * Candidate pairs are found with a PanCellGrid over the reference points.
+ * They are then taken closest first, each point being used once.  This
+ * greedy assignment is not always the optimal one, but it only differs
+ * from it when several points compete within the threshold, and it stays
+ * O(n log n) where the Hungarian method is cubic.  Images are matched in
+ * parallel.
+ */
+
+#include <math.h>
+#include <json-glib/json-glib.h>
+#include "pan-agreement.h"
+#include "pan-cell-grid.h"
+#include "pan-parallel.h"
+
+/* The images with the most disagreement listed by pan_agreement_to_string(). */
+#define MAX_WORST 10
+
+struct _PanAgreement
+{
+    GPtrArray *filenames;
+    GArray *counts;
+    guint distance;
+};
+
+typedef struct
+{
+    guint64 d2;
+    guint32 test;
+    guint32 reference;
+} Candidate;
+
+typedef struct
+{
+    GArray *candidates;
+    guint32 test;
+} Gather;
+
+typedef struct
+{
+    GArray *reference;
+    GArray *test;
+    PanAgreementCounts counts;
+} Job;
+
+/* The filenames and the points of every record of a document. */
+typedef struct
+{
+    GPtrArray *names;
+    GPtrArray *points;
+} Snapshot;
+
+typedef struct
+{
+    gchar *path;
+    Snapshot *test;
+    guint distance;
+} CompareFile;
+
+typedef struct
+{
+    PanDocument *reference;
+    PanAgreement *agreement;
+} Compared;
+
+static gint     compare_candidates (gconstpointer  a,
+                                    gconstpointer  b);
+static void     add_candidate      (guint32        position,
+                                    guint64        d2,
+                                    gpointer       user_data);
+static Snapshot *snapshot_new      (PanDocument   *document);
+static void     snapshot_free      (Snapshot      *snapshot);
+static GArray  *snapshot_points    (Snapshot      *snapshot,
+                                    guint          position);
+static PanAgreement *compare_snapshots (Snapshot *reference,
+                                        Snapshot *test,
+                                        guint     distance);
+static void     compare_file_free  (CompareFile   *data);
+static void     compared_free      (Compared      *compared);
+static void     compare_file_thread (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable);
+static gpointer match_job          (gpointer       item,
+                                    gpointer       user_data,
+                                    GError       **error);
+static void     job_free           (Job           *job);
+static guint64  n_unmatched        (const PanAgreementCounts *counts);
+static gint     compare_worst      (gconstpointer  a,
+                                    gconstpointer  b,
+                                    gpointer       user_data);
+static void     add_counts         (JsonBuilder              *builder,
+                                    const PanAgreementCounts *counts);
+
+/* Ties are broken by position, so the result does not depend on the sort. */
+static gint
+compare_candidates (gconstpointer a,
+                    gconstpointer b)
+{
+    const Candidate *candidate_a = a;
+    const Candidate *candidate_b = b;
+
+    if (candidate_a->d2 != candidate_b->d2)
+        return candidate_a->d2 < candidate_b->d2 ? -1 : 1;
+    if (candidate_a->test != candidate_b->test)
+        return candidate_a->test < candidate_b->test ? -1 : 1;
+
+    return candidate_a->reference < candidate_b->reference ? -1 : candidate_a->reference > candidate_b->reference;
+}
+
+static void
+add_candidate (guint32  position,
+               guint64  d2,
+               gpointer user_data)
+{
+    Gather *gather = user_data;
+    Candidate found;
+
+    found.d2        = d2;
+    found.test      = gather->test;
+    found.reference = position;
+    g_array_append_val (gather->candidates, found);
+}
+
+/**
+ * pan_agreement_match:
+ * @reference: (array): x, y pairs of the reference points
+ * @test: (array): x, y pairs of the test points
+ * @distance: the largest distance in pixels at which points match
+ * @test_match: (out caller-allocates) (array length=n_test): for each test
+ *   point, the reference point it matched or %G_MAXUINT32
+ * @error_sum: (out) (optional): the summed distance of the matched pairs
+ *
+ * Matches the test points of one image to its reference points.
+ *
+ * Returns: the number of matched pairs
+ */
+guint
+pan_agreement_match (const guint32 *reference,
+                     guint          n_reference,
+                     const guint32 *test,
+                     guint          n_test,
+                     guint          distance,
+                     guint32       *test_match,
+                     gdouble       *error_sum)
+{
+    g_autoptr (PanCellGrid) grid = NULL;
+    g_autoptr (GArray) candidates = NULL;
+    g_autofree gboolean *taken = NULL;
+    const Candidate *candidate;
+    Gather gather;
+    gdouble sum = 0.0;
+    guint n_matched = 0;
+
+    for (guint i = 0; i < n_test; i++)
+        test_match[i] = G_MAXUINT32;
+    if (error_sum)
+        *error_sum = 0.0;
+    if (n_reference == 0 || n_test == 0)
+        return 0;
+
+    grid       = pan_cell_grid_new (reference, n_reference, distance);
+    candidates = g_array_new (FALSE, FALSE, sizeof (Candidate));
+    gather.candidates = candidates;
+    for (guint i = 0; i < n_test; i++) {
+        gather.test = i;
+        pan_cell_grid_foreach_near (grid, test[2 * i], test[2 * i + 1], add_candidate, &gather);
+    }
+    g_array_sort (candidates, compare_candidates);
+
+    taken = g_new0 (gboolean, n_reference);
+    for (guint i = 0; i < candidates->len; i++) {
+        candidate = &g_array_index (candidates, Candidate, i);
+        if (test_match[candidate->test] != G_MAXUINT32 || taken[candidate->reference])
+            continue;
+
+        test_match[candidate->test] = candidate->reference;
+        taken[candidate->reference] = TRUE;
+        sum += sqrt ((gdouble) candidate->d2);
+        n_matched++;
+    }
+
+    if (error_sum)
+        *error_sum = sum;
+
+    return n_matched;
+}
+
+/* Copies what is compared, so that the document is not needed afterwards. */
+static Snapshot *
+snapshot_new (PanDocument *document)
+{
+    PanRecordList *records;
+    Snapshot *snapshot;
+    GArray *points;
+    guint n_records;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    snapshot  = g_new0 (Snapshot, 1);
+    snapshot->names  = g_ptr_array_new_full (n_records, g_free);
+    snapshot->points = g_ptr_array_new_full (n_records, (GDestroyNotify) g_array_unref);
+    for (guint i = 0; i < n_records; i++) {
+        points = g_array_new (FALSE, FALSE, sizeof (guint32));
+        pan_record_list_copy_points (records, i, points);
+        g_ptr_array_add (snapshot->names, g_strdup (pan_record_list_get_filename (records, i)));
+        g_ptr_array_add (snapshot->points, points);
+    }
+
+    return snapshot;
+}
+
+static void
+snapshot_free (Snapshot *snapshot)
+{
+    g_ptr_array_unref (snapshot->names);
+    g_ptr_array_unref (snapshot->points);
+    g_free (snapshot);
+}
+
+/* Images missing from the other document give an empty array. */
+static GArray *
+snapshot_points (Snapshot *snapshot,
+                 guint     position)
+{
+    if (position == G_MAXUINT)
+        return g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    return g_array_ref (g_ptr_array_index (snapshot->points, position));
+}
+
+static gpointer
+match_job (gpointer   item,
+           gpointer   user_data,
+           GError   **error)
+{
+    Job *job = item;
+    g_autofree guint32 *test_match = NULL;
+    guint n_reference = job->reference->len / 2;
+    guint n_test = job->test->len / 2;
+
+    test_match = g_new (guint32, MAX (n_test, 1));
+    job->counts.n_reference = n_reference;
+    job->counts.n_test      = n_test;
+    job->counts.n_matched   = pan_agreement_match ((const guint32 *) job->reference->data, n_reference,
+                                                   (const guint32 *) job->test->data, n_test,
+                                                   GPOINTER_TO_UINT (user_data),
+                                                   test_match, &job->counts.error_sum);
+
+    return job;
+}
+
+static void
+job_free (Job *job)
+{
+    g_array_unref (job->reference);
+    g_array_unref (job->test);
+    g_free (job);
+}
+
+static PanAgreement *
+compare_snapshots (Snapshot *reference,
+                   Snapshot *test,
+                   guint     distance)
+{
+    g_autoptr (GHashTable) names = NULL;
+    g_autoptr (GPtrArray) jobs = NULL;
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    g_autofree gboolean *paired = NULL;
+    PanAgreement *self;
+    const gchar *name;
+    gpointer value;
+    guint n_reference, n_test, position;
+    Job *job;
+
+    n_reference = reference->names->len;
+    n_test      = test->names->len;
+
+    names = g_hash_table_new (g_str_hash, g_str_equal);
+    for (guint i = 0; i < n_reference; i++)
+        g_hash_table_insert (names, g_ptr_array_index (reference->names, i), GUINT_TO_POINTER (i));
+
+    self = g_new0 (PanAgreement, 1);
+    self->filenames = g_ptr_array_new_with_free_func (g_free);
+    self->distance  = distance;
+    jobs   = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+    paired = g_new0 (gboolean, MAX (n_reference, 1));
+
+    for (guint i = 0; i < n_test; i++) {
+        name = g_ptr_array_index (test->names, i);
+        position = G_MAXUINT;
+        if (g_hash_table_lookup_extended (names, name, NULL, &value)) {
+            position = GPOINTER_TO_UINT (value);
+            paired[position] = TRUE;
+        }
+
+        job = g_new0 (Job, 1);
+        job->reference = snapshot_points (reference, position);
+        job->test      = snapshot_points (test, i);
+        g_ptr_array_add (jobs, job);
+        g_ptr_array_add (self->filenames, g_strdup (name));
+    }
+
+    for (guint i = 0; i < n_reference; i++) {
+        if (paired[i])
+            continue;
+
+        job = g_new0 (Job, 1);
+        job->reference = snapshot_points (reference, i);
+        job->test      = snapshot_points (test, G_MAXUINT);
+        g_ptr_array_add (jobs, job);
+        g_ptr_array_add (self->filenames, g_strdup (g_ptr_array_index (reference->names, i)));
+    }
+
+    self->counts = g_array_sized_new (FALSE, TRUE, sizeof (PanAgreementCounts), jobs->len);
+    if (jobs->len == 0)
+        return self;
+
+    results = g_new0 (gpointer, jobs->len);
+    errors  = g_new0 (GError *, jobs->len);
+    pan_parallel_map (jobs->pdata, jobs->len, match_job, GUINT_TO_POINTER (distance), results, errors);
+
+    for (guint i = 0; i < jobs->len; i++) {
+        job = g_ptr_array_index (jobs, i);
+        g_array_append_val (self->counts, job->counts);
+    }
+
+    return self;
+}
+
+/**
+ * pan_agreement_compare:
+ * @reference: the document taken as ground truth
+ * @test: the document scored against it
+ * @distance: the largest distance in pixels at which points match
+ *
+ * Pairs the images of the two documents by filename and matches their
+ * points.  Images of @test come first, in order, followed by those only
+ * in @reference.  An image missing from one side counts all its points as
+ * unmatched.
+ *
+ * Returns: (transfer full): the counts of every image
+ */
+PanAgreement *
+pan_agreement_compare (PanDocument *reference,
+                       PanDocument *test,
+                       guint        distance)
+{
+    Snapshot *reference_snapshot, *test_snapshot;
+    PanAgreement *self;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (reference), NULL);
+    g_return_val_if_fail (PAN_IS_DOCUMENT (test), NULL);
+
+    reference_snapshot = snapshot_new (reference);
+    test_snapshot      = snapshot_new (test);
+    self = compare_snapshots (reference_snapshot, test_snapshot, distance);
+    snapshot_free (reference_snapshot);
+    snapshot_free (test_snapshot);
+
+    return self;
+}
+
+static void
+compare_file_free (CompareFile *data)
+{
+    g_free (data->path);
+    snapshot_free (data->test);
+    g_free (data);
+}
+
+static void
+compared_free (Compared *compared)
+{
+    g_clear_object (&compared->reference);
+    g_clear_pointer (&compared->agreement, pan_agreement_free);
+    g_free (compared);
+}
+
+/* The reference is only seen by this thread until the task returns it. */
+static void
+compare_file_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+    CompareFile *data = task_data;
+    Snapshot *reference_snapshot;
+    Compared *compared;
+    GError *error = NULL;
+
+    compared = g_new0 (Compared, 1);
+    compared->reference = pan_document_load_file (data->path, &error);
+    if (!compared->reference) {
+        compared_free (compared);
+        g_task_return_error (task, error);
+        return;
+    }
+
+    reference_snapshot  = snapshot_new (compared->reference);
+    compared->agreement = compare_snapshots (reference_snapshot, data->test, data->distance);
+    snapshot_free (reference_snapshot);
+
+    g_task_return_pointer (task, compared, (GDestroyNotify) compared_free);
+}
+
+/**
+ * pan_agreement_compare_file_async:
+ * @path: the document taken as ground truth
+ * @test: the document scored against it
+ *
+ * Loads @path and compares it with @test as pan_agreement_compare() does,
+ * on a thread.  The points of @test are copied before this returns, so
+ * edits made meanwhile are not seen.
+ */
+void
+pan_agreement_compare_file_async (const gchar         *path,
+                                  PanDocument         *test,
+                                  guint                distance,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+    CompareFile *data;
+
+    g_return_if_fail (path != NULL);
+    g_return_if_fail (PAN_IS_DOCUMENT (test));
+
+    data = g_new0 (CompareFile, 1);
+    data->path     = g_strdup (path);
+    data->test     = snapshot_new (test);
+    data->distance = distance;
+
+    task = g_task_new (test, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_agreement_compare_file_async);
+    g_task_set_task_data (task, data, (GDestroyNotify) compare_file_free);
+    g_task_run_in_thread (task, compare_file_thread);
+}
+
+/**
+ * pan_agreement_compare_file_finish:
+ * @reference: (out) (transfer full): the loaded reference document
+ *
+ * Returns: (transfer full) (nullable): the counts of every image, or
+ *   %NULL with @error set if the reference could not be loaded
+ */
+PanAgreement *
+pan_agreement_compare_file_finish (PanDocument   *test,
+                                   GAsyncResult  *result,
+                                   PanDocument  **reference,
+                                   GError       **error)
+{
+    Compared *compared;
+    PanAgreement *self;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (test), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, test), NULL);
+    g_return_val_if_fail (reference != NULL, NULL);
+
+    compared = g_task_propagate_pointer (G_TASK (result), error);
+    if (!compared)
+        return NULL;
+
+    *reference = g_steal_pointer (&compared->reference);
+    self       = g_steal_pointer (&compared->agreement);
+    compared_free (compared);
+
+    return self;
+}
+
+void
+pan_agreement_free (PanAgreement *self)
+{
+    g_return_if_fail (self != NULL);
+
+    g_ptr_array_unref (self->filenames);
+    g_array_unref (self->counts);
+    g_free (self);
+}
+
+guint
+pan_agreement_get_n_images (PanAgreement *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->counts->len;
+}
+
+/* The threshold @self was computed with. */
+guint
+pan_agreement_get_distance (PanAgreement *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->distance;
+}
+
+const gchar *
+pan_agreement_get_filename (PanAgreement *self,
+                            guint         position)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (position < self->filenames->len, NULL);
+
+    return g_ptr_array_index (self->filenames, position);
+}
+
+const PanAgreementCounts *
+pan_agreement_get_counts (PanAgreement *self,
+                          guint         position)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (position < self->counts->len, NULL);
+
+    return &g_array_index (self->counts, PanAgreementCounts, position);
+}
+
+void
+pan_agreement_get_totals (PanAgreement       *self,
+                          PanAgreementCounts *totals)
+{
+    const PanAgreementCounts *counts;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (totals != NULL);
+
+    *totals = (PanAgreementCounts) { 0 };
+    for (guint i = 0; i < self->counts->len; i++) {
+        counts = &g_array_index (self->counts, PanAgreementCounts, i);
+        totals->n_reference += counts->n_reference;
+        totals->n_test      += counts->n_test;
+        totals->n_matched   += counts->n_matched;
+        totals->error_sum   += counts->error_sum;
+    }
+}
+
+static guint64
+n_unmatched (const PanAgreementCounts *counts)
+{
+    return counts->n_reference + counts->n_test - 2 * counts->n_matched;
+}
+
+static gint
+compare_worst (gconstpointer a,
+               gconstpointer b,
+               gpointer      user_data)
+{
+    PanAgreement *self = user_data;
+    guint64 unmatched_a = n_unmatched (pan_agreement_get_counts (self, *(const guint *) a));
+    guint64 unmatched_b = n_unmatched (pan_agreement_get_counts (self, *(const guint *) b));
+
+    if (unmatched_a != unmatched_b)
+        return unmatched_a > unmatched_b ? -1 : 1;
+
+    return *(const guint *) a < *(const guint *) b ? -1 : 1;
+}
+
+static void
+add_counts (JsonBuilder              *builder,
+            const PanAgreementCounts *counts)
+{
+    json_builder_set_member_name (builder, "reference");
+    json_builder_add_int_value (builder, counts->n_reference);
+    json_builder_set_member_name (builder, "test");
+    json_builder_add_int_value (builder, counts->n_test);
+    json_builder_set_member_name (builder, "matched");
+    json_builder_add_int_value (builder, counts->n_matched);
+    json_builder_set_member_name (builder, "precision");
+    json_builder_add_double_value (builder, counts->n_test ? (gdouble) counts->n_matched / counts->n_test : 1.0);
+    json_builder_set_member_name (builder, "recall");
+    json_builder_add_double_value (builder, counts->n_reference ? (gdouble) counts->n_matched / counts->n_reference : 1.0);
+    json_builder_set_member_name (builder, "mean_error");
+    json_builder_add_double_value (builder, counts->n_matched ? counts->error_sum / counts->n_matched : 0.0);
+}
+
+/**
+ * pan_agreement_to_json:
+ * @reference: (nullable): the path reported as "reference"
+ * @test: (nullable): the path reported as "document"
+ *
+ * Returns: (transfer full): the totals followed by one entry per image
+ */
+gchar *
+pan_agreement_to_json (PanAgreement *self,
+                       const gchar  *reference,
+                       const gchar  *test)
+{
+    g_autoptr (JsonBuilder) builder = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    PanAgreementCounts totals;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    pan_agreement_get_totals (self, &totals);
+
+    builder = json_builder_new ();
+    json_builder_begin_object (builder);
+    if (test) {
+        json_builder_set_member_name (builder, "document");
+        json_builder_add_string_value (builder, test);
+    }
+    if (reference) {
+        json_builder_set_member_name (builder, "reference");
+        json_builder_add_string_value (builder, reference);
+    }
+    json_builder_set_member_name (builder, "distance");
+    json_builder_add_int_value (builder, self->distance);
+    json_builder_set_member_name (builder, "images");
+    json_builder_add_int_value (builder, self->counts->len);
+    add_counts (builder, &totals);
+
+    json_builder_set_member_name (builder, "per_image");
+    json_builder_begin_array (builder);
+    for (guint i = 0; i < self->counts->len; i++) {
+        json_builder_begin_object (builder);
+        json_builder_set_member_name (builder, "filename");
+        json_builder_add_string_value (builder, pan_agreement_get_filename (self, i));
+        add_counts (builder, pan_agreement_get_counts (self, i));
+        json_builder_end_object (builder);
+    }
+    json_builder_end_array (builder);
+    json_builder_end_object (builder);
+
+    root = json_builder_get_root (builder);
+    generator = json_generator_new ();
+    json_generator_set_root (generator, root);
+
+    return json_generator_to_data (generator, NULL);
+}
+
+/**
+ * pan_agreement_to_string:
+ *
+ * Returns: (transfer full): the totals and the images with the most
+ *   unmatched points, for a monospace font
+ */
+gchar *
+pan_agreement_to_string (PanAgreement *self)
+{
+    g_autofree guint *order = NULL;
+    const PanAgreementCounts *counts;
+    PanAgreementCounts totals;
+    GString *string;
+    gdouble precision, recall;
+    guint n;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    pan_agreement_get_totals (self, &totals);
+    precision = totals.n_test ? (gdouble) totals.n_matched / totals.n_test : 1.0;
+    recall    = totals.n_reference ? (gdouble) totals.n_matched / totals.n_reference : 1.0;
+
+    string = g_string_new (NULL);
+    g_string_append_printf (string, "%-12s %u\n", "Images", self->counts->len);
+    g_string_append_printf (string, "%-12s %" G_GUINT64_FORMAT "\n", "Reference", totals.n_reference);
+    g_string_append_printf (string, "%-12s %" G_GUINT64_FORMAT "\n", "Test", totals.n_test);
+    g_string_append_printf (string, "%-12s %" G_GUINT64_FORMAT " within %u px\n", "Matched",
+                            totals.n_matched, self->distance);
+    g_string_append_printf (string, "%-12s %.3f\n", "Precision", precision);
+    g_string_append_printf (string, "%-12s %.3f\n", "Recall", recall);
+    g_string_append_printf (string, "%-12s %.3f\n", "F1",
+                            precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0);
+    g_string_append_printf (string, "%-12s %.2f px\n", "Mean error",
+                            totals.n_matched ? totals.error_sum / totals.n_matched : 0.0);
+
+    order = g_new (guint, MAX (self->counts->len, 1));
+    for (guint i = 0; i < self->counts->len; i++)
+        order[i] = i;
+    g_qsort_with_data (order, self->counts->len, sizeof (guint), compare_worst, self);
+
+    n = MIN (self->counts->len, MAX_WORST);
+    for (guint i = 0; i < n; i++) {
+        counts = pan_agreement_get_counts (self, order[i]);
+        if (n_unmatched (counts) == 0)
+            break;
+        if (i == 0)
+            g_string_append_printf (string, "\n%-32s %6s %6s %6s\n", "Most unmatched", "Ref", "Test", "Match");
+        g_string_append_printf (string, "%-32.32s %6" G_GUINT64_FORMAT " %6" G_GUINT64_FORMAT " %6" G_GUINT64_FORMAT "\n",
+                                pan_agreement_get_filename (self, order[i]),
+                                counts->n_reference, counts->n_test, counts->n_matched);
+    }
+
+    return g_string_free (string, FALSE);
+}
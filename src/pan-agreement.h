@@ -0,0 +1,79 @@
+/*
+ * pan-agreement.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include "pan-document.h"
+
+G_BEGIN_DECLS
+
+/*
+ * How the points of one image in two documents agree.  error_sum is the
+ * summed distance between matched points, in pixels.
+ */
+typedef struct
+{
+    guint64 n_reference;
+    guint64 n_test;
+    guint64 n_matched;
+    gdouble error_sum;
+} PanAgreementCounts;
+
+typedef struct _PanAgreement PanAgreement;
+
+guint                     pan_agreement_match        (const guint32      *reference,
+                                                      guint               n_reference,
+                                                      const guint32      *test,
+                                                      guint               n_test,
+                                                      guint               distance,
+                                                      guint32            *test_match,
+                                                      gdouble            *error_sum);
+PanAgreement             *pan_agreement_compare      (PanDocument        *reference,
+                                                      PanDocument        *test,
+                                                      guint               distance);
+void                      pan_agreement_compare_file_async  (const gchar         *path,
+                                                             PanDocument         *test,
+                                                             guint                distance,
+                                                             GCancellable        *cancellable,
+                                                             GAsyncReadyCallback  callback,
+                                                             gpointer             user_data);
+PanAgreement             *pan_agreement_compare_file_finish (PanDocument   *test,
+                                                             GAsyncResult  *result,
+                                                             PanDocument  **reference,
+                                                             GError       **error);
+void                      pan_agreement_free         (PanAgreement       *self);
+guint                     pan_agreement_get_n_images (PanAgreement       *self);
+guint                     pan_agreement_get_distance (PanAgreement       *self);
+const gchar              *pan_agreement_get_filename (PanAgreement       *self,
+                                                      guint               position);
+const PanAgreementCounts *pan_agreement_get_counts   (PanAgreement       *self,
+                                                      guint               position);
+void                      pan_agreement_get_totals   (PanAgreement       *self,
+                                                      PanAgreementCounts *totals);
+gchar                    *pan_agreement_to_json      (PanAgreement       *self,
+                                                      const gchar        *reference,
+                                                      const gchar        *test);
+gchar                    *pan_agreement_to_string    (PanAgreement       *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanAgreement, pan_agreement_free)
+
+G_END_DECLS
@@ -152,6 +152,19 @@ pan_annot_update (PanAnnot *self, guint x, guint y)
     g_object_notify_by_pspec (G_OBJECT (self), pan_annot_properties[PROP_Y]);
 }
 
+/*
+ * Like pan_annot_update(), without notifying.  For bulk edits that signal
+ * the change through the store instead.
+ */
+void
+pan_annot_set_pos (PanAnnot *self, guint x, guint y)
+{
+    g_return_if_fail (PAN_IS_ANNOT (self));
+
+    self->x = x;
+    self->y = y;
+}
+
 void
 pan_annot_translate (PanAnnot *self, guint dx, guint dy)
 {
@@ -33,6 +33,9 @@ PanAnnot *pan_annot_new       (guint x,
 void      pan_annot_update    (PanAnnot *self,
                                guint     x,
                                guint     y);
+void      pan_annot_set_pos   (PanAnnot *self,
+                               guint     x,
+                               guint     y);
 void      pan_annot_translate (PanAnnot *self,
                                guint     dx,
                                guint     dy);
@@ -24,6 +24,7 @@
 
 #include "pan-application.h"
 #include "pan-window.h"
+#include "pan-cli.h"
 
 struct _PanApplication
 {
@@ -63,12 +64,21 @@ pan_application_activate (GApplication *self)
     gtk_window_present (app->window);
 }
 
+static gint
+pan_application_handle_local_options (GApplication *self,
+                                      GVariantDict *options)
+{
+    /* Batch verbs run here, before GTK is initialised. */
+    return pan_cli_run (options);
+}
+
 static void
 pan_application_class_init (PanApplicationClass *klass)
 {
     GApplicationClass *app_class = G_APPLICATION_CLASS (klass);
 
-    app_class->activate = pan_application_activate;
+    app_class->activate             = pan_application_activate;
+    app_class->handle_local_options = pan_application_handle_local_options;
 }
 
 static void
@@ -160,5 +170,47 @@ pan_application_init (PanApplication *self)
         GTK_APPLICATION (self),
         "win.new",
         (const char *[]){"<Ctrl>o", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.dump_perf",
+        (const char *[]){"<Ctrl><Shift>d", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.memory_report",
+        (const char *[]){"<Ctrl><Shift>m", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.statistics",
+        (const char *[]){"<Ctrl>i", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.find_duplicates",
+        (const char *[]){"<Ctrl><Shift>f", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.next_duplicate",
+        (const char *[]){"F8", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.prev_duplicate",
+        (const char *[]){"<Shift>F8", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.merge_duplicates",
+        (const char *[]){"<Ctrl>m", NULL});
+
+    gtk_application_set_accels_for_action (
+        GTK_APPLICATION (self),
+        "win.compare",
+        (const char *[]){"<Ctrl><Shift>c", NULL});
+
+    pan_cli_add_options (G_APPLICATION (self));
 }
 
@@ -0,0 +1,208 @@
+/*
+ * pan-binary.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A compact binary form of a document, for pipelines that load far more
+ * documents than a person ever opens.  All integers are 32-bit little
+ * endian:
+ *
+ *   "PANB" version root_len root
+ *   n_records { name_len name hash_lo hash_hi n_annots { x y } * n_annots } * n_records
+ *
+ * where the hash is the content hash of the image, zero if unknown.
+ * Version 1 files, which have no hash, are still read.
+ * Strings are not NUL-terminated.  Loading maps the file and checks every
+ * length against what is left before reading.
+ */
+
+#include <string.h>
+#include "pan-binary.h"
+
+#define MAGIC   "PANB"
+#define VERSION 2
+
+typedef struct
+{
+    const guint8 *data;
+    gsize left;
+} Reader;
+
+static void     put_u32    (GByteArray  *out,
+                            guint32      value);
+static void     put_string (GByteArray  *out,
+                            const gchar *string);
+static gboolean get_u32    (Reader      *reader,
+                            guint32     *value);
+static gchar   *get_string (Reader      *reader);
+
+static void
+put_u32 (GByteArray *out,
+         guint32     value)
+{
+    value = GUINT32_TO_LE (value);
+    g_byte_array_append (out, (const guint8 *) &value, sizeof value);
+}
+
+static void
+put_string (GByteArray  *out,
+            const gchar *string)
+{
+    gsize len;
+
+    len = string ? strlen (string) : 0;
+    put_u32 (out, len);
+    g_byte_array_append (out, (const guint8 *) string, len);
+}
+
+static gboolean
+get_u32 (Reader  *reader,
+         guint32 *value)
+{
+    if (reader->left < sizeof *value)
+        return FALSE;
+
+    memcpy (value, reader->data, sizeof *value);
+    *value = GUINT32_FROM_LE (*value);
+    reader->data += sizeof *value;
+    reader->left -= sizeof *value;
+
+    return TRUE;
+}
+
+static gchar *
+get_string (Reader *reader)
+{
+    guint32 len;
+    gchar *string;
+
+    if (!get_u32 (reader, &len) || reader->left < len)
+        return NULL;
+
+    string = g_strndup ((const gchar *) reader->data, len);
+    reader->data += len;
+    reader->left -= len;
+
+    return string;
+}
+
+PanDocument *
+pan_binary_load (const gchar  *path,
+                 GError      **error)
+{
+    g_autoptr (GMappedFile) file = NULL;
+    g_autoptr (PanRecordList) records = NULL;
+    g_autoptr (GArray) points = NULL;
+    g_autofree gchar *root = NULL;
+    Reader reader;
+    guint32 version, n_records, n_annots, xy;
+    guint32 hash[2] = { 0, 0 };
+    gchar *name;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    file = g_mapped_file_new (path, FALSE, error);
+    if (!file)
+        return NULL;
+
+    reader.data = (const guint8 *) g_mapped_file_get_contents (file);
+    reader.left = g_mapped_file_get_length (file);
+
+    if (reader.left < 4 || memcmp (reader.data, MAGIC, 4) != 0)
+        goto invalid;
+    reader.data += 4;
+    reader.left -= 4;
+
+    if (!get_u32 (&reader, &version) || version < 1 || version > VERSION)
+        goto invalid;
+    root = get_string (&reader);
+    if (!root || !get_u32 (&reader, &n_records))
+        goto invalid;
+
+    records = pan_record_list_new ();
+    points  = g_array_new (FALSE, FALSE, sizeof (guint32));
+    for (guint32 i = 0; i < n_records; i++) {
+        name = get_string (&reader);
+        if (!name ||
+            (version >= 2 && (!get_u32 (&reader, &hash[0]) || !get_u32 (&reader, &hash[1]))) ||
+            !get_u32 (&reader, &n_annots) || reader.left / 8 < n_annots) {
+            g_free (name);
+            goto invalid;
+        }
+
+        /* Points go straight into the index, no record is built. */
+        g_array_set_size (points, 0);
+        for (guint32 j = 0; j < 2 * n_annots; j++) {
+            get_u32 (&reader, &xy);
+            g_array_append_val (points, xy);
+        }
+
+        pan_record_list_append_points (records, name, (const guint32 *) points->data, n_annots);
+        pan_record_list_set_hash (records, i, (guint64) hash[1] << 32 | hash[0]);
+        g_free (name);
+    }
+
+    return g_object_new (PAN_TYPE_DOCUMENT, "path", root, "records", records, NULL);
+
+invalid:
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "%s is not a valid binary document", path);
+    return NULL;
+}
+
+gboolean
+pan_binary_save (PanDocument  *document,
+                 const gchar  *path,
+                 GError      **error)
+{
+    g_autoptr (GByteArray) out = NULL;
+    g_autoptr (GArray) points = NULL;
+    PanRecordList *records;
+    guint n_records, n_annots;
+    guint64 hash;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+
+    out    = g_byte_array_new ();
+    points = g_array_new (FALSE, FALSE, sizeof (guint32));
+    g_byte_array_append (out, (const guint8 *) MAGIC, 4);
+    put_u32 (out, VERSION);
+    put_string (out, pan_document_get_root_path (document));
+    put_u32 (out, n_records);
+
+    for (guint i = 0; i < n_records; i++) {
+        put_string (out, pan_record_list_get_filename (records, i));
+        hash = pan_record_list_get_hash (records, i);
+        put_u32 (out, hash & G_MAXUINT32);
+        put_u32 (out, hash >> 32);
+
+        g_array_set_size (points, 0);
+        n_annots = pan_record_list_copy_points (records, i, points);
+        put_u32 (out, n_annots);
+        for (guint j = 0; j < points->len; j++)
+            put_u32 (out, g_array_index (points, guint32, j));
+    }
+
+    return g_file_set_contents (path, (const gchar *) out->data, out->len, error);
+}
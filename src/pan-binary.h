@@ -1,5 +1,5 @@
 /*
- * pan-action-create.h
+ * pan-binary.h
  *
  * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
  *
@@ -19,19 +19,17 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+
 #pragma once
 
-#include <glib-object.h>
-#include "pan-action.h"
-#include "pan-record.h"
-#include "pan-annot.h"
+#include "pan-document.h"
 
 G_BEGIN_DECLS
 
-#define PAN_TYPE_ACTION_CREATE pan_action_create_get_type ()
-G_DECLARE_FINAL_TYPE (PanActionCreate, pan_action_create, PAN, ACTION_CREATE, PanAction)
-
-PanAction *pan_action_create_new (PanRecord *record, PanAnnot *annot);
+PanDocument *pan_binary_load (const gchar  *path,
+                              GError      **error);
+gboolean     pan_binary_save (PanDocument  *document,
+                              const gchar  *path,
+                              GError      **error);
 
 G_END_DECLS
-
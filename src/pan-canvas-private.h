@@ -0,0 +1,41 @@
+/*
+ * pan-widget.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "pan-canvas.h"
+#include "pan-event-trace.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Hooks for driving the canvas without user input, used by the rendering
+ * benchmark and the trace replay tool.  They are not part of the interface the window uses.
+ */
+
+void pan_canvas_set_zoom_factor (PanCanvas *self,
+                                 gfloat     zoom_factor);
+void pan_canvas_set_hover       (PanCanvas *self,
+                                 guint      position);
+void pan_canvas_replay_event    (PanCanvas      *self,
+                                 const PanEvent *event);
+
+G_END_DECLS
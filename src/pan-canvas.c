@@ -20,16 +20,37 @@
  */
 
 #include "config.h"
+#include <math.h>
 #include "pan-canvas.h"
+#include "pan-canvas-private.h"
 #include "pan-action.h"
-#include "pan-action-create.h"
-#include "pan-action-move.h"
-#include "pan-action-delete.h"
+#include "pan-history.h"
+#include "pan-spatial-index.h"
+#include "pan-event-trace.h"
+#include "pan-perf.h"
+#include "pan-profiler.h"
+#include "pan-agreement.h"
+#include "pan-minimap.h"
+#include "pan-levels.h"
 
 #define ZOOM_DELTA          0.1
 #define MAX_ZOOM_FACTOR     10.0
 #define MIN_ZOOM_FACTOR     0.1
 #define BOX_PADDING         5
+#define OVERLAY_MARGIN      8
+#define MAX_FRAME_INTERVAL  (G_USEC_PER_SEC / 4)
+#define ZOOM_DURATION       (G_USEC_PER_SEC * 3 / 20)
+#define SCROLL_ZOOM_STEP    1.2
+#define SCROLL_STEP_PIXELS  20.0
+
+typedef enum
+{
+    DRAG_NONE,
+    DRAG_MOVE,
+    DRAG_BOX,
+    DRAG_LASSO,
+    DRAG_MINIMAP
+} DragMode;
 
 struct _PanCanvas
 {
@@ -47,15 +68,14 @@ struct _PanCanvas
 
     gint mode;
     gint state;
-    gboolean is_dragging;
+    DragMode drag_mode;
 
     PanDocument *document;
     guint record_idx;
     guint n_records;
 
     PanRecord *selected_record;
-    PanAnnot *selected_annot;
-    PanAnnot *hover_annot;
+    guint hover_pos;
 
     GtkAdjustment *hadjustment;
     GtkAdjustment *vadjustment;
@@ -67,19 +87,71 @@ struct _PanCanvas
     GdkCursor *move_cursor;
 
     GtkSingleSelection *record_selection;
-    GtkSingleSelection *annot_selection;
+    GtkMultiSelection *annot_selection;
+    PanSpatialIndex *index;
+
+    /* The annotation selection of each record left, by record position. */
+    GHashTable *selections;
+    guint selected_position;
 
     GtkWidget *context_menu;
 
     guint prev_x, prev_y;
-    guint old_x, old_y;
+    guint band_x, band_y;
+    guint drag_dx, drag_dy;
+    GtkBitset *drag_set;
+    GArray *lasso;
 
     gfloat zoom_factor;
 
-    GSList *undo_stack;
-    GSList *redo_stack;
+    /*
+     * A running zoom animation goes from zoom_from to zoom_target, keeping
+     * the image point under (zoom_x, zoom_y) in place.
+     */
+    guint zoom_tick_id;
+    gint64 zoom_start_time;
+    gdouble zoom_from;
+    gdouble zoom_target;
+    gdouble zoom_x, zoom_y;
+    gdouble pinch_zoom;
+    gboolean pinching;
+    gdouble pointer_x, pointer_y;
 
     AdwStyleManager *style_manager;
+
+    PanEventTrace *trace;
+    gchar *trace_path;
+
+    PanPerf *perf;
+    gboolean perf_overlay;
+    gint64 last_frame_time;
+
+    gboolean skip_similar;
+
+    PanMinimap *minimap;
+    gboolean show_minimap;
+    guint minimap_source;
+
+    /* Display adjustments, applied by the renderer as the image is drawn. */
+    gdouble brightness;
+    gdouble contrast;
+    gdouble gamma;
+    guint channel;
+    gboolean auto_levels;
+    gdouble window;
+    gdouble level;
+    gchar *image_path;
+    PanLevels levels;
+    gboolean levels_valid;
+    GCancellable *levels_cancellable;
+
+    /* The document compared against, and the matching of the current record. */
+    PanDocument *reference;
+    GHashTable *reference_names;
+    guint match_distance;
+    GArray *reference_points;
+    GArray *test_match;
+    gboolean agreement_valid;
 };
 
 enum
@@ -91,6 +163,16 @@ enum
     PROP_VSCROLL_POLICY,
     PROP_RADIUS,
     PROP_DOCUMENT,
+    PROP_PERF_OVERLAY,
+    PROP_SKIP_SIMILAR,
+    PROP_SHOW_MINIMAP,
+    PROP_BRIGHTNESS,
+    PROP_CONTRAST,
+    PROP_GAMMA,
+    PROP_CHANNEL,
+    PROP_AUTO_LEVELS,
+    PROP_WINDOW,
+    PROP_LEVEL,
     N_PROPS
 };
 
@@ -132,6 +214,10 @@ static void                  pan_canvas_button_released_cb
                                                                                     gdouble    x,
                                                                                     gdouble    y,
                                                                                     gpointer   user_data);
+static void                  pan_canvas_drag_end_cb                                (PanCanvas *self,
+                                                                                    gdouble    offset_x,
+                                                                                    gdouble    offset_y,
+                                                                                    gpointer   user_data);
 static void                  pan_canvas_pointer_motion_cb                          (PanCanvas *self,
                                                                                     gdouble    x,
                                                                                     gdouble    y,
@@ -144,6 +230,35 @@ static void                  pan_canvas_pointer_leave_cb
                                                                                     gdouble    x,
                                                                                     gdouble    y,
                                                                                     gpointer   user_data);
+static gboolean              pan_canvas_scroll_cb                                  (PanCanvas *self,
+                                                                                    gdouble    dx,
+                                                                                    gdouble    dy,
+                                                                                    gpointer   user_data);
+static void                  pan_canvas_pinch_begin_cb                             (PanCanvas        *self,
+                                                                                    GdkEventSequence *sequence,
+                                                                                    gpointer          user_data);
+static void                  pan_canvas_pinch_end_cb                               (PanCanvas        *self,
+                                                                                    GdkEventSequence *sequence,
+                                                                                    gpointer          user_data);
+static void                  pan_canvas_pinch_cb                                   (PanCanvas *self,
+                                                                                    gdouble    scale,
+                                                                                    gpointer   user_data);
+static void                  configure_adjustments                                 (PanCanvas *self,
+                                                                                    gint       width,
+                                                                                    gint       height);
+static void                  set_zoom_at                                           (PanCanvas *self,
+                                                                                    gdouble    zoom,
+                                                                                    gdouble    x,
+                                                                                    gdouble    y);
+static gdouble               zoom_goal                                             (PanCanvas *self);
+static void                  animate_zoom                                          (PanCanvas *self,
+                                                                                    gdouble    zoom,
+                                                                                    gdouble    x,
+                                                                                    gdouble    y);
+static gboolean              zoom_tick_cb                                          (GtkWidget     *widget,
+                                                                                    GdkFrameClock *frame_clock,
+                                                                                    gpointer       user_data);
+static void                  stop_zoom                                             (PanCanvas *self);
 static void                  pan_canvas_set_adjustment                             (PanCanvas     *self,
                                                                                     GtkAdjustment *adjustment,
                                                                                     GtkOrientation orientation);
@@ -170,17 +285,76 @@ static void                  pan_widget_annot_selection_changed_cb
                                                                                     guint              n_items,
                                                                                     gpointer           user_data);
 static void                  set_up_context_menu                                   (PanCanvas *self);
+static GtkBitset            *get_selection                                         (PanCanvas *self);
+static void                  set_selection                                         (PanCanvas *self,
+                                                                                    GtkBitset *selected);
+static void                  translate_set                                         (PanCanvas *self,
+                                                                                    GtkBitset *set,
+                                                                                    guint      dx,
+                                                                                    guint      dy);
+static void                  push_moves                                            (PanCanvas *self,
+                                                                                    GtkBitset *set,
+                                                                                    guint      dx,
+                                                                                    guint      dy);
+static void                  delete_selection                                      (PanCanvas *self);
+static gboolean              handle_key                                            (PanCanvas      *self,
+                                                                                    guint           keyval,
+                                                                                    GdkModifierType state);
+static void                  handle_press                                          (PanCanvas      *self,
+                                                                                    gint            n_press,
+                                                                                    gdouble         x,
+                                                                                    gdouble         y,
+                                                                                    GdkModifierType state);
+static void                  handle_release                                        (PanCanvas *self);
+static void                  handle_motion                                         (PanCanvas *self,
+                                                                                    gdouble    x,
+                                                                                    gdouble    y);
+static void                  trace_event                                           (PanCanvas      *self,
+                                                                                    PanEventType    type,
+                                                                                    guint           value,
+                                                                                    GdkModifierType state,
+                                                                                    gdouble         x,
+                                                                                    gdouble         y);
+static guint                 pick                                                  (PanCanvas *self,
+                                                                                    guint      x,
+                                                                                    guint      y);
+static void                  snapshot_overlay                                      (PanCanvas   *self,
+                                                                                    GtkSnapshot *snapshot);
+static void                  snapshot_agreement                                    (PanCanvas   *self,
+                                                                                    GtkSnapshot *snapshot,
+                                                                                    gint         scroll_x,
+                                                                                    gint         scroll_y);
+static void                  update_agreement                                      (PanCanvas *self);
+static gboolean              minimap_bounds                                        (PanCanvas       *self,
+                                                                                    graphene_rect_t *bounds);
+static void                  snapshot_minimap                                      (PanCanvas   *self,
+                                                                                    GtkSnapshot *snapshot);
+static gboolean              render_minimap_cb                                     (gpointer user_data);
+static guint                 push_adjustments                                      (PanCanvas   *self,
+                                                                                    GtkSnapshot *snapshot);
+static void                  start_levels                                          (PanCanvas *self);
+static gboolean              is_deep_format                                        (GdkMemoryFormat format);
+static gsize                 texture_bytes                                         (GdkTexture *texture);
+static void                  levels_computed_cb                                    (GObject      *source,
+                                                                                    GAsyncResult *result,
+                                                                                    gpointer      user_data);
+static void                  center_on_minimap                                     (PanCanvas             *self,
+                                                                                    const graphene_rect_t *bounds,
+                                                                                    gdouble                x,
+                                                                                    gdouble                y);
+static void                  finish_drag                                           (PanCanvas *self);
 static void                  load_record                                           (PanCanvas *self);
+static void                  push_action                                           (PanCanvas       *self,
+                                                                                    const PanAction *action);
+static void                  annots_changed                                        (PanCanvas *self);
+static gboolean              is_skipped                                            (PanCanvas *self,
+                                                                                    guint      pos);
 static void                  load_image                                            (PanCanvas *self,
                                                                                     gchar     *img_path);
 static GtkSizeRequestMode    pan_canvas_get_request_mode                           (GtkWidget *widget);
 static GdkCursor            *load_cursor                                           (const gchar *resource_path,
                                                                                     guint        hotspot_x,
                                                                                     guint        hotspot_y);
-static void                  stack_push_action                                     (GSList    **stack,
-                                                                                    PanAction  *action);
-static PanAction            *stack_pop_action                                      (GSList **stack);
-static void                  stack_clear                                           (GSList **stack);
 
 G_DEFINE_FINAL_TYPE_WITH_CODE (PanCanvas, pan_canvas, GTK_TYPE_WIDGET,
                                G_IMPLEMENT_INTERFACE (GTK_TYPE_SCROLLABLE, NULL))
@@ -219,6 +393,61 @@ pan_canvas_class_init (PanCanvasClass *klass)
                                                           PAN_TYPE_DOCUMENT,
                                                           G_PARAM_READWRITE));
 
+    g_object_class_install_property (object_class, PROP_PERF_OVERLAY,
+                                     g_param_spec_boolean ("perf-overlay", NULL, NULL,
+                                                           FALSE,
+                                                           G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_SKIP_SIMILAR,
+                                     g_param_spec_boolean ("skip-similar", NULL, NULL,
+                                                           FALSE,
+                                                           G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_SHOW_MINIMAP,
+                                     g_param_spec_boolean ("show-minimap", NULL, NULL,
+                                                           TRUE,
+                                                           G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_BRIGHTNESS,
+                                     g_param_spec_double ("brightness", NULL, NULL,
+                                                          -1.0, 1.0, 0.0,
+                                                          G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_CONTRAST,
+                                     g_param_spec_double ("contrast", NULL, NULL,
+                                                          0.0, 4.0, 1.0,
+                                                          G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_GAMMA,
+                                     g_param_spec_double ("gamma", NULL, NULL,
+                                                          0.1, 10.0, 1.0,
+                                                          G_PARAM_READWRITE));
+
+    /* 0 shows all channels, 1 to 3 only red, green or blue, as grey. */
+    g_object_class_install_property (object_class, PROP_CHANNEL,
+                                     g_param_spec_uint ("channel", NULL, NULL,
+                                                        0, 3, 0,
+                                                        G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_AUTO_LEVELS,
+                                     g_param_spec_boolean ("auto-levels", NULL, NULL,
+                                                           FALSE,
+                                                           G_PARAM_READWRITE));
+
+    /*
+     * The range of input values stretched to full scale, as its width and
+     * centre, in 0 to 1 of the auto levels range or of the full range.
+     */
+    g_object_class_install_property (object_class, PROP_WINDOW,
+                                     g_param_spec_double ("window", NULL, NULL,
+                                                          0.001, 1.0, 1.0,
+                                                          G_PARAM_READWRITE));
+
+    g_object_class_install_property (object_class, PROP_LEVEL,
+                                     g_param_spec_double ("level", NULL, NULL,
+                                                          0.0, 1.0, 0.5,
+                                                          G_PARAM_READWRITE));
+
     gtk_widget_class_install_action (widget_class, "pan-widget.create",
                                      NULL, pan_canvas_create_action_cb);
     gtk_widget_class_install_action (widget_class, "pan-widget.delete",
@@ -230,8 +459,11 @@ pan_canvas_init (PanCanvas *self)
 {
     GtkEventController *key_controller;
     GtkEventController *pointer_controller;
+    GtkEventController *scroll_controller;
     GtkGesture *button_controller;
+    GtkGesture *pinch_controller;
     GtkGesture *sec_button_controller;
+    GtkGesture *drag_controller;
     AdwAccentColor accent_color;
 
     gtk_widget_set_focusable (GTK_WIDGET (self), TRUE);
@@ -246,6 +478,11 @@ pan_canvas_init (PanCanvas *self)
     g_signal_connect_swapped (button_controller, "pressed", G_CALLBACK (pan_canvas_button_press_cb), self);
     g_signal_connect_swapped (button_controller, "released", G_CALLBACK (pan_canvas_button_released_cb), self);
 
+    /* The click gesture gives up once the pointer moves, so drags end here. */
+    drag_controller = gtk_gesture_drag_new ();
+    gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (drag_controller));
+    g_signal_connect_swapped (drag_controller, "drag-end", G_CALLBACK (pan_canvas_drag_end_cb), self);
+
     sec_button_controller = gtk_gesture_click_new ();
     gtk_gesture_single_set_button (GTK_GESTURE_SINGLE (sec_button_controller), GDK_BUTTON_SECONDARY);
     gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (sec_button_controller));
@@ -257,6 +494,16 @@ pan_canvas_init (PanCanvas *self)
     g_signal_connect_swapped (pointer_controller, "enter", G_CALLBACK (pan_canvas_pointer_enter_cb), self);
     g_signal_connect_swapped (pointer_controller, "leave", G_CALLBACK (pan_canvas_pointer_leave_cb), self);
 
+    scroll_controller = gtk_event_controller_scroll_new (GTK_EVENT_CONTROLLER_SCROLL_VERTICAL);
+    gtk_widget_add_controller (GTK_WIDGET (self), scroll_controller);
+    g_signal_connect_swapped (scroll_controller, "scroll", G_CALLBACK (pan_canvas_scroll_cb), self);
+
+    pinch_controller = gtk_gesture_zoom_new ();
+    gtk_widget_add_controller (GTK_WIDGET (self), GTK_EVENT_CONTROLLER (pinch_controller));
+    g_signal_connect_swapped (pinch_controller, "begin", G_CALLBACK (pan_canvas_pinch_begin_cb), self);
+    g_signal_connect_swapped (pinch_controller, "end", G_CALLBACK (pan_canvas_pinch_end_cb), self);
+    g_signal_connect_swapped (pinch_controller, "scale-changed", G_CALLBACK (pan_canvas_pinch_cb), self);
+
     self->annot_idx   = 0;
     self->radius      = 10.0;
     self->zoom_factor = 1.0;
@@ -282,11 +529,20 @@ pan_canvas_init (PanCanvas *self)
     self->document         = NULL;
     self->record_selection = NULL;
     self->annot_selection  = NULL;
-
-    self->is_dragging = FALSE;
-
-    self->undo_stack = NULL;
-    self->redo_stack = NULL;
+    self->index            = pan_spatial_index_new ();
+    self->selections       = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) gtk_bitset_unref);
+    self->lasso            = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+    self->hover_pos        = GTK_INVALID_LIST_POSITION;
+    self->reference_points = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->test_match       = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->minimap          = pan_minimap_new ();
+    self->show_minimap     = TRUE;
+    self->contrast         = 1.0;
+    self->gamma            = 1.0;
+    self->window           = 1.0;
+    self->level            = 0.5;
+
+    self->drag_mode = DRAG_NONE;
 
     self->normal_cursor = gdk_cursor_new_from_name ("crosshair", NULL);
     self->hand_cursor   = gdk_cursor_new_from_name ("grab", NULL);
@@ -300,6 +556,16 @@ pan_canvas_init (PanCanvas *self)
     accent_color = adw_style_manager_get_accent_color (self->style_manager);
     adw_accent_color_to_rgba (accent_color, &self->accent_color);
     g_signal_connect (self->style_manager, "notify::accent-color", G_CALLBACK (accent_color_notify_cb), self);
+
+    /* Set PAN_EVENT_TRACE to a file name to record a trace for replay-trace. */
+    if (g_getenv ("PAN_EVENT_TRACE")) {
+        self->trace      = pan_event_trace_new ();
+        self->trace_path = g_strdup (g_getenv ("PAN_EVENT_TRACE"));
+    }
+
+    /* The counters are cheap enough to keep; the overlay only shows them. */
+    self->perf         = pan_perf_new ();
+    self->perf_overlay = g_getenv ("PAN_PERF_OVERLAY") != NULL;
 }
 
 static void
@@ -330,6 +596,36 @@ pan_canvas_get_property (GObject    *object,
     case PROP_DOCUMENT:
         g_value_set_object (value, canvas->document);
         break;
+    case PROP_PERF_OVERLAY:
+        g_value_set_boolean (value, canvas->perf_overlay);
+        break;
+    case PROP_SKIP_SIMILAR:
+        g_value_set_boolean (value, canvas->skip_similar);
+        break;
+    case PROP_SHOW_MINIMAP:
+        g_value_set_boolean (value, canvas->show_minimap);
+        break;
+    case PROP_BRIGHTNESS:
+        g_value_set_double (value, canvas->brightness);
+        break;
+    case PROP_CONTRAST:
+        g_value_set_double (value, canvas->contrast);
+        break;
+    case PROP_GAMMA:
+        g_value_set_double (value, canvas->gamma);
+        break;
+    case PROP_CHANNEL:
+        g_value_set_uint (value, canvas->channel);
+        break;
+    case PROP_AUTO_LEVELS:
+        g_value_set_boolean (value, canvas->auto_levels);
+        break;
+    case PROP_WINDOW:
+        g_value_set_double (value, canvas->window);
+        break;
+    case PROP_LEVEL:
+        g_value_set_double (value, canvas->level);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -366,6 +662,46 @@ pan_canvas_set_property (GObject      *object,
     case PROP_DOCUMENT:
         pan_canvas_set_document (canvas, g_value_get_object (value));
         break;
+    case PROP_PERF_OVERLAY:
+        canvas->perf_overlay = g_value_get_boolean (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_SKIP_SIMILAR:
+        canvas->skip_similar = g_value_get_boolean (value);
+        break;
+    case PROP_SHOW_MINIMAP:
+        canvas->show_minimap = g_value_get_boolean (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_BRIGHTNESS:
+        canvas->brightness = g_value_get_double (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_CONTRAST:
+        canvas->contrast = g_value_get_double (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_GAMMA:
+        canvas->gamma = g_value_get_double (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_CHANNEL:
+        canvas->channel = g_value_get_uint (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_AUTO_LEVELS:
+        canvas->auto_levels = g_value_get_boolean (value);
+        start_levels (canvas);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_WINDOW:
+        canvas->window = g_value_get_double (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
+    case PROP_LEVEL:
+        canvas->level = g_value_get_double (value);
+        gtk_widget_queue_draw (GTK_WIDGET (canvas));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -376,9 +712,21 @@ static void
 pan_canvas_dispose (GObject *object)
 {
     PanCanvas *canvas;
+    GError *error = NULL;
 
     canvas = PAN_CANVAS (object);
 
+    stop_zoom (canvas);
+
+    if (canvas->trace) {
+        if (!pan_event_trace_save (canvas->trace, canvas->trace_path, &error)) {
+            g_warning ("Could not save the event trace: %s", error->message);
+            g_clear_error (&error);
+        }
+        g_clear_pointer (&canvas->trace, pan_event_trace_free);
+        g_clear_pointer (&canvas->trace_path, g_free);
+    }
+
     g_clear_pointer (&canvas->context_menu, gtk_widget_unparent);
     g_clear_object (&canvas->hadjustment);
     g_clear_object (&canvas->vadjustment);
@@ -389,6 +737,14 @@ pan_canvas_dispose (GObject *object)
     g_clear_object (&canvas->document);
     g_clear_object (&canvas->record_selection);
     g_clear_object (&canvas->annot_selection);
+    g_clear_object (&canvas->selected_record);
+    g_clear_pointer (&canvas->drag_set, gtk_bitset_unref);
+    g_clear_pointer (&canvas->selections, g_hash_table_unref);
+    g_clear_object (&canvas->reference);
+    g_clear_pointer (&canvas->reference_names, g_hash_table_unref);
+    g_clear_handle_id (&canvas->minimap_source, g_source_remove);
+    g_cancellable_cancel (canvas->levels_cancellable);
+    g_clear_object (&canvas->levels_cancellable);
 
     G_OBJECT_CLASS (pan_canvas_parent_class)->dispose (object);
 }
@@ -400,8 +756,13 @@ pan_canvas_finalize (GObject *object)
 
     canvas = PAN_CANVAS (object);
 
-    stack_clear (&canvas->undo_stack);
-    stack_clear (&canvas->redo_stack);
+    pan_spatial_index_free (canvas->index);
+    pan_perf_free (canvas->perf);
+    g_array_unref (canvas->lasso);
+    g_array_unref (canvas->reference_points);
+    g_array_unref (canvas->test_match);
+    pan_minimap_free (canvas->minimap);
+    g_free (canvas->image_path);
 
     G_OBJECT_CLASS (pan_canvas_parent_class)->finalize (object);
 }
@@ -454,11 +815,12 @@ accent_color_notify_cb (GObject *self,
     gtk_widget_queue_draw (GTK_WIDGET (canvas));
 }
 
+/* Scrolling moves the image under the same allocation, so it only redraws. */
 static void
 pan_canvas_adjustment_cb (GtkAdjustment *adjustment,
                           gpointer user_data)
 {
-    gtk_widget_queue_allocate (GTK_WIDGET (user_data));
+    gtk_widget_queue_draw (GTK_WIDGET (user_data));
 }
 
 static GtkSizeRequestMode
@@ -498,56 +860,116 @@ pan_canvas_snapshot (GtkWidget   *self,
     PanCanvas *canvas;
     gint width, height;
     gint scroll_x, scroll_y;
+    gdouble hvalue, vvalue;
+    GskScalingFilter filter;
     guint n_annots;
     GListStore *annot_store;
     PanAnnot *annot;
+    GtkBitset *selected;
+    GtkBitset *visible;
+    GtkBitsetIter iter;
+    GdkFrameClock *frame_clock;
+    gint64 start, frame_time;
+    gint64 begin;
+    guint margin, visited;
+    guint n_pushed;
+    guint x0, y0, x1, y1;
+    guint pos;
     guint x, y;
     const gfloat dash= 1.0;
 
     canvas = PAN_CANVAS (self);
-    if (!canvas->document)
+    if (!canvas->document || !canvas->selected_record)
         return;
 
-    scroll_x = -gtk_adjustment_get_value (canvas->hadjustment);
-    scroll_y = -gtk_adjustment_get_value (canvas->vadjustment);
+    begin = PAN_PROFILER_CURRENT_TIME;
+    start = g_get_monotonic_time ();
+    frame_clock = gtk_widget_get_frame_clock (self);
+    if (frame_clock) {
+        frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+        if (frame_time > canvas->last_frame_time &&
+            frame_time - canvas->last_frame_time < MAX_FRAME_INTERVAL)
+            pan_perf_record (canvas->perf, PAN_PERF_FRAME, frame_time - canvas->last_frame_time);
+        canvas->last_frame_time = frame_time;
+    }
+
+    /* Whole pixels go into the coordinates, the rest into the transform. */
+    hvalue = gtk_adjustment_get_value (canvas->hadjustment);
+    vvalue = gtk_adjustment_get_value (canvas->vadjustment);
+    scroll_x = -(gint) floor (hvalue);
+    scroll_y = -(gint) floor (vvalue);
 
+    gtk_snapshot_save (snapshot);
     gtk_snapshot_scale (snapshot,
                         canvas->zoom_factor, canvas->zoom_factor);
+    gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (floor (hvalue) - hvalue,
+                                                            floor (vvalue) - vvalue));
 
     if (canvas->image) {
         width = gdk_texture_get_width (canvas->image);
         height = gdk_texture_get_height (canvas->image);
-        gtk_snapshot_append_texture (snapshot, canvas->image,
-                                     &GRAPHENE_RECT_INIT (scroll_x, scroll_y,
-                                                          width, height));
+        /* Mipmaps only once the zoom settles, plain filtering while it moves. */
+        filter = canvas->zoom_tick_id || canvas->pinching ? GSK_SCALING_FILTER_LINEAR
+                                                          : GSK_SCALING_FILTER_TRILINEAR;
+        n_pushed = push_adjustments (canvas, snapshot);
+        gtk_snapshot_append_scaled_texture (snapshot, canvas->image, filter,
+                                            &GRAPHENE_RECT_INIT (scroll_x, scroll_y,
+                                                                 width, height));
+        for (guint i = 0; i < n_pushed; i++)
+            gtk_snapshot_pop (snapshot);
     }
 
     annot_store = pan_record_annots (canvas->selected_record);
     n_annots = g_list_model_get_n_items (G_LIST_MODEL (annot_store));
-    for (guint i = 0; i < n_annots; i++) {
-        annot = g_list_model_get_item (G_LIST_MODEL (annot_store), i);
+
+    /* Only annotations whose box can reach the viewport are drawn. */
+    margin = canvas->radius + BOX_PADDING;
+    x0 = MAX (-scroll_x - (gint) margin, 0);
+    y0 = MAX (-scroll_y - (gint) margin, 0);
+    x1 = MAX (-scroll_x + (gint) (gtk_widget_get_width (self) / canvas->zoom_factor) + (gint) margin, 0);
+    y1 = MAX (-scroll_y + (gint) (gtk_widget_get_height (self) / canvas->zoom_factor) + (gint) margin, 0);
+
+    visible = gtk_bitset_new_empty ();
+    visited = pan_spatial_index_query_rect (canvas->index, x0, y0, x1, y1, visible);
+    pan_perf_set_counter (canvas->perf, PAN_PERF_POINTS_VISITED, visited);
+    pan_perf_set_counter (canvas->perf, PAN_PERF_POINTS_DRAWN, gtk_bitset_get_size (visible));
+
+    if (gtk_bitset_iter_init_first (&iter, visible, &pos)) {
         path_builder = gsk_path_builder_new ();
-        pan_annot_get_pos (annot, &x, &y);
-        x += scroll_x;
-        y += scroll_y;
-        gsk_path_builder_add_circle (path_builder, &GRAPHENE_POINT_INIT (x, y),
-                                     canvas->radius);
+        do {
+            annot = g_list_model_get_item (G_LIST_MODEL (annot_store), pos);
+            pan_annot_get_pos (annot, &x, &y);
+            g_object_unref (annot);
+            x += scroll_x;
+            y += scroll_y;
+            gsk_path_builder_add_circle (path_builder, &GRAPHENE_POINT_INIT (x, y),
+                                         canvas->radius);
+        } while (gtk_bitset_iter_next (&iter, &pos));
         path = gsk_path_builder_free_to_path (path_builder);
         gtk_snapshot_append_fill (snapshot, path, GSK_FILL_RULE_WINDING,
                                   &canvas->color);
         gsk_path_unref (path);
     }
 
-    if (canvas->selected_annot) {
+    if (canvas->reference)
+        snapshot_agreement (canvas, snapshot, scroll_x, scroll_y);
+
+    selected = get_selection (canvas);
+    gtk_bitset_intersect (visible, selected);
+    if (gtk_bitset_iter_init_first (&iter, visible, &pos)) {
         path_builder = gsk_path_builder_new ();
-        pan_annot_get_pos (canvas->selected_annot, &x, &y);
-        x += scroll_x;
-        y += scroll_y;
-        gsk_path_builder_add_rect (path_builder,
-                                   &GRAPHENE_RECT_INIT (x - canvas->radius - BOX_PADDING,
-                                                        y - canvas->radius - BOX_PADDING,
-                                                        2 * (canvas->radius + BOX_PADDING),
-                                                        2 * (canvas->radius + BOX_PADDING)));
+        do {
+            annot = g_list_model_get_item (G_LIST_MODEL (annot_store), pos);
+            pan_annot_get_pos (annot, &x, &y);
+            g_object_unref (annot);
+            x += scroll_x;
+            y += scroll_y;
+            gsk_path_builder_add_rect (path_builder,
+                                       &GRAPHENE_RECT_INIT (x - canvas->radius - BOX_PADDING,
+                                                            y - canvas->radius - BOX_PADDING,
+                                                            2 * (canvas->radius + BOX_PADDING),
+                                                            2 * (canvas->radius + BOX_PADDING)));
+        } while (gtk_bitset_iter_next (&iter, &pos));
         path = gsk_path_builder_free_to_path (path_builder);
         stroke = gsk_stroke_new (3);
         gsk_stroke_set_dash (stroke, &dash, 1);
@@ -556,9 +978,11 @@ pan_canvas_snapshot (GtkWidget   *self,
         gsk_stroke_free (stroke);
     }
 
-    if (canvas->hover_annot && canvas->hover_annot != canvas->selected_annot) {
+    if (canvas->hover_pos < n_annots && !gtk_bitset_contains (selected, canvas->hover_pos)) {
         path_builder = gsk_path_builder_new ();
-        pan_annot_get_pos (canvas->hover_annot, &x, &y);
+        annot = g_list_model_get_item (G_LIST_MODEL (annot_store), canvas->hover_pos);
+        pan_annot_get_pos (annot, &x, &y);
+        g_object_unref (annot);
         x += scroll_x;
         y += scroll_y;
         gsk_path_builder_add_circle (path_builder, &GRAPHENE_POINT_INIT (x, y),
@@ -569,236 +993,1066 @@ pan_canvas_snapshot (GtkWidget   *self,
         gsk_path_unref (path);
         gsk_stroke_free (stroke);
     }
+    gtk_bitset_unref (selected);
+    gtk_bitset_unref (visible);
+
+    if (canvas->drag_mode == DRAG_BOX || canvas->drag_mode == DRAG_LASSO) {
+        path_builder = gsk_path_builder_new ();
+        if (canvas->drag_mode == DRAG_BOX) {
+            gsk_path_builder_add_rect (path_builder,
+                                       &GRAPHENE_RECT_INIT ((gint) canvas->band_x + scroll_x,
+                                                            (gint) canvas->band_y + scroll_y,
+                                                            (gint) (canvas->prev_x - canvas->band_x),
+                                                            (gint) (canvas->prev_y - canvas->band_y)));
+        } else if (canvas->lasso->len > 0) {
+            for (guint i = 0; i < canvas->lasso->len; i++) {
+                graphene_point_t *point = &g_array_index (canvas->lasso, graphene_point_t, i);
+
+                if (i == 0)
+                    gsk_path_builder_move_to (path_builder, point->x + scroll_x, point->y + scroll_y);
+                else
+                    gsk_path_builder_line_to (path_builder, point->x + scroll_x, point->y + scroll_y);
+            }
+            gsk_path_builder_close (path_builder);
+        }
+        path = gsk_path_builder_free_to_path (path_builder);
+        stroke = gsk_stroke_new (1);
+        gsk_stroke_set_dash (stroke, &dash, 1);
+        gtk_snapshot_append_stroke (snapshot, path, stroke, &canvas->accent_color);
+        gsk_path_unref (path);
+        gsk_stroke_free (stroke);
+    }
+    gtk_snapshot_restore (snapshot);
+
+    snapshot_minimap (canvas, snapshot);
+
+    pan_perf_record (canvas->perf, PAN_PERF_SNAPSHOT, g_get_monotonic_time () - start);
+    PAN_PROFILER_ADD_MARK (begin, "pan_canvas_snapshot", NULL);
+
+    if (canvas->perf_overlay)
+        snapshot_overlay (canvas, snapshot);
 }
 
+/*
+ * Draws a line from every matched point to its reference point, a ring
+ * around points with no match, and a dashed ring where the reference has
+ * a point this record is missing.
+ */
 static void
-pan_canvas_size_allocate (GtkWidget *widget,
-                          gint       width,
-                          gint       height,
-                          gint       baseline)
+snapshot_agreement (PanCanvas   *self,
+                    GtkSnapshot *snapshot,
+                    gint         scroll_x,
+                    gint         scroll_y)
 {
-    PanCanvas *canvas;
-    int img_width, img_height;
-    int value;
-
-    canvas = PAN_CANVAS (widget);
-    if (!canvas->image)
-        return;
-
-    img_width = gdk_texture_get_width (canvas->image);
-    img_height = gdk_texture_get_height (canvas->image);
+    static const GdkRGBA matched_color   = { 0.2, 0.8, 0.3, 1.0 };
+    static const GdkRGBA unmatched_color = { 0.9, 0.2, 0.2, 1.0 };
+    static const GdkRGBA missed_color    = { 0.2, 0.5, 1.0, 1.0 };
+    const gfloat dash = 4.0;
+    GskPathBuilder *lines, *unmatched, *missed;
+    GListStore *annot_store;
+    GskStroke *stroke;
+    GskPath *path;
+    PanAnnot *annot;
+    g_autofree gboolean *taken = NULL;
+    const guint32 *reference;
+    guint n_annots, n_reference;
+    guint32 match;
+    guint x, y;
 
-    img_width = (int) (img_width * canvas->zoom_factor);
-    img_height = (int) (img_height * canvas->zoom_factor);
+    update_agreement (self);
 
-    value = gtk_adjustment_get_value (canvas->hadjustment);
-    gtk_adjustment_configure (canvas->hadjustment, value, 0, img_width,
-                              width * 0.1, width, width);
+    annot_store = pan_record_annots (self->selected_record);
+    n_annots    = MIN (g_list_model_get_n_items (G_LIST_MODEL (annot_store)), self->test_match->len);
+    reference   = (const guint32 *) self->reference_points->data;
+    n_reference = self->reference_points->len / 2;
+    taken       = g_new0 (gboolean, MAX (n_reference, 1));
+
+    lines     = gsk_path_builder_new ();
+    unmatched = gsk_path_builder_new ();
+    missed    = gsk_path_builder_new ();
+    for (guint i = 0; i < n_annots; i++) {
+        annot = g_list_model_get_item (G_LIST_MODEL (annot_store), i);
+        pan_annot_get_pos (annot, &x, &y);
+        g_object_unref (annot);
+
+        match = g_array_index (self->test_match, guint32, i);
+        if (match < n_reference) {
+            taken[match] = TRUE;
+            gsk_path_builder_move_to (lines, (gint) x + scroll_x, (gint) y + scroll_y);
+            gsk_path_builder_line_to (lines, (gint) reference[2 * match] + scroll_x,
+                                      (gint) reference[2 * match + 1] + scroll_y);
+        } else {
+            gsk_path_builder_add_circle (unmatched,
+                                         &GRAPHENE_POINT_INIT ((gint) x + scroll_x, (gint) y + scroll_y),
+                                         self->radius + BOX_PADDING);
+        }
+    }
+    for (guint i = 0; i < n_reference; i++) {
+        if (taken[i])
+            continue;
+        gsk_path_builder_add_circle (missed,
+                                     &GRAPHENE_POINT_INIT ((gint) reference[2 * i] + scroll_x,
+                                                           (gint) reference[2 * i + 1] + scroll_y),
+                                     self->radius + BOX_PADDING);
+    }
 
-    value = gtk_adjustment_get_value (canvas->vadjustment);
-    gtk_adjustment_configure (canvas->vadjustment, value, 0, img_height,
-                              height * 0.1, height, height);
+    stroke = gsk_stroke_new (2);
+    path = gsk_path_builder_free_to_path (lines);
+    gtk_snapshot_append_stroke (snapshot, path, stroke, &matched_color);
+    gsk_path_unref (path);
+    path = gsk_path_builder_free_to_path (unmatched);
+    gtk_snapshot_append_stroke (snapshot, path, stroke, &unmatched_color);
+    gsk_path_unref (path);
+    gsk_stroke_set_dash (stroke, &dash, 1);
+    path = gsk_path_builder_free_to_path (missed);
+    gtk_snapshot_append_stroke (snapshot, path, stroke, &missed_color);
+    gsk_path_unref (path);
+    gsk_stroke_free (stroke);
 }
 
+/* Matches the current record against its namesake in the reference. */
 static void
-delete_annot (PanCanvas *self)
+update_agreement (PanCanvas *self)
 {
-    GListStore *annots_store;
-    PanAction *action;
-    int pos;
+    PanRecordList *records;
+    g_autoptr (GArray) test = NULL;
+    gpointer position;
+    guint n_annots;
 
-    annots_store = pan_record_annots (self->selected_record);
-    pos = gtk_single_selection_get_selected (self->annot_selection);
-    action = pan_action_delete_new (self->selected_record, self->selected_annot, pos);
-    stack_clear (&self->redo_stack);
-    stack_push_action (&self->undo_stack, action);
-    g_list_store_remove (annots_store, pos);
-    self->selected_annot = NULL;
-    self->hover_annot = NULL;
-    gtk_widget_queue_draw (GTK_WIDGET (self));
+    if (self->agreement_valid)
+        return;
+
+    g_array_set_size (self->reference_points, 0);
+    records = pan_document_records (self->reference);
+    if (g_hash_table_lookup_extended (self->reference_names,
+                                      pan_record_filename (self->selected_record),
+                                      NULL, &position))
+        pan_record_list_copy_points (records, GPOINTER_TO_UINT (position), self->reference_points);
+
+    test = g_array_new (FALSE, FALSE, sizeof (guint32));
+    n_annots = pan_record_copy_points (self->selected_record, test);
+
+    g_array_set_size (self->test_match, n_annots);
+    pan_agreement_match ((const guint32 *) self->reference_points->data, self->reference_points->len / 2,
+                         (const guint32 *) test->data, n_annots, self->match_distance,
+                         (guint32 *) self->test_match->data, NULL);
+    self->agreement_valid = TRUE;
 }
 
-static gboolean
-pan_canvas_key_press_cb (PanCanvas      *self,
-                         guint           keyval,
-                         guint           keycode,
-                         GdkModifierType state,
-                         gpointer        user_data)
+/*
+ * Wraps the image in a color matrix for the levels, window, contrast,
+ * brightness and channel, and in a gamma curve where GSK has one.  The
+ * renderer applies them, so changing them costs a redraw and nothing else.
+ * It samples 16-bit and float textures at their own precision, so a narrow
+ * window of a deep image still shows every step in it.
+ *
+ * Returns: the number of nodes pushed, for the caller to pop
+ */
+static guint
+push_adjustments (PanCanvas   *self,
+                  GtkSnapshot *snapshot)
 {
-    guint dx = 0,
-          dy = 0;
-
-    if (!self->selected_record)
-        return FALSE;
-
-    switch (keyval) {
-    case GDK_KEY_Up:
-        dy = -1;
-        break;
-    case GDK_KEY_Down:
-        dy = 1;
-        break;
-    case GDK_KEY_Left:
-        dx = -1;
-        break;
-    case GDK_KEY_Right:
-        dx = 1;
-        break;
-    case GDK_KEY_Delete:
-        delete_annot (self);
-        return TRUE;
-    default:
-        return FALSE;
+#if GTK_CHECK_VERSION (4, 20, 0)
+    GskComponentTransfer *transfer, *identity;
+#endif
+    graphene_matrix_t matrix;
+    graphene_vec4_t offset;
+    gfloat m[16] = { 0 };
+    gfloat o[4] = { 0 };
+    gfloat low, high, span, scale;
+    gboolean levels;
+    guint n_pushed = 0;
+    guint source;
+
+#if GTK_CHECK_VERSION (4, 20, 0)
+    /* Pushed first, so that it applies to the output of the matrix. */
+    if (self->gamma != 1.0) {
+        transfer = gsk_component_transfer_new_gamma (1.0, 1.0 / self->gamma, 0.0);
+        identity = gsk_component_transfer_new_identity ();
+        gtk_snapshot_push_component_transfer (snapshot, transfer, transfer, transfer, identity);
+        gsk_component_transfer_free (transfer);
+        gsk_component_transfer_free (identity);
+        n_pushed++;
     }
+#endif
+
+    levels = self->auto_levels && self->levels_valid;
+    if (!levels && self->brightness == 0.0 && self->contrast == 1.0 && self->channel == 0 &&
+        self->window == 1.0 && self->level == 0.5)
+        return n_pushed;
+
+    /* Row i of the matrix is what input channel i adds to each output. */
+    for (guint c = 0; c < 3; c++) {
+        source = self->channel == 0 ? c : self->channel - 1;
+        low    = levels ? self->levels.low[source] : 0.0f;
+        high   = levels ? self->levels.high[source] : 1.0f;
+        span   = high - low;
+        high   = low + (self->level + self->window / 2) * span;
+        low    = low + (self->level - self->window / 2) * span;
+        scale  = self->contrast / MAX (high - low, 1.0f / 65535);
+        m[source * 4 + c] = scale;
+        o[c] = -low * scale + 0.5 * (1.0 - self->contrast) + self->brightness;
+    }
+    m[15] = 1.0f;
 
-    pan_annot_translate (self->selected_annot, dx, dy);
-    gtk_widget_queue_draw (GTK_WIDGET (self));
-    return TRUE;
+    graphene_matrix_init_from_float (&matrix, m);
+    graphene_vec4_init_from_float (&offset, o);
+    gtk_snapshot_push_color_matrix (snapshot, &matrix, &offset);
+
+    return n_pushed + 1;
 }
 
+/*
+ * Levels are computed off the main thread, from a small decode for 8-bit
+ * images and from the texture itself for deeper ones.
+ */
 static void
-pan_canvas_button_press_cb (PanCanvas *self,
-                            gint       n_press,
-                            gdouble    x,
-                            gdouble    y,
-                            gpointer   user_data)
+start_levels (PanCanvas *self)
 {
-    PanAnnot *annot;
-    GListStore *annot_store;
-    guint n_annots;
-    guint annot_x, annot_y;
-    PanAction *action;
-    int scroll_x, scroll_y;
+    g_cancellable_cancel (self->levels_cancellable);
+    g_clear_object (&self->levels_cancellable);
+    self->levels_valid = FALSE;
 
-    if (!self->document)
+    if (!self->auto_levels || !self->image || !self->image_path)
         return;
 
-    scroll_x = gtk_adjustment_get_value (self->hadjustment);
-    scroll_y = gtk_adjustment_get_value (self->vadjustment);
+    self->levels_cancellable = g_cancellable_new ();
+    if (is_deep_format (gdk_texture_get_format (self->image)))
+        pan_levels_compute_texture_async (self->image, self->levels_cancellable,
+                                          levels_computed_cb, self);
+    else
+        pan_levels_compute_async (self->image_path, self->levels_cancellable,
+                                  levels_computed_cb, self);
+}
 
-    x = (int) (x / self->zoom_factor + scroll_x);
-    y = (int) (y / self->zoom_factor + scroll_y);
+/* Whether @format has more than 8 bits per channel. */
+static gboolean
+is_deep_format (GdkMemoryFormat format)
+{
+#if GTK_CHECK_VERSION (4, 12, 0)
+    if (format == GDK_MEMORY_G16 ||
+        format == GDK_MEMORY_G16A16_PREMULTIPLIED ||
+        format == GDK_MEMORY_G16A16)
+        return TRUE;
+#endif
+
+    return format == GDK_MEMORY_R16G16B16 ||
+           format == GDK_MEMORY_R16G16B16A16_PREMULTIPLIED ||
+           format == GDK_MEMORY_R16G16B16A16 ||
+           format == GDK_MEMORY_R16G16B16_FLOAT ||
+           format == GDK_MEMORY_R16G16B16A16_FLOAT_PREMULTIPLIED ||
+           format == GDK_MEMORY_R16G16B16A16_FLOAT ||
+           format == GDK_MEMORY_R32G32B32_FLOAT ||
+           format == GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED ||
+           format == GDK_MEMORY_R32G32B32A32_FLOAT;
+}
 
-    gtk_widget_grab_focus (GTK_WIDGET (self));
+/* Roughly what @texture takes in memory, counting 16-bit and float pixels. */
+static gsize
+texture_bytes (GdkTexture *texture)
+{
+    GdkMemoryFormat format;
+    gsize bpp;
+
+    format = gdk_texture_get_format (texture);
+    if (format == GDK_MEMORY_R32G32B32_FLOAT ||
+        format == GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED ||
+        format == GDK_MEMORY_R32G32B32A32_FLOAT)
+        bpp = 16;
+    else if (is_deep_format (format))
+        bpp = 8;
+    else
+        bpp = 4;
 
-    annot_store = pan_record_annots (self->selected_record);
-    n_annots = g_list_model_get_n_items (G_LIST_MODEL (annot_store));
-    for (guint i = 0; i < n_annots; i++) {
-        annot = g_list_model_get_item (G_LIST_MODEL (annot_store), i);
-        pan_annot_get_pos (annot, &annot_x, &annot_y);
-        if (graphene_point_near (&GRAPHENE_POINT_INIT (x, y),
-                                 &GRAPHENE_POINT_INIT (annot_x, annot_y),
-                                 self->radius)) {
-            self->selected_annot = annot;
-            self->is_dragging = TRUE;
-            self->prev_x = x;
-            self->prev_y = y;
-            self->old_x = x;
-            self->old_y = y;
-            gtk_selection_model_select_item (GTK_SELECTION_MODEL (self->annot_selection), i, TRUE);
-            gtk_widget_set_cursor (GTK_WIDGET (self), self->move_cursor);
-            gtk_widget_queue_draw (GTK_WIDGET (self));
-            return;
-        }
+    return (gsize) gdk_texture_get_width (texture) * gdk_texture_get_height (texture) * bpp;
+}
+
+/* Cancelled when the canvas goes away, so @user_data is alive otherwise. */
+static void
+levels_computed_cb (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+    PanCanvas *self;
+    PanLevels levels;
+    GError *error = NULL;
+
+    if (!pan_levels_compute_finish (result, &levels, &error)) {
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_warning ("Could not compute levels: %s", error->message);
+        g_error_free (error);
+        return;
     }
 
-    annot = pan_annot_new (x, y);
-    g_list_store_append (annot_store, annot);
-    action = pan_action_create_new (self->selected_record, annot);
-    stack_push_action (&self->undo_stack, action);
-    stack_clear (&self->redo_stack);
-    self->selected_annot = annot;
+    self = user_data;
+    self->levels       = levels;
+    self->levels_valid = TRUE;
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
-static void
-pan_canvas_button_released_cb (PanCanvas *self,
-                               gint       n_press,
-                               gdouble    x,
-                               gdouble    y,
-                               gpointer   user_data)
+/* The minimap is only shown while the image does not fit the canvas. */
+static gboolean
+minimap_bounds (PanCanvas       *self,
+                graphene_rect_t *bounds)
 {
-    PanAction *action;
-    guint new_x, new_y;
+    gint width, height;
 
-    if (self->is_dragging) {
-        self->is_dragging = FALSE;
-        gtk_widget_set_cursor (GTK_WIDGET (self), self->hand_cursor);
+    if (!self->show_minimap || !self->image)
+        return FALSE;
 
-        if (self->old_x != x || self->old_y != y) {
-            pan_annot_get_pos (self->selected_annot, &new_x, &new_y);
-            action = pan_action_move_new (self->selected_annot, self->old_x, self->old_y, new_x, new_y);
-            stack_push_action (&self->undo_stack, action);
-            stack_clear (&self->redo_stack);
-        }
-    }
+    width  = gtk_widget_get_width (GTK_WIDGET (self));
+    height = gtk_widget_get_height (GTK_WIDGET (self));
+    if (gdk_texture_get_width (self->image) * self->zoom_factor <= width &&
+        gdk_texture_get_height (self->image) * self->zoom_factor <= height)
+        return FALSE;
+
+    return pan_minimap_get_bounds (self->minimap, width, height, bounds);
 }
 
 static void
-pan_canvas_pointer_motion_cb (PanCanvas *self,
-                              gdouble    x,
-                              gdouble    y,
-                              gpointer   user_data)
+snapshot_minimap (PanCanvas   *self,
+                  GtkSnapshot *snapshot)
 {
-    gint scroll_x, scroll_y;
-    PanAnnot *annot;
-    GListStore *annot_store;
-    guint dx, dy;
-    guint annot_x, annot_y;
-    guint n_annots;
+    static const GdkRGBA frame_color = { 1.0, 1.0, 1.0, 0.9 };
+    graphene_rect_t bounds, viewport;
 
-    if (!self->document || !self->selected_record)
+    if (!minimap_bounds (self, &bounds))
         return;
 
-    scroll_x = gtk_adjustment_get_value (self->hadjustment);
-    scroll_y = gtk_adjustment_get_value (self->vadjustment);
-
-    x = (int) (x / self->zoom_factor + scroll_x);
-    y = (int) (y / self->zoom_factor + scroll_y);
+    /* The copy of the image cannot be rendered while we are snapshotting. */
+    if (!pan_minimap_has_texture (self->minimap) && self->minimap_source == 0)
+        self->minimap_source = g_idle_add (render_minimap_cb, self);
 
-    if (self->is_dragging) {
-        dx = x - self->prev_x;
-        dy = y - self->prev_y;
-        self->prev_x = x;
-        self->prev_y = y;
-        pan_annot_translate (self->selected_annot, dx, dy);
-        gtk_widget_queue_draw (GTK_WIDGET (self));
-        return;
-    }
+    graphene_rect_init (&viewport,
+                        gtk_adjustment_get_value (self->hadjustment),
+                        gtk_adjustment_get_value (self->vadjustment),
+                        gtk_widget_get_width (GTK_WIDGET (self)) / self->zoom_factor,
+                        gtk_widget_get_height (GTK_WIDGET (self)) / self->zoom_factor);
+    pan_minimap_snapshot (self->minimap, snapshot, &bounds, &viewport, &self->color, &frame_color);
+}
 
-    annot_store = pan_record_annots (self->selected_record);
-    n_annots = g_list_model_get_n_items (G_LIST_MODEL (annot_store));
-    for (guint i = 0; i < n_annots; i++) {
-        annot = g_list_model_get_item (G_LIST_MODEL (annot_store), i);
-        pan_annot_get_pos (annot, &annot_x, &annot_y);
-        if (graphene_point_near (&GRAPHENE_POINT_INIT (x, y), &GRAPHENE_POINT_INIT (annot_x, annot_y), self->radius)) {
-            self->hover_annot = annot;
-            gtk_widget_set_cursor (GTK_WIDGET (self), self->hand_cursor);
-            gtk_widget_queue_draw (GTK_WIDGET (self));
-            return;
-        }
-    }
+static gboolean
+render_minimap_cb (gpointer user_data)
+{
+    PanCanvas *self = user_data;
+    GtkNative *native;
 
-    if (self->hover_annot) {
-        self->hover_annot = NULL;
-        gtk_widget_set_cursor (GTK_WIDGET (self), self->normal_cursor);
+    self->minimap_source = 0;
+    native = gtk_widget_get_native (GTK_WIDGET (self));
+    if (self->image && native && gtk_native_get_renderer (native)) {
+        pan_minimap_render (self->minimap, gtk_native_get_renderer (native), self->image);
         gtk_widget_queue_draw (GTK_WIDGET (self));
     }
+
+    return G_SOURCE_REMOVE;
 }
 
+/* Scrolls so that the point of the image under (x, y) on the minimap is centred. */
 static void
-pan_canvas_pointer_enter_cb (PanCanvas *self,
-                             gdouble    x,
-                             gdouble    y,
-                             gpointer   user_data)
+center_on_minimap (PanCanvas             *self,
+                   const graphene_rect_t *bounds,
+                   gdouble                x,
+                   gdouble                y)
 {
+    gdouble image_x, image_y;
+
+    pan_minimap_to_image (self->minimap, bounds, x, y, &image_x, &image_y);
+    gtk_adjustment_set_value (self->hadjustment,
+                              image_x - gtk_widget_get_width (GTK_WIDGET (self)) / self->zoom_factor / 2);
+    gtk_adjustment_set_value (self->vadjustment,
+                              image_y - gtk_widget_get_height (GTK_WIDGET (self)) / self->zoom_factor / 2);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+/* Draws the counters in the top left corner, unaffected by zoom. */
 static void
-pan_canvas_pointer_leave_cb (PanCanvas *self,
-                             gdouble    x,
-                             gdouble    y,
-                             gpointer   user_data)
+snapshot_overlay (PanCanvas   *self,
+                  GtkSnapshot *snapshot)
+{
+    PangoLayout *layout;
+    PangoFontDescription *font;
+    gchar *text;
+    gint width, height;
+
+    text = pan_perf_to_string (self->perf);
+    layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
+    font = pango_font_description_from_string ("Monospace 9");
+    pango_layout_set_font_description (layout, font);
+    pango_layout_get_pixel_size (layout, &width, &height);
+
+    gtk_snapshot_append_color (snapshot, &(GdkRGBA) { 0.0, 0.0, 0.0, 0.6 },
+                               &GRAPHENE_RECT_INIT (OVERLAY_MARGIN, OVERLAY_MARGIN,
+                                                    width + 2 * OVERLAY_MARGIN,
+                                                    height + 2 * OVERLAY_MARGIN));
+    gtk_snapshot_save (snapshot);
+    gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (2 * OVERLAY_MARGIN, 2 * OVERLAY_MARGIN));
+    gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 1.0, 1.0, 1.0, 1.0 });
+    gtk_snapshot_restore (snapshot);
+
+    pango_font_description_free (font);
+    g_object_unref (layout);
+    g_free (text);
+}
+
+static void
+pan_canvas_size_allocate (GtkWidget *widget,
+                          gint       width,
+                          gint       height,
+                          gint       baseline)
+{
+    configure_adjustments (PAN_CANVAS (widget), width, height);
+}
+
+/*
+ * The adjustments are in image pixels, like their values, which are the
+ * image point at the top left corner of the widget.
+ */
+static void
+configure_adjustments (PanCanvas *self,
+                       gint       width,
+                       gint       height)
+{
+    gdouble page;
+
+    if (!self->image)
+        return;
+
+    page = width / self->zoom_factor;
+    gtk_adjustment_configure (self->hadjustment, gtk_adjustment_get_value (self->hadjustment),
+                              0, gdk_texture_get_width (self->image), page * 0.1, page, page);
+
+    page = height / self->zoom_factor;
+    gtk_adjustment_configure (self->vadjustment, gtk_adjustment_get_value (self->vadjustment),
+                              0, gdk_texture_get_height (self->image), page * 0.1, page, page);
+}
+
+/* Sets the zoom at once, keeping the image point under (@x, @y) in place. */
+static void
+set_zoom_at (PanCanvas *self,
+             gdouble    zoom,
+             gdouble    x,
+             gdouble    y)
+{
+    gdouble image_x, image_y;
+
+    image_x = x / self->zoom_factor + gtk_adjustment_get_value (self->hadjustment);
+    image_y = y / self->zoom_factor + gtk_adjustment_get_value (self->vadjustment);
+
+    self->zoom_factor = CLAMP (zoom, MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+    configure_adjustments (self,
+                           gtk_widget_get_width (GTK_WIDGET (self)),
+                           gtk_widget_get_height (GTK_WIDGET (self)));
+    gtk_adjustment_set_value (self->hadjustment, image_x - x / self->zoom_factor);
+    gtk_adjustment_set_value (self->vadjustment, image_y - y / self->zoom_factor);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/* The zoom the canvas is at or on its way to. */
+static gdouble
+zoom_goal (PanCanvas *self)
+{
+    return self->zoom_tick_id ? self->zoom_target : self->zoom_factor;
+}
+
+/*
+ * Zooms to @zoom over ZOOM_DURATION, anchored at (@x, @y).  A new target
+ * while one is running starts from wherever the zoom is.  Each frame only
+ * changes the transform and the adjustments, so nothing is laid out again.
+ */
+static void
+animate_zoom (PanCanvas *self,
+              gdouble    zoom,
+              gdouble    x,
+              gdouble    y)
+{
+    GdkFrameClock *frame_clock;
+    gboolean animations;
+
+    g_object_get (gtk_widget_get_settings (GTK_WIDGET (self)),
+                  "gtk-enable-animations", &animations, NULL);
+    frame_clock = gtk_widget_get_frame_clock (GTK_WIDGET (self));
+    if (!frame_clock || !animations) {
+        stop_zoom (self);
+        set_zoom_at (self, zoom, x, y);
+        return;
+    }
+
+    self->zoom_from       = self->zoom_factor;
+    self->zoom_target     = CLAMP (zoom, MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+    self->zoom_x          = x;
+    self->zoom_y          = y;
+    self->zoom_start_time = gdk_frame_clock_get_frame_time (frame_clock);
+    if (!self->zoom_tick_id)
+        self->zoom_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self), zoom_tick_cb, NULL, NULL);
+}
+
+static gboolean
+zoom_tick_cb (GtkWidget     *widget,
+              GdkFrameClock *frame_clock,
+              gpointer       user_data)
+{
+    PanCanvas *self;
+    gdouble t;
+
+    self = PAN_CANVAS (widget);
+    t = (gdouble) (gdk_frame_clock_get_frame_time (frame_clock) - self->zoom_start_time) / ZOOM_DURATION;
+    if (t >= 1.0) {
+        /* Cleared first, so that the last frame is drawn at full quality. */
+        self->zoom_tick_id = 0;
+        set_zoom_at (self, self->zoom_target, self->zoom_x, self->zoom_y);
+        return G_SOURCE_REMOVE;
+    }
+
+    /* Eased out, and geometric so that each step looks the same size. */
+    t = 1.0 - pow (1.0 - t, 3);
+    set_zoom_at (self, self->zoom_from * pow (self->zoom_target / self->zoom_from, t),
+                 self->zoom_x, self->zoom_y);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+stop_zoom (PanCanvas *self)
+{
+    if (!self->zoom_tick_id)
+        return;
+
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->zoom_tick_id);
+    self->zoom_tick_id = 0;
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static GtkBitset *
+get_selection (PanCanvas *self)
+{
+    if (!self->annot_selection)
+        return gtk_bitset_new_empty ();
+
+    return gtk_selection_model_get_selection (GTK_SELECTION_MODEL (self->annot_selection));
+}
+
+static void
+set_selection (PanCanvas *self,
+               GtkBitset *selected)
+{
+    GtkBitset *mask;
+    guint n_annots;
+
+    n_annots = g_list_model_get_n_items (G_LIST_MODEL (self->annot_selection));
+    mask = gtk_bitset_new_range (0, n_annots);
+    gtk_selection_model_set_selection (GTK_SELECTION_MODEL (self->annot_selection), selected, mask);
+    gtk_bitset_unref (mask);
+}
+
+/*
+ * Moves the points without touching the spatial index.  Nothing queries it
+ * while a drag is under way, and push_moves() marks it stale once, when
+ * the move is recorded.
+ */
+static void
+translate_set (PanCanvas *self,
+               GtkBitset *set,
+               guint      dx,
+               guint      dy)
+{
+    GListStore *annots_store;
+    GtkBitsetIter iter;
+    PanAnnot *annot;
+    guint pos;
+    guint x, y;
+
+    annots_store = pan_record_annots (self->selected_record);
+    if (!gtk_bitset_iter_init_first (&iter, set, &pos))
+        return;
+
+    do {
+        annot = g_list_model_get_item (G_LIST_MODEL (annots_store), pos);
+        pan_annot_get_pos (annot, &x, &y);
+        pan_annot_translate (annot, dx, dy);
+        pan_minimap_move_point (self->minimap, x, y, x + dx, y + dy);
+        g_object_unref (annot);
+    } while (gtk_bitset_iter_next (&iter, &pos));
+}
+
+/*
+ * Records that the annotations in set were moved by (dx, dy).  A single
+ * annotation gets a plain move, so that nudges with the arrow keys keep
+ * merging; anything larger becomes one group.
+ */
+static void
+push_moves (PanCanvas *self,
+            GtkBitset *set,
+            guint      dx,
+            guint      dy)
+{
+    g_autoptr (PanActionGroup) group = NULL;
+    GListStore *annots_store;
+    GtkBitsetIter iter;
+    PanAnnot *annot;
+    PanAction action;
+    guint x, y;
+    guint pos;
+
+    annots_store = pan_record_annots (self->selected_record);
+    if (!gtk_bitset_iter_init_first (&iter, set, &pos))
+        return;
+
+    if (gtk_bitset_get_size (set) > 1)
+        group = pan_action_group_new ();
+
+    do {
+        annot = g_list_model_get_item (G_LIST_MODEL (annots_store), pos);
+        pan_annot_get_pos (annot, &x, &y);
+        g_object_unref (annot);
+        action = pan_action_move (pos, x - dx, y - dy, x, y);
+        if (group)
+            pan_action_group_add (group, &action);
+    } while (gtk_bitset_iter_next (&iter, &pos));
+
+    if (group)
+        action = pan_action_group_end (g_steal_pointer (&group));
+    push_action (self, &action);
+}
+
+static void
+delete_selection (PanCanvas *self)
+{
+    g_autoptr (PanActionGroup) group = NULL;
+    GListStore *annots_store;
+    GtkBitset *selected;
+    GtkBitsetIter iter;
+    PanAnnot *annot;
+    PanAction action;
+    guint annot_x, annot_y;
+    guint pos;
+
+    if (!self->selected_record)
+        return;
+
+    selected = get_selection (self);
+    if (!gtk_bitset_iter_init_first (&iter, selected, &pos)) {
+        gtk_bitset_unref (selected);
+        return;
+    }
+
+    annots_store = pan_record_annots (self->selected_record);
+    if (gtk_bitset_get_size (selected) > 1)
+        group = pan_action_group_new ();
+
+    do {
+        annot = g_list_model_get_item (G_LIST_MODEL (annots_store), pos);
+        pan_annot_get_pos (annot, &annot_x, &annot_y);
+        g_object_unref (annot);
+        action = pan_action_delete (pos, annot_x, annot_y);
+        if (group)
+            pan_action_group_add (group, &action);
+    } while (gtk_bitset_iter_next (&iter, &pos));
+    gtk_bitset_unref (selected);
+
+    if (group)
+        action = pan_action_group_end (g_steal_pointer (&group));
+    pan_action_redo (&action, annots_store);
+    push_action (self, &action);
+    self->hover_pos = GTK_INVALID_LIST_POSITION;
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static gboolean
+handle_key (PanCanvas      *self,
+            guint           keyval,
+            GdkModifierType state)
+{
+    guint dx = 0,
+          dy = 0;
+    GtkBitset *selected;
+
+    if (!self->selected_record || self->drag_mode != DRAG_NONE)
+        return FALSE;
+
+    switch (keyval) {
+    case GDK_KEY_Up:
+        dy = -1;
+        break;
+    case GDK_KEY_Down:
+        dy = 1;
+        break;
+    case GDK_KEY_Left:
+        dx = -1;
+        break;
+    case GDK_KEY_Right:
+        dx = 1;
+        break;
+    case GDK_KEY_Delete:
+        delete_selection (self);
+        return TRUE;
+    default:
+        return FALSE;
+    }
+
+    selected = get_selection (self);
+    if (gtk_bitset_is_empty (selected)) {
+        gtk_bitset_unref (selected);
+        return FALSE;
+    }
+
+    /* Held arrow keys merge into one history step, for several points too. */
+    translate_set (self, selected, dx, dy);
+    push_moves (self, selected, dx, dy);
+    gtk_bitset_unref (selected);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+    return TRUE;
+}
+
+static gboolean
+pan_canvas_key_press_cb (PanCanvas      *self,
+                         guint           keyval,
+                         guint           keycode,
+                         GdkModifierType state,
+                         gpointer        user_data)
+{
+    trace_event (self, PAN_EVENT_KEY, keyval, state, 0, 0);
+
+    return handle_key (self, keyval, state);
+}
+
+/*
+ * A press on an annotation selects it and starts moving the selection,
+ * or toggles it with Shift or Ctrl held.  On empty space Shift starts a
+ * box selection, Ctrl a lasso, and a plain click creates an annotation.
+ */
+static void
+handle_press (PanCanvas      *self,
+              gint            n_press,
+              gdouble         x,
+              gdouble         y,
+              GdkModifierType state)
+{
+    PanAnnot *annot;
+    GListStore *annot_store;
+    graphene_rect_t bounds;
+    guint n_annots;
+    guint pos;
+    PanAction action;
+    gdouble scroll_x, scroll_y;
+
+    if (!self->document || !self->selected_record)
+        return;
+
+    if (minimap_bounds (self, &bounds) &&
+        graphene_rect_contains_point (&bounds, &GRAPHENE_POINT_INIT (x, y))) {
+        self->drag_mode = DRAG_MINIMAP;
+        center_on_minimap (self, &bounds, x, y);
+        return;
+    }
+
+    scroll_x = gtk_adjustment_get_value (self->hadjustment);
+    scroll_y = gtk_adjustment_get_value (self->vadjustment);
+
+    x = (int) (x / self->zoom_factor + scroll_x);
+    y = (int) (y / self->zoom_factor + scroll_y);
+
+    gtk_widget_grab_focus (GTK_WIDGET (self));
+
+    self->prev_x = x;
+    self->prev_y = y;
+
+    pos = pick (self, x, y);
+    if (pos != GTK_INVALID_LIST_POSITION) {
+        if (state & (GDK_SHIFT_MASK | GDK_CONTROL_MASK)) {
+            if (gtk_selection_model_is_selected (GTK_SELECTION_MODEL (self->annot_selection), pos))
+                gtk_selection_model_unselect_item (GTK_SELECTION_MODEL (self->annot_selection), pos);
+            else
+                gtk_selection_model_select_item (GTK_SELECTION_MODEL (self->annot_selection), pos, FALSE);
+            return;
+        }
+
+        if (!gtk_selection_model_is_selected (GTK_SELECTION_MODEL (self->annot_selection), pos))
+            gtk_selection_model_select_item (GTK_SELECTION_MODEL (self->annot_selection), pos, TRUE);
+
+        self->drag_mode = DRAG_MOVE;
+        self->drag_set  = get_selection (self);
+        self->drag_dx   = 0;
+        self->drag_dy   = 0;
+        gtk_widget_set_cursor (GTK_WIDGET (self), self->move_cursor);
+        return;
+    }
+
+    if (state & GDK_SHIFT_MASK) {
+        self->drag_mode = DRAG_BOX;
+        self->band_x = x;
+        self->band_y = y;
+        return;
+    }
+
+    if (state & GDK_CONTROL_MASK) {
+        self->drag_mode = DRAG_LASSO;
+        g_array_set_size (self->lasso, 0);
+        g_array_append_val (self->lasso, GRAPHENE_POINT_INIT (x, y));
+        return;
+    }
+
+    annot_store = pan_record_annots (self->selected_record);
+    n_annots = g_list_model_get_n_items (G_LIST_MODEL (annot_store));
+    annot = pan_annot_new (x, y);
+    g_list_store_append (annot_store, annot);
+    g_object_unref (annot);
+    action = pan_action_create (n_annots, x, y);
+    push_action (self, &action);
+    gtk_selection_model_select_item (GTK_SELECTION_MODEL (self->annot_selection), n_annots, TRUE);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+pan_canvas_button_press_cb (PanCanvas *self,
+                            gint       n_press,
+                            gdouble    x,
+                            gdouble    y,
+                            gpointer   user_data)
+{
+    GdkModifierType state;
+
+    state = gtk_event_controller_get_current_event_state (GTK_EVENT_CONTROLLER (user_data));
+    trace_event (self, PAN_EVENT_PRESS, n_press, state, x, y);
+    handle_press (self, n_press, x, y, state);
+}
+
+static guint
+pick (PanCanvas *self,
+      guint      x,
+      guint      y)
+{
+    gint64 start;
+    guint pos;
+
+    start = g_get_monotonic_time ();
+    pos = pan_spatial_index_pick (self->index, x, y, self->radius);
+    pan_perf_record (self->perf, PAN_PERF_HIT_TEST, g_get_monotonic_time () - start);
+
+    return pos;
+}
+
+static void
+finish_drag (PanCanvas *self)
+{
+    GtkBitset *selected;
+
+    switch (self->drag_mode) {
+    case DRAG_MOVE:
+        if (self->drag_dx != 0 || self->drag_dy != 0)
+            push_moves (self, self->drag_set, self->drag_dx, self->drag_dy);
+        g_clear_pointer (&self->drag_set, gtk_bitset_unref);
+        break;
+    case DRAG_BOX:
+        selected = gtk_bitset_new_empty ();
+        pan_spatial_index_query_rect (self->index,
+                                      MIN (self->band_x, self->prev_x),
+                                      MIN (self->band_y, self->prev_y),
+                                      MAX (self->band_x, self->prev_x),
+                                      MAX (self->band_y, self->prev_y),
+                                      selected);
+        set_selection (self, selected);
+        gtk_bitset_unref (selected);
+        break;
+    case DRAG_LASSO:
+        selected = gtk_bitset_new_empty ();
+        pan_spatial_index_query_polygon (self->index,
+                                         (const graphene_point_t *) self->lasso->data,
+                                         self->lasso->len,
+                                         selected);
+        set_selection (self, selected);
+        gtk_bitset_unref (selected);
+        g_array_set_size (self->lasso, 0);
+        break;
+    case DRAG_MINIMAP:
+        break;
+    case DRAG_NONE:
+    default:
+        return;
+    }
+
+    self->drag_mode = DRAG_NONE;
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+handle_release (PanCanvas *self)
+{
+    if (self->drag_mode == DRAG_MOVE)
+        gtk_widget_set_cursor (GTK_WIDGET (self), self->hand_cursor);
+
+    finish_drag (self);
+}
+
+static void
+pan_canvas_button_released_cb (PanCanvas *self,
+                               gint       n_press,
+                               gdouble    x,
+                               gdouble    y,
+                               gpointer   user_data)
+{
+    trace_event (self, PAN_EVENT_RELEASE, n_press, 0, x, y);
+    handle_release (self);
+}
+
+static void
+pan_canvas_drag_end_cb (PanCanvas *self,
+                        gdouble    offset_x,
+                        gdouble    offset_y,
+                        gpointer   user_data)
+{
+    trace_event (self, PAN_EVENT_DRAG_END, 0, 0, offset_x, offset_y);
+    handle_release (self);
+}
+
+static void
+handle_motion (PanCanvas *self,
+               gdouble    x,
+               gdouble    y)
+{
+    graphene_rect_t bounds;
+    gdouble scroll_x, scroll_y;
+    guint dx, dy;
+    guint pos;
+
+    if (!self->document || !self->selected_record)
+        return;
+
+    if (self->drag_mode == DRAG_MINIMAP) {
+        if (minimap_bounds (self, &bounds))
+            center_on_minimap (self, &bounds, x, y);
+        return;
+    }
+
+    scroll_x = gtk_adjustment_get_value (self->hadjustment);
+    scroll_y = gtk_adjustment_get_value (self->vadjustment);
+
+    x = (int) (x / self->zoom_factor + scroll_x);
+    y = (int) (y / self->zoom_factor + scroll_y);
+
+    switch (self->drag_mode) {
+    case DRAG_MOVE:
+        dx = x - self->prev_x;
+        dy = y - self->prev_y;
+        self->prev_x = x;
+        self->prev_y = y;
+        self->drag_dx += dx;
+        self->drag_dy += dy;
+        translate_set (self, self->drag_set, dx, dy);
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+        return;
+    case DRAG_BOX:
+        self->prev_x = MAX (x, 0);
+        self->prev_y = MAX (y, 0);
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+        return;
+    case DRAG_LASSO:
+        g_array_append_val (self->lasso, GRAPHENE_POINT_INIT (x, y));
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+        return;
+    case DRAG_MINIMAP:
+    case DRAG_NONE:
+    default:
+        break;
+    }
+
+    pos = pick (self, x, y);
+    if (pos == self->hover_pos)
+        return;
+
+    self->hover_pos = pos;
+    gtk_widget_set_cursor (GTK_WIDGET (self),
+                           pos != GTK_INVALID_LIST_POSITION ? self->hand_cursor : self->normal_cursor);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+pan_canvas_pointer_motion_cb (PanCanvas *self,
+                              gdouble    x,
+                              gdouble    y,
+                              gpointer   user_data)
+{
+    self->pointer_x = x;
+    self->pointer_y = y;
+    trace_event (self, PAN_EVENT_MOTION, 0, 0, x, y);
+    handle_motion (self, x, y);
+}
+
+static void
+pan_canvas_pointer_enter_cb (PanCanvas *self,
+                             gdouble    x,
+                             gdouble    y,
+                             gpointer   user_data)
+{
+    self->pointer_x = x;
+    self->pointer_y = y;
+}
+
+/* Ctrl+scroll zooms at the pointer; plain scrolling is left to the parent. */
+static gboolean
+pan_canvas_scroll_cb (PanCanvas *self,
+                      gdouble    dx,
+                      gdouble    dy,
+                      gpointer   user_data)
+{
+    GtkEventController *controller;
+    GdkModifierType state;
+    gdouble zoom;
+
+    controller = GTK_EVENT_CONTROLLER (user_data);
+    state = gtk_event_controller_get_current_event_state (controller);
+    if (!(state & GDK_CONTROL_MASK) || !self->image)
+        return FALSE;
+
+    if (gtk_event_controller_scroll_get_unit (GTK_EVENT_CONTROLLER_SCROLL (controller)) == GDK_SCROLL_UNIT_SURFACE)
+        dy /= SCROLL_STEP_PIXELS;
+
+    zoom = CLAMP (zoom_goal (self) * pow (SCROLL_ZOOM_STEP, -dy), MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+    trace_event (self, PAN_EVENT_ZOOM, (guint) round (zoom * 1000), 0, self->pointer_x, self->pointer_y);
+    animate_zoom (self, zoom, self->pointer_x, self->pointer_y);
+
+    return TRUE;
+}
+
+static void
+pan_canvas_pinch_begin_cb (PanCanvas        *self,
+                           GdkEventSequence *sequence,
+                           gpointer          user_data)
+{
+    stop_zoom (self);
+    self->pinch_zoom = self->zoom_factor;
+    self->pinching   = TRUE;
+}
+
+static void
+pan_canvas_pinch_end_cb (PanCanvas        *self,
+                         GdkEventSequence *sequence,
+                         gpointer          user_data)
+{
+    self->pinching = FALSE;
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/* A pinch follows the fingers directly, anchored between them. */
+static void
+pan_canvas_pinch_cb (PanCanvas *self,
+                     gdouble    scale,
+                     gpointer   user_data)
+{
+    gdouble x, y, zoom;
+
+    if (!self->image || !gtk_gesture_get_bounding_box_center (GTK_GESTURE (user_data), &x, &y))
+        return;
+
+    zoom = CLAMP (self->pinch_zoom * scale, MIN_ZOOM_FACTOR, MAX_ZOOM_FACTOR);
+    trace_event (self, PAN_EVENT_ZOOM, (guint) round (zoom * 1000), 0, x, y);
+    set_zoom_at (self, zoom, x, y);
+}
+
+static void
+pan_canvas_pointer_leave_cb (PanCanvas *self,
+                             gdouble    x,
+                             gdouble    y,
+                             gpointer   user_data)
 {
 }
 
@@ -853,10 +2107,11 @@ pan_canvas_zoom_in (PanCanvas *self)
 {
     g_return_if_fail (PAN_IS_CANVAS (self));
 
-    if (self->zoom_factor + ZOOM_DELTA <= MAX_ZOOM_FACTOR)
-        self->zoom_factor += ZOOM_DELTA;
-    gtk_widget_queue_allocate (GTK_WIDGET (self));
-    gtk_widget_queue_draw (GTK_WIDGET (self));
+    trace_event (self, PAN_EVENT_ZOOM_IN, 0, 0, 0, 0);
+
+    animate_zoom (self, zoom_goal (self) + ZOOM_DELTA,
+                  gtk_widget_get_width (GTK_WIDGET (self)) / 2.0,
+                  gtk_widget_get_height (GTK_WIDGET (self)) / 2.0);
 }
 
 void
@@ -864,10 +2119,11 @@ pan_canvas_zoom_out (PanCanvas *self)
 {
     g_return_if_fail (PAN_IS_CANVAS (self));
 
-    if (self->zoom_factor - ZOOM_DELTA >= MIN_ZOOM_FACTOR)
-        self->zoom_factor -= ZOOM_DELTA;
-    gtk_widget_queue_allocate (GTK_WIDGET (self));
-    gtk_widget_queue_draw (GTK_WIDGET (self));
+    trace_event (self, PAN_EVENT_ZOOM_OUT, 0, 0, 0, 0);
+
+    animate_zoom (self, zoom_goal (self) - ZOOM_DELTA,
+                  gtk_widget_get_width (GTK_WIDGET (self)) / 2.0,
+                  gtk_widget_get_height (GTK_WIDGET (self)) / 2.0);
 }
 
 void
@@ -875,9 +2131,12 @@ pan_canvas_zoom_original (PanCanvas *self)
 {
     g_return_if_fail (PAN_IS_CANVAS (self));
 
-    self->zoom_factor = 1.0;
-    gtk_widget_queue_allocate (GTK_WIDGET (self));
-    gtk_widget_queue_draw (GTK_WIDGET (self));
+    trace_event (self, PAN_EVENT_ZOOM_ORIGINAL, 0, 0, 0, 0);
+
+    stop_zoom (self);
+    set_zoom_at (self, 1.0,
+                 gtk_widget_get_width (GTK_WIDGET (self)) / 2.0,
+                 gtk_widget_get_height (GTK_WIDGET (self)) / 2.0);
 }
 
 void
@@ -887,9 +2146,12 @@ pan_canvas_zoom_fit (PanCanvas *self)
     gint viewport_width, viewport_height;
     gboolean scale_x, scale_y;
     gfloat x_ratio, y_ratio;
+    gfloat zoom;
 
     g_return_if_fail (PAN_IS_CANVAS (self));
 
+    trace_event (self, PAN_EVENT_ZOOM_FIT, 0, 0, 0, 0);
+
     img_width = gdk_texture_get_width (self->image);
     img_height = gdk_texture_get_height (self->image);
     viewport_width = gtk_widget_get_width (GTK_WIDGET (self));
@@ -901,16 +2163,16 @@ pan_canvas_zoom_fit (PanCanvas *self)
     y_ratio = viewport_height / (float) img_height;
 
     if (scale_x && scale_y)
-        self->zoom_factor = MIN (x_ratio, y_ratio);
+        zoom = MIN (x_ratio, y_ratio);
     else if (scale_x)
-        self->zoom_factor = x_ratio;
+        zoom = x_ratio;
     else if (scale_y)
-        self->zoom_factor = y_ratio;
+        zoom = y_ratio;
+    else
+        return;
 
-    if (scale_x || scale_y) {
-        gtk_widget_queue_allocate (GTK_WIDGET (self));
-        gtk_widget_queue_draw (GTK_WIDGET (self));
-    }
+    stop_zoom (self);
+    set_zoom_at (self, zoom, viewport_width / 2.0, viewport_height / 2.0);
 }
 
 static void
@@ -954,24 +2216,52 @@ pan_canvas_delete_action_cb (GtkWidget  *widget,
                              const char *action_name,
                              GVariant   *parameter)
 {
-    delete_annot (PAN_CANVAS (widget));
+    delete_selection (PAN_CANVAS (widget));
 }
 
 static void
 load_record (PanCanvas *self)
 {
     GListStore *annots_store;
+    GtkBitset *selected;
     gchar *root_path, *filename, *img_path;
+    gint64 begin;
 
-    self->selected_record = gtk_single_selection_get_selected_item (self->record_selection);
-    annots_store = pan_record_annots (self->selected_record);
+    begin = PAN_PROFILER_CURRENT_TIME;
+    finish_drag (self);
 
+    /* The selection is kept for the record it belongs to. */
     if (self->annot_selection) {
+        selected = get_selection (self);
+        if (!self->selected_record || gtk_bitset_is_empty (selected))
+            g_hash_table_remove (self->selections, GUINT_TO_POINTER (self->selected_position));
+        else
+            g_hash_table_insert (self->selections, GUINT_TO_POINTER (self->selected_position),
+                                 gtk_bitset_ref (selected));
+        gtk_bitset_unref (selected);
+
         g_signal_handlers_disconnect_by_func (self->annot_selection, pan_widget_annot_selection_changed_cb, self);
-        g_object_unref (self->annot_selection);
+        g_clear_object (&self->annot_selection);
     }
 
-    self->annot_selection = gtk_single_selection_new (G_LIST_MODEL (g_object_ref (annots_store)));
+    g_set_object (&self->selected_record, gtk_single_selection_get_selected_item (self->record_selection));
+    self->selected_position = gtk_single_selection_get_selected (self->record_selection);
+    self->hover_pos = GTK_INVALID_LIST_POSITION;
+    self->agreement_valid = FALSE;
+    if (!self->selected_record) {
+        pan_spatial_index_set_model (self->index, NULL);
+        pan_minimap_set_model (self->minimap, NULL);
+        return;
+    }
+
+    annots_store = pan_record_annots (self->selected_record);
+    pan_spatial_index_set_model (self->index, G_LIST_MODEL (annots_store));
+    pan_minimap_set_model (self->minimap, G_LIST_MODEL (annots_store));
+
+    self->annot_selection = gtk_multi_selection_new (G_LIST_MODEL (g_object_ref (annots_store)));
+    selected = g_hash_table_lookup (self->selections, GUINT_TO_POINTER (self->selected_position));
+    if (selected)
+        set_selection (self, selected);
     g_signal_connect (GTK_SELECTION_MODEL (self->annot_selection), "selection-changed", G_CALLBACK (pan_widget_annot_selection_changed_cb), self);
 
     root_path = pan_document_get_root_path (self->document);
@@ -980,12 +2270,10 @@ load_record (PanCanvas *self)
 
     load_image (self, img_path);
 
-    stack_clear (&self->undo_stack);
-    stack_clear (&self->redo_stack);
-
     gtk_widget_queue_allocate (GTK_WIDGET (self));
     gtk_widget_queue_draw (GTK_WIDGET (self));
 
+    PAN_PROFILER_ADD_MARK (begin, "load_record", filename);
     g_free (img_path);
 }
 
@@ -995,21 +2283,28 @@ record_changed (GtkSelectionModel *self,
                 guint              n_items,
                 gpointer           user_data)
 {
-    load_record (PAN_CANVAS (user_data));
+    PanCanvas *canvas = user_data;
+
+    trace_event (canvas, PAN_EVENT_SELECT_RECORD,
+                 gtk_single_selection_get_selected (canvas->record_selection), 0, 0, 0);
+    load_record (canvas);
 }
 
 void
 pan_canvas_set_document (PanCanvas   *self,
                          PanDocument *document)
 {
-    GListStore *records;
+    PanRecordList *records;
 
     g_return_if_fail (PAN_IS_CANVAS (self));
     g_return_if_fail (PAN_IS_DOCUMENT (document));
 
+    finish_drag (self);
     g_clear_object (&self->document);
     g_clear_object (&self->record_selection);
     g_clear_object (&self->annot_selection);
+    g_clear_object (&self->selected_record);
+    g_hash_table_remove_all (self->selections);
 
     self->document = g_object_ref (document);
 
@@ -1031,10 +2326,27 @@ static void
 load_image (PanCanvas *self,
             gchar     *img_path)
 {
+    gint64 start, begin;
+
     g_clear_object (&self->image);
+    begin = PAN_PROFILER_CURRENT_TIME;
+    start = g_get_monotonic_time ();
+    /* GDK keeps 16-bit and float PNG and TIFF images at their own depth. */
     self->image = gdk_texture_new_from_filename (img_path, NULL);
-    if (!self->image)
+    pan_perf_record (self->perf, PAN_PERF_DECODE, g_get_monotonic_time () - start);
+    PAN_PROFILER_ADD_MARK (begin, "load_image", img_path);
+    pan_minimap_set_image (self->minimap, self->image);
+    g_clear_handle_id (&self->minimap_source, g_source_remove);
+    g_free (self->image_path);
+    self->image_path = g_strdup (img_path);
+    start_levels (self);
+    if (!self->image) {
         g_warning ("set_image: Invalid image file: %s",  img_path);
+        pan_perf_set_counter (self->perf, PAN_PERF_TEXTURE_BYTES, 0);
+        return;
+    }
+
+    pan_perf_set_counter (self->perf, PAN_PERF_TEXTURE_BYTES, texture_bytes (self->image));
 }
 
 void
@@ -1053,8 +2365,14 @@ pan_canvas_prev (PanCanvas *self)
     g_return_if_fail (PAN_IS_CANVAS (self));
 
     pos = gtk_single_selection_get_selected (self->record_selection);
-    if (pos >= 1)
-        gtk_single_selection_set_selected (self->record_selection, pos - 1);
+    if (pos == GTK_INVALID_LIST_POSITION)
+        return;
+    for (guint prev = pos; prev-- > 0;) {
+        if (!is_skipped (self, prev)) {
+            gtk_single_selection_set_selected (self->record_selection, prev);
+            return;
+        }
+    }
 }
 
 void
@@ -1066,8 +2384,12 @@ pan_canvas_next (PanCanvas *self)
 
     g_object_get (self->record_selection, "n-items", &n, NULL);
     pos = gtk_single_selection_get_selected (self->record_selection);
-    if (pos + 1 < n)
-        gtk_single_selection_set_selected (self->record_selection, pos + 1);
+    for (guint next = pos + 1; next < n; next++) {
+        if (!is_skipped (self, next)) {
+            gtk_single_selection_set_selected (self->record_selection, next);
+            return;
+        }
+    }
 }
 
 void
@@ -1091,13 +2413,13 @@ pan_canvas_get_record_selection_model (PanCanvas *self)
     return g_object_ref (self->record_selection);
 }
 
-GtkSingleSelection *
+GtkSelectionModel *
 pan_canvas_get_annot_selection_model (PanCanvas *self)
 {
     g_return_val_if_fail (PAN_IS_CANVAS (self), NULL);
     // g_assert (self->annot_selection);
 
-    return self->annot_selection;
+    return GTK_SELECTION_MODEL (self->annot_selection);
 }
 
 
@@ -1107,65 +2429,371 @@ pan_widget_annot_selection_changed_cb (GtkSelectionModel *model,
                                        guint              n_items,
                                        gpointer           user_data)
 {
-    PanCanvas *canvas = user_data;
-
-    canvas->selected_annot = gtk_single_selection_get_selected_item (GTK_SINGLE_SELECTION (model));
     gtk_widget_queue_draw (GTK_WIDGET (user_data));
 }
 
 static void
-stack_push_action (GSList    **stack,
-                   PanAction  *action)
+push_action (PanCanvas       *self,
+             const PanAction *action)
+{
+    pan_history_push (pan_record_get_history (self->selected_record), action);
+    annots_changed (self);
+}
+
+/* The index and the statistics both go stale with every edit. */
+static void
+annots_changed (PanCanvas *self)
 {
-    *stack = g_slist_prepend (*stack, action);
+    pan_spatial_index_invalidate (self->index);
+    self->agreement_valid = FALSE;
+    pan_document_record_changed (self->document,
+                                 gtk_single_selection_get_selected (self->record_selection));
 }
 
-static PanAction *
-stack_pop_action (GSList **stack)
+/* Images flagged as looking like an earlier one are passed over when stepping. */
+static gboolean
+is_skipped (PanCanvas *self,
+            guint      pos)
 {
-    PanAction *action;
+    if (!self->skip_similar || !self->document)
+        return FALSE;
 
-    if (!*stack)
-        return NULL;
-    action = (*stack)->data;
-    *stack = g_slist_remove_link (*stack, *stack);
-    return action;
+    return (pan_record_list_get_flags (pan_document_records (self->document), pos) &
+            PAN_RECORD_DUPLICATE) != 0;
 }
 
-static void
-stack_clear (GSList **stack)
+/**
+ * pan_canvas_get_perf_report:
+ *
+ * Returns: (transfer full): the frame, snapshot, hit-test and decode
+ *   timings and the drawing counters as JSON
+ */
+gchar *
+pan_canvas_get_perf_report (PanCanvas *self)
 {
-    if (!*stack) return;
+    g_return_val_if_fail (PAN_IS_CANVAS (self), NULL);
 
-    g_slist_free_full (*stack, g_object_unref);
-    *stack = NULL;
+    return pan_perf_to_json (self->perf);
 }
 
+/**
+ * pan_canvas_account_memory:
+ *
+ * Adds the decoded image and the spatial index to @report.  The document
+ * is accounted separately.
+ */
 void
-pan_canvas_undo (PanCanvas *self)
+pan_canvas_account_memory (PanCanvas       *self,
+                           PanMemoryReport *report)
+{
+    g_return_if_fail (PAN_IS_CANVAS (self));
+    g_return_if_fail (report != NULL);
+
+    if (self->image) {
+        pan_memory_report_add (report, PAN_MEMORY_TEXTURES, texture_bytes (self->image));
+        pan_memory_report_add_objects (report, G_OBJECT_TYPE (self->image), 1);
+    }
+
+    pan_memory_report_add (report, PAN_MEMORY_INDEX, pan_spatial_index_get_size (self->index));
+    pan_memory_report_add (report, PAN_MEMORY_TEXTURES, pan_minimap_get_size (self->minimap));
+}
+
+void
+pan_canvas_delete_selected (PanCanvas *self)
+{
+    g_return_if_fail (PAN_IS_CANVAS (self));
+
+    delete_selection (self);
+}
+
+/**
+ * pan_canvas_clear_annots:
+ *
+ * Deletes every annotation of the current record as one undo step.  The
+ * store is emptied with a single splice, so this costs one items-changed
+ * and one redraw however many points there are.
+ */
+void
+pan_canvas_clear_annots (PanCanvas *self)
+{
+    g_autoptr (PanActionGroup) group = NULL;
+    GListStore *annots_store;
+    PanAnnot *annot;
+    PanAction action;
+    guint annot_x, annot_y;
+    guint n_annots;
+
+    g_return_if_fail (PAN_IS_CANVAS (self));
+
+    if (!self->selected_record)
+        return;
+
+    annots_store = pan_record_annots (self->selected_record);
+    n_annots = g_list_model_get_n_items (G_LIST_MODEL (annots_store));
+    if (n_annots == 0)
+        return;
+
+    group = pan_action_group_new ();
+    for (guint i = 0; i < n_annots; i++) {
+        annot = g_list_model_get_item (G_LIST_MODEL (annots_store), i);
+        pan_annot_get_pos (annot, &annot_x, &annot_y);
+        action = pan_action_delete (i, annot_x, annot_y);
+        pan_action_group_add (group, &action);
+        g_object_unref (annot);
+    }
+
+    action = pan_action_group_end (g_steal_pointer (&group));
+    pan_action_redo (&action, annots_store);
+    push_action (self, &action);
+    self->hover_pos = GTK_INVALID_LIST_POSITION;
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/**
+ * pan_canvas_merge_duplicates:
+ * @duplicates: (array length=n_duplicates): pairs from pan_duplicates_find(),
+ *   sorted by record
+ *
+ * Merges each cluster of duplicate points into one, as one undo step per
+ * record.
+ *
+ * Returns: the number of points removed
+ */
+guint
+pan_canvas_merge_duplicates (PanCanvas          *self,
+                             const PanDuplicate *duplicates,
+                             guint               n_duplicates)
+{
+    PanRecordList *records;
+    PanRecord *record;
+    guint current, removed, total = 0;
+    guint start, end;
+
+    g_return_val_if_fail (PAN_IS_CANVAS (self), 0);
+
+    if (!self->document)
+        return 0;
+
+    records = pan_document_records (self->document);
+    current = gtk_single_selection_get_selected (self->record_selection);
+    for (start = 0; start < n_duplicates; start = end) {
+        for (end = start + 1; end < n_duplicates; end++)
+            if (duplicates[end].record != duplicates[start].record)
+                break;
+
+        /* Builds the record if its points were spilled into the index. */
+        record  = g_list_model_get_item (G_LIST_MODEL (records), duplicates[start].record);
+        removed = record ? pan_duplicates_merge (record, duplicates + start, end - start) : 0;
+        g_clear_object (&record);
+        if (removed == 0)
+            continue;
+
+        total += removed;
+        if (duplicates[start].record == current) {
+            if (self->annot_selection)
+                gtk_selection_model_unselect_all (GTK_SELECTION_MODEL (self->annot_selection));
+            annots_changed (self);
+            self->hover_pos = GTK_INVALID_LIST_POSITION;
+        } else {
+            pan_document_record_changed (self->document, duplicates[start].record);
+        }
+    }
+
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+
+    return total;
+}
+
+/**
+ * pan_canvas_set_reference:
+ * @reference: (nullable): the document to compare against, or %NULL to
+ *   stop comparing
+ * @distance: the largest distance in pixels at which points match
+ *
+ * Shows how the points of each record match those of the record with the
+ * same filename in @reference.
+ */
+void
+pan_canvas_set_reference (PanCanvas   *self,
+                          PanDocument *reference,
+                          guint        distance)
 {
-    PanAction *action;
+    PanRecordList *records;
+    guint n_records;
 
     g_return_if_fail (PAN_IS_CANVAS (self));
+    g_return_if_fail (reference == NULL || PAN_IS_DOCUMENT (reference));
+
+    g_set_object (&self->reference, reference);
+    g_clear_pointer (&self->reference_names, g_hash_table_unref);
+    self->match_distance  = distance;
+    self->agreement_valid = FALSE;
+
+    if (reference) {
+        records   = pan_document_records (reference);
+        n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+        self->reference_names = g_hash_table_new (g_str_hash, g_str_equal);
+        for (guint i = 0; i < n_records; i++)
+            g_hash_table_insert (self->reference_names,
+                                 (gpointer) pan_record_list_get_filename (records, i),
+                                 GUINT_TO_POINTER (i));
+    }
 
-    action = stack_pop_action (&self->undo_stack);
-    if (!action) return;
-    pan_action_undo (action);
-    stack_push_action (&self->redo_stack, action);
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+/**
+ * pan_canvas_reload:
+ *
+ * Loads the image of the current record again, after the document was
+ * pointed at other files.
+ */
+void
+pan_canvas_reload (PanCanvas *self)
+{
+    g_return_if_fail (PAN_IS_CANVAS (self));
+
+    if (self->document)
+        load_record (self);
+}
+
+void
+pan_canvas_undo (PanCanvas *self)
+{
+    PanHistory *history;
+    gint64 begin;
+
+    g_return_if_fail (PAN_IS_CANVAS (self));
+
+    trace_event (self, PAN_EVENT_UNDO, 0, 0, 0, 0);
+
+    if (!self->selected_record)
+        return;
+
+    begin = PAN_PROFILER_CURRENT_TIME;
+    history = pan_record_get_history (self->selected_record);
+    if (pan_history_undo (history, pan_record_annots (self->selected_record))) {
+        annots_changed (self);
+        pan_minimap_invalidate (self->minimap);
+        self->hover_pos = GTK_INVALID_LIST_POSITION;
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+    PAN_PROFILER_ADD_MARK (begin, "pan_canvas_undo", NULL);
+}
+
 void
 pan_canvas_redo (PanCanvas *self)
 {
-    PanAction *action;
+    PanHistory *history;
+    gint64 begin;
+
+    g_return_if_fail (PAN_IS_CANVAS (self));
+
+    trace_event (self, PAN_EVENT_REDO, 0, 0, 0, 0);
+
+    if (!self->selected_record)
+        return;
+
+    begin = PAN_PROFILER_CURRENT_TIME;
+    history = pan_record_get_history (self->selected_record);
+    if (pan_history_redo (history, pan_record_annots (self->selected_record))) {
+        annots_changed (self);
+        pan_minimap_invalidate (self->minimap);
+        self->hover_pos = GTK_INVALID_LIST_POSITION;
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+    PAN_PROFILER_ADD_MARK (begin, "pan_canvas_redo", NULL);
+}
+
+void
+pan_canvas_set_zoom_factor (PanCanvas *self,
+                            gfloat     zoom_factor)
+{
+    g_return_if_fail (PAN_IS_CANVAS (self));
+    g_return_if_fail (zoom_factor >= MIN_ZOOM_FACTOR && zoom_factor <= MAX_ZOOM_FACTOR);
+
+    stop_zoom (self);
+    set_zoom_at (self, zoom_factor,
+                 gtk_widget_get_width (GTK_WIDGET (self)) / 2.0,
+                 gtk_widget_get_height (GTK_WIDGET (self)) / 2.0);
+}
 
+void
+pan_canvas_set_hover (PanCanvas *self,
+                      guint      position)
+{
     g_return_if_fail (PAN_IS_CANVAS (self));
 
-    action = stack_pop_action (&self->redo_stack);
-    if (!action) return;
-    pan_action_redo (action);
-    stack_push_action (&self->undo_stack, action);
+    self->hover_pos = position;
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+static void
+trace_event (PanCanvas      *self,
+             PanEventType    type,
+             guint           value,
+             GdkModifierType state,
+             gdouble         x,
+             gdouble         y)
+{
+    if (self->trace)
+        pan_event_trace_record (self->trace, type, value, state, x, y);
+}
+
+/**
+ * pan_canvas_replay_event:
+ *
+ * Feeds @event to the canvas as if it came from the user.  Pointer
+ * coordinates are in widget space, as they were recorded.
+ */
+void
+pan_canvas_replay_event (PanCanvas      *self,
+                         const PanEvent *event)
+{
+    g_return_if_fail (PAN_IS_CANVAS (self));
+    g_return_if_fail (event != NULL);
+
+    switch ((PanEventType) event->type) {
+    case PAN_EVENT_PRESS:
+        handle_press (self, event->value, event->x, event->y, event->state);
+        break;
+    case PAN_EVENT_RELEASE:
+    case PAN_EVENT_DRAG_END:
+        handle_release (self);
+        break;
+    case PAN_EVENT_MOTION:
+        handle_motion (self, event->x, event->y);
+        break;
+    case PAN_EVENT_KEY:
+        handle_key (self, event->value, event->state);
+        break;
+    case PAN_EVENT_ZOOM_IN:
+        pan_canvas_zoom_in (self);
+        break;
+    case PAN_EVENT_ZOOM_OUT:
+        pan_canvas_zoom_out (self);
+        break;
+    case PAN_EVENT_ZOOM_ORIGINAL:
+        pan_canvas_zoom_original (self);
+        break;
+    case PAN_EVENT_ZOOM_FIT:
+        pan_canvas_zoom_fit (self);
+        break;
+    case PAN_EVENT_ZOOM:
+        animate_zoom (self, event->value / 1000.0, event->x, event->y);
+        break;
+    case PAN_EVENT_SELECT_RECORD:
+        gtk_single_selection_set_selected (self->record_selection, event->value);
+        break;
+    case PAN_EVENT_UNDO:
+        pan_canvas_undo (self);
+        break;
+    case PAN_EVENT_REDO:
+        pan_canvas_redo (self);
+        break;
+    case PAN_N_EVENT_TYPES:
+    default:
+        g_warn_if_reached ();
+        break;
+    }
+}
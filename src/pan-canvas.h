@@ -22,6 +22,7 @@
 #pragma once
 
 #include "pan-document.h"
+#include "pan-duplicates.h"
 #include <adwaita.h>
 
 G_BEGIN_DECLS
@@ -47,9 +48,24 @@ void pan_canvas_prev          (PanCanvas *self);
 void pan_canvas_last          (PanCanvas *self);
 void pan_canvas_undo          (PanCanvas *self);
 void pan_canvas_redo          (PanCanvas *self);
+void pan_canvas_reload        (PanCanvas *self);
+
+void pan_canvas_delete_selected (PanCanvas *self);
+void pan_canvas_clear_annots    (PanCanvas *self);
+
+guint pan_canvas_merge_duplicates (PanCanvas          *self,
+                                   const PanDuplicate *duplicates,
+                                   guint               n_duplicates);
+void  pan_canvas_set_reference    (PanCanvas          *self,
+                                   PanDocument        *reference,
+                                   guint               distance);
+
+gchar *pan_canvas_get_perf_report  (PanCanvas *self);
+void   pan_canvas_account_memory   (PanCanvas       *self,
+                                    PanMemoryReport *report);
 
 GtkSingleSelection *pan_canvas_get_record_selection_model (PanCanvas *self);
-GtkSingleSelection *pan_canvas_get_annot_selection_model  (PanCanvas *self);
+GtkSelectionModel  *pan_canvas_get_annot_selection_model  (PanCanvas *self);
 
 G_END_DECLS
 
@@ -0,0 +1,172 @@
+/*
+ * pan-cell-grid.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/*
+ * Finds the points near a position for a fixed threshold.  The points are
+ * hashed into square cells as wide as the threshold, so only the cell of
+ * the position and its eight neighbours can hold a point close enough.
+ * The cells are runs of a sorted array, and a hash table maps each cell
+ * to the start of its run.
+ *
+ * Unlike PanSpatialIndex, the grid is built once over a plain copy of the
+ * points, so it can be used on any thread.
+ */
+
+#include "pan-cell-grid.h"
+
+typedef struct
+{
+    guint64 cell;
+    guint32 pos;
+} Cell;
+
+struct _PanCellGrid
+{
+    const guint32 *xy;
+    guint size;
+    guint64 limit;
+    GArray *cells;
+    GHashTable *starts;
+};
+
+static guint64 cell_key      (guint64       cx,
+                              guint64       cy);
+static gint    compare_cells (gconstpointer a,
+                              gconstpointer b);
+
+static guint64
+cell_key (guint64 cx,
+          guint64 cy)
+{
+    return cx << 32 | cy;
+}
+
+static gint
+compare_cells (gconstpointer a,
+               gconstpointer b)
+{
+    const Cell *cell_a = a;
+    const Cell *cell_b = b;
+
+    if (cell_a->cell != cell_b->cell)
+        return cell_a->cell < cell_b->cell ? -1 : 1;
+
+    return cell_a->pos < cell_b->pos ? -1 : cell_a->pos > cell_b->pos;
+}
+
+/**
+ * pan_cell_grid_new:
+ * @xy: (array): x, y pairs, which must outlive the grid
+ * @distance: the largest distance in pixels at which points are near
+ *
+ * Returns: (transfer full): a grid over @xy
+ */
+PanCellGrid *
+pan_cell_grid_new (const guint32 *xy,
+                   guint          n_points,
+                   guint          distance)
+{
+    PanCellGrid *self;
+    const Cell *cell;
+
+    self = g_new0 (PanCellGrid, 1);
+    self->xy     = xy;
+    self->size   = MAX (distance, 1);
+    self->limit  = (guint64) distance * distance;
+    self->cells  = g_array_sized_new (FALSE, FALSE, sizeof (Cell), n_points);
+    self->starts = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+    g_array_set_size (self->cells, n_points);
+    for (guint i = 0; i < n_points; i++) {
+        g_array_index (self->cells, Cell, i) = (Cell) {
+            .cell = cell_key (xy[2 * i] / self->size, xy[2 * i + 1] / self->size),
+            .pos  = i,
+        };
+    }
+    g_array_sort (self->cells, compare_cells);
+
+    /* The keys point into cells, which no longer moves. */
+    for (guint i = 0; i < n_points; i++) {
+        cell = &g_array_index (self->cells, Cell, i);
+        if (i == 0 || cell->cell != g_array_index (self->cells, Cell, i - 1).cell)
+            g_hash_table_insert (self->starts, (gpointer) &cell->cell, GUINT_TO_POINTER (i));
+    }
+
+    return self;
+}
+
+void
+pan_cell_grid_free (PanCellGrid *self)
+{
+    if (!self)
+        return;
+
+    g_hash_table_unref (self->starts);
+    g_array_unref (self->cells);
+    g_free (self);
+}
+
+/**
+ * pan_cell_grid_foreach_near:
+ *
+ * Calls @func for every point of @self no further than the distance from
+ * @x, @y, cell by cell and by position within a cell.
+ */
+void
+pan_cell_grid_foreach_near (PanCellGrid     *self,
+                            guint32          x,
+                            guint32          y,
+                            PanCellGridFunc  func,
+                            gpointer         user_data)
+{
+    const Cell *cell;
+    guint64 cx, cy, key;
+    gint64 dx, dy;
+    gpointer start;
+    guint32 p;
+
+    g_return_if_fail (self != NULL);
+
+    cx = x / self->size;
+    cy = y / self->size;
+    for (guint64 ny = cy > 0 ? cy - 1 : 0; ny <= cy + 1; ny++) {
+        for (guint64 nx = cx > 0 ? cx - 1 : 0; nx <= cx + 1; nx++) {
+            key = cell_key (nx, ny);
+            if (!g_hash_table_lookup_extended (self->starts, &key, NULL, &start))
+                continue;
+
+            for (guint j = GPOINTER_TO_UINT (start); j < self->cells->len; j++) {
+                cell = &g_array_index (self->cells, Cell, j);
+                if (cell->cell != key)
+                    break;
+
+                p  = cell->pos;
+                dx = (gint64) self->xy[2 * p] - x;
+                dy = (gint64) self->xy[2 * p + 1] - y;
+                if ((guint64) (dx * dx + dy * dy) > self->limit)
+                    continue;
+
+                func (p, dx * dx + dy * dy, user_data);
+            }
+        }
+    }
+}
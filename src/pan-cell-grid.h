@@ -0,0 +1,48 @@
+/*
+ * pan-cell-grid.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PanCellGrid PanCellGrid;
+
+/* Called with a point within the distance, and its squared distance. */
+typedef void (*PanCellGridFunc) (guint32  position,
+                                 guint64  d2,
+                                 gpointer user_data);
+
+PanCellGrid *pan_cell_grid_new          (const guint32   *xy,
+                                         guint            n_points,
+                                         guint            distance);
+void         pan_cell_grid_free         (PanCellGrid     *self);
+void         pan_cell_grid_foreach_near (PanCellGrid     *self,
+                                         guint32          x,
+                                         guint32          y,
+                                         PanCellGridFunc  func,
+                                         gpointer         user_data);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanCellGrid, pan_cell_grid_free)
+
+G_END_DECLS
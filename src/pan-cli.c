@@ -0,0 +1,641 @@
+/*
+ * pan-cli.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Batch verbs for pipelines.  They are handled from handle-local-options,
+ * before GTK is initialised, so they work without a display.  Every verb
+ * takes any number of documents and processes them on a thread pool; the
+ * output is printed in the order the documents were given.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <glib/gi18n.h>
+
+#include "pan-cli.h"
+#include "pan-document.h"
+#include "pan-memory.h"
+#include "pan-parallel.h"
+#include "pan-density.h"
+#include "pan-crops.h"
+#include "pan-agreement.h"
+
+/* Validation stops listing problems of a document after this many. */
+#define MAX_PROBLEMS 10
+
+static const GOptionEntry cli_options[] =
+{
+    { "convert", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Convert each pair of INPUT OUTPUT documents, by extension"), NULL },
+    { "stats", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Print totals, a spatial histogram and per-image counts of each document as JSON"), NULL },
+    { "validate", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Check that each document loads and its images exist"), NULL },
+    { "merge", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Merge the documents into the one given with --output"), NULL },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Where --merge writes its result"), N_("DOCUMENT") },
+    { "density", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Write a density map per image to DIRECTORY"), N_("DIRECTORY") },
+    { "sigma", 0, 0, G_OPTION_ARG_DOUBLE, NULL,
+      N_("Width of the density kernel in pixels (default 4)"), N_("PIXELS") },
+    { "knn", 0, 0, G_OPTION_ARG_INT, NULL,
+      N_("Adapt the kernel to the mean distance to K neighbours"), N_("K") },
+    { "downscale", 0, 0, G_OPTION_ARG_INT, NULL,
+      N_("Divide the size of the density maps by FACTOR"), N_("FACTOR") },
+    { "density-format", 0, 0, G_OPTION_ARG_STRING, NULL,
+      N_("Write density maps as npy (default) or tiff"), N_("FORMAT") },
+    { "crops", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Write a crop around every point to DIRECTORY or a .tar file"), N_("OUTPUT") },
+    { "crop-size", 0, 0, G_OPTION_ARG_INT, NULL,
+      N_("Side of the crops in pixels (default 64)"), N_("PIXELS") },
+    { "crop-padding", 0, 0, G_OPTION_ARG_INT, NULL,
+      N_("Extra context added on every side of a crop"), N_("PIXELS") },
+    { "crop-border", 0, 0, G_OPTION_ARG_STRING, NULL,
+      N_("Fill outside the image by clamp (default), mirror or zero, or skip such crops"), N_("MODE") },
+    { "compare", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Print precision, recall and localization error of each document against REFERENCE as JSON"), N_("REFERENCE") },
+    { "match-distance", 0, 0, G_OPTION_ARG_INT, NULL,
+      N_("Largest distance at which --compare matches two points (default 10)"), N_("PIXELS") },
+    { "hash", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Store the content hash of every image in each document, for --relink"), NULL },
+    { "relink", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Find the images of each document in DIRECTORY by content and save it"), N_("DIRECTORY") },
+    { "memory-report", 0, 0, G_OPTION_ARG_FILENAME, NULL,
+      N_("Print the memory held by DOCUMENT and exit"), N_("DOCUMENT") },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, NULL,
+      NULL, N_("DOCUMENT…") },
+    { NULL }
+};
+
+static gpointer load_job         (gpointer   item,
+                                  gpointer   user_data,
+                                  GError   **error);
+static gpointer stats_job        (gpointer   item,
+                                  gpointer   user_data,
+                                  GError   **error);
+static gpointer validate_job     (gpointer   item,
+                                  gpointer   user_data,
+                                  GError   **error);
+static gpointer convert_job      (gpointer   item,
+                                  gpointer   user_data,
+                                  GError   **error);
+static gint     run_jobs         (gchar          **paths,
+                                  guint            n_jobs,
+                                  PanParallelFunc  func,
+                                  gboolean         print);
+static gint     merge            (gchar       **paths,
+                                  const gchar  *output);
+static gint     memory_report    (const gchar *path);
+static gint     density          (gchar        **paths,
+                                  const gchar   *directory,
+                                  GVariantDict  *options);
+static gint     crops            (gchar        **paths,
+                                  const gchar   *output,
+                                  GVariantDict  *options);
+static gint     compare          (gchar        **paths,
+                                  const gchar   *reference,
+                                  GVariantDict  *options);
+static gboolean relink_document  (const gchar   *path,
+                                  const gchar   *directory,
+                                  GError       **error);
+static gint     relink           (gchar        **paths,
+                                  const gchar   *directory);
+
+void
+pan_cli_add_options (GApplication *application)
+{
+    g_application_add_main_option_entries (application, cli_options);
+}
+
+static gpointer
+load_job (gpointer   item,
+          gpointer   user_data,
+          GError   **error)
+{
+    return pan_document_load_file (item, error);
+}
+
+/* Unchanged documents are answered from the cache, without loading them. */
+static gpointer
+stats_job (gpointer   item,
+           gpointer   user_data,
+           GError   **error)
+{
+    g_autoptr (PanDocument) document = NULL;
+    g_autoptr (PanStats) cached = NULL;
+    g_autoptr (PanStats) stats = NULL;
+    GError *cache_error = NULL;
+
+    cached = pan_stats_load_cache (item);
+    if (cached)
+        return pan_stats_to_json (cached, item);
+
+    document = pan_document_load_file (item, error);
+    if (!document)
+        return NULL;
+
+    /* This already runs on the pool, one document per worker. */
+    stats = pan_stats_new ();
+    pan_stats_update (stats, document, FALSE);
+    if (!pan_stats_save_cache (stats, item, &cache_error)) {
+        g_warning ("Could not cache the statistics of %s: %s", (const gchar *) item, cache_error->message);
+        g_error_free (cache_error);
+    }
+
+    return pan_stats_to_json (stats, item);
+}
+
+static gpointer
+validate_job (gpointer   item,
+              gpointer   user_data,
+              GError   **error)
+{
+    g_autoptr (PanDocument) document = NULL;
+    g_autoptr (GHashTable) names = NULL;
+    g_autoptr (GString) problems = NULL;
+    g_autofree gchar *path = NULL;
+    PanRecordList *records;
+    const gchar *root, *name;
+    guint n_records, n_problems = 0;
+
+    document = pan_document_load_file (item, error);
+    if (!document)
+        return NULL;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    root      = pan_document_get_root_path (document);
+    names     = g_hash_table_new (g_str_hash, g_str_equal);
+    problems  = g_string_new (NULL);
+
+    if (!root || !g_file_test (root, G_FILE_TEST_IS_DIR)) {
+        g_string_append_printf (problems, "\n  image folder %s does not exist", root ? root : "(none)");
+        n_problems++;
+        root = NULL;
+    }
+
+    for (guint i = 0; i < n_records; i++) {
+        name = pan_record_list_get_filename (records, i);
+        if (!*name) {
+            if (n_problems++ < MAX_PROBLEMS)
+                g_string_append_printf (problems, "\n  image %u has no filename", i);
+            continue;
+        }
+        if (!g_hash_table_add (names, (gpointer) name) && n_problems++ < MAX_PROBLEMS)
+            g_string_append_printf (problems, "\n  %s is listed more than once", name);
+
+        if (!root)
+            continue;
+        g_free (path);
+        path = g_build_filename (root, name, NULL);
+        if (!g_file_test (path, G_FILE_TEST_IS_REGULAR) && n_problems++ < MAX_PROBLEMS)
+            g_string_append_printf (problems, "\n  %s is missing", path);
+    }
+
+    if (n_problems > 0) {
+        if (n_problems > MAX_PROBLEMS)
+            g_string_append_printf (problems, "\n  and %u more", n_problems - MAX_PROBLEMS);
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "%u problems:%s", n_problems, problems->str);
+        return NULL;
+    }
+
+    return g_strdup_printf ("%s: ok", (const gchar *) item);
+}
+
+/* item points at an input path, followed by its output path. */
+static gpointer
+convert_job (gpointer   item,
+             gpointer   user_data,
+             GError   **error)
+{
+    g_autoptr (PanDocument) document = NULL;
+    gchar **pair = item;
+
+    document = pan_document_load_file (pair[0], error);
+    if (!document || !pan_document_save_file (document, pair[1], error))
+        return NULL;
+
+    return g_strdup_printf ("%s -> %s", pair[0], pair[1]);
+}
+
+/*
+ * Runs func over paths, or over consecutive pairs of them for --convert,
+ * and prints what each job returned.  Failures go to stderr.
+ */
+static gint
+run_jobs (gchar          **paths,
+          guint            n_jobs,
+          PanParallelFunc  func,
+          gboolean         print)
+{
+    g_autofree gpointer *items = NULL;
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    guint stride;
+    gint status = EXIT_SUCCESS;
+
+    stride  = g_strv_length (paths) / n_jobs;
+    items   = g_new (gpointer, n_jobs);
+    results = g_new0 (gpointer, n_jobs);
+    errors  = g_new0 (GError *, n_jobs);
+    for (guint i = 0; i < n_jobs; i++)
+        items[i] = stride == 1 ? (gpointer) paths[i] : (gpointer) &paths[i * stride];
+
+    pan_parallel_map (items, n_jobs, func, NULL, results, errors);
+
+    for (guint i = 0; i < n_jobs; i++) {
+        if (errors[i]) {
+            g_printerr ("%s: %s\n", paths[i * stride], errors[i]->message);
+            g_error_free (errors[i]);
+            status = EXIT_FAILURE;
+            continue;
+        }
+        if (print)
+            g_print ("%s\n", (gchar *) results[i]);
+        g_free (results[i]);
+    }
+
+    return status;
+}
+
+/* Inputs are loaded in parallel; the merge itself is cheap and sequential. */
+static gint
+merge (gchar       **paths,
+       const gchar  *output)
+{
+    g_autoptr (PanDocument) merged = NULL;
+    g_autofree gpointer *documents = NULL;
+    g_autofree GError **errors = NULL;
+    GError *error = NULL;
+    guint n;
+    gint status = EXIT_SUCCESS;
+
+    n         = g_strv_length (paths);
+    documents = g_new0 (gpointer, n);
+    errors    = g_new0 (GError *, n);
+
+    if (!pan_parallel_map ((gpointer *) paths, n, load_job, NULL, documents, errors)) {
+        for (guint i = 0; i < n; i++) {
+            if (errors[i]) {
+                g_printerr ("%s: %s\n", paths[i], errors[i]->message);
+                g_error_free (errors[i]);
+            }
+        }
+        status = EXIT_FAILURE;
+        goto out;
+    }
+
+    merged = pan_document_merge ((PanDocument **) documents, n);
+    if (!pan_document_save_file (merged, output, &error)) {
+        g_printerr ("%s: %s\n", output, error->message);
+        g_error_free (error);
+        status = EXIT_FAILURE;
+    }
+
+out:
+    for (guint i = 0; i < n; i++)
+        g_clear_object (&documents[i]);
+
+    return status;
+}
+
+static gint
+memory_report (const gchar *path)
+{
+    g_autoptr (PanDocument) document = NULL;
+    g_autoptr (PanMemoryReport) report = NULL;
+    g_autofree gchar *text = NULL;
+    GError *error = NULL;
+
+    document = pan_document_load_file (path, &error);
+    if (!document) {
+        g_printerr ("%s: %s\n", path, error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+
+    report = pan_memory_report_new ();
+    pan_document_account_memory (document, report);
+    text = pan_memory_report_to_string (report);
+    g_print ("%s", text);
+
+    return EXIT_SUCCESS;
+}
+
+/* Each document is exported in turn; its images are spread over the pool. */
+static gint
+density (gchar        **paths,
+         const gchar   *directory,
+         GVariantDict  *options)
+{
+    PanDensityOptions density_options;
+    const gchar *format = NULL;
+    GError *error = NULL;
+    gint value;
+    gint status = EXIT_SUCCESS;
+
+    pan_density_options_init (&density_options);
+    g_variant_dict_lookup (options, "sigma", "d", &density_options.sigma);
+    if (g_variant_dict_lookup (options, "knn", "i", &value))
+        density_options.knn = MAX (value, 0);
+    if (g_variant_dict_lookup (options, "downscale", "i", &value))
+        density_options.downscale = MAX (value, 1);
+    if (g_variant_dict_lookup (options, "density-format", "&s", &format)) {
+        if (!g_strcmp0 (format, "tiff")) {
+            density_options.format = PAN_DENSITY_TIFF;
+        } else if (g_strcmp0 (format, "npy")) {
+            g_printerr (_("Unknown density format %s\n"), format);
+            return EXIT_FAILURE;
+        }
+    }
+    if (density_options.sigma <= 0.0) {
+        g_printerr (_("--sigma must be positive\n"));
+        return EXIT_FAILURE;
+    }
+
+    if (g_mkdir_with_parents (directory, 0755) != 0) {
+        g_printerr ("%s: %s\n", directory, g_strerror (errno));
+        return EXIT_FAILURE;
+    }
+
+    for (guint i = 0; paths[i]; i++) {
+        g_autoptr (PanDocument) document = NULL;
+
+        document = pan_document_load_file (paths[i], &error);
+        if (!document || !pan_density_export (document, directory, &density_options, &error)) {
+            g_printerr ("%s: %s\n", paths[i], error->message);
+            g_clear_error (&error);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
+
+static gint
+crops (gchar        **paths,
+       const gchar   *output,
+       GVariantDict  *options)
+{
+    static const gchar *border_names[] = { "clamp", "mirror", "zero", "skip", NULL };
+    PanCropOptions crop_options;
+    const gchar *border = NULL;
+    GError *error = NULL;
+    gint value;
+    gint status = EXIT_SUCCESS;
+
+    pan_crop_options_init (&crop_options);
+    if (g_variant_dict_lookup (options, "crop-size", "i", &value))
+        crop_options.size = MAX (value, 1);
+    if (g_variant_dict_lookup (options, "crop-padding", "i", &value))
+        crop_options.padding = MAX (value, 0);
+    if (g_variant_dict_lookup (options, "crop-border", "&s", &border)) {
+        if (!g_strv_contains (border_names, border)) {
+            g_printerr (_("Unknown border mode %s\n"), border);
+            return EXIT_FAILURE;
+        }
+        /* The names are listed in the order of PanCropBorder. */
+        for (guint i = 0; border_names[i]; i++) {
+            if (!g_strcmp0 (border_names[i], border))
+                crop_options.border = (PanCropBorder) i;
+        }
+    }
+
+    /* Several documents would overwrite one archive, so a .tar takes one. */
+    if (g_str_has_suffix (output, ".tar") && g_strv_length (paths) > 1) {
+        g_printerr (_("Only one document can be exported to an archive\n"));
+        return EXIT_FAILURE;
+    }
+
+    for (guint i = 0; paths[i]; i++) {
+        g_autoptr (PanDocument) document = NULL;
+
+        document = pan_document_load_file (paths[i], &error);
+        if (!document || !pan_crops_export (document, output, &crop_options, &error)) {
+            g_printerr ("%s: %s\n", paths[i], error->message);
+            g_clear_error (&error);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/* The documents are loaded in parallel, then each is matched image by image. */
+static gint
+compare (gchar        **paths,
+         const gchar   *reference,
+         GVariantDict  *options)
+{
+    g_autoptr (GPtrArray) inputs = NULL;
+    g_autofree gpointer *documents = NULL;
+    g_autofree GError **errors = NULL;
+    g_autofree gchar *json = NULL;
+    PanAgreement *agreement;
+    guint distance = 10;
+    gint value;
+    guint n;
+    gint status = EXIT_SUCCESS;
+
+    if (g_variant_dict_lookup (options, "match-distance", "i", &value))
+        distance = MAX (value, 0);
+
+    inputs = g_ptr_array_new ();
+    g_ptr_array_add (inputs, (gpointer) reference);
+    for (guint i = 0; paths[i]; i++)
+        g_ptr_array_add (inputs, paths[i]);
+
+    n         = inputs->len;
+    documents = g_new0 (gpointer, n);
+    errors    = g_new0 (GError *, n);
+    pan_parallel_map (inputs->pdata, n, load_job, NULL, documents, errors);
+
+    if (errors[0]) {
+        g_printerr ("%s: %s\n", reference, errors[0]->message);
+        status = EXIT_FAILURE;
+        goto out;
+    }
+
+    for (guint i = 1; i < n; i++) {
+        if (errors[i]) {
+            g_printerr ("%s: %s\n", (const gchar *) inputs->pdata[i], errors[i]->message);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        agreement = pan_agreement_compare (documents[0], documents[i], distance);
+        g_free (json);
+        json = pan_agreement_to_json (agreement, reference, inputs->pdata[i]);
+        g_print ("%s\n", json);
+        pan_agreement_free (agreement);
+    }
+
+out:
+    for (guint i = 0; i < n; i++) {
+        g_clear_error (&errors[i]);
+        g_clear_object (&documents[i]);
+    }
+
+    return status;
+}
+
+/* Without a directory the images are only hashed.  Saves in place. */
+static gboolean
+relink_document (const gchar  *path,
+                 const gchar  *directory,
+                 GError      **error)
+{
+    g_autoptr (PanDocument) document = NULL;
+    GError *relink_error = NULL;
+    guint n, n_records;
+
+    document = pan_document_load_file (path, error);
+    if (!document)
+        return FALSE;
+
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (document)));
+    if (directory) {
+        n = pan_document_relink (document, directory, &relink_error);
+        if (relink_error) {
+            g_propagate_error (error, relink_error);
+            return FALSE;
+        }
+        g_print ("%s: found %u of %u images\n", path, n, n_records);
+    } else {
+        n = pan_document_hash_images (document);
+        g_print ("%s: hashed %u of %u images\n", path, n, n_records);
+    }
+
+    return pan_document_save_file (document, path, error);
+}
+
+/*
+ * Documents are done in turn, since hashing their images already keeps
+ * every core busy.
+ */
+static gint
+relink (gchar       **paths,
+        const gchar  *directory)
+{
+    GError *error = NULL;
+    gint status = EXIT_SUCCESS;
+
+    for (guint i = 0; paths[i]; i++) {
+        if (!relink_document (paths[i], directory, &error)) {
+            g_printerr ("%s: %s\n", paths[i], error->message);
+            g_clear_error (&error);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
+
+/**
+ * pan_cli_run:
+ *
+ * Runs the verb selected in @options.
+ *
+ * Returns: the exit status, or -1 if no verb was given and the
+ *   application should start as usual
+ */
+gint
+pan_cli_run (GVariantDict *options)
+{
+    g_auto (GStrv) paths = NULL;
+    g_autofree gchar *output = NULL;
+    g_autofree gchar *report = NULL;
+    g_autofree gchar *directory = NULL;
+    g_autofree gchar *crops_output = NULL;
+    g_autofree gchar *reference = NULL;
+    g_autofree gchar *relink_directory = NULL;
+    guint n_paths;
+
+    if (g_variant_dict_lookup (options, "memory-report", "^ay", &report))
+        return memory_report (report);
+
+    g_variant_dict_lookup (options, G_OPTION_REMAINING, "^aay", &paths);
+    n_paths = paths ? g_strv_length (paths) : 0;
+
+    if (g_variant_dict_contains (options, "convert")) {
+        if (n_paths == 0 || n_paths % 2 != 0) {
+            g_printerr (_("--convert takes pairs of INPUT OUTPUT documents\n"));
+            return EXIT_FAILURE;
+        }
+        return run_jobs (paths, n_paths / 2, convert_job, FALSE);
+    }
+
+    if (g_variant_dict_contains (options, "stats") || g_variant_dict_contains (options, "validate")) {
+        if (n_paths == 0) {
+            g_printerr (_("No documents given\n"));
+            return EXIT_FAILURE;
+        }
+        return run_jobs (paths, n_paths,
+                         g_variant_dict_contains (options, "stats") ? stats_job : validate_job,
+                         TRUE);
+    }
+
+    if (g_variant_dict_lookup (options, "density", "^ay", &directory)) {
+        if (n_paths == 0) {
+            g_printerr (_("No documents given\n"));
+            return EXIT_FAILURE;
+        }
+        return density (paths, directory, options);
+    }
+
+    if (g_variant_dict_lookup (options, "crops", "^ay", &crops_output)) {
+        if (n_paths == 0) {
+            g_printerr (_("No documents given\n"));
+            return EXIT_FAILURE;
+        }
+        return crops (paths, crops_output, options);
+    }
+
+    if (g_variant_dict_lookup (options, "compare", "^ay", &reference)) {
+        if (n_paths == 0) {
+            g_printerr (_("No documents given\n"));
+            return EXIT_FAILURE;
+        }
+        return compare (paths, reference, options);
+    }
+
+    if (g_variant_dict_lookup (options, "relink", "^ay", &relink_directory) ||
+        g_variant_dict_contains (options, "hash")) {
+        if (n_paths == 0) {
+            g_printerr (_("No documents given\n"));
+            return EXIT_FAILURE;
+        }
+        return relink (paths, relink_directory);
+    }
+
+    if (g_variant_dict_contains (options, "merge")) {
+        if (n_paths == 0 || !g_variant_dict_lookup (options, "output", "^ay", &output)) {
+            g_printerr (_("--merge takes the documents to merge and --output\n"));
+            return EXIT_FAILURE;
+        }
+        return merge (paths, output);
+    }
+
+    return -1;
+}
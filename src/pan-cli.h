@@ -1,5 +1,5 @@
 /*
- * pan-action-delete.h
+ * pan-cli.h
  *
  * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
  *
@@ -19,19 +19,14 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+
 #pragma once
 
-#include <glib-object.h>
-#include "pan-action.h"
-#include "pan-record.h"
-#include "pan-annot.h"
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
-#define PAN_TYPE_ACTION_DELETE pan_action_delete_get_type ()
-G_DECLARE_FINAL_TYPE (PanActionDelete, pan_action_delete, PAN, ACTION_DELETE, PanAction)
-
-PanAction *pan_action_delete_new (PanRecord *record, PanAnnot *annot, guint pos);
+void pan_cli_add_options (GApplication *application);
+gint pan_cli_run         (GVariantDict *options);
 
 G_END_DECLS
-
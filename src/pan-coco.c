@@ -0,0 +1,763 @@
+/*
+ * pan-coco.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * COCO keypoint files, as used by most pose and point datasets.  Every
+ * point becomes an annotation of its own with a single keypoint of the
+ * category "point":
+ *
+ *   { "info": { "root": ... },
+ *     "images": [ { "id": 1, "file_name": "0001.jpg" }, ... ],
+ *     "annotations": [ { "id": 1, "image_id": 1, "category_id": 1,
+ *                        "keypoints": [ x, y, 2 ], "num_keypoints": 1 }, ... ],
+ *     "categories": [ { "id": 1, "name": "point", "keypoints": [ "point" ] } ] }
+ *
+ * Images carry no width and height, as that would mean opening every one
+ * of them.  On loading, every visible keypoint becomes a point, and an
+ * annotation without keypoints adds the centre of its bounding box.  The
+ * root folder is read from "info", or else is the folder the file is in.
+ *
+ * Neither direction builds a JSON tree.  Saving writes the text through a
+ * small buffer, and loading runs a pull parser over a fixed buffer that
+ * skips everything it does not need, so memory follows the number of
+ * points rather than the size of the file.
+ */
+
+#include "pan-coco.h"
+#include "pan-writer.h"
+
+#define BUFFER_SIZE (64 * 1024)
+
+typedef struct
+{
+    GInputStream *in;
+    guint8 *buffer;
+    gsize pos;
+    gsize len;
+    goffset offset;
+    GString *string;
+    GError *error;
+    gboolean invalid;
+} Scanner;
+
+typedef struct
+{
+    GHashTable *ids;
+    GPtrArray *names;
+    GPtrArray *points;
+    GArray *keypoints;
+    GArray *bbox;
+    gchar *root;
+} Import;
+
+static void     scanner_init      (Scanner       *s,
+                                   GInputStream  *in);
+static void     scanner_clear     (Scanner       *s);
+static gint     peek_char         (Scanner       *s);
+static gint     next_char         (Scanner       *s);
+static void     skip_space        (Scanner       *s);
+static gboolean fail              (Scanner       *s);
+static gboolean expect            (Scanner       *s,
+                                   gint           c);
+static gboolean read_hex          (Scanner       *s,
+                                   gunichar      *value);
+static gboolean read_string       (Scanner       *s);
+static gboolean read_number       (Scanner       *s,
+                                   gdouble       *value);
+static gboolean read_numbers      (Scanner       *s,
+                                   GArray        *numbers);
+static gboolean skip_value        (Scanner       *s);
+static gboolean next_member       (Scanner       *s,
+                                   gboolean      *first);
+static gboolean next_element      (Scanner       *s,
+                                   gboolean      *first);
+static gboolean key_is            (Scanner       *s,
+                                   const gchar   *name);
+static guint    image_index       (Import        *import,
+                                   gint64         id);
+static void     add_point         (GArray        *points,
+                                   gdouble        x,
+                                   gdouble        y);
+static gboolean parse_info        (Scanner       *s,
+                                   Import        *import);
+static gboolean parse_images      (Scanner       *s,
+                                   Import        *import);
+static gboolean parse_annotations (Scanner       *s,
+                                   Import        *import);
+static gboolean parse_document    (Scanner       *s,
+                                   Import        *import);
+static void     append_string     (GString       *out,
+                                   const gchar   *text);
+
+static void
+scanner_init (Scanner      *s,
+              GInputStream *in)
+{
+    *s = (Scanner) {
+        .in     = in,
+        .buffer = g_malloc (BUFFER_SIZE),
+        .string = g_string_new (NULL),
+    };
+}
+
+static void
+scanner_clear (Scanner *s)
+{
+    g_free (s->buffer);
+    g_string_free (s->string, TRUE);
+    g_clear_error (&s->error);
+}
+
+/* Returns the next byte without consuming it, or -1 at the end. */
+static gint
+peek_char (Scanner *s)
+{
+    gssize n;
+
+    if (s->pos < s->len)
+        return s->buffer[s->pos];
+    if (s->error)
+        return -1;
+
+    s->offset += s->len;
+    s->pos = s->len = 0;
+    n = g_input_stream_read (s->in, s->buffer, BUFFER_SIZE, NULL, &s->error);
+    if (n <= 0)
+        return -1;
+    s->len = n;
+
+    return s->buffer[0];
+}
+
+static gint
+next_char (Scanner *s)
+{
+    gint c;
+
+    c = peek_char (s);
+    if (c >= 0)
+        s->pos++;
+
+    return c;
+}
+
+static void
+skip_space (Scanner *s)
+{
+    gint c;
+
+    while ((c = peek_char (s)) == ' ' || c == '\t' || c == '\n' || c == '\r')
+        s->pos++;
+}
+
+static gboolean
+fail (Scanner *s)
+{
+    s->invalid = TRUE;
+
+    return FALSE;
+}
+
+static gboolean
+expect (Scanner *s,
+        gint     c)
+{
+    skip_space (s);
+    if (next_char (s) != c)
+        return fail (s);
+
+    return TRUE;
+}
+
+static gboolean
+read_hex (Scanner  *s,
+          gunichar *value)
+{
+    gint c, digit;
+
+    *value = 0;
+    for (guint i = 0; i < 4; i++) {
+        c = next_char (s);
+        digit = c < 0 ? -1 : g_ascii_xdigit_value (c);
+        if (digit < 0)
+            return fail (s);
+        *value = *value * 16 + digit;
+    }
+
+    return TRUE;
+}
+
+/* Reads a string into s->string. */
+static gboolean
+read_string (Scanner *s)
+{
+    gunichar c, low;
+    gint ch;
+
+    if (!expect (s, '"'))
+        return FALSE;
+
+    g_string_truncate (s->string, 0);
+    for (;;) {
+        ch = next_char (s);
+        if (ch < 0)
+            return fail (s);
+        if (ch == '"')
+            return TRUE;
+        if (ch != '\\') {
+            g_string_append_c (s->string, ch);
+            continue;
+        }
+
+        ch = next_char (s);
+        switch (ch) {
+        case '"':
+        case '\\':
+        case '/':
+            g_string_append_c (s->string, ch);
+            break;
+        case 'b':
+            g_string_append_c (s->string, '\b');
+            break;
+        case 'f':
+            g_string_append_c (s->string, '\f');
+            break;
+        case 'n':
+            g_string_append_c (s->string, '\n');
+            break;
+        case 'r':
+            g_string_append_c (s->string, '\r');
+            break;
+        case 't':
+            g_string_append_c (s->string, '\t');
+            break;
+        case 'u':
+            if (!read_hex (s, &c))
+                return FALSE;
+            if (c >= 0xd800 && c < 0xdc00) {
+                if (next_char (s) != '\\' || next_char (s) != 'u' || !read_hex (s, &low) ||
+                    low < 0xdc00 || low >= 0xe000)
+                    return fail (s);
+                c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+            }
+            g_string_append_unichar (s->string, c);
+            break;
+        default:
+            return fail (s);
+        }
+    }
+}
+
+static gboolean
+read_number (Scanner *s,
+             gdouble *value)
+{
+    gchar text[64];
+    gchar *end;
+    guint n = 0;
+    gint c;
+
+    skip_space (s);
+    while ((c = peek_char (s)) >= 0 &&
+           (g_ascii_isdigit (c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+        if (n == sizeof text - 1)
+            return fail (s);
+        text[n++] = c;
+        s->pos++;
+    }
+    text[n] = '\0';
+
+    *value = g_ascii_strtod (text, &end);
+    if (n == 0 || *end != '\0')
+        return fail (s);
+
+    return TRUE;
+}
+
+static gboolean
+read_numbers (Scanner *s,
+              GArray  *numbers)
+{
+    gboolean first = TRUE;
+    gdouble value;
+
+    g_array_set_size (numbers, 0);
+    if (!expect (s, '['))
+        return FALSE;
+
+    while (next_element (s, &first)) {
+        if (!read_number (s, &value))
+            return FALSE;
+        g_array_append_val (numbers, value);
+    }
+
+    return !s->invalid;
+}
+
+/*
+ * Skips one value of any kind.  Nesting is only counted, so this is
+ * cheap for the large members we do not read, like segmentations.
+ */
+static gboolean
+skip_value (Scanner *s)
+{
+    guint depth = 0;
+    gint c;
+
+    do {
+        skip_space (s);
+        c = peek_char (s);
+        if (c < 0)
+            return fail (s);
+
+        if (c == '"') {
+            if (!read_string (s))
+                return FALSE;
+        } else if (c == '{' || c == '[') {
+            s->pos++;
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0)
+                return fail (s);
+            s->pos++;
+            depth--;
+        } else if (c == ',' || c == ':') {
+            if (depth == 0)
+                return fail (s);
+            s->pos++;
+        } else if (g_ascii_isalnum (c) || c == '-') {
+            while ((c = peek_char (s)) >= 0 &&
+                   (g_ascii_isalnum (c) || c == '-' || c == '+' || c == '.'))
+                s->pos++;
+        } else {
+            return fail (s);
+        }
+    } while (depth > 0);
+
+    return TRUE;
+}
+
+/*
+ * Steps to the next member of an object whose '{' has been read, leaving
+ * its name in s->string and the value unread.  Returns %FALSE after the
+ * closing '}' and on errors, which set s->invalid.
+ */
+static gboolean
+next_member (Scanner  *s,
+             gboolean *first)
+{
+    skip_space (s);
+    if (peek_char (s) == '}') {
+        s->pos++;
+        return FALSE;
+    }
+    if (!*first && !expect (s, ','))
+        return FALSE;
+    *first = FALSE;
+
+    return read_string (s) && expect (s, ':');
+}
+
+/* Like next_member(), for the elements of an array. */
+static gboolean
+next_element (Scanner  *s,
+              gboolean *first)
+{
+    skip_space (s);
+    if (peek_char (s) == ']') {
+        s->pos++;
+        return FALSE;
+    }
+    if (!*first && !expect (s, ','))
+        return FALSE;
+    *first = FALSE;
+
+    return TRUE;
+}
+
+static gboolean
+key_is (Scanner     *s,
+        const gchar *name)
+{
+    return g_str_equal (s->string->str, name);
+}
+
+/* Annotations may come before their image, which then has no name yet. */
+static guint
+image_index (Import *import,
+             gint64  id)
+{
+    gpointer index;
+
+    if (g_hash_table_lookup_extended (import->ids, &id, NULL, &index))
+        return GPOINTER_TO_UINT (index);
+
+    index = GUINT_TO_POINTER (import->names->len);
+    g_hash_table_insert (import->ids, g_memdup2 (&id, sizeof id), index);
+    g_ptr_array_add (import->names, NULL);
+    g_ptr_array_add (import->points, g_array_new (FALSE, FALSE, sizeof (guint32)));
+
+    return GPOINTER_TO_UINT (index);
+}
+
+static void
+add_point (GArray  *points,
+           gdouble  x,
+           gdouble  y)
+{
+    guint32 point[2];
+
+    point[0] = CLAMP (x + 0.5, 0, G_MAXUINT32);
+    point[1] = CLAMP (y + 0.5, 0, G_MAXUINT32);
+    g_array_append_vals (points, point, 2);
+}
+
+static gboolean
+parse_info (Scanner *s,
+            Import  *import)
+{
+    gboolean first = TRUE;
+
+    skip_space (s);
+    if (peek_char (s) != '{')
+        return skip_value (s);
+    s->pos++;
+
+    while (next_member (s, &first)) {
+        if (key_is (s, "root")) {
+            if (!read_string (s))
+                return FALSE;
+            g_free (import->root);
+            import->root = g_strdup (s->string->str);
+        } else if (!skip_value (s)) {
+            return FALSE;
+        }
+    }
+
+    return !s->invalid;
+}
+
+static gboolean
+parse_images (Scanner *s,
+              Import  *import)
+{
+    g_autofree gchar *name = NULL;
+    gboolean first = TRUE;
+    gboolean first_member;
+    gboolean has_id;
+    gdouble id = 0;
+    guint index;
+
+    if (!expect (s, '['))
+        return FALSE;
+
+    while (next_element (s, &first)) {
+        if (!expect (s, '{'))
+            return FALSE;
+
+        has_id = FALSE;
+        first_member = TRUE;
+        g_clear_pointer (&name, g_free);
+        while (next_member (s, &first_member)) {
+            if (key_is (s, "id")) {
+                if (!read_number (s, &id))
+                    return FALSE;
+                has_id = TRUE;
+            } else if (key_is (s, "file_name")) {
+                if (!read_string (s))
+                    return FALSE;
+                g_free (name);
+                name = g_strdup (s->string->str);
+            } else if (!skip_value (s)) {
+                return FALSE;
+            }
+        }
+        if (s->invalid || !has_id || !name)
+            return fail (s);
+
+        index = image_index (import, (gint64) id);
+        g_free (g_ptr_array_index (import->names, index));
+        g_ptr_array_index (import->names, index) = g_steal_pointer (&name);
+    }
+
+    return !s->invalid;
+}
+
+static gboolean
+parse_annotations (Scanner *s,
+                   Import  *import)
+{
+    gboolean first = TRUE;
+    gboolean first_member;
+    gboolean has_image;
+    gdouble image_id = 0;
+    const gdouble *v;
+    GArray *points;
+
+    if (!expect (s, '['))
+        return FALSE;
+
+    while (next_element (s, &first)) {
+        if (!expect (s, '{'))
+            return FALSE;
+
+        has_image = FALSE;
+        first_member = TRUE;
+        g_array_set_size (import->keypoints, 0);
+        g_array_set_size (import->bbox, 0);
+        while (next_member (s, &first_member)) {
+            if (key_is (s, "image_id")) {
+                if (!read_number (s, &image_id))
+                    return FALSE;
+                has_image = TRUE;
+            } else if (key_is (s, "keypoints")) {
+                if (!read_numbers (s, import->keypoints))
+                    return FALSE;
+            } else if (key_is (s, "bbox")) {
+                if (!read_numbers (s, import->bbox))
+                    return FALSE;
+            } else if (!skip_value (s)) {
+                return FALSE;
+            }
+        }
+        if (s->invalid || !has_image)
+            return fail (s);
+
+        points = g_ptr_array_index (import->points, image_index (import, (gint64) image_id));
+        if (import->keypoints->len >= 3) {
+            v = (const gdouble *) import->keypoints->data;
+            for (guint i = 0; i + 2 < import->keypoints->len; i += 3) {
+                if (v[i + 2] > 0)
+                    add_point (points, v[i], v[i + 1]);
+            }
+        } else if (import->bbox->len == 4) {
+            v = (const gdouble *) import->bbox->data;
+            add_point (points, v[0] + v[2] / 2, v[1] + v[3] / 2);
+        }
+    }
+
+    return !s->invalid;
+}
+
+static gboolean
+parse_document (Scanner *s,
+                Import  *import)
+{
+    gboolean first = TRUE;
+    gboolean parsed;
+
+    if (!expect (s, '{'))
+        return FALSE;
+
+    while (next_member (s, &first)) {
+        if (key_is (s, "images"))
+            parsed = parse_images (s, import);
+        else if (key_is (s, "annotations"))
+            parsed = parse_annotations (s, import);
+        else if (key_is (s, "info"))
+            parsed = parse_info (s, import);
+        else
+            parsed = skip_value (s);
+
+        if (!parsed)
+            return FALSE;
+    }
+
+    return !s->invalid;
+}
+
+static void
+append_string (GString     *out,
+               const gchar *text)
+{
+    g_string_append_c (out, '"');
+    for (const gchar *p = text ? text : ""; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            g_string_append_c (out, '\\');
+        if ((guchar) *p < 0x20)
+            g_string_append_printf (out, "\\u%04x", (guchar) *p);
+        else
+            g_string_append_c (out, *p);
+    }
+    g_string_append_c (out, '"');
+}
+
+PanDocument *
+pan_coco_load (const gchar  *path,
+               GError      **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFile) parent = NULL;
+    g_autoptr (GFileInputStream) stream = NULL;
+    PanDocument *document = NULL;
+    Scanner scanner;
+    Import import;
+    gboolean parsed;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    file   = g_file_new_for_path (path);
+    stream = g_file_read (file, NULL, error);
+    if (!stream)
+        return NULL;
+
+    import = (Import) {
+        .ids       = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL),
+        .names     = g_ptr_array_new_with_free_func (g_free),
+        .points    = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref),
+        .keypoints = g_array_new (FALSE, FALSE, sizeof (gdouble)),
+        .bbox      = g_array_new (FALSE, FALSE, sizeof (gdouble)),
+    };
+    scanner_init (&scanner, G_INPUT_STREAM (stream));
+
+    parsed = parse_document (&scanner, &import);
+    if (scanner.error) {
+        g_propagate_error (error, g_steal_pointer (&scanner.error));
+    } else if (!parsed) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "%s is not a valid COCO file, error at byte %" G_GOFFSET_FORMAT,
+                     path, scanner.offset + (goffset) scanner.pos);
+    } else if (g_ptr_array_find (import.names, NULL, NULL)) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "%s has annotations of images it does not list", path);
+    } else {
+        if (!import.root || !*import.root) {
+            g_free (import.root);
+            parent = g_file_get_parent (file);
+            import.root = g_file_get_path (parent);
+        }
+        document = pan_document_new_from_points (import.root, import.names, import.points);
+    }
+
+    scanner_clear (&scanner);
+    g_hash_table_unref (import.ids);
+    g_ptr_array_unref (import.names);
+    g_ptr_array_unref (import.points);
+    g_array_unref (import.keypoints);
+    g_array_unref (import.bbox);
+    g_free (import.root);
+
+    return document;
+}
+
+/**
+ * pan_coco_sniff:
+ *
+ * Tells COCO files from documents of our own, which share the ".json"
+ * extension.  Only the top-level members before the first telling one
+ * are read, which for both kinds is at most a few small ones.
+ *
+ * Returns: %TRUE if @path looks like a COCO file
+ */
+gboolean
+pan_coco_sniff (const gchar *path)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFileInputStream) stream = NULL;
+    Scanner scanner;
+    gboolean first = TRUE;
+    gboolean coco = FALSE;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    file   = g_file_new_for_path (path);
+    stream = g_file_read (file, NULL, NULL);
+    if (!stream)
+        return FALSE;
+
+    scanner_init (&scanner, G_INPUT_STREAM (stream));
+    if (expect (&scanner, '{')) {
+        while (next_member (&scanner, &first)) {
+            if (key_is (&scanner, "images") || key_is (&scanner, "annotations") ||
+                key_is (&scanner, "categories")) {
+                coco = TRUE;
+                break;
+            }
+            if (key_is (&scanner, "records") || key_is (&scanner, "path") ||
+                !skip_value (&scanner))
+                break;
+        }
+    }
+    scanner_clear (&scanner);
+
+    return coco;
+}
+
+gboolean
+pan_coco_save (PanDocument  *document,
+               const gchar  *path,
+               GError      **error)
+{
+    PanWriter *writer;
+    GString *buffer;
+    g_autoptr (GArray) points = NULL;
+    PanRecordList *records;
+    guint n_records, n_annots;
+    guint64 annot_id = 0;
+    guint x, y;
+    gboolean written = TRUE;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    writer = pan_writer_new (path, error);
+    if (!writer)
+        return FALSE;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    buffer    = pan_writer_get_buffer (writer);
+    points    = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    g_string_append (buffer, "{\"info\":{\"description\":\"Exported by Pan\",\"root\":");
+    append_string (buffer, pan_document_get_root_path (document));
+    g_string_append (buffer, "},\n\"images\":[");
+    for (guint i = 0; written && i < n_records; i++) {
+        g_string_append_printf (buffer, "%s\n{\"id\":%u,\"file_name\":", i > 0 ? "," : "", i + 1);
+        append_string (buffer, pan_record_list_get_filename (records, i));
+        g_string_append_c (buffer, '}');
+        written = pan_writer_check (writer);
+    }
+
+    g_string_append (buffer, "],\n\"annotations\":[");
+    for (guint i = 0; written && i < n_records; i++) {
+        g_array_set_size (points, 0);
+        n_annots = pan_record_list_copy_points (records, i, points);
+        for (guint j = 0; written && j < n_annots; j++) {
+            x = g_array_index (points, guint32, 2 * j);
+            y = g_array_index (points, guint32, 2 * j + 1);
+
+            annot_id++;
+            g_string_append_printf (buffer,
+                                    "%s\n{\"id\":%" G_GUINT64_FORMAT ",\"image_id\":%u,"
+                                    "\"category_id\":1,\"keypoints\":[%u,%u,2],\"num_keypoints\":1,"
+                                    "\"bbox\":[%u,%u,0,0],\"area\":0,\"iscrowd\":0}",
+                                    annot_id > 1 ? "," : "", annot_id, i + 1, x, y, x, y);
+            written = pan_writer_check (writer);
+        }
+    }
+
+    g_string_append (buffer,
+                     "],\n\"categories\":[{\"id\":1,\"name\":\"point\",\"supercategory\":\"point\","
+                     "\"keypoints\":[\"point\"],\"skeleton\":[]}]}\n");
+
+    return pan_writer_finish (writer, error);
+}
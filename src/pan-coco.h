@@ -1,5 +1,5 @@
 /*
- * pan-action-move.h
+ * pan-coco.h
  *
  * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
  *
@@ -21,17 +21,15 @@
 
 #pragma once
 
-#include <glib-object.h>
-#include "pan-action.h"
-#include "pan-record.h"
-#include "pan-annot.h"
+#include "pan-document.h"
 
 G_BEGIN_DECLS
 
-#define PAN_TYPE_ACTION_MOVE pan_action_move_get_type ()
-G_DECLARE_FINAL_TYPE (PanActionMove, pan_action_move, PAN, ACTION_MOVE, PanAction)
-
-PanAction *pan_action_move_new (PanAnnot *annot, guint old_x, guint old_y, guint new_x, guint new_y);
+PanDocument *pan_coco_load  (const gchar  *path,
+                             GError      **error);
+gboolean     pan_coco_save  (PanDocument  *document,
+                             const gchar  *path,
+                             GError      **error);
+gboolean     pan_coco_sniff (const gchar  *path);
 
 G_END_DECLS
-
@@ -0,0 +1,366 @@
+/*
+ * pan-crops.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Crops around every annotation for classifier training.  Each image is
+ * decoded once, on a worker thread, and all of its crops are cut and
+ * encoded as PNG there.  They go either to a directory, written by the
+ * workers directly, or into a single tar archive, where a lock keeps the
+ * entries whole.  Nothing is held beyond the image being worked on.
+ *
+ * A crop is size pixels plus padding on every side, centred on the point.
+ * Pixels outside the image repeat the edge, mirror the image or are zero;
+ * alternatively crops that reach outside are skipped.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "pan-crops.h"
+#include "pan-parallel.h"
+
+#define DEFAULT_SIZE  64
+#define TAR_BLOCK     512
+
+typedef struct
+{
+    const gchar *root;
+    const gchar *directory;
+    const PanCropOptions *options;
+    GOutputStream *archive;
+    GMutex lock;
+} Export;
+
+typedef struct
+{
+    const gchar *filename;
+    const gchar *stem;
+    GArray *points;
+} Job;
+
+static gint       map_coord   (gint          v,
+                               gint          size,
+                               PanCropBorder border);
+static GdkPixbuf *cut_crop    (GdkPixbuf            *image,
+                               gint                  cx,
+                               gint                  cy,
+                               const PanCropOptions *options);
+static void       fill_header (guint8       *header,
+                               const gchar  *name,
+                               gsize         size,
+                               gchar         type);
+static gboolean   write_block (Export       *export,
+                               const guint8 *header,
+                               const gchar  *data,
+                               gsize         size,
+                               GError      **error);
+static gboolean   write_entry (Export       *export,
+                               const gchar  *name,
+                               const gchar  *data,
+                               gsize         size,
+                               GError      **error);
+static gpointer   export_job  (gpointer   item,
+                               gpointer   user_data,
+                               GError   **error);
+
+void
+pan_crop_options_init (PanCropOptions *options)
+{
+    options->size    = DEFAULT_SIZE;
+    options->padding = 0;
+    options->border  = PAN_CROP_BORDER_CLAMP;
+}
+
+/* Maps a coordinate onto [0, size), or returns -1 for a zero pixel. */
+static gint
+map_coord (gint          v,
+           gint          size,
+           PanCropBorder border)
+{
+    if (v >= 0 && v < size)
+        return v;
+
+    switch (border) {
+    case PAN_CROP_BORDER_CLAMP:
+        return CLAMP (v, 0, size - 1);
+    case PAN_CROP_BORDER_MIRROR:
+        /* Reflect without repeating the edge pixel, folding as often as needed. */
+        if (size == 1)
+            return 0;
+        v = ABS (v) % (2 * size - 2);
+        return v < size ? v : 2 * size - 2 - v;
+    case PAN_CROP_BORDER_ZERO:
+    case PAN_CROP_BORDER_SKIP:
+    default:
+        return -1;
+    }
+}
+
+static GdkPixbuf *
+cut_crop (GdkPixbuf            *image,
+          gint                  cx,
+          gint                  cy,
+          const PanCropOptions *options)
+{
+    GdkPixbuf *crop;
+    const guint8 *src;
+    guint8 *dst;
+    gint side, x0, y0, sx, sy;
+    gint width, height, channels, src_stride, dst_stride;
+
+    side     = options->size + 2 * options->padding;
+    x0       = cx - side / 2;
+    y0       = cy - side / 2;
+    width    = gdk_pixbuf_get_width (image);
+    height   = gdk_pixbuf_get_height (image);
+    channels = gdk_pixbuf_get_n_channels (image);
+
+    if (options->border == PAN_CROP_BORDER_SKIP &&
+        (x0 < 0 || y0 < 0 || x0 + side > width || y0 + side > height))
+        return NULL;
+
+    crop = gdk_pixbuf_new (GDK_COLORSPACE_RGB, gdk_pixbuf_get_has_alpha (image), 8, side, side);
+    src  = gdk_pixbuf_read_pixels (image);
+    dst  = gdk_pixbuf_get_pixels (crop);
+    src_stride = gdk_pixbuf_get_rowstride (image);
+    dst_stride = gdk_pixbuf_get_rowstride (crop);
+
+    for (gint y = 0; y < side; y++) {
+        sy = map_coord (y0 + y, height, options->border);
+        /* Rows inside the image are copied in one go where possible. */
+        if (sy >= 0 && x0 >= 0 && x0 + side <= width) {
+            memcpy (dst + y * dst_stride, src + sy * src_stride + x0 * channels, side * channels);
+            continue;
+        }
+        for (gint x = 0; x < side; x++) {
+            sx = map_coord (x0 + x, width, options->border);
+            if (sx < 0 || sy < 0)
+                memset (dst + y * dst_stride + x * channels, 0, channels);
+            else
+                memcpy (dst + y * dst_stride + x * channels, src + sy * src_stride + sx * channels, channels);
+        }
+    }
+
+    return crop;
+}
+
+/* Writes one ustar entry, or a file when exporting to a directory. */
+/* A ustar header; names of 100 bytes or more are cut here, see write_entry(). */
+static void
+fill_header (guint8      *header,
+             const gchar *name,
+             gsize        size,
+             gchar        type)
+{
+    guint checksum = 0;
+
+    memset (header, 0, TAR_BLOCK);
+    memcpy (header, name, MIN (strlen (name), 100));
+    memcpy (header + 100, "0000644", 8);
+    memcpy (header + 108, "0000000", 8);
+    memcpy (header + 116, "0000000", 8);
+    g_snprintf ((gchar *) header + 124, 12, "%011" G_GSIZE_MODIFIER "o", size);
+    g_snprintf ((gchar *) header + 136, 12, "%011" G_GINT64_MODIFIER "o", g_get_real_time () / G_USEC_PER_SEC);
+    memset (header + 148, ' ', 8);
+    header[156] = type;
+    memcpy (header + 257, "ustar", 6);
+    memcpy (header + 263, "00", 2);
+    for (guint i = 0; i < TAR_BLOCK; i++)
+        checksum += header[i];
+    g_snprintf ((gchar *) header + 148, 8, "%06o", checksum);
+}
+
+/* Writes a header and its data padded to whole blocks.  Call with the lock held. */
+static gboolean
+write_block (Export        *export,
+             const guint8  *header,
+             const gchar   *data,
+             gsize          size,
+             GError       **error)
+{
+    static const guint8 padding[TAR_BLOCK] = { 0 };
+
+    return g_output_stream_write_all (export->archive, header, TAR_BLOCK, NULL, NULL, error) &&
+           g_output_stream_write_all (export->archive, data, size, NULL, NULL, error) &&
+           g_output_stream_write_all (export->archive, padding, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK,
+                                      NULL, NULL, error);
+}
+
+/*
+ * Names that do not fit the 100 bytes of a ustar header are preceded by a
+ * GNU long name entry holding the whole name, which GNU tar, bsdtar and
+ * Python's tarfile read.  The ustar prefix field does not help here: it
+ * is only split at a '/', and the stems have none.
+ */
+static gboolean
+write_entry (Export       *export,
+             const gchar  *name,
+             const gchar  *data,
+             gsize         size,
+             GError      **error)
+{
+    g_autofree gchar *path = NULL;
+    guint8 long_header[TAR_BLOCK];
+    guint8 header[TAR_BLOCK];
+    gsize name_len;
+    gboolean written;
+
+    if (!export->archive) {
+        path = g_build_filename (export->directory, name, NULL);
+        return g_file_set_contents (path, data, size, error);
+    }
+
+    name_len = strlen (name);
+    if (name_len >= 100)
+        fill_header (long_header, "././@LongLink", name_len + 1, 'L');
+    fill_header (header, name, size, '0');
+
+    g_mutex_lock (&export->lock);
+    written = (name_len < 100 || write_block (export, long_header, name, name_len + 1, error)) &&
+              write_block (export, header, data, size, error);
+    g_mutex_unlock (&export->lock);
+
+    return written;
+}
+
+static gpointer
+export_job (gpointer   item,
+            gpointer   user_data,
+            GError   **error)
+{
+    Export *export = user_data;
+    Job *job = item;
+    g_autoptr (GdkPixbuf) image = NULL;
+    g_autofree gchar *image_path = NULL;
+    guint n_points;
+
+    n_points = job->points->len / 2;
+    if (n_points == 0)
+        return GINT_TO_POINTER (TRUE);
+
+    image_path = g_build_filename (export->root, job->filename, NULL);
+    image = gdk_pixbuf_new_from_file (image_path, error);
+    if (!image)
+        return NULL;
+
+    for (guint i = 0; i < n_points; i++) {
+        g_autoptr (GdkPixbuf) crop = NULL;
+        g_autofree gchar *data = NULL;
+        g_autofree gchar *name = NULL;
+        gsize size;
+
+        crop = cut_crop (image,
+                         g_array_index (job->points, guint32, 2 * i),
+                         g_array_index (job->points, guint32, 2 * i + 1),
+                         export->options);
+        if (!crop)
+            continue;
+
+        name = g_strdup_printf ("%s_%u.png", job->stem, i);
+        if (!gdk_pixbuf_save_to_buffer (crop, &data, &size, "png", error, NULL) ||
+            !write_entry (export, name, data, size, error))
+            return NULL;
+    }
+
+    return GINT_TO_POINTER (TRUE);
+}
+
+/**
+ * pan_crops_export:
+ * @output: a directory, created if needed, or a file ending in ".tar"
+ *
+ * Cuts a crop around every annotation of @document and writes it as PNG,
+ * named after the image, as by pan_record_list_dup_stems(), and the
+ * position of the annotation in it.
+ *
+ * Returns: %TRUE if every image was processed
+ */
+gboolean
+pan_crops_export (PanDocument           *document,
+                  const gchar           *output,
+                  const PanCropOptions  *options,
+                  GError               **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFileOutputStream) stream = NULL;
+    g_autofree Job *jobs = NULL;
+    g_autofree gpointer *items = NULL;
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    g_auto (GStrv) stems = NULL;
+    guint8 end[2 * TAR_BLOCK] = { 0 };
+    PanRecordList *records;
+    Export export = { 0 };
+    guint n_records, n_failed;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), FALSE);
+    g_return_val_if_fail (output != NULL, FALSE);
+    g_return_val_if_fail (options != NULL && options->size > 0, FALSE);
+
+    records = pan_document_records (document);
+    stems   = pan_record_list_dup_stems (records, error);
+    if (!stems)
+        return FALSE;
+
+    if (g_str_has_suffix (output, ".tar")) {
+        file = g_file_new_for_path (output);
+        stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+        if (!stream)
+            return FALSE;
+        export.archive = G_OUTPUT_STREAM (stream);
+    } else if (g_mkdir_with_parents (output, 0755) != 0) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "Could not create %s: %s", output, g_strerror (errno));
+        return FALSE;
+    }
+
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    jobs      = g_new0 (Job, n_records);
+    items     = g_new (gpointer, n_records);
+    results   = g_new0 (gpointer, n_records);
+    errors    = g_new0 (GError *, n_records);
+
+    for (guint i = 0; i < n_records; i++) {
+        jobs[i].filename = pan_record_list_get_filename (records, i);
+        jobs[i].stem     = stems[i];
+        jobs[i].points   = g_array_new (FALSE, FALSE, sizeof (guint32));
+        items[i] = &jobs[i];
+        pan_record_list_copy_points (records, i, jobs[i].points);
+    }
+
+    export.root      = pan_document_get_root_path (document);
+    export.directory = output;
+    export.options   = options;
+    g_mutex_init (&export.lock);
+    pan_parallel_map (items, n_records, export_job, &export, results, errors);
+    g_mutex_clear (&export.lock);
+
+    n_failed = pan_record_list_collect_errors (records, errors, error);
+    for (guint i = 0; i < n_records; i++)
+        g_array_unref (jobs[i].points);
+
+    if (export.archive &&
+        (!g_output_stream_write_all (export.archive, end, sizeof end, NULL, NULL, n_failed ? NULL : error) ||
+         !g_output_stream_close (export.archive, NULL, n_failed ? NULL : error)))
+        return FALSE;
+
+    return n_failed == 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * pan-crops.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include "pan-document.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_CROP_BORDER_CLAMP,
+    PAN_CROP_BORDER_MIRROR,
+    PAN_CROP_BORDER_ZERO,
+    PAN_CROP_BORDER_SKIP
+} PanCropBorder;
+
+typedef struct
+{
+    guint size;
+    guint padding;
+    PanCropBorder border;
+} PanCropOptions;
+
+void     pan_crop_options_init (PanCropOptions *options);
+gboolean pan_crops_export      (PanDocument           *document,
+                                const gchar           *output,
+                                const PanCropOptions  *options,
+                                GError               **error);
+
+G_END_DECLS
@@ -0,0 +1,259 @@
+/*
+ * pan-csv.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A plain table with one row per point, for spreadsheets and scripts:
+ *
+ *   filename,x,y
+ *   0001.jpg,120,348
+ *   0002.jpg,,
+ *
+ * Images without points get one row with empty coordinates so that they
+ * survive a round trip.  Rows of one image need not be adjacent.
+ * Filenames are quoted as in RFC 4180 when needed, but quoted fields may
+ * not span lines.  There is no place for the root folder, so on loading
+ * it is taken to be the folder the file is in.
+ *
+ * Both directions stream: saving fills a small buffer that is written out
+ * whenever it is full, and loading reads a line at a time, keeping only
+ * the coordinates.
+ */
+
+#include <string.h>
+#include "pan-csv.h"
+#include "pan-writer.h"
+
+#define BUFFER_SIZE (64 * 1024)
+#define HEADER      "filename,x,y"
+
+static const gchar *quote        (GString       *out,
+                                  const gchar   *field);
+static gboolean     split_row    (const gchar   *line,
+                                  GPtrArray     *fields);
+static gboolean     parse_coord  (const gchar   *text,
+                                  guint32       *value);
+
+static const gchar *
+quote (GString     *out,
+       const gchar *field)
+{
+    if (!strpbrk (field, ",\"\r\n"))
+        return field;
+
+    g_string_assign (out, "\"");
+    for (const gchar *p = field; *p; p++) {
+        if (*p == '"')
+            g_string_append_c (out, '"');
+        g_string_append_c (out, *p);
+    }
+    g_string_append_c (out, '"');
+
+    return out->str;
+}
+
+static gboolean
+split_row (const gchar *line,
+           GPtrArray   *fields)
+{
+    const gchar *p = line;
+    GString *field;
+
+    g_ptr_array_set_size (fields, 0);
+    for (;;) {
+        field = g_string_new (NULL);
+        if (*p == '"') {
+            for (p++; *p != '"' || p[1] == '"'; p++) {
+                if (*p == '\0') {
+                    g_string_free (field, TRUE);
+                    return FALSE;
+                }
+                if (*p == '"')
+                    p++;
+                g_string_append_c (field, *p);
+            }
+            p++;
+            if (*p != ',' && *p != '\0') {
+                g_string_free (field, TRUE);
+                return FALSE;
+            }
+        } else {
+            while (*p != ',' && *p != '\0')
+                g_string_append_c (field, *p++);
+        }
+        g_ptr_array_add (fields, g_string_free (field, FALSE));
+
+        if (*p == '\0')
+            return TRUE;
+        p++;
+    }
+}
+
+/*
+ * Other tools write subpixel positions, which are rounded.  Anything that
+ * rounds to a 32-bit coordinate is taken, up to G_MAXUINT32 itself.
+ */
+static gboolean
+parse_coord (const gchar *text,
+             guint32     *value)
+{
+    gdouble number;
+    gchar *end;
+
+    number = g_ascii_strtod (text, &end);
+    if (end == text || *end != '\0' || !(number >= 0 && number < G_MAXUINT32 + 0.5))
+        return FALSE;
+
+    *value = (guint32) (number + 0.5);
+
+    return TRUE;
+}
+
+PanDocument *
+pan_csv_load (const gchar  *path,
+              GError      **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFile) parent = NULL;
+    g_autoptr (GFileInputStream) stream = NULL;
+    g_autoptr (GDataInputStream) in = NULL;
+    g_autoptr (GHashTable) positions = NULL;
+    g_autoptr (GPtrArray) names = NULL;
+    g_autoptr (GPtrArray) points = NULL;
+    g_autoptr (GPtrArray) fields = NULL;
+    g_autofree gchar *root = NULL;
+    GError *local_error = NULL;
+    const gchar *name, *x, *y;
+    gpointer index;
+    guint32 point[2];
+    guint line_number = 0;
+    gboolean valid;
+    gchar *line;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    file   = g_file_new_for_path (path);
+    stream = g_file_read (file, NULL, error);
+    if (!stream)
+        return NULL;
+
+    in = g_data_input_stream_new (G_INPUT_STREAM (stream));
+    g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (in), BUFFER_SIZE);
+    g_data_input_stream_set_newline_type (in, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+
+    /* The keys are owned by names. */
+    positions = g_hash_table_new (g_str_hash, g_str_equal);
+    names     = g_ptr_array_new_with_free_func (g_free);
+    points    = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+    fields    = g_ptr_array_new_with_free_func (g_free);
+
+    while ((line = g_data_input_stream_read_line (in, NULL, NULL, &local_error))) {
+        line_number++;
+        if (*line == '\0') {
+            g_free (line);
+            continue;
+        }
+
+        valid = split_row (line, fields);
+        g_free (line);
+        if (!valid || fields->len != 3)
+            goto invalid;
+
+        name = g_ptr_array_index (fields, 0);
+        x    = g_ptr_array_index (fields, 1);
+        y    = g_ptr_array_index (fields, 2);
+        if (line_number == 1 && !g_strcmp0 (name, "filename"))
+            continue;
+
+        if (!g_hash_table_lookup_extended (positions, name, NULL, &index)) {
+            index = GUINT_TO_POINTER (names->len);
+            g_ptr_array_add (names, g_strdup (name));
+            g_ptr_array_add (points, g_array_new (FALSE, FALSE, sizeof (guint32)));
+            g_hash_table_insert (positions, g_ptr_array_index (names, names->len - 1), index);
+        }
+
+        if (*x == '\0' && *y == '\0')
+            continue;
+        if (!parse_coord (x, &point[0]) || !parse_coord (y, &point[1]))
+            goto invalid;
+        g_array_append_vals (g_ptr_array_index (points, GPOINTER_TO_UINT (index)), point, 2);
+    }
+    if (local_error) {
+        g_propagate_error (error, local_error);
+        return NULL;
+    }
+
+    parent = g_file_get_parent (file);
+    root   = g_file_get_path (parent);
+
+    return pan_document_new_from_points (root, names, points);
+
+invalid:
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "%s:%u: expected %s", path, line_number, HEADER);
+    return NULL;
+}
+
+gboolean
+pan_csv_save (PanDocument  *document,
+              const gchar  *path,
+              GError      **error)
+{
+    g_autoptr (GString) quoted = NULL;
+    g_autoptr (GArray) points = NULL;
+    PanWriter *writer;
+    GString *buffer;
+    PanRecordList *records;
+    const gchar *name;
+    guint n_records, n_annots;
+    gboolean written = TRUE;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    writer = pan_writer_new (path, error);
+    if (!writer)
+        return FALSE;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    buffer    = pan_writer_get_buffer (writer);
+    quoted    = g_string_new (NULL);
+    points    = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    g_string_append (buffer, HEADER "\n");
+    for (guint i = 0; written && i < n_records; i++) {
+        name = quote (quoted, pan_record_list_get_filename (records, i));
+        g_array_set_size (points, 0);
+        n_annots = pan_record_list_copy_points (records, i, points);
+        if (n_annots == 0)
+            g_string_append_printf (buffer, "%s,,\n", name);
+
+        for (guint j = 0; written && j < n_annots; j++) {
+            g_string_append_printf (buffer, "%s,%u,%u\n", name,
+                                    g_array_index (points, guint32, 2 * j),
+                                    g_array_index (points, guint32, 2 * j + 1));
+            written = pan_writer_check (writer);
+        }
+        written = pan_writer_check (writer);
+    }
+
+    return pan_writer_finish (writer, error);
+}
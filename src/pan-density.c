@@ -0,0 +1,499 @@
+/*
+ * pan-density.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Density maps for crowd-counting models.  Every annotation is splatted as
+ * a Gaussian that sums to one, so a map sums to the number of points.  The
+ * kernel is the outer product of two 1D kernels, each normalised over the
+ * part that falls inside the image, and is added one row at a time with a
+ * scaled vector add that the compiler turns into SIMD code.
+ *
+ * The kernel width is either fixed or, as in MCNN, beta times the mean
+ * distance to the k nearest neighbours of the point.
+ */
+
+#include <math.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "pan-density.h"
+#include "pan-parallel.h"
+
+#define DEFAULT_SIGMA 4.0
+#define DEFAULT_BETA  0.3
+#define MIN_SIGMA     0.5
+#define N_SIGMAS      3
+
+#define NPY_ALIGNMENT 64
+#define TIFF_N_TAGS   10
+
+typedef struct
+{
+    const gchar *directory;
+    const gchar *root;
+    const PanDensityOptions *options;
+} Export;
+
+typedef struct
+{
+    const gchar *filename;
+    const gchar *stem;
+    GArray *points;
+} Job;
+
+static void     axpy            (gfloat       *restrict y,
+                                 const gfloat *restrict x,
+                                 gfloat                 a,
+                                 guint                  n);
+static guint    make_kernel     (gfloat  *kernel,
+                                 gdouble  center,
+                                 gdouble  sigma,
+                                 guint    size,
+                                 guint   *first);
+static gint     compare_x       (gconstpointer a,
+                                 gconstpointer b,
+                                 gpointer      user_data);
+static gdouble *knn_sigmas      (const guint32 *points,
+                                 guint          n_points,
+                                 guint          k,
+                                 gdouble        beta,
+                                 gdouble        fallback);
+static gboolean write_npy       (const gchar  *path,
+                                 const gfloat *map,
+                                 guint         width,
+                                 guint         height,
+                                 GError      **error);
+static gboolean write_tiff      (const gchar  *path,
+                                 const gfloat *map,
+                                 guint         width,
+                                 guint         height,
+                                 GError      **error);
+static gpointer export_job      (gpointer   item,
+                                 gpointer   user_data,
+                                 GError   **error);
+
+void
+pan_density_options_init (PanDensityOptions *options)
+{
+    options->sigma     = DEFAULT_SIGMA;
+    options->knn       = 0;
+    options->beta      = DEFAULT_BETA;
+    options->downscale = 1;
+    options->format    = PAN_DENSITY_NPY;
+}
+
+static void
+axpy (gfloat       *restrict y,
+      const gfloat *restrict x,
+      gfloat                 a,
+      guint                  n)
+{
+    for (guint i = 0; i < n; i++)
+        y[i] += a * x[i];
+}
+
+/*
+ * Fills kernel with the samples of a Gaussian around center that lie in
+ * [0, size) and normalises them to sum to one.  Returns how many there
+ * are; the first one is at *first.
+ */
+static guint
+make_kernel (gfloat  *kernel,
+             gdouble  center,
+             gdouble  sigma,
+             guint    size,
+             guint   *first)
+{
+    gdouble start, end, sum = 0.0;
+    guint n;
+
+    start = MAX (floor (center - N_SIGMAS * sigma), 0.0);
+    end   = MIN (ceil (center + N_SIGMAS * sigma), (gdouble) size - 1);
+    if (end < start)
+        return 0;
+
+    n = end - start + 1;
+    for (guint i = 0; i < n; i++) {
+        gdouble d = start + i - center;
+
+        kernel[i] = exp (-d * d / (2.0 * sigma * sigma));
+        sum += kernel[i];
+    }
+    for (guint i = 0; i < n; i++)
+        kernel[i] /= sum;
+
+    *first = start;
+
+    return n;
+}
+
+static gint
+compare_x (gconstpointer a,
+           gconstpointer b,
+           gpointer      user_data)
+{
+    const guint32 *points = user_data;
+    guint32 xa = points[2 * *(const guint *) a];
+    guint32 xb = points[2 * *(const guint *) b];
+
+    return xa < xb ? -1 : xa > xb;
+}
+
+/*
+ * Finds the k nearest neighbours of every point by walking outwards from
+ * it in x order until the horizontal gap alone exceeds the k-th best
+ * distance.  best keeps the k smallest squared distances in ascending order.
+ */
+static gdouble *
+knn_sigmas (const guint32 *points,
+            guint          n_points,
+            guint          k,
+            gdouble        beta,
+            gdouble        fallback)
+{
+    g_autofree guint *order = NULL;
+    g_autofree gdouble *best = NULL;
+    gdouble *sigmas;
+    gdouble dx, dy, d, sum;
+    guint n_best, j;
+    gint step;
+
+    sigmas = g_new (gdouble, n_points);
+    order  = g_new (guint, n_points);
+    best   = g_new (gdouble, k);
+    for (guint i = 0; i < n_points; i++)
+        order[i] = i;
+    g_qsort_with_data (order, n_points, sizeof (guint), compare_x, (gpointer) points);
+
+    for (guint p = 0; p < n_points; p++) {
+        const guint32 *point = &points[2 * order[p]];
+
+        n_best = 0;
+        for (step = -1; step <= 1; step += 2) {
+            for (gint q = (gint) p + step; q >= 0 && q < (gint) n_points; q += step) {
+                const guint32 *other = &points[2 * order[q]];
+
+                dx = (gdouble) other[0] - point[0];
+                if (n_best == k && dx * dx >= best[k - 1])
+                    break;
+                dy = (gdouble) other[1] - point[1];
+                d  = dx * dx + dy * dy;
+                if (n_best == k && d >= best[k - 1])
+                    continue;
+
+                j = n_best < k ? n_best++ : k - 1;
+                while (j > 0 && best[j - 1] > d) {
+                    best[j] = best[j - 1];
+                    j--;
+                }
+                best[j] = d;
+            }
+        }
+
+        if (n_best == 0) {
+            sigmas[order[p]] = fallback;
+            continue;
+        }
+
+        sum = 0.0;
+        for (guint i = 0; i < n_best; i++)
+            sum += sqrt (best[i]);
+        sigmas[order[p]] = beta * sum / n_best;
+    }
+
+    return sigmas;
+}
+
+/**
+ * pan_density_render:
+ * @points: (array length=n_points): interleaved x and y of the points
+ * @width: width of the image
+ * @height: height of the image
+ * @out_width: (out): width of the map, @width divided by the downscale
+ * @out_height: (out): height of the map
+ *
+ * Renders the density map of @points.  Points outside the image are
+ * skipped.
+ *
+ * Returns: (transfer full): the map, row by row
+ */
+gfloat *
+pan_density_render (const guint32           *points,
+                    guint                    n_points,
+                    guint                    width,
+                    guint                    height,
+                    const PanDensityOptions *options,
+                    guint                   *out_width,
+                    guint                   *out_height)
+{
+    g_autofree gdouble *sigmas = NULL;
+    g_autofree gfloat *kx = NULL;
+    g_autofree gfloat *ky = NULL;
+    gfloat *map;
+    gdouble scale, sigma, cx, cy;
+    guint w, h, capacity, needed;
+    guint x0, y0, nx, ny;
+
+    g_return_val_if_fail (options->downscale > 0, NULL);
+
+    scale = 1.0 / options->downscale;
+    w = (width + options->downscale - 1) / options->downscale;
+    h = (height + options->downscale - 1) / options->downscale;
+    map = g_new0 (gfloat, (gsize) w * h);
+
+    if (options->knn > 0 && n_points > 0)
+        sigmas = knn_sigmas (points, n_points, options->knn, options->beta, options->sigma);
+
+    capacity = 0;
+    for (guint i = 0; i < n_points; i++) {
+        if (points[2 * i] >= width || points[2 * i + 1] >= height)
+            continue;
+
+        sigma = MAX ((sigmas ? sigmas[i] : options->sigma) * scale, MIN_SIGMA);
+        needed = 2 * N_SIGMAS * sigma + 3;
+        if (capacity < needed) {
+            capacity = needed;
+            kx = g_renew (gfloat, kx, capacity);
+            ky = g_renew (gfloat, ky, capacity);
+        }
+
+        /* Map pixel centres onto the downscaled grid. */
+        cx = (points[2 * i] + 0.5) * scale - 0.5;
+        cy = (points[2 * i + 1] + 0.5) * scale - 0.5;
+        nx = make_kernel (kx, cx, sigma, w, &x0);
+        ny = make_kernel (ky, cy, sigma, h, &y0);
+
+        for (guint j = 0; j < ny; j++)
+            axpy (map + (gsize) (y0 + j) * w + x0, kx, ky[j], nx);
+    }
+
+    *out_width  = w;
+    *out_height = h;
+
+    return map;
+}
+
+static gboolean
+write_npy (const gchar  *path,
+           const gfloat *map,
+           guint         width,
+           guint         height,
+           GError      **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFileOutputStream) stream = NULL;
+    g_autoptr (GString) header = NULL;
+    guint16 header_len;
+
+    /* Version 1.0: magic, version, header length, then a padded dict. */
+    header = g_string_new (NULL);
+    g_string_printf (header,
+                     "{'descr': '<f4', 'fortran_order': False, 'shape': (%u, %u), }",
+                     height, width);
+    while ((10 + header->len + 1) % NPY_ALIGNMENT != 0)
+        g_string_append_c (header, ' ');
+    g_string_append_c (header, '\n');
+    header_len = GUINT16_TO_LE (header->len);
+
+    file = g_file_new_for_path (path);
+    stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+    if (!stream)
+        return FALSE;
+
+    return g_output_stream_write_all (G_OUTPUT_STREAM (stream), "\x93NUMPY\x01\x00", 8, NULL, NULL, error) &&
+           g_output_stream_write_all (G_OUTPUT_STREAM (stream), &header_len, 2, NULL, NULL, error) &&
+           g_output_stream_write_all (G_OUTPUT_STREAM (stream), header->str, header->len, NULL, NULL, error) &&
+           g_output_stream_write_all (G_OUTPUT_STREAM (stream), map, (gsize) width * height * sizeof (gfloat), NULL, NULL, error) &&
+           g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+/* A little-endian baseline TIFF with one strip of 32-bit float samples. */
+static gboolean
+write_tiff (const gchar  *path,
+            const gfloat *map,
+            guint         width,
+            guint         height,
+            GError      **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFileOutputStream) stream = NULL;
+    g_autoptr (GByteArray) header = NULL;
+    guint32 data_offset, data_size;
+    /* tag, type (3 = SHORT, 4 = LONG), value; all tags have one value */
+    guint32 tags[TIFF_N_TAGS][3] = {
+        { 256, 4, width },       /* ImageWidth */
+        { 257, 4, height },      /* ImageLength */
+        { 258, 3, 32 },          /* BitsPerSample */
+        { 259, 3, 1 },           /* Compression: none */
+        { 262, 3, 1 },           /* PhotometricInterpretation: BlackIsZero */
+        { 273, 4, 0 },           /* StripOffsets, set below */
+        { 277, 3, 1 },           /* SamplesPerPixel */
+        { 278, 4, height },      /* RowsPerStrip */
+        { 279, 4, 0 },           /* StripByteCounts, set below */
+        { 339, 3, 3 },           /* SampleFormat: IEEE float */
+    };
+    guint16 u16;
+    guint32 u32;
+
+    data_offset = 8 + 2 + TIFF_N_TAGS * 12 + 4;
+    data_size   = (guint32) width * height * sizeof (gfloat);
+    tags[5][2]  = data_offset;
+    tags[8][2]  = data_size;
+
+    header = g_byte_array_new ();
+    g_byte_array_append (header, (const guint8 *) "II*\0", 4);
+    u32 = GUINT32_TO_LE (8);
+    g_byte_array_append (header, (const guint8 *) &u32, 4);
+    u16 = GUINT16_TO_LE (TIFF_N_TAGS);
+    g_byte_array_append (header, (const guint8 *) &u16, 2);
+    for (guint i = 0; i < TIFF_N_TAGS; i++) {
+        u16 = GUINT16_TO_LE (tags[i][0]);
+        g_byte_array_append (header, (const guint8 *) &u16, 2);
+        u16 = GUINT16_TO_LE (tags[i][1]);
+        g_byte_array_append (header, (const guint8 *) &u16, 2);
+        u32 = GUINT32_TO_LE (1);
+        g_byte_array_append (header, (const guint8 *) &u32, 4);
+        /* SHORT values sit in the low bytes of the value field. */
+        if (tags[i][1] == 3) {
+            u16 = GUINT16_TO_LE (tags[i][2]);
+            g_byte_array_append (header, (const guint8 *) &u16, 2);
+            u16 = 0;
+            g_byte_array_append (header, (const guint8 *) &u16, 2);
+        } else {
+            u32 = GUINT32_TO_LE (tags[i][2]);
+            g_byte_array_append (header, (const guint8 *) &u32, 4);
+        }
+    }
+    u32 = 0;
+    g_byte_array_append (header, (const guint8 *) &u32, 4);
+
+    file = g_file_new_for_path (path);
+    stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+    if (!stream)
+        return FALSE;
+
+    return g_output_stream_write_all (G_OUTPUT_STREAM (stream), header->data, header->len, NULL, NULL, error) &&
+           g_output_stream_write_all (G_OUTPUT_STREAM (stream), map, data_size, NULL, NULL, error) &&
+           g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+static gpointer
+export_job (gpointer   item,
+            gpointer   user_data,
+            GError   **error)
+{
+    Export *export = user_data;
+    Job *job = item;
+    g_autofree gchar *image_path = NULL;
+    g_autofree gchar *path = NULL;
+    g_autofree gfloat *map = NULL;
+    gint width, height;
+    guint w, h;
+    gboolean written;
+
+    image_path = g_build_filename (export->root, job->filename, NULL);
+    if (!gdk_pixbuf_get_file_info (image_path, &width, &height)) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "Could not read the size of %s", image_path);
+        return NULL;
+    }
+
+    map = pan_density_render ((const guint32 *) job->points->data, job->points->len / 2,
+                              width, height, export->options, &w, &h);
+
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    for (gsize i = 0; i < (gsize) w * h; i++) {
+        guint32 *bits = (guint32 *) &map[i];
+
+        *bits = GUINT32_SWAP_LE_BE (*bits);
+    }
+#endif
+
+    path = g_strdup_printf ("%s/%s.%s", export->directory, job->stem,
+                            export->options->format == PAN_DENSITY_TIFF ? "tif" : "npy");
+
+    if (export->options->format == PAN_DENSITY_TIFF)
+        written = write_tiff (path, map, w, h, error);
+    else
+        written = write_npy (path, map, w, h, error);
+
+    return written ? GINT_TO_POINTER (TRUE) : NULL;
+}
+
+/**
+ * pan_density_export:
+ * @directory: an existing directory the maps are written to
+ *
+ * Writes one density map per image of @document, named after the image
+ * as by pan_record_list_dup_stems().  The points are copied out of the
+ * records first, then the images are processed in parallel.  Images
+ * whose size cannot be read are reported in @error but do not stop the
+ * others.
+ *
+ * Returns: %TRUE if every map was written
+ */
+gboolean
+pan_density_export (PanDocument              *document,
+                    const gchar              *directory,
+                    const PanDensityOptions  *options,
+                    GError                  **error)
+{
+    g_autofree Job *jobs = NULL;
+    g_autofree gpointer *items = NULL;
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    g_auto (GStrv) stems = NULL;
+    PanRecordList *records;
+    Export export;
+    guint n_records, n_failed;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), FALSE);
+    g_return_val_if_fail (directory != NULL, FALSE);
+    g_return_val_if_fail (options != NULL, FALSE);
+
+    records = pan_document_records (document);
+    stems   = pan_record_list_dup_stems (records, error);
+    if (!stems)
+        return FALSE;
+
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    jobs      = g_new0 (Job, n_records);
+    items     = g_new (gpointer, n_records);
+    results   = g_new0 (gpointer, n_records);
+    errors    = g_new0 (GError *, n_records);
+
+    for (guint i = 0; i < n_records; i++) {
+        jobs[i].filename = pan_record_list_get_filename (records, i);
+        jobs[i].stem     = stems[i];
+        jobs[i].points   = g_array_new (FALSE, FALSE, sizeof (guint32));
+        items[i] = &jobs[i];
+        pan_record_list_copy_points (records, i, jobs[i].points);
+    }
+
+    export.directory = directory;
+    export.root      = pan_document_get_root_path (document);
+    export.options   = options;
+    pan_parallel_map (items, n_records, export_job, &export, results, errors);
+
+    n_failed = pan_record_list_collect_errors (records, errors, error);
+    for (guint i = 0; i < n_records; i++)
+        g_array_unref (jobs[i].points);
+
+    return n_failed == 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * pan-density.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include "pan-document.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_DENSITY_NPY,
+    PAN_DENSITY_TIFF
+} PanDensityFormat;
+
+typedef struct
+{
+    gdouble sigma;
+    guint knn;
+    gdouble beta;
+    guint downscale;
+    PanDensityFormat format;
+} PanDensityOptions;
+
+void     pan_density_options_init (PanDensityOptions *options);
+gfloat  *pan_density_render       (const guint32           *points,
+                                   guint                    n_points,
+                                   guint                    width,
+                                   guint                    height,
+                                   const PanDensityOptions *options,
+                                   guint                   *out_width,
+                                   guint                   *out_height);
+gboolean pan_density_export       (PanDocument              *document,
+                                   const gchar              *directory,
+                                   const PanDensityOptions  *options,
+                                   GError                  **error);
+
+G_END_DECLS
@@ -22,6 +22,13 @@
 #include <glib.h>
 #include <json-glib/json-glib.h>
 #include "pan-document.h"
+#include "pan-record-list.h"
+#include "pan-profiler.h"
+#include "pan-binary.h"
+#include "pan-csv.h"
+#include "pan-coco.h"
+#include "pan-hash.h"
+#include "pan-parallel.h"
 
 struct _PanDocument
 {
@@ -29,8 +36,9 @@ struct _PanDocument
 
     gchar *path;
     gboolean is_dirty;
-    GListStore *records;
+    PanRecordList *records;
     gboolean dirty;
+    PanStats *stats;
 };
 
 enum
@@ -43,6 +51,21 @@ enum
 
 static GParamSpec *pan_document_props[N_PROPS] = {NULL, };
 
+/* One image to hash; position is G_MAXUINT for files not in the document. */
+typedef struct
+{
+    guint position;
+    gchar *name;
+    gchar *path;
+    guint64 hash;
+} HashJob;
+
+typedef struct {
+    gchar     *root;
+    GPtrArray *unhashed;
+    GPtrArray *files;
+} RelinkData;
+
 static void         pan_document_get_property                (GObject    *object,
                                                               guint       property_id,
                                                               GValue     *value,
@@ -63,6 +86,39 @@ static JsonNode    *pan_document_serialize_property          (JsonSerializable *
                                                               const gchar      *property_name,
                                                               const GValue     *value,
                                                               GParamSpec       *pspec);
+static GPtrArray   *unhashed_images                          (PanDocument *self);
+static void         hash_images                              (GPtrArray *jobs);
+static guint        apply_hashes                             (PanDocument *self,
+                                                              GPtrArray   *jobs);
+static gpointer     hash_job                                 (gpointer   item,
+                                                              gpointer   user_data,
+                                                              GError   **error);
+static void         hash_thread                              (GTask        *task,
+                                                              gpointer      source_object,
+                                                              gpointer      task_data,
+                                                              GCancellable *cancellable);
+static void         hash_job_free                            (HashJob *job);
+static gboolean     hash_folder                              (const gchar  *root,
+                                                              GPtrArray    *jobs,
+                                                              GError      **error);
+static guint        match_hashes                             (PanDocument *self,
+                                                              const gchar *root,
+                                                              GPtrArray   *jobs);
+static void         relink_thread                            (GTask        *task,
+                                                              gpointer      source_object,
+                                                              gpointer      task_data,
+                                                              GCancellable *cancellable);
+static void         relink_data_free                         (RelinkData *data);
+static void         stats_thread                             (GTask        *task,
+                                                              gpointer      source_object,
+                                                              gpointer      task_data,
+                                                              GCancellable *cancellable);
+static gboolean     list_files                               (GFile      *root,
+                                                              GFile      *directory,
+                                                              GPtrArray  *names,
+                                                              GError    **error);
+static void         cache_stats                              (PanDocument *self,
+                                                              const gchar *path);
 
 G_DEFINE_FINAL_TYPE_WITH_CODE (PanDocument, pan_document, G_TYPE_OBJECT,
                                G_IMPLEMENT_INTERFACE (JSON_TYPE_SERIALIZABLE,
@@ -80,7 +136,7 @@ pan_document_class_init (PanDocumentClass *klass)
 
     pan_document_props[PROP_RECORDS] =
         g_param_spec_object ("records", NULL, NULL,
-                             G_TYPE_LIST_STORE,
+                             PAN_TYPE_RECORD_LIST,
                              G_PARAM_READWRITE);
     pan_document_props[PROP_PATH] =
         g_param_spec_string ("path",
@@ -94,7 +150,7 @@ static void
 pan_document_init (PanDocument *self)
 {
     self->is_dirty = FALSE;
-    self->records  = g_list_store_new (PAN_TYPE_RECORD);
+    self->records  = pan_record_list_new ();
 }
 
 static void
@@ -112,6 +168,7 @@ pan_document_finalize (GObject *object)
     PanDocument *document = PAN_DOCUMENT (object);
 
     g_free (document->path);
+    g_clear_pointer (&document->stats, pan_stats_free);
     G_OBJECT_CLASS (pan_document_parent_class)->finalize (object);
 }
 
@@ -154,7 +211,7 @@ pan_document_set_property (GObject      *object,
     case PROP_RECORDS:
         if (document->records)
             g_object_unref (document->records);
-        document->records = g_value_get_object (value);
+        document->records = g_value_dup_object (value);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -177,12 +234,16 @@ pan_document_new (GFile *file)
     GFileEnumerator *file_enumerator;
     GFileInfo *file_info;
     GError *error = NULL;
-    PanRecord *record;
     const gchar *filename;
+    gint64 begin;
 
+    begin = PAN_PROFILER_CURRENT_TIME;
     doc = g_object_new (PAN_TYPE_DOCUMENT, NULL);
-    doc->path = g_strdup (g_file_get_path (file));
-    file_enumerator = g_file_enumerate_children (file, "", 0, NULL, &error);
+    doc->path = g_file_get_path (file);
+    file_enumerator = g_file_enumerate_children (file,
+                                                 G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                                 G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                                 0, NULL, &error);
     if (!file_enumerator) {
         g_error ("%s", error->message);
         g_error_free (error);
@@ -192,11 +253,10 @@ pan_document_new (GFile *file)
     error = NULL;
     while ((file_info = g_file_enumerator_next_file (file_enumerator,
                                                      NULL, &error)) != NULL) {
-        if (g_file_info_get_file_type (file_info) != G_FILE_TYPE_REGULAR)
-            continue;
-        filename = g_file_info_get_name (file_info);
-        record = pan_record_new (filename);
-        g_list_store_append (doc->records, record);
+        if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_REGULAR) {
+            filename = g_file_info_get_name (file_info);
+            pan_record_list_append (doc->records, filename);
+        }
         g_object_unref (G_OBJECT (file_info));
     }
     if (error) {
@@ -207,10 +267,12 @@ pan_document_new (GFile *file)
 
     g_object_unref (file_enumerator);
 
+    PAN_PROFILER_ADD_MARK (begin, "pan_document_new", doc->path);
+
     return doc;
 }
 
-GListStore *
+PanRecordList *
 pan_document_records (PanDocument *self)
 {
     g_return_val_if_fail (PAN_IS_DOCUMENT (self), NULL);
@@ -233,13 +295,19 @@ pan_document_save (PanDocument *self,
     GError *error = NULL;
     gchar *data;
     gsize size;
+    gint64 begin;
 
     g_return_if_fail (PAN_IS_DOCUMENT (self));
 
+    begin = PAN_PROFILER_CURRENT_TIME;
     data = json_gobject_to_data (G_OBJECT (self), &size);
-    g_file_set_contents (path, data, size, &error);
+    if (g_file_set_contents (path, data, size, &error))
+        cache_stats (self, path);
+    else
+        g_clear_error (&error);
     self->dirty = FALSE;
     g_free (data);
+    PAN_PROFILER_ADD_MARK (begin, "pan_document_save", path);
 }
 
 static gboolean
@@ -249,22 +317,48 @@ pan_document_deserialize_property (JsonSerializable *serializable,
                                    GParamSpec       *pspec,
                                    JsonNode         *property_node)
 {
+    g_autoptr (GArray) points = NULL;
     JsonNode *node;
-    JsonArray *array;
-    PanRecord *record;
-    GListStore *record_store;
-    guint n;
+    JsonArray *array, *annots;
+    JsonObject *object, *annot;
+    PanRecordList *record_list;
+    const gchar *hash;
+    guint32 point[2];
+    guint n, n_annots;
 
     if (!g_strcmp0 (property_name, "records")) {
-        record_store = g_list_store_new (PAN_TYPE_RECORD);
+        record_list = pan_record_list_new ();
         array = json_node_get_array (property_node);
         n = json_array_get_length (array);
+        points = g_array_new (FALSE, FALSE, sizeof (guint32));
         for (int i = 0; i < n; i++) {
             node = json_array_get_element (array, i);
-            record = PAN_RECORD (json_gobject_deserialize (PAN_TYPE_RECORD, node));
-            g_list_store_append (record_store, record);
+            object = json_node_get_object (node);
+            annots = json_object_get_array_member_with_default (object, "annots", NULL);
+
+            /* The points go straight into the index, no record is built. */
+            g_array_set_size (points, 0);
+            n_annots = annots ? json_array_get_length (annots) : 0;
+            for (guint j = 0; j < n_annots; j++) {
+                node = json_array_get_element (annots, j);
+                if (!JSON_NODE_HOLDS_OBJECT (node))
+                    continue;
+                annot = json_node_get_object (node);
+                point[0] = json_object_get_int_member_with_default (annot, "x", 0);
+                point[1] = json_object_get_int_member_with_default (annot, "y", 0);
+                g_array_append_vals (points, point, 2);
+            }
+            pan_record_list_append_points (record_list,
+                                           json_object_get_string_member_with_default (object, "filename", ""),
+                                           (const guint32 *) points->data, points->len / 2);
+
+            hash = json_object_get_string_member_with_default (object, "hash", NULL);
+            if (hash)
+                pan_record_list_set_hash (record_list, i, pan_hash_from_string (hash));
+            if (json_object_get_boolean_member_with_default (object, "duplicate", FALSE))
+                pan_record_list_set_flags (record_list, i, PAN_RECORD_DUPLICATE);
         }
-        g_value_set_object (value, record_store);
+        g_value_take_object (value, record_list);
         return TRUE;
     }
     return json_serializable_default_deserialize_property (serializable, property_name, value, pspec, property_node);
@@ -276,20 +370,55 @@ pan_document_serialize_property (JsonSerializable *serializable,
                                  const GValue     *value,
                                  GParamSpec       *pspec)
 {
+    g_autoptr (GArray) points = NULL;
     JsonNode *node, *child;
-    JsonArray *array;
-    GListStore *records_store;
+    JsonArray *array, *annots;
+    JsonObject *object, *annot;
+    PanRecordList *record_list;
     PanRecord *record;
+    gchar *text;
+    guint64 hash;
     guint n;
 
     if (!g_strcmp0 (property_name, "records")) {
-        records_store = g_value_get_object (value);
-        n = g_list_model_get_n_items (G_LIST_MODEL (records_store));
+        record_list = g_value_get_object (value);
+        n = g_list_model_get_n_items (G_LIST_MODEL (record_list));
         node = json_node_new (JSON_NODE_ARRAY);
-        array = json_array_new ();
+        array = json_array_sized_new (n);
+        points = g_array_new (FALSE, FALSE, sizeof (guint32));
         for (guint i = 0; i < n; i++) {
-            record = g_list_model_get_item (G_LIST_MODEL (records_store), i);
-            child = json_gobject_serialize (G_OBJECT (record));
+            record = pan_record_list_peek (record_list, i);
+            if (record) {
+                child = json_gobject_serialize (G_OBJECT (record));
+            } else {
+                /* Write records that are not alive straight from the index. */
+                g_array_set_size (points, 0);
+                pan_record_list_copy_points (record_list, i, points);
+                annots = json_array_sized_new (points->len / 2);
+                for (guint j = 0; j + 1 < points->len; j += 2) {
+                    annot = json_object_new ();
+                    json_object_set_int_member (annot, "x", g_array_index (points, guint32, j));
+                    json_object_set_int_member (annot, "y", g_array_index (points, guint32, j + 1));
+                    json_array_add_object_element (annots, annot);
+                }
+
+                object = json_object_new ();
+                json_object_set_string_member (object, "filename",
+                                               pan_record_list_get_filename (record_list, i));
+                json_object_set_array_member (object, "annots", annots);
+                if (pan_record_list_get_flags (record_list, i) & PAN_RECORD_DUPLICATE)
+                    json_object_set_boolean_member (object, "duplicate", TRUE);
+                child = json_node_init_object (json_node_alloc (), object);
+                json_object_unref (object);
+            }
+
+            /* The hash is only written once it is known. */
+            hash = pan_record_list_get_hash (record_list, i);
+            if (hash != PAN_HASH_NONE) {
+                text = pan_hash_to_string (hash);
+                json_object_set_string_member (json_node_get_object (child), "hash", text);
+                g_free (text);
+            }
             json_array_add_element (array, child);
         }
         json_node_set_array (node, array);
@@ -307,12 +436,201 @@ pan_document_open (gchar *path)
     gsize size;
     GError *error = NULL;
     PanDocument *document;
+    gint64 begin;
 
+    begin = PAN_PROFILER_CURRENT_TIME;
     g_file_get_contents (path,  &data, &size, &error);
     document = PAN_DOCUMENT (json_gobject_from_data (PAN_TYPE_DOCUMENT, data, size, &error));
+    PAN_PROFILER_ADD_MARK (begin, "pan_document_open", path);
+    return document;
+}
+
+/**
+ * pan_document_load_file:
+ *
+ * Loads a document, choosing the format by extension: ".bin" for the
+ * binary format, ".csv" for a table of points, and JSON for anything
+ * else.  JSON files are sniffed for COCO keypoints first.  Unlike
+ * pan_document_open() this reports failures and is safe to call from any
+ * thread.
+ *
+ * Returns: (transfer full) (nullable): the document
+ */
+PanDocument *
+pan_document_load_file (const gchar  *path,
+                        GError      **error)
+{
+    g_autofree gchar *data = NULL;
+    PanDocument *document;
+    gsize size;
+    gint64 begin;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    begin = PAN_PROFILER_CURRENT_TIME;
+    if (g_str_has_suffix (path, ".bin")) {
+        document = pan_binary_load (path, error);
+    } else if (g_str_has_suffix (path, ".csv")) {
+        document = pan_csv_load (path, error);
+    } else if (pan_coco_sniff (path)) {
+        document = pan_coco_load (path, error);
+    } else {
+        if (!g_file_get_contents (path, &data, &size, error))
+            return NULL;
+        document = (PanDocument *) json_gobject_from_data (PAN_TYPE_DOCUMENT, data, size, error);
+    }
+    if (document)
+        document->stats = pan_stats_load_cache (path);
+    PAN_PROFILER_ADD_MARK (begin, "pan_document_load_file", path);
+
     return document;
 }
 
+/**
+ * pan_document_save_file:
+ *
+ * Saves @self in the format matching the extension of @path, see
+ * pan_document_load_file().  COCO files are written for paths ending in
+ * ".coco.json".
+ */
+gboolean
+pan_document_save_file (PanDocument  *self,
+                        const gchar  *path,
+                        GError      **error)
+{
+    g_autofree gchar *data = NULL;
+    gboolean saved;
+    gsize size;
+    gint64 begin;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    begin = PAN_PROFILER_CURRENT_TIME;
+    if (g_str_has_suffix (path, ".bin")) {
+        saved = pan_binary_save (self, path, error);
+    } else if (g_str_has_suffix (path, ".csv")) {
+        saved = pan_csv_save (self, path, error);
+    } else if (g_str_has_suffix (path, ".coco.json")) {
+        saved = pan_coco_save (self, path, error);
+    } else {
+        data  = json_gobject_to_data (G_OBJECT (self), &size);
+        saved = g_file_set_contents (path, data, size, error);
+    }
+    if (saved) {
+        self->dirty = FALSE;
+        cache_stats (self, path);
+    }
+    PAN_PROFILER_ADD_MARK (begin, "pan_document_save_file", path);
+
+    return saved;
+}
+
+/**
+ * pan_document_new_from_points:
+ * @root: the folder the images are in
+ * @names: the filenames of the images, in order
+ * @points: for each image, a #GArray of guint32 x, y pairs
+ *
+ * Builds a document from plain coordinates, as importers and
+ * pan_document_merge() collect them.  The points go straight into the
+ * index, records are only built when they are asked for.
+ *
+ * Returns: (transfer full): the document
+ */
+PanDocument *
+pan_document_new_from_points (const gchar *root,
+                              GPtrArray   *names,
+                              GPtrArray   *points)
+{
+    g_autoptr (PanRecordList) records = NULL;
+    GArray *coords;
+
+    g_return_val_if_fail (names != NULL, NULL);
+    g_return_val_if_fail (points != NULL && points->len == names->len, NULL);
+
+    records = pan_record_list_new ();
+    for (guint i = 0; i < names->len; i++) {
+        coords = g_ptr_array_index (points, i);
+        pan_record_list_append_points (records, g_ptr_array_index (names, i),
+                                       (const guint32 *) coords->data, coords->len / 2);
+    }
+
+    return g_object_new (PAN_TYPE_DOCUMENT,
+                         "path", root,
+                         "records", records,
+                         NULL);
+}
+
+/**
+ * pan_document_merge:
+ * @documents: (array length=n_documents): the documents to merge
+ *
+ * Builds a document holding every image of @documents, in order of first
+ * appearance.  Annotations of images that appear more than once are
+ * combined, dropping points at exactly the same position.  The root path
+ * is taken from the first document.
+ *
+ * Returns: (transfer full): the merged document
+ */
+PanDocument *
+pan_document_merge (PanDocument **documents,
+                    guint         n_documents)
+{
+    g_autoptr (GHashTable) positions = NULL;
+    g_autoptr (GPtrArray) names = NULL;
+    g_autoptr (GPtrArray) sets = NULL;
+    g_autoptr (GPtrArray) coords = NULL;
+    g_autoptr (GArray) copied = NULL;
+    PanRecordList *records;
+    GArray *points;
+    GHashTable *seen;
+    const gchar *name;
+    gpointer index;
+    gint64 key;
+    guint n;
+
+    g_return_val_if_fail (n_documents > 0, NULL);
+
+    /*
+     * For each distinct filename, coords holds its (x, y) pairs in order
+     * and sets the positions already taken.
+     */
+    positions = g_hash_table_new (g_str_hash, g_str_equal);
+    names     = g_ptr_array_new ();
+    coords    = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+    sets      = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+    copied    = g_array_new (FALSE, FALSE, sizeof (guint32));
+    for (guint d = 0; d < n_documents; d++) {
+        records = pan_document_records (documents[d]);
+        n = g_list_model_get_n_items (G_LIST_MODEL (records));
+        for (guint i = 0; i < n; i++) {
+            name = pan_record_list_get_filename (records, i);
+            if (!g_hash_table_lookup_extended (positions, name, NULL, &index)) {
+                index = GUINT_TO_POINTER (names->len);
+                g_hash_table_insert (positions, (gpointer) name, index);
+                g_ptr_array_add (names, (gpointer) name);
+                g_ptr_array_add (coords, g_array_new (FALSE, FALSE, sizeof (guint32)));
+                g_ptr_array_add (sets, g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL));
+            }
+
+            g_array_set_size (copied, 0);
+            if (pan_record_list_copy_points (records, i, copied) == 0)
+                continue;
+
+            points = g_ptr_array_index (coords, GPOINTER_TO_UINT (index));
+            seen   = g_ptr_array_index (sets, GPOINTER_TO_UINT (index));
+            for (guint j = 0; j + 1 < copied->len; j += 2) {
+                key = ((gint64) g_array_index (copied, guint32, j) << 32) | g_array_index (copied, guint32, j + 1);
+                if (g_hash_table_add (seen, g_memdup2 (&key, sizeof key)))
+                    g_array_append_vals (points, &g_array_index (copied, guint32, j), 2);
+            }
+        }
+    }
+
+    return pan_document_new_from_points (pan_document_get_root_path (documents[0]), names, coords);
+}
+
 gboolean
 pan_document_is_dirty (PanDocument *self)
 {
@@ -329,3 +647,507 @@ pan_document_set_dirty (PanDocument *self,
     self->dirty = dirty;
 }
 
+
+void
+pan_document_account_memory (PanDocument     *self,
+                             PanMemoryReport *report)
+{
+    g_return_if_fail (PAN_IS_DOCUMENT (self));
+    g_return_if_fail (report != NULL);
+
+    pan_memory_report_add (report, PAN_MEMORY_RECORDS, pan_memory_instance_size (PAN_TYPE_DOCUMENT));
+    if (self->path)
+        pan_memory_report_add (report, PAN_MEMORY_FILENAMES, strlen (self->path) + 1);
+    pan_memory_report_add_objects (report, PAN_TYPE_DOCUMENT, 1);
+
+    pan_record_list_account_memory (self->records, report);
+}
+
+/* Statistics that are not complete are left to be computed on demand. */
+static void
+cache_stats (PanDocument *self,
+             const gchar *path)
+{
+    GError *error = NULL;
+
+    if (!self->stats || !pan_stats_is_complete (self->stats))
+        return;
+
+    if (!pan_stats_save_cache (self->stats, path, &error)) {
+        g_warning ("Could not cache the statistics of %s: %s", path, error->message);
+        g_error_free (error);
+    }
+}
+
+/**
+ * pan_document_get_stats:
+ *
+ * Returns the statistics of @self, summarizing the records that are new
+ * or changed since the last call.  After loading a document whose
+ * statistics were cached when it was saved, this costs nothing.
+ *
+ * Returns: (transfer none): the statistics
+ */
+PanStats *
+pan_document_get_stats (PanDocument *self)
+{
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), NULL);
+
+    if (!self->stats)
+        self->stats = pan_stats_new ();
+    pan_stats_update (self->stats, self, TRUE);
+
+    return self->stats;
+}
+
+static void
+stats_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+    if (task_data)
+        pan_stats_pass_run (task_data, TRUE);
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * pan_document_get_stats_async:
+ *
+ * Like pan_document_get_stats(), but reads the images on a thread.  The
+ * summaries are stored when the operation is finished.
+ */
+void
+pan_document_get_stats_async (PanDocument         *self,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (PAN_IS_DOCUMENT (self));
+
+    if (!self->stats)
+        self->stats = pan_stats_new ();
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_document_get_stats_async);
+    g_task_set_task_data (task, pan_stats_begin (self->stats, self), (GDestroyNotify) pan_stats_pass_free);
+    g_task_run_in_thread (task, stats_thread);
+}
+
+/**
+ * pan_document_get_stats_finish:
+ *
+ * Returns: (transfer none) (nullable): the statistics, or %NULL with
+ *   @error set
+ */
+PanStats *
+pan_document_get_stats_finish (PanDocument   *self,
+                               GAsyncResult  *result,
+                               GError       **error)
+{
+    PanStatsPass *pass;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+    if (!g_task_propagate_boolean (G_TASK (result), error))
+        return NULL;
+
+    pass = g_task_get_task_data (G_TASK (result));
+    if (pass)
+        pan_stats_finish (self->stats, pass);
+
+    return self->stats;
+}
+
+/**
+ * pan_document_record_changed:
+ *
+ * Tells @self that the annotations of the record at @position were
+ * edited, so that its summary is computed again.
+ */
+void
+pan_document_record_changed (PanDocument *self,
+                             guint        position)
+{
+    g_return_if_fail (PAN_IS_DOCUMENT (self));
+
+    if (self->stats)
+        pan_stats_invalidate (self->stats, position);
+}
+
+static void
+hash_job_free (HashJob *job)
+{
+    g_free (job->name);
+    g_free (job->path);
+    g_free (job);
+}
+
+/* Images that cannot be read keep PAN_HASH_NONE, they may be gone already. */
+static gpointer
+hash_job (gpointer   item,
+          gpointer   user_data,
+          GError   **error)
+{
+    HashJob *job = item;
+
+    if (!pan_hash_file (job->path, &job->hash, NULL, NULL))
+        job->hash = PAN_HASH_NONE;
+
+    return job;
+}
+
+static GPtrArray *
+unhashed_images (PanDocument *self)
+{
+    GPtrArray *jobs;
+    HashJob *job;
+    guint n_records;
+
+    jobs      = g_ptr_array_new_with_free_func ((GDestroyNotify) hash_job_free);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (self->records));
+    for (guint i = 0; i < n_records; i++) {
+        if (pan_record_list_get_hash (self->records, i) != PAN_HASH_NONE)
+            continue;
+
+        job = g_new0 (HashJob, 1);
+        job->position = i;
+        job->name     = g_strdup (pan_record_list_get_filename (self->records, i));
+        job->path     = g_build_filename (self->path ? self->path : ".", job->name, NULL);
+        g_ptr_array_add (jobs, job);
+    }
+
+    return jobs;
+}
+
+static void
+hash_images (GPtrArray *jobs)
+{
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+
+    if (jobs->len == 0)
+        return;
+
+    results = g_new0 (gpointer, jobs->len);
+    errors  = g_new0 (GError *, jobs->len);
+    pan_parallel_map (jobs->pdata, jobs->len, hash_job, NULL, results, errors);
+}
+
+/* Records renamed while the hashes were computed are left alone. */
+static guint
+apply_hashes (PanDocument *self,
+              GPtrArray   *jobs)
+{
+    HashJob *job;
+    guint n_hashed = 0;
+
+    for (guint i = 0; i < jobs->len; i++) {
+        job = g_ptr_array_index (jobs, i);
+        if (job->hash == PAN_HASH_NONE ||
+            g_strcmp0 (pan_record_list_get_filename (self->records, job->position), job->name))
+            continue;
+
+        pan_record_list_set_hash (self->records, job->position, job->hash);
+        n_hashed++;
+    }
+
+    return n_hashed;
+}
+
+/**
+ * pan_document_hash_images:
+ *
+ * Computes the content hash of every image that does not have one yet,
+ * on all cores.  The hashes are saved with the document, so this only
+ * reads images added since.
+ *
+ * Returns: the number of images hashed
+ */
+guint
+pan_document_hash_images (PanDocument *self)
+{
+    g_autoptr (GPtrArray) jobs = NULL;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), 0);
+
+    jobs = unhashed_images (self);
+    hash_images (jobs);
+
+    return apply_hashes (self, jobs);
+}
+
+static void
+hash_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+    hash_images (task_data);
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * pan_document_hash_images_async:
+ *
+ * Like pan_document_hash_images(), but reads the images on a thread.  The
+ * hashes are stored when the operation is finished.
+ */
+void
+pan_document_hash_images_async (PanDocument         *self,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (PAN_IS_DOCUMENT (self));
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_document_hash_images_async);
+    g_task_set_task_data (task, unhashed_images (self), (GDestroyNotify) g_ptr_array_unref);
+    g_task_run_in_thread (task, hash_thread);
+}
+
+guint
+pan_document_hash_images_finish (PanDocument   *self,
+                                 GAsyncResult  *result,
+                                 GError       **error)
+{
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), 0);
+    g_return_val_if_fail (g_task_is_valid (result, self), 0);
+
+    if (!g_task_propagate_boolean (G_TASK (result), error))
+        return 0;
+
+    return apply_hashes (self, g_task_get_task_data (G_TASK (result)));
+}
+
+/* Collects the paths of the regular files below directory, relative to root. */
+static gboolean
+list_files (GFile      *root,
+            GFile      *directory,
+            GPtrArray  *names,
+            GError    **error)
+{
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    GFileInfo *info;
+    GFile *child;
+    gboolean ok = TRUE;
+
+    enumerator = g_file_enumerate_children (directory,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                            G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                            G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, error);
+    if (!enumerator)
+        return FALSE;
+
+    while (ok && g_file_enumerator_iterate (enumerator, &info, &child, NULL, error) && info) {
+        if (g_file_info_get_is_hidden (info))
+            continue;
+
+        switch (g_file_info_get_file_type (info)) {
+        case G_FILE_TYPE_REGULAR:
+            g_ptr_array_add (names, g_file_get_relative_path (root, child));
+            break;
+        case G_FILE_TYPE_DIRECTORY:
+            ok = list_files (root, child, names, error);
+            break;
+        case G_FILE_TYPE_UNKNOWN:
+        case G_FILE_TYPE_SYMBOLIC_LINK:
+        case G_FILE_TYPE_SPECIAL:
+        case G_FILE_TYPE_SHORTCUT:
+        case G_FILE_TYPE_MOUNTABLE:
+        default:
+            break;
+        }
+    }
+
+    return ok && !(error && *error);
+}
+
+/* Hashes every file below root.  Runs on any thread, it does not touch the document. */
+static gboolean
+hash_folder (const gchar  *root,
+             GPtrArray    *jobs,
+             GError      **error)
+{
+    g_autoptr (GFile) root_file = NULL;
+    g_autoptr (GPtrArray) names = NULL;
+    HashJob *job;
+
+    root_file = g_file_new_for_path (root);
+    names     = g_ptr_array_new_with_free_func (g_free);
+    if (!list_files (root_file, root_file, names, error))
+        return FALSE;
+
+    for (guint i = 0; i < names->len; i++) {
+        job = g_new0 (HashJob, 1);
+        job->position = G_MAXUINT;
+        job->name     = g_strdup (g_ptr_array_index (names, i));
+        job->path     = g_build_filename (root, job->name, NULL);
+        g_ptr_array_add (jobs, job);
+    }
+    hash_images (jobs);
+
+    return TRUE;
+}
+
+/* Points each record at the file below root with the same hash. */
+static guint
+match_hashes (PanDocument *self,
+              const gchar *root,
+              GPtrArray   *jobs)
+{
+    g_autoptr (GHashTable) found = NULL;
+    HashJob *job;
+    gpointer match;
+    guint n_records, n_found = 0;
+    guint64 hash;
+
+    /* A NULL value marks content found in more than one file. */
+    found = g_hash_table_new (g_int64_hash, g_int64_equal);
+    for (guint i = 0; i < jobs->len; i++) {
+        job = g_ptr_array_index (jobs, i);
+        if (job->hash == PAN_HASH_NONE)
+            continue;
+        if (g_hash_table_contains (found, &job->hash))
+            g_hash_table_insert (found, &job->hash, NULL);
+        else
+            g_hash_table_insert (found, &job->hash, job);
+    }
+
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (self->records));
+    for (guint i = 0; i < n_records; i++) {
+        hash = pan_record_list_get_hash (self->records, i);
+        if (hash == PAN_HASH_NONE || !(match = g_hash_table_lookup (found, &hash)))
+            continue;
+
+        job = match;
+        if (g_strcmp0 (pan_record_list_get_filename (self->records, i), job->name)) {
+            pan_record_list_set_filename (self->records, i, job->name);
+            pan_document_record_changed (self, i);
+        }
+        n_found++;
+    }
+
+    if (n_found > 0) {
+        g_object_set (self, "path", root, NULL);
+        self->dirty = TRUE;
+    }
+
+    return n_found;
+}
+
+/**
+ * pan_document_relink:
+ * @root: the folder the images are in now
+ *
+ * Finds the images of @self below @root by their content, after they were
+ * moved or renamed.  Images that were never hashed are hashed first, if
+ * they are still where they were.  Every file below @root is hashed on
+ * all cores, and each record whose hash is found is pointed at that file.
+ * Files whose content appears more than once are ambiguous and skipped.
+ *
+ * @root becomes the root of @self if at least one image was found.
+ *
+ * Returns: the number of images found, or 0 with @error set if @root
+ *   could not be read
+ */
+guint
+pan_document_relink (PanDocument  *self,
+                     const gchar  *root,
+                     GError      **error)
+{
+    g_autoptr (GPtrArray) jobs = NULL;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), 0);
+    g_return_val_if_fail (root != NULL, 0);
+
+    pan_document_hash_images (self);
+
+    jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) hash_job_free);
+    if (!hash_folder (root, jobs, error))
+        return 0;
+
+    return match_hashes (self, root, jobs);
+}
+
+static void
+relink_data_free (RelinkData *data)
+{
+    g_free (data->root);
+    g_ptr_array_unref (data->unhashed);
+    g_ptr_array_unref (data->files);
+    g_free (data);
+}
+
+static void
+relink_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+    RelinkData *data = task_data;
+    GError *error = NULL;
+
+    hash_images (data->unhashed);
+    if (!hash_folder (data->root, data->files, &error))
+        g_task_return_error (task, error);
+    else
+        g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * pan_document_relink_async:
+ *
+ * Like pan_document_relink(), but lists and reads the files on a thread.
+ * The records are pointed at their new paths when the operation is
+ * finished.
+ */
+void
+pan_document_relink_async (PanDocument         *self,
+                           const gchar         *root,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+    RelinkData *data;
+
+    g_return_if_fail (PAN_IS_DOCUMENT (self));
+    g_return_if_fail (root != NULL);
+
+    data = g_new0 (RelinkData, 1);
+    data->root     = g_strdup (root);
+    data->unhashed = unhashed_images (self);
+    data->files    = g_ptr_array_new_with_free_func ((GDestroyNotify) hash_job_free);
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_document_relink_async);
+    g_task_set_task_data (task, data, (GDestroyNotify) relink_data_free);
+    g_task_run_in_thread (task, relink_thread);
+}
+
+guint
+pan_document_relink_finish (PanDocument   *self,
+                            GAsyncResult  *result,
+                            GError       **error)
+{
+    RelinkData *data;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (self), 0);
+    g_return_val_if_fail (g_task_is_valid (result, self), 0);
+
+    /* The old locations were read before the folder, keep what they gave. */
+    data = g_task_get_task_data (G_TASK (result));
+    apply_hashes (self, data->unhashed);
+    if (!g_task_propagate_boolean (G_TASK (result), error))
+        return 0;
+
+    return match_hashes (self, data->root, data->files);
+}
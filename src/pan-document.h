@@ -24,21 +24,64 @@
 #include <glib.h>
 #include <gio/gio.h>
 #include "pan-record.h"
+#include "pan-record-list.h"
+#include "pan-stats.h"
 
 G_BEGIN_DECLS
 
 #define PAN_TYPE_DOCUMENT pan_document_get_type ()
 G_DECLARE_FINAL_TYPE (PanDocument, pan_document, PAN, DOCUMENT, GObject)
 
-PanDocument *pan_document_new           (GFile *file);
-GListStore  *pan_document_records       (PanDocument *self);
-PanDocument *pan_document_open          (gchar *path);
-void         pan_document_save          (PanDocument *self,
-                                         gchar *path);
-gchar       *pan_document_get_root_path (PanDocument *self);
-gboolean     pan_document_is_dirty      (PanDocument *self);
-void         pan_document_set_dirty     (PanDocument *self,
-                                         gboolean     dirty);
+PanDocument   *pan_document_new           (GFile *file);
+PanRecordList *pan_document_records       (PanDocument *self);
+PanDocument   *pan_document_open          (gchar *path);
+void           pan_document_save          (PanDocument *self,
+                                           gchar *path);
+PanDocument   *pan_document_load_file     (const gchar  *path,
+                                           GError      **error);
+gboolean       pan_document_save_file     (PanDocument  *self,
+                                           const gchar  *path,
+                                           GError      **error);
+PanDocument   *pan_document_new_from_points (const gchar *root,
+                                             GPtrArray   *names,
+                                             GPtrArray   *points);
+PanDocument   *pan_document_merge         (PanDocument **documents,
+                                           guint         n_documents);
+gchar         *pan_document_get_root_path (PanDocument *self);
+gboolean       pan_document_is_dirty      (PanDocument *self);
+void           pan_document_set_dirty     (PanDocument *self,
+                                           gboolean     dirty);
+void           pan_document_account_memory (PanDocument     *self,
+                                            PanMemoryReport *report);
+PanStats      *pan_document_get_stats     (PanDocument *self);
+void           pan_document_get_stats_async  (PanDocument         *self,
+                                              GCancellable        *cancellable,
+                                              GAsyncReadyCallback  callback,
+                                              gpointer             user_data);
+PanStats      *pan_document_get_stats_finish (PanDocument   *self,
+                                              GAsyncResult  *result,
+                                              GError       **error);
+void           pan_document_record_changed (PanDocument *self,
+                                            guint        position);
+guint          pan_document_hash_images   (PanDocument  *self);
+void           pan_document_hash_images_async  (PanDocument         *self,
+                                                GCancellable        *cancellable,
+                                                GAsyncReadyCallback  callback,
+                                                gpointer             user_data);
+guint          pan_document_hash_images_finish (PanDocument   *self,
+                                                GAsyncResult  *result,
+                                                GError       **error);
+guint          pan_document_relink        (PanDocument  *self,
+                                           const gchar  *root,
+                                           GError      **error);
+void           pan_document_relink_async  (PanDocument         *self,
+                                           const gchar         *root,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+guint          pan_document_relink_finish (PanDocument   *self,
+                                           GAsyncResult  *result,
+                                           GError       **error);
 
 G_END_DECLS
 
@@ -0,0 +1,366 @@
+/*
+ * pan-duplicates.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Finds points that were placed twice, by a double click or by annotating
+ * an image again.  Each record is put in a PanCellGrid as wide as the
+ * threshold, so a point is only compared with the points around it.
+ * Records are searched in parallel.
+ */
+
+#include "pan-duplicates.h"
+#include "pan-cell-grid.h"
+#include "pan-parallel.h"
+
+typedef struct
+{
+    guint record;
+    guint current;
+    GArray *points;
+    GArray *pairs;
+} Job;
+
+typedef struct
+{
+    GPtrArray *jobs;
+    guint distance;
+} Search;
+
+static gint     compare_pairs (gconstpointer  a,
+                               gconstpointer  b);
+static void     add_pair      (guint32        position,
+                               guint64        d2,
+                               gpointer       user_data);
+static gpointer find_job      (gpointer       item,
+                               gpointer       user_data,
+                               GError       **error);
+static void     job_free      (Job           *job);
+static guint    find_root     (guint         *parent,
+                               guint          i);
+static Search  *search_new    (PanDocument   *document,
+                               guint          distance);
+static GArray  *search_run    (Search        *search);
+static void     search_free   (Search        *search);
+static void     search_thread (GTask         *task,
+                               gpointer       source_object,
+                               gpointer       task_data,
+                               GCancellable  *cancellable);
+
+static gint
+compare_pairs (gconstpointer a,
+               gconstpointer b)
+{
+    const PanDuplicate *pair_a = a;
+    const PanDuplicate *pair_b = b;
+
+    if (pair_a->first != pair_b->first)
+        return pair_a->first < pair_b->first ? -1 : 1;
+
+    return pair_a->second < pair_b->second ? -1 : pair_a->second > pair_b->second;
+}
+
+/* Each pair is reported once, from its first point. */
+static void
+add_pair (guint32  position,
+          guint64  d2,
+          gpointer user_data)
+{
+    Job *job = user_data;
+    PanDuplicate pair;
+
+    if (position <= job->current)
+        return;
+
+    pair.record = job->record;
+    pair.first  = job->current;
+    pair.second = position;
+    g_array_append_val (job->pairs, pair);
+}
+
+static gpointer
+find_job (gpointer   item,
+          gpointer   user_data,
+          GError   **error)
+{
+    Job *job = item;
+    g_autoptr (PanCellGrid) grid = NULL;
+    const guint32 *xy = (const guint32 *) job->points->data;
+    guint n = job->points->len / 2;
+
+    grid = pan_cell_grid_new (xy, n, GPOINTER_TO_UINT (user_data));
+    for (job->current = 0; job->current < n; job->current++)
+        pan_cell_grid_foreach_near (grid, xy[2 * job->current], xy[2 * job->current + 1], add_pair, job);
+    g_array_sort (job->pairs, compare_pairs);
+
+    return job;
+}
+
+static void
+job_free (Job *job)
+{
+    g_array_unref (job->points);
+    g_array_unref (job->pairs);
+    g_free (job);
+}
+
+static guint
+find_root (guint *parent,
+           guint  i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+/* Copies the points of every record with at least two of them. */
+static Search *
+search_new (PanDocument *document,
+            guint        distance)
+{
+    PanRecordList *records;
+    Search *search;
+    guint n_records;
+    Job *job;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    search    = g_new0 (Search, 1);
+    search->jobs     = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+    search->distance = distance;
+    for (guint i = 0; i < n_records; i++) {
+        job = g_new0 (Job, 1);
+        job->record = i;
+        job->points = g_array_new (FALSE, FALSE, sizeof (guint32));
+        job->pairs  = g_array_new (FALSE, FALSE, sizeof (PanDuplicate));
+        if (pan_record_list_copy_points (records, i, job->points) < 2) {
+            job_free (job);
+            continue;
+        }
+        g_ptr_array_add (search->jobs, job);
+    }
+
+    return search;
+}
+
+/* Searches the copies on the worker pool.  It does not touch the document. */
+static GArray *
+search_run (Search *search)
+{
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    GPtrArray *jobs = search->jobs;
+    GArray *duplicates;
+    Job *job;
+
+    duplicates = g_array_new (FALSE, FALSE, sizeof (PanDuplicate));
+    if (jobs->len == 0)
+        return duplicates;
+
+    results = g_new0 (gpointer, jobs->len);
+    errors  = g_new0 (GError *, jobs->len);
+    pan_parallel_map (jobs->pdata, jobs->len, find_job, GUINT_TO_POINTER (search->distance), results, errors);
+
+    for (guint i = 0; i < jobs->len; i++) {
+        job = g_ptr_array_index (jobs, i);
+        g_array_append_vals (duplicates, job->pairs->data, job->pairs->len);
+    }
+
+    return duplicates;
+}
+
+static void
+search_free (Search *search)
+{
+    g_ptr_array_unref (search->jobs);
+    g_free (search);
+}
+
+static void
+search_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+    g_task_return_pointer (task, search_run (task_data), (GDestroyNotify) g_array_unref);
+}
+
+/**
+ * pan_duplicates_find:
+ * @distance: the largest distance in pixels at which points count as one
+ *
+ * Finds every pair of points closer than @distance within the records of
+ * @document.
+ *
+ * Returns: (transfer full) (element-type PanDuplicate): the pairs, sorted
+ *   by record and then by position
+ */
+GArray *
+pan_duplicates_find (PanDocument *document,
+                     guint        distance)
+{
+    Search *search;
+    GArray *duplicates;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), NULL);
+
+    search     = search_new (document, distance);
+    duplicates = search_run (search);
+    search_free (search);
+
+    return duplicates;
+}
+
+/**
+ * pan_duplicates_find_async:
+ *
+ * Like pan_duplicates_find(), but searches on a thread.  The points are
+ * copied before this returns, so edits made meanwhile are not seen.
+ */
+void
+pan_duplicates_find_async (PanDocument         *document,
+                           guint                distance,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (PAN_IS_DOCUMENT (document));
+
+    task = g_task_new (document, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_duplicates_find_async);
+    g_task_set_task_data (task, search_new (document, distance), (GDestroyNotify) search_free);
+    g_task_run_in_thread (task, search_thread);
+}
+
+/**
+ * pan_duplicates_find_finish:
+ *
+ * Returns: (transfer full) (element-type PanDuplicate) (nullable): the
+ *   pairs, or %NULL with @error set
+ */
+GArray *
+pan_duplicates_find_finish (PanDocument   *document,
+                            GAsyncResult  *result,
+                            GError       **error)
+{
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, document), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * pan_duplicates_merge:
+ * @duplicates: (array length=n_duplicates): pairs of @record
+ *
+ * Replaces each cluster of points linked by @duplicates with a single
+ * point at their centroid, kept at the position of the first of them.
+ * All of it is applied and pushed to the history of @record as one group
+ * action.  Pairs that no longer fit the record are ignored.
+ *
+ * Returns: the number of points removed
+ */
+guint
+pan_duplicates_merge (PanRecord          *record,
+                      const PanDuplicate *duplicates,
+                      guint               n_duplicates)
+{
+    g_autoptr (PanActionGroup) group = NULL;
+    g_autofree guint *parent = NULL;
+    g_autofree guint32 *coords = NULL;
+    g_autofree guint64 *sums = NULL;
+    g_autofree guint *counts = NULL;
+    GListStore *store;
+    PanAnnot *annot;
+    PanAction action;
+    guint n, a, b, root;
+    guint x, y, cx, cy;
+    guint removed = 0;
+
+    g_return_val_if_fail (PAN_IS_RECORD (record), 0);
+
+    store = pan_record_annots (record);
+    n = g_list_model_get_n_items (G_LIST_MODEL (store));
+    if (n < 2 || n_duplicates == 0)
+        return 0;
+
+    parent = g_new (guint, n);
+    for (guint i = 0; i < n; i++)
+        parent[i] = i;
+
+    /* The smaller position becomes the root, so it is the one kept. */
+    for (guint i = 0; i < n_duplicates; i++) {
+        if (duplicates[i].first >= n || duplicates[i].second >= n)
+            continue;
+        a = find_root (parent, duplicates[i].first);
+        b = find_root (parent, duplicates[i].second);
+        parent[MAX (a, b)] = MIN (a, b);
+    }
+
+    coords = g_new (guint32, 2 * n);
+    sums   = g_new0 (guint64, 2 * n);
+    counts = g_new0 (guint, n);
+    for (guint i = 0; i < n; i++) {
+        annot = g_list_model_get_item (G_LIST_MODEL (store), i);
+        pan_annot_get_pos (annot, &x, &y);
+        g_object_unref (annot);
+
+        coords[2 * i]     = x;
+        coords[2 * i + 1] = y;
+        root = find_root (parent, i);
+        sums[2 * root]     += x;
+        sums[2 * root + 1] += y;
+        counts[root]++;
+    }
+
+    group = pan_action_group_new ();
+    for (guint i = 0; i < n; i++) {
+        root = find_root (parent, i);
+        if (root != i) {
+            action = pan_action_delete (i, coords[2 * i], coords[2 * i + 1]);
+            pan_action_group_add (group, &action);
+            removed++;
+            continue;
+        }
+        if (counts[i] < 2)
+            continue;
+
+        cx = (sums[2 * i] + counts[i] / 2) / counts[i];
+        cy = (sums[2 * i + 1] + counts[i] / 2) / counts[i];
+        if (cx != coords[2 * i] || cy != coords[2 * i + 1]) {
+            action = pan_action_move (i, coords[2 * i], coords[2 * i + 1], cx, cy);
+            pan_action_group_add (group, &action);
+        }
+    }
+
+    if (removed == 0)
+        return 0;
+
+    action = pan_action_group_end (g_steal_pointer (&group));
+    pan_action_redo (&action, store);
+    pan_history_push (pan_record_get_history (record), &action);
+
+    return removed;
+}
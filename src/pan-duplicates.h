@@ -0,0 +1,50 @@
+/*
+ * pan-duplicates.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "pan-document.h"
+
+G_BEGIN_DECLS
+
+/* Two points of one record that are closer than the threshold, first < second. */
+typedef struct
+{
+    guint record;
+    guint first;
+    guint second;
+} PanDuplicate;
+
+GArray *pan_duplicates_find        (PanDocument         *document,
+                                    guint                distance);
+void    pan_duplicates_find_async  (PanDocument         *document,
+                                    guint                distance,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data);
+GArray *pan_duplicates_find_finish (PanDocument         *document,
+                                    GAsyncResult        *result,
+                                    GError             **error);
+guint   pan_duplicates_merge       (PanRecord           *record,
+                                    const PanDuplicate  *duplicates,
+                                    guint                n_duplicates);
+
+G_END_DECLS
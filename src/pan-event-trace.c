@@ -0,0 +1,219 @@
+/*
+ * pan-event-trace.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A trace is a text file with one event per line:
+ *
+ *   <time> <type> <value> <state> <x> <y>
+ *
+ * preceded by a header line naming the format version.  Lines starting with
+ * '#' are comments.  Text keeps traces readable and easy to trim by hand.
+ */
+
+#include "pan-event-trace.h"
+
+#define TRACE_HEADER "# pan event trace 1"
+
+struct _PanEventTrace
+{
+    GArray *events;
+    gint64 start;
+};
+
+static const gchar *type_names[PAN_N_EVENT_TYPES] =
+{
+    [PAN_EVENT_PRESS]         = "press",
+    [PAN_EVENT_RELEASE]       = "release",
+    [PAN_EVENT_DRAG_END]      = "drag-end",
+    [PAN_EVENT_MOTION]        = "motion",
+    [PAN_EVENT_KEY]           = "key",
+    [PAN_EVENT_ZOOM_IN]       = "zoom-in",
+    [PAN_EVENT_ZOOM_OUT]      = "zoom-out",
+    [PAN_EVENT_ZOOM_ORIGINAL] = "zoom-original",
+    [PAN_EVENT_ZOOM_FIT]      = "zoom-fit",
+    [PAN_EVENT_ZOOM]          = "zoom",
+    [PAN_EVENT_SELECT_RECORD] = "select-record",
+    [PAN_EVENT_UNDO]          = "undo",
+    [PAN_EVENT_REDO]          = "redo",
+};
+
+static gboolean parse_type (const gchar  *name,
+                            guint32      *type);
+
+static gboolean
+parse_type (const gchar *name,
+            guint32     *type)
+{
+    for (guint i = 0; i < PAN_N_EVENT_TYPES; i++) {
+        if (g_str_equal (name, type_names[i])) {
+            *type = i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+PanEventTrace *
+pan_event_trace_new (void)
+{
+    PanEventTrace *trace;
+
+    trace = g_new0 (PanEventTrace, 1);
+    trace->events = g_array_new (FALSE, FALSE, sizeof (PanEvent));
+    trace->start  = -1;
+
+    return trace;
+}
+
+void
+pan_event_trace_free (PanEventTrace *self)
+{
+    if (!self)
+        return;
+
+    g_array_unref (self->events);
+    g_free (self);
+}
+
+PanEventTrace *
+pan_event_trace_load (const gchar  *path,
+                      GError      **error)
+{
+    g_autoptr (PanEventTrace) trace = NULL;
+    g_autofree gchar *contents = NULL;
+    g_auto (GStrv) lines = NULL;
+    g_auto (GStrv) fields = NULL;
+    PanEvent event;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    if (!g_file_get_contents (path, &contents, NULL, error))
+        return NULL;
+
+    if (!g_str_has_prefix (contents, TRACE_HEADER)) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "%s is not an event trace", path);
+        return NULL;
+    }
+
+    trace = pan_event_trace_new ();
+    lines = g_strsplit (contents, "\n", -1);
+    for (guint i = 0; lines[i]; i++) {
+        if (lines[i][0] == '\0' || lines[i][0] == '#')
+            continue;
+
+        g_clear_pointer (&fields, g_strfreev);
+        fields = g_strsplit (lines[i], " ", -1);
+        if (g_strv_length (fields) != 6 || !parse_type (fields[1], &event.type)) {
+            g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "%s:%u: malformed event", path, i + 1);
+            return NULL;
+        }
+
+        event.time  = g_ascii_strtoll (fields[0], NULL, 10);
+        event.value = g_ascii_strtoull (fields[2], NULL, 10);
+        event.state = g_ascii_strtoull (fields[3], NULL, 10);
+        event.x     = g_ascii_strtod (fields[4], NULL);
+        event.y     = g_ascii_strtod (fields[5], NULL);
+        g_array_append_val (trace->events, event);
+    }
+
+    return g_steal_pointer (&trace);
+}
+
+gboolean
+pan_event_trace_save (PanEventTrace  *self,
+                      const gchar    *path,
+                      GError        **error)
+{
+    g_autoptr (GString) contents = NULL;
+    gchar x[G_ASCII_DTOSTR_BUF_SIZE], y[G_ASCII_DTOSTR_BUF_SIZE];
+    const PanEvent *event;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    contents = g_string_new (TRACE_HEADER "\n");
+    for (guint i = 0; i < self->events->len; i++) {
+        event = &g_array_index (self->events, PanEvent, i);
+        g_string_append_printf (contents, "%" G_GINT64_FORMAT " %s %u %u %s %s\n",
+                                event->time, type_names[event->type],
+                                event->value, event->state,
+                                g_ascii_formatd (x, sizeof x, "%.2f", event->x),
+                                g_ascii_formatd (y, sizeof y, "%.2f", event->y));
+    }
+
+    return g_file_set_contents (path, contents->str, contents->len, error);
+}
+
+void
+pan_event_trace_record (PanEventTrace *self,
+                        PanEventType   type,
+                        guint          value,
+                        guint          state,
+                        gdouble        x,
+                        gdouble        y)
+{
+    PanEvent event;
+    gint64 now;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (type < PAN_N_EVENT_TYPES);
+
+    now = g_get_monotonic_time ();
+    if (self->start < 0)
+        self->start = now;
+
+    event.time  = now - self->start;
+    event.type  = type;
+    event.value = value;
+    event.state = state;
+    event.x     = x;
+    event.y     = y;
+    g_array_append_val (self->events, event);
+}
+
+guint
+pan_event_trace_get_n_events (PanEventTrace *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->events->len;
+}
+
+const PanEvent *
+pan_event_trace_get_event (PanEventTrace *self,
+                           guint          index)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (index < self->events->len, NULL);
+
+    return &g_array_index (self->events, PanEvent, index);
+}
+
+const gchar *
+pan_event_type_to_string (PanEventType type)
+{
+    g_return_val_if_fail (type < PAN_N_EVENT_TYPES, NULL);
+
+    return type_names[type];
+}
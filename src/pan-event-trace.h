@@ -0,0 +1,83 @@
+/*
+ * pan-event-trace.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_EVENT_PRESS,
+    PAN_EVENT_RELEASE,
+    PAN_EVENT_DRAG_END,
+    PAN_EVENT_MOTION,
+    PAN_EVENT_KEY,
+    PAN_EVENT_ZOOM_IN,
+    PAN_EVENT_ZOOM_OUT,
+    PAN_EVENT_ZOOM_ORIGINAL,
+    PAN_EVENT_ZOOM_FIT,
+    PAN_EVENT_ZOOM,
+    PAN_EVENT_SELECT_RECORD,
+    PAN_EVENT_UNDO,
+    PAN_EVENT_REDO,
+    PAN_N_EVENT_TYPES
+} PanEventType;
+
+/*
+ * One input event as the canvas saw it.  value holds the press count, the
+ * keyval, the record position or the zoom in thousandths, depending on the
+ * type; time is in microseconds since the first event of the trace.
+ */
+typedef struct
+{
+    gint64  time;
+    guint32 type;
+    guint32 state;
+    guint32 value;
+    gdouble x;
+    gdouble y;
+} PanEvent;
+
+typedef struct _PanEventTrace PanEventTrace;
+
+PanEventTrace  *pan_event_trace_new            (void);
+void            pan_event_trace_free           (PanEventTrace *self);
+PanEventTrace  *pan_event_trace_load           (const gchar  *path,
+                                                GError      **error);
+gboolean        pan_event_trace_save           (PanEventTrace  *self,
+                                                const gchar    *path,
+                                                GError        **error);
+void            pan_event_trace_record         (PanEventTrace *self,
+                                                PanEventType   type,
+                                                guint          value,
+                                                guint          state,
+                                                gdouble        x,
+                                                gdouble        y);
+guint           pan_event_trace_get_n_events   (PanEventTrace *self);
+const PanEvent *pan_event_trace_get_event      (PanEventTrace *self,
+                                                guint          index);
+const gchar    *pan_event_type_to_string       (PanEventType type);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanEventTrace, pan_event_trace_free)
+
+G_END_DECLS
@@ -0,0 +1,243 @@
+/*
+ * pan-hash.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A fingerprint of an image file, so records can find their image again
+ * after it was moved or renamed.  This is XXH64 with a zero seed: it is
+ * not cryptographic, but it runs at memory speed and 64 bits are plenty
+ * to tell the images of one dataset apart.  Files are hashed as a stream,
+ * so only one buffer of each is held at a time.
+ */
+
+#include <string.h>
+#include "pan-hash.h"
+
+#define PRIME1 G_GUINT64_CONSTANT (11400714785074694791)
+#define PRIME2 G_GUINT64_CONSTANT (14029467366897019727)
+#define PRIME3 G_GUINT64_CONSTANT (1609587929392839161)
+#define PRIME4 G_GUINT64_CONSTANT (9650029242287828579)
+#define PRIME5 G_GUINT64_CONSTANT (2870177450012600261)
+
+#define BUFFER_SIZE (256 * 1024)
+
+static guint64 rotl        (guint64       value,
+                            guint         bits);
+static guint64 read_u64    (const guint8 *data);
+static guint32 read_u32    (const guint8 *data);
+static guint64 round_acc   (guint64       acc,
+                            guint64       input);
+static guint64 merge_round (guint64       acc,
+                            guint64       value);
+
+static guint64
+rotl (guint64 value,
+      guint   bits)
+{
+    return value << bits | value >> (64 - bits);
+}
+
+static guint64
+read_u64 (const guint8 *data)
+{
+    guint64 value;
+
+    memcpy (&value, data, sizeof value);
+    return GUINT64_FROM_LE (value);
+}
+
+static guint32
+read_u32 (const guint8 *data)
+{
+    guint32 value;
+
+    memcpy (&value, data, sizeof value);
+    return GUINT32_FROM_LE (value);
+}
+
+static guint64
+round_acc (guint64 acc,
+           guint64 input)
+{
+    acc += input * PRIME2;
+    acc  = rotl (acc, 31);
+    return acc * PRIME1;
+}
+
+static guint64
+merge_round (guint64 acc,
+             guint64 value)
+{
+    acc ^= round_acc (0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+void
+pan_hash_init (PanHashState *state)
+{
+    g_return_if_fail (state != NULL);
+
+    memset (state, 0, sizeof *state);
+    state->acc[0] = PRIME1 + PRIME2;
+    state->acc[1] = PRIME2;
+    state->acc[2] = 0;
+    state->acc[3] = 0 - PRIME1;
+}
+
+void
+pan_hash_update (PanHashState *state,
+                 const void   *data,
+                 gsize         len)
+{
+    const guint8 *bytes = data;
+    guint fill;
+
+    g_return_if_fail (state != NULL);
+
+    state->total += len;
+
+    if (state->buffered > 0) {
+        fill = MIN (len, 32 - state->buffered);
+        memcpy (state->buffer + state->buffered, bytes, fill);
+        state->buffered += fill;
+        bytes += fill;
+        len   -= fill;
+        if (state->buffered < 32)
+            return;
+
+        for (guint i = 0; i < 4; i++)
+            state->acc[i] = round_acc (state->acc[i], read_u64 (state->buffer + 8 * i));
+        state->buffered = 0;
+    }
+
+    for (; len >= 32; bytes += 32, len -= 32) {
+        for (guint i = 0; i < 4; i++)
+            state->acc[i] = round_acc (state->acc[i], read_u64 (bytes + 8 * i));
+    }
+
+    memcpy (state->buffer, bytes, len);
+    state->buffered = len;
+}
+
+guint64
+pan_hash_finish (PanHashState *state)
+{
+    const guint8 *bytes;
+    guint64 hash;
+    guint left;
+
+    g_return_val_if_fail (state != NULL, PAN_HASH_NONE);
+
+    if (state->total >= 32) {
+        hash = rotl (state->acc[0], 1) + rotl (state->acc[1], 7) +
+               rotl (state->acc[2], 12) + rotl (state->acc[3], 18);
+        for (guint i = 0; i < 4; i++)
+            hash = merge_round (hash, state->acc[i]);
+    } else {
+        hash = PRIME5;
+    }
+    hash += state->total;
+
+    bytes = state->buffer;
+    left  = state->buffered;
+    for (; left >= 8; bytes += 8, left -= 8) {
+        hash ^= round_acc (0, read_u64 (bytes));
+        hash  = rotl (hash, 27) * PRIME1 + PRIME4;
+    }
+    if (left >= 4) {
+        hash ^= read_u32 (bytes) * PRIME1;
+        hash  = rotl (hash, 23) * PRIME2 + PRIME3;
+        bytes += 4;
+        left  -= 4;
+    }
+    for (; left > 0; bytes++, left--) {
+        hash ^= *bytes * PRIME5;
+        hash  = rotl (hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+
+    return hash != PAN_HASH_NONE ? hash : 1;
+}
+
+/**
+ * pan_hash_file:
+ * @hash: (out): the hash of the contents of @path
+ *
+ * Returns: %TRUE if the whole file was read
+ */
+gboolean
+pan_hash_file (const gchar   *path,
+               guint64       *hash,
+               GCancellable  *cancellable,
+               GError       **error)
+{
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFileInputStream) stream = NULL;
+    g_autofree guint8 *buffer = NULL;
+    PanHashState state;
+    gssize n;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+    g_return_val_if_fail (hash != NULL, FALSE);
+
+    file   = g_file_new_for_path (path);
+    stream = g_file_read (file, cancellable, error);
+    if (!stream)
+        return FALSE;
+
+    buffer = g_malloc (BUFFER_SIZE);
+    pan_hash_init (&state);
+    while ((n = g_input_stream_read (G_INPUT_STREAM (stream), buffer, BUFFER_SIZE, cancellable, error)) > 0)
+        pan_hash_update (&state, buffer, n);
+    if (n < 0)
+        return FALSE;
+
+    *hash = pan_hash_finish (&state);
+
+    return TRUE;
+}
+
+gchar *
+pan_hash_to_string (guint64 hash)
+{
+    return g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+}
+
+/**
+ * pan_hash_from_string:
+ *
+ * Returns: the hash written by pan_hash_to_string(), or %PAN_HASH_NONE if
+ *   @string is not one
+ */
+guint64
+pan_hash_from_string (const gchar *string)
+{
+    guint64 hash;
+
+    if (!string || !g_ascii_string_to_unsigned (string, 16, 0, G_MAXUINT64, &hash, NULL))
+        return PAN_HASH_NONE;
+
+    return hash;
+}
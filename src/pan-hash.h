@@ -0,0 +1,52 @@
+/*
+ * pan-hash.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* No content hashes to zero, so it stands for "not hashed yet". */
+#define PAN_HASH_NONE 0
+
+typedef struct
+{
+    guint64 acc[4];
+    guint64 total;
+    guint8 buffer[32];
+    guint buffered;
+} PanHashState;
+
+void     pan_hash_init   (PanHashState  *state);
+void     pan_hash_update (PanHashState  *state,
+                          const void    *data,
+                          gsize          len);
+guint64  pan_hash_finish (PanHashState  *state);
+gboolean pan_hash_file   (const gchar   *path,
+                          guint64       *hash,
+                          GCancellable  *cancellable,
+                          GError       **error);
+gchar   *pan_hash_to_string   (guint64      hash);
+guint64  pan_hash_from_string (const gchar *string);
+
+G_END_DECLS
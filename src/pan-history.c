@@ -0,0 +1,400 @@
+/*
+ * pan-history.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Every record owns a PanHistory.  The undo and redo stacks share one ring
+ * of packed PanActions: the n_undo entries after start can be undone, and
+ * the n_redo entries following them were undone and can be redone.  The
+ * ring grows on demand up to the maximum depth, after which the oldest
+ * entry is overwritten.  Group actions own an array of children, which is
+ * freed whenever their slot is dropped and counted towards the budget.
+ *
+ * A move only merges into the newest undo step when nothing was undone,
+ * redone or dropped from the redo stack since that step was pushed;
+ * sealed marks that it may no longer grow.
+ *
+ * All histories are kept on a global LRU list, ordered by their last edit.
+ * When their storage together exceeds the byte budget, the least recently
+ * edited histories are emptied, then the oldest steps of the one being
+ * edited are dropped.  The list link is embedded in the history,
+ * so none of this allocates.  An emptied history calls its release func,
+ * which may free it.
+ */
+
+#include "pan-history.h"
+
+#define DEFAULT_MAX_DEPTH    1000
+#define DEFAULT_MAX_BYTES    (8 * 1024 * 1024)
+#define DEFAULT_MERGE_WINDOW 750
+#define MIN_CAPACITY         16
+
+struct _PanHistory
+{
+    PanAction *ring;
+    guint capacity;
+    guint start;
+    guint n_undo;
+    guint n_redo;
+    gsize payload;
+    gboolean sealed;
+
+    GList lru_link;
+    PanHistoryFunc release_func;
+    gpointer release_data;
+};
+
+static GQueue  lru          = G_QUEUE_INIT;
+static gsize   total_size   = 0;
+static guint   max_depth    = DEFAULT_MAX_DEPTH;
+static guint64 max_bytes    = DEFAULT_MAX_BYTES;
+static guint   merge_window = DEFAULT_MERGE_WINDOW;
+
+static PanAction *ring_slot       (PanHistory *self,
+                                   guint       index);
+static void       grow            (PanHistory *self);
+static void       drop_slot       (PanHistory *self,
+                                   guint       index);
+static void       drop_oldest     (PanHistory *self);
+static void       drop_redo       (PanHistory *self);
+static void       release_storage (PanHistory *self);
+static void       touch           (PanHistory *self);
+static void       enforce_budget  (PanHistory *keep);
+
+static PanAction *
+ring_slot (PanHistory *self,
+           guint       index)
+{
+    return &self->ring[(self->start + index) % self->capacity];
+}
+
+static void
+grow (PanHistory *self)
+{
+    PanAction *ring;
+    guint capacity;
+    guint n;
+
+    n = self->n_undo + self->n_redo;
+    capacity = MAX (self->capacity * 2, MIN_CAPACITY);
+    capacity = MAX (MIN (capacity, max_depth), n + 1);
+
+    ring = g_new (PanAction, capacity);
+    for (guint i = 0; i < n; i++)
+        ring[i] = *ring_slot (self, i);
+
+    total_size += (capacity - self->capacity) * sizeof (PanAction);
+
+    g_free (self->ring);
+    self->ring     = ring;
+    self->capacity = capacity;
+    self->start    = 0;
+}
+
+static void
+drop_slot (PanHistory *self,
+           guint       index)
+{
+    PanAction *action;
+
+    action = ring_slot (self, index);
+    total_size -= pan_action_get_size (action) - sizeof (PanAction);
+    self->payload -= pan_action_get_size (action) - sizeof (PanAction);
+    pan_action_clear (action);
+}
+
+static void
+drop_oldest (PanHistory *self)
+{
+    drop_slot (self, 0);
+    self->start = (self->start + 1) % self->capacity;
+    self->n_undo--;
+}
+
+static void
+drop_redo (PanHistory *self)
+{
+    if (self->n_redo > 0)
+        self->sealed = TRUE;
+
+    for (guint i = 0; i < self->n_redo; i++)
+        drop_slot (self, self->n_undo + i);
+    self->n_redo = 0;
+}
+
+static void
+release_storage (PanHistory *self)
+{
+    for (guint i = 0; i < self->n_undo + self->n_redo; i++)
+        drop_slot (self, i);
+
+    total_size -= self->capacity * sizeof (PanAction);
+    g_clear_pointer (&self->ring, g_free);
+    self->capacity = 0;
+    self->start    = 0;
+    self->n_undo   = 0;
+    self->n_redo   = 0;
+    self->sealed   = FALSE;
+
+    if (self->lru_link.data) {
+        g_queue_unlink (&lru, &self->lru_link);
+        self->lru_link.data = NULL;
+    }
+}
+
+static void
+touch (PanHistory *self)
+{
+    if (self->lru_link.data)
+        g_queue_unlink (&lru, &self->lru_link);
+
+    self->lru_link.data = self;
+    g_queue_push_head_link (&lru, &self->lru_link);
+}
+
+/*
+ * Empties the least recently edited histories first.  If that is not
+ * enough, keep, the history just edited, loses its oldest steps too, down
+ * to the newest one.
+ */
+static void
+enforce_budget (PanHistory *keep)
+{
+    PanHistory *history;
+    GList *link;
+
+    while (total_size > max_bytes) {
+        link = g_queue_peek_tail_link (&lru);
+        if (!link || link->data == keep)
+            break;
+
+        /* The release func may free the history, so it comes last. */
+        history = link->data;
+        release_storage (history);
+        if (history->release_func)
+            history->release_func (history->release_data);
+    }
+
+    while (total_size > max_bytes && keep->n_undo > 1)
+        drop_oldest (keep);
+}
+
+PanHistory *
+pan_history_new (void)
+{
+    return g_new0 (PanHistory, 1);
+}
+
+void
+pan_history_free (PanHistory *self)
+{
+    if (!self)
+        return;
+
+    release_storage (self);
+    g_free (self);
+}
+
+/**
+ * pan_history_push:
+ * @self: a #PanHistory
+ * @action: an action that has already been applied
+ *
+ * Records @action as the newest undo step and forgets everything that
+ * could be redone.  If @action follows the previous action within the
+ * merge window and the two can be merged, no new step is added, unless
+ * an undo or redo came in between.
+ *
+ * The history takes over the children of a group action.
+ */
+void
+pan_history_push (PanHistory      *self,
+                  const PanAction *action)
+{
+    PanAction *top;
+    PanAction merged;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (action != NULL);
+
+    drop_redo (self);
+    touch (self);
+
+    if (self->n_undo > 0 && !self->sealed) {
+        top = ring_slot (self, self->n_undo - 1);
+        if (action->time - top->time <= merge_window * G_TIME_SPAN_MILLISECOND &&
+            pan_action_merge (top, action)) {
+            merged = *action;
+            pan_action_clear (&merged);
+            return;
+        }
+    }
+
+    while (self->n_undo >= max_depth)
+        drop_oldest (self);
+
+    if (self->n_undo == self->capacity)
+        grow (self);
+
+    *ring_slot (self, self->n_undo) = *action;
+    self->n_undo++;
+    self->sealed = FALSE;
+    total_size += pan_action_get_size (action) - sizeof (PanAction);
+    self->payload += pan_action_get_size (action) - sizeof (PanAction);
+
+    enforce_budget (self);
+}
+
+gboolean
+pan_history_undo (PanHistory *self,
+                  GListStore *annots)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (self->n_undo == 0)
+        return FALSE;
+
+    pan_action_undo (ring_slot (self, self->n_undo - 1), annots);
+    self->n_undo--;
+    self->n_redo++;
+    self->sealed = TRUE;
+    touch (self);
+
+    return TRUE;
+}
+
+gboolean
+pan_history_redo (PanHistory *self,
+                  GListStore *annots)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (self->n_redo == 0)
+        return FALSE;
+
+    pan_action_redo (ring_slot (self, self->n_undo), annots);
+    self->n_undo++;
+    self->n_redo--;
+    self->sealed = TRUE;
+    touch (self);
+
+    return TRUE;
+}
+
+void
+pan_history_clear (PanHistory *self)
+{
+    g_return_if_fail (self != NULL);
+
+    release_storage (self);
+}
+
+gboolean
+pan_history_can_undo (PanHistory *self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->n_undo > 0;
+}
+
+gboolean
+pan_history_can_redo (PanHistory *self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->n_redo > 0;
+}
+
+gsize
+pan_history_get_size (PanHistory *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return sizeof (PanHistory) + self->capacity * sizeof (PanAction) + self->payload;
+}
+
+/**
+ * pan_history_set_release_func:
+ *
+ * Sets a function to call after the budget emptied @self to make room for
+ * another history.  It may free @self.
+ */
+void
+pan_history_set_release_func (PanHistory     *self,
+                              PanHistoryFunc  func,
+                              gpointer        user_data)
+{
+    g_return_if_fail (self != NULL);
+
+    self->release_func = func;
+    self->release_data = user_data;
+}
+
+/**
+ * pan_history_account_memory:
+ *
+ * Adds the ring and the children of group actions to @report, split into
+ * the undo and the redo stack.  Unused slots of the ring count as undo.
+ */
+void
+pan_history_account_memory (PanHistory      *self,
+                            PanMemoryReport *report)
+{
+    gsize redo = 0;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (report != NULL);
+
+    for (guint i = 0; i < self->n_redo; i++)
+        redo += pan_action_get_size (ring_slot (self, self->n_undo + i));
+
+    pan_memory_report_add (report, PAN_MEMORY_UNDO, pan_history_get_size (self) - redo);
+    pan_memory_report_add (report, PAN_MEMORY_REDO, redo);
+}
+
+/**
+ * pan_history_set_limits:
+ * @depth: maximum number of undo steps kept per record
+ * @bytes: budget for the storage of all histories together
+ * @window: time in milliseconds within which moves merge
+ *
+ * Configures all histories.  If the budget shrinks below what is in use,
+ * all but the most recently edited history may be emptied right away.
+ */
+void
+pan_history_set_limits (guint   depth,
+                        guint64 bytes,
+                        guint   window)
+{
+    g_return_if_fail (depth > 0);
+
+    max_depth    = depth;
+    max_bytes    = bytes;
+    merge_window = window;
+
+    if (lru.head)
+        enforce_budget (lru.head->data);
+}
+
+gsize
+pan_history_get_total_size (void)
+{
+    return total_size;
+}
@@ -0,0 +1,59 @@
+/*
+ * pan-history.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "pan-action.h"
+#include "pan-memory.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PanHistory PanHistory;
+
+typedef void (*PanHistoryFunc) (gpointer user_data);
+
+PanHistory *pan_history_new            (void);
+void        pan_history_free           (PanHistory *self);
+void        pan_history_push           (PanHistory      *self,
+                                        const PanAction *action);
+gboolean    pan_history_undo           (PanHistory *self,
+                                        GListStore *annots);
+gboolean    pan_history_redo           (PanHistory *self,
+                                        GListStore *annots);
+void        pan_history_clear          (PanHistory *self);
+gboolean    pan_history_can_undo       (PanHistory *self);
+gboolean    pan_history_can_redo       (PanHistory *self);
+void        pan_history_account_memory (PanHistory      *self,
+                                        PanMemoryReport *report);
+gsize       pan_history_get_size       (PanHistory *self);
+void        pan_history_set_release_func (PanHistory     *self,
+                                          PanHistoryFunc  func,
+                                          gpointer        user_data);
+
+void        pan_history_set_limits     (guint   depth,
+                                        guint64 bytes,
+                                        guint   window);
+gsize       pan_history_get_total_size (void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanHistory, pan_history_free)
+
+G_END_DECLS
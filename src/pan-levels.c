@@ -0,0 +1,335 @@
+/*
+ * pan-levels.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Auto levels: the darkest and brightest values of each channel once the
+ * outermost CLIP of the pixels on either side are ignored.
+ *
+ * For 8-bit images the histogram is taken from a decode at a reduced
+ * scale, which is all a percentile needs.  Images with 16-bit or float
+ * channels are counted from the texture itself at 16 bits, since the
+ * 8-bit decode would fold a 12-bit range into a handful of bins.  Either
+ * runs on a GTask thread, once per image.
+ *
+ * The 8-bit counting loop keeps four histograms per channel and adds them
+ * up at the end, so that runs of equal pixels do not wait on each other's
+ * increments.
+ */
+
+#include <string.h>
+#include "pan-levels.h"
+
+/* Images are decoded to at most this many pixels a side. */
+#define SAMPLE_SIZE 512
+
+/* The share of pixels clipped at each end. */
+#define CLIP 0.005
+
+#define BINS   256
+#define BINS16 65536
+
+static void compute_thread         (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable);
+static void compute_texture_thread (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable);
+
+/**
+ * pan_levels_histogram:
+ * @pixels: 8-bit RGB or RGBA pixels
+ * @histogram: (out caller-allocates) (array fixed-size=768): the counts of
+ *   the red, green and blue values, one channel after the other
+ */
+void
+pan_levels_histogram (const guint8 *pixels,
+                      gint          width,
+                      gint          height,
+                      gint          stride,
+                      gint          n_channels,
+                      guint32      *histogram)
+{
+    guint32 (*lanes)[3][BINS];
+    const guint8 *row, *pixel;
+    gint x;
+
+    g_return_if_fail (pixels != NULL);
+    g_return_if_fail (n_channels >= 3);
+
+    lanes = g_malloc0 (sizeof (guint32[4][3][BINS]));
+    for (gint y = 0; y < height; y++) {
+        row = pixels + (gsize) y * stride;
+        for (x = 0; x + 4 <= width; x += 4) {
+            pixel = row + x * n_channels;
+            for (guint lane = 0; lane < 4; lane++, pixel += n_channels) {
+                lanes[lane][0][pixel[0]]++;
+                lanes[lane][1][pixel[1]]++;
+                lanes[lane][2][pixel[2]]++;
+            }
+        }
+        for (pixel = row + x * n_channels; x < width; x++, pixel += n_channels) {
+            lanes[0][0][pixel[0]]++;
+            lanes[0][1][pixel[1]]++;
+            lanes[0][2][pixel[2]]++;
+        }
+    }
+
+    for (guint c = 0; c < 3; c++) {
+        for (guint v = 0; v < BINS; v++)
+            histogram[c * BINS + v] = lanes[0][c][v] + lanes[1][c][v] + lanes[2][c][v] + lanes[3][c][v];
+    }
+    g_free (lanes);
+}
+
+/**
+ * pan_levels_histogram16:
+ * @pixels: 16-bit RGBA pixels
+ * @stride: the length of a row in bytes
+ * @histogram: (out caller-allocates): 3 × 65536 counts, one channel after
+ *   the other
+ */
+void
+pan_levels_histogram16 (const guint16 *pixels,
+                        gint           width,
+                        gint           height,
+                        gsize          stride,
+                        guint32       *histogram)
+{
+    const guint16 *pixel;
+
+    g_return_if_fail (pixels != NULL);
+
+    memset (histogram, 0, 3 * BINS16 * sizeof (guint32));
+    for (gint y = 0; y < height; y++) {
+        pixel = (const guint16 *) ((const guint8 *) pixels + y * stride);
+        for (gint x = 0; x < width; x++, pixel += 4) {
+            histogram[pixel[0]]++;
+            histogram[BINS16 + pixel[1]]++;
+            histogram[2 * BINS16 + pixel[2]]++;
+        }
+    }
+}
+
+/**
+ * pan_levels_from_histogram:
+ * @histogram: (array): 3 × @n_bins counts, one channel after the other
+ * @clip: the share of pixels to ignore at each end
+ *
+ * Channels with a single value are left at the full range.
+ */
+void
+pan_levels_from_histogram (const guint32 *histogram,
+                           guint          n_bins,
+                           gdouble        clip,
+                           PanLevels     *levels)
+{
+    const guint32 *counts;
+    guint64 total, limit, seen;
+    guint low, high;
+
+    g_return_if_fail (histogram != NULL);
+    g_return_if_fail (n_bins >= 2);
+    g_return_if_fail (levels != NULL);
+
+    for (guint c = 0; c < 3; c++) {
+        counts = histogram + c * n_bins;
+        total = 0;
+        for (guint v = 0; v < n_bins; v++)
+            total += counts[v];
+        limit = total * clip;
+
+        seen = 0;
+        for (low = 0; low < n_bins - 1; low++) {
+            seen += counts[low];
+            if (seen > limit)
+                break;
+        }
+        seen = 0;
+        for (high = n_bins - 1; high > 0; high--) {
+            seen += counts[high];
+            if (seen > limit)
+                break;
+        }
+
+        if (high <= low) {
+            low  = 0;
+            high = n_bins - 1;
+        }
+        levels->low[c]  = (gfloat) low / (n_bins - 1);
+        levels->high[c] = (gfloat) high / (n_bins - 1);
+    }
+}
+
+gboolean
+pan_levels_compute (const gchar  *path,
+                    PanLevels    *levels,
+                    GError      **error)
+{
+    g_autoptr (GdkPixbuf) pixbuf = NULL;
+    guint32 histogram[3 * BINS];
+
+    g_return_val_if_fail (path != NULL, FALSE);
+    g_return_val_if_fail (levels != NULL, FALSE);
+
+    pixbuf = gdk_pixbuf_new_from_file_at_size (path, SAMPLE_SIZE, SAMPLE_SIZE, error);
+    if (!pixbuf)
+        return FALSE;
+
+    pan_levels_histogram (gdk_pixbuf_read_pixels (pixbuf),
+                          gdk_pixbuf_get_width (pixbuf),
+                          gdk_pixbuf_get_height (pixbuf),
+                          gdk_pixbuf_get_rowstride (pixbuf),
+                          gdk_pixbuf_get_n_channels (pixbuf),
+                          histogram);
+    pan_levels_from_histogram (histogram, BINS, CLIP, levels);
+
+    return TRUE;
+}
+
+/**
+ * pan_levels_compute_for_texture:
+ *
+ * Counts every pixel of @texture at 16 bits per channel.  Float channels
+ * are clamped to 0 to 1.
+ */
+void
+pan_levels_compute_for_texture (GdkTexture *texture,
+                                PanLevels  *levels)
+{
+    g_autoptr (GdkTextureDownloader) downloader = NULL;
+    g_autoptr (GBytes) bytes = NULL;
+    g_autofree guint32 *histogram = NULL;
+    gsize stride;
+
+    g_return_if_fail (GDK_IS_TEXTURE (texture));
+    g_return_if_fail (levels != NULL);
+
+    downloader = gdk_texture_downloader_new (texture);
+    gdk_texture_downloader_set_format (downloader, GDK_MEMORY_R16G16B16A16);
+    bytes = gdk_texture_downloader_download_bytes (downloader, &stride);
+
+    histogram = g_new (guint32, 3 * BINS16);
+    pan_levels_histogram16 (g_bytes_get_data (bytes, NULL),
+                            gdk_texture_get_width (texture),
+                            gdk_texture_get_height (texture),
+                            stride, histogram);
+    pan_levels_from_histogram (histogram, BINS16, CLIP, levels);
+}
+
+static void
+compute_thread (GTask        *task,
+                gpointer      source_object,
+                gpointer      task_data,
+                GCancellable *cancellable)
+{
+    PanLevels *levels;
+    GError *error = NULL;
+
+    levels = g_new (PanLevels, 1);
+    if (!pan_levels_compute (task_data, levels, &error)) {
+        g_free (levels);
+        g_task_return_error (task, error);
+        return;
+    }
+
+    g_task_return_pointer (task, levels, g_free);
+}
+
+/* Textures are immutable, so reading one off the main thread is safe. */
+static void
+compute_texture_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+    PanLevels *levels;
+
+    if (g_task_return_error_if_cancelled (task))
+        return;
+
+    levels = g_new (PanLevels, 1);
+    pan_levels_compute_for_texture (task_data, levels);
+    g_task_return_pointer (task, levels, g_free);
+}
+
+/**
+ * pan_levels_compute_async:
+ *
+ * Like pan_levels_compute(), but decodes the image on a thread.
+ */
+void
+pan_levels_compute_async (const gchar         *path,
+                          GCancellable        *cancellable,
+                          GAsyncReadyCallback  callback,
+                          gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (path != NULL);
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_levels_compute_async);
+    g_task_set_task_data (task, g_strdup (path), g_free);
+    g_task_run_in_thread (task, compute_thread);
+}
+
+/**
+ * pan_levels_compute_texture_async:
+ *
+ * Like pan_levels_compute_for_texture(), on a thread.  Finish it with
+ * pan_levels_compute_finish().
+ */
+void
+pan_levels_compute_texture_async (GdkTexture          *texture,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (GDK_IS_TEXTURE (texture));
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_levels_compute_texture_async);
+    g_task_set_task_data (task, g_object_ref (texture), g_object_unref);
+    g_task_run_in_thread (task, compute_texture_thread);
+}
+
+gboolean
+pan_levels_compute_finish (GAsyncResult  *result,
+                           PanLevels     *levels,
+                           GError       **error)
+{
+    g_autofree PanLevels *computed = NULL;
+
+    g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+    g_return_val_if_fail (levels != NULL, FALSE);
+
+    computed = g_task_propagate_pointer (G_TASK (result), error);
+    if (!computed)
+        return FALSE;
+
+    *levels = *computed;
+
+    return TRUE;
+}
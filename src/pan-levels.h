@@ -0,0 +1,68 @@
+/*
+ * pan-levels.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* The input range to stretch to full scale, per channel, in 0 to 1. */
+typedef struct
+{
+    gfloat low[3];
+    gfloat high[3];
+} PanLevels;
+
+void     pan_levels_histogram              (const guint8         *pixels,
+                                            gint                  width,
+                                            gint                  height,
+                                            gint                  stride,
+                                            gint                  n_channels,
+                                            guint32              *histogram);
+void     pan_levels_histogram16            (const guint16        *pixels,
+                                            gint                  width,
+                                            gint                  height,
+                                            gsize                 stride,
+                                            guint32              *histogram);
+void     pan_levels_from_histogram         (const guint32        *histogram,
+                                            guint                 n_bins,
+                                            gdouble               clip,
+                                            PanLevels            *levels);
+gboolean pan_levels_compute                (const gchar          *path,
+                                            PanLevels            *levels,
+                                            GError              **error);
+void     pan_levels_compute_for_texture    (GdkTexture           *texture,
+                                            PanLevels            *levels);
+void     pan_levels_compute_async          (const gchar          *path,
+                                            GCancellable         *cancellable,
+                                            GAsyncReadyCallback   callback,
+                                            gpointer              user_data);
+void     pan_levels_compute_texture_async  (GdkTexture           *texture,
+                                            GCancellable         *cancellable,
+                                            GAsyncReadyCallback   callback,
+                                            gpointer              user_data);
+gboolean pan_levels_compute_finish         (GAsyncResult         *result,
+                                            PanLevels            *levels,
+                                            GError              **error);
+
+G_END_DECLS
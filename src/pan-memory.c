@@ -0,0 +1,180 @@
+/*
+ * pan-memory.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A PanMemoryReport collects estimates of the bytes held by the document,
+ * canvas and undo histories.  Each owner adds what it holds through its
+ * own *_account_memory() function, so the numbers stay next to the code
+ * that allocates them.  Objects reached on the way are counted per type;
+ * the report also prints the live instance count GObject keeps when run
+ * with GOBJECT_DEBUG=instance-count.
+ */
+
+#include "pan-memory.h"
+
+struct _PanMemoryReport
+{
+    gsize bytes[PAN_MEMORY_N_CATEGORIES];
+    GArray *objects;
+};
+
+typedef struct
+{
+    GType type;
+    guint n_objects;
+} ObjectCount;
+
+static const gchar *category_names[PAN_MEMORY_N_CATEGORIES] =
+{
+    [PAN_MEMORY_RECORDS]   = "records",
+    [PAN_MEMORY_ANNOTS]    = "annotations",
+    [PAN_MEMORY_FILENAMES] = "filenames",
+    [PAN_MEMORY_UNDO]      = "undo stack",
+    [PAN_MEMORY_REDO]      = "redo stack",
+    [PAN_MEMORY_TEXTURES]  = "textures",
+    [PAN_MEMORY_INDEX]     = "spatial index",
+};
+
+PanMemoryReport *
+pan_memory_report_new (void)
+{
+    PanMemoryReport *report;
+
+    report = g_new0 (PanMemoryReport, 1);
+    report->objects = g_array_new (FALSE, FALSE, sizeof (ObjectCount));
+
+    return report;
+}
+
+void
+pan_memory_report_free (PanMemoryReport *self)
+{
+    if (!self)
+        return;
+
+    g_array_unref (self->objects);
+    g_free (self);
+}
+
+void
+pan_memory_report_add (PanMemoryReport   *self,
+                       PanMemoryCategory  category,
+                       gsize              bytes)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (category < PAN_MEMORY_N_CATEGORIES);
+
+    self->bytes[category] += bytes;
+}
+
+void
+pan_memory_report_add_objects (PanMemoryReport *self,
+                               GType            type,
+                               guint            n_objects)
+{
+    ObjectCount *count;
+    ObjectCount entry;
+
+    g_return_if_fail (self != NULL);
+
+    for (guint i = 0; i < self->objects->len; i++) {
+        count = &g_array_index (self->objects, ObjectCount, i);
+        if (count->type == type) {
+            count->n_objects += n_objects;
+            return;
+        }
+    }
+
+    entry.type      = type;
+    entry.n_objects = n_objects;
+    g_array_append_val (self->objects, entry);
+}
+
+gsize
+pan_memory_report_get (PanMemoryReport   *self,
+                       PanMemoryCategory  category)
+{
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (category < PAN_MEMORY_N_CATEGORIES, 0);
+
+    return self->bytes[category];
+}
+
+gsize
+pan_memory_report_get_total (PanMemoryReport *self)
+{
+    gsize total = 0;
+
+    g_return_val_if_fail (self != NULL, 0);
+
+    for (guint i = 0; i < PAN_MEMORY_N_CATEGORIES; i++)
+        total += self->bytes[i];
+
+    return total;
+}
+
+/**
+ * pan_memory_report_to_string:
+ *
+ * Returns: (transfer full): the report as a table, one line per category
+ *   and per object type
+ */
+gchar *
+pan_memory_report_to_string (PanMemoryReport *self)
+{
+    GString *text;
+    ObjectCount *count;
+    gchar *size;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    text = g_string_new (NULL);
+    for (guint i = 0; i < PAN_MEMORY_N_CATEGORIES; i++) {
+        size = g_format_size (self->bytes[i]);
+        g_string_append_printf (text, "%-14s %12s\n", category_names[i], size);
+        g_free (size);
+    }
+    size = g_format_size (pan_memory_report_get_total (self));
+    g_string_append_printf (text, "%-14s %12s\n\n", "total", size);
+    g_free (size);
+
+    g_string_append_printf (text, "%-16s %10s %10s\n", "type", "reached", "live");
+    for (guint i = 0; i < self->objects->len; i++) {
+        count = &g_array_index (self->objects, ObjectCount, i);
+        g_string_append_printf (text, "%-16s %10u %10d\n",
+                                g_type_name (count->type),
+                                count->n_objects,
+                                g_type_get_instance_count (count->type));
+    }
+
+    return g_string_free (text, FALSE);
+}
+
+/* Size of one instance of an instantiatable type, without what it points to. */
+gsize
+pan_memory_instance_size (GType type)
+{
+    GTypeQuery query;
+
+    g_type_query (type, &query);
+
+    return query.instance_size;
+}
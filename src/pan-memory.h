@@ -0,0 +1,60 @@
+/*
+ * pan-memory.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_MEMORY_RECORDS,
+    PAN_MEMORY_ANNOTS,
+    PAN_MEMORY_FILENAMES,
+    PAN_MEMORY_UNDO,
+    PAN_MEMORY_REDO,
+    PAN_MEMORY_TEXTURES,
+    PAN_MEMORY_INDEX,
+    PAN_MEMORY_N_CATEGORIES
+} PanMemoryCategory;
+
+typedef struct _PanMemoryReport PanMemoryReport;
+
+PanMemoryReport *pan_memory_report_new         (void);
+void             pan_memory_report_free        (PanMemoryReport *self);
+void             pan_memory_report_add         (PanMemoryReport   *self,
+                                                PanMemoryCategory  category,
+                                                gsize              bytes);
+void             pan_memory_report_add_objects (PanMemoryReport *self,
+                                                GType            type,
+                                                guint            n_objects);
+gsize            pan_memory_report_get         (PanMemoryReport   *self,
+                                                PanMemoryCategory  category);
+gsize            pan_memory_report_get_total   (PanMemoryReport *self);
+gchar           *pan_memory_report_to_string   (PanMemoryReport *self);
+
+gsize            pan_memory_instance_size      (GType type);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanMemoryReport, pan_memory_report_free)
+
+G_END_DECLS
@@ -0,0 +1,483 @@
+/*
+ * pan-minimap.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * The overview drawn in the corner of the canvas when the image does not
+ * fit: a small copy of the image, how densely it is annotated, and the
+ * part of it in view.
+ *
+ * The copy is rendered once per image by the GSK renderer, so the full
+ * resolution texture is only read on the GPU and never again after that.
+ * The density is a DENSITY_CELLS square grid of point counts.  Points
+ * added to the store and points moved by the canvas update their cells
+ * directly; removals and anything else the minimap cannot follow mark
+ * the counts stale, and they are recounted on the next draw.  The grid is
+ * drawn into a render node that is kept until the counts change, so a
+ * frame only adds the viewport frame to what is cached.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "pan-minimap.h"
+#include "pan-annot.h"
+
+/* The longer side of the minimap, in logical pixels. */
+#define MINIMAP_SIZE  160
+#define MARGIN        8
+#define DENSITY_CELLS 32
+
+struct _PanMinimap
+{
+    gint image_width;
+    gint image_height;
+    GdkTexture *texture;
+
+    GListModel *annots;
+    gulong items_changed_id;
+
+    guint32 counts[DENSITY_CELLS * DENSITY_CELLS];
+    gboolean stale;
+
+    /* The counts as drawn, for the size and color they were drawn with. */
+    GskRenderNode *density;
+    gboolean density_valid;
+    gfloat density_width;
+    gfloat density_height;
+    GdkRGBA density_color;
+};
+
+static void  map_size         (PanMinimap    *self,
+                               gfloat        *width,
+                               gfloat        *height);
+static guint cell_of          (PanMinimap    *self,
+                               guint          x,
+                               guint          y);
+static void  recount          (PanMinimap    *self);
+static void  counts_changed   (PanMinimap    *self);
+static void  items_changed_cb (GListModel    *model,
+                               guint          position,
+                               guint          removed,
+                               guint          added,
+                               gpointer       user_data);
+static void  update_density   (PanMinimap    *self,
+                               gfloat         width,
+                               gfloat         height,
+                               const GdkRGBA *color);
+
+PanMinimap *
+pan_minimap_new (void)
+{
+    PanMinimap *self;
+
+    self = g_new0 (PanMinimap, 1);
+    self->stale = TRUE;
+
+    return self;
+}
+
+void
+pan_minimap_free (PanMinimap *self)
+{
+    g_return_if_fail (self != NULL);
+
+    pan_minimap_set_model (self, NULL);
+    g_clear_object (&self->texture);
+    g_clear_pointer (&self->density, gsk_render_node_unref);
+    g_free (self);
+}
+
+/**
+ * pan_minimap_set_image:
+ * @image: (nullable): the image shown on the canvas
+ *
+ * Drops the copy of the previous image.  Only the size of @image is kept;
+ * the copy is made by pan_minimap_render().
+ */
+void
+pan_minimap_set_image (PanMinimap *self,
+                       GdkTexture *image)
+{
+    g_return_if_fail (self != NULL);
+
+    g_clear_object (&self->texture);
+    self->image_width  = image ? gdk_texture_get_width (image) : 0;
+    self->image_height = image ? gdk_texture_get_height (image) : 0;
+    pan_minimap_invalidate (self);
+}
+
+void
+pan_minimap_set_model (PanMinimap *self,
+                       GListModel *annots)
+{
+    g_return_if_fail (self != NULL);
+
+    if (self->annots) {
+        g_clear_signal_handler (&self->items_changed_id, self->annots);
+        g_clear_object (&self->annots);
+    }
+
+    if (annots) {
+        self->annots = g_object_ref (annots);
+        self->items_changed_id = g_signal_connect (annots, "items-changed",
+                                                   G_CALLBACK (items_changed_cb), self);
+    }
+    pan_minimap_invalidate (self);
+}
+
+/**
+ * pan_minimap_move_point:
+ *
+ * Moves one point of the model from (@old_x, @old_y) to (@x, @y) in the
+ * counts.  Call it for moves, which the model does not signal.
+ */
+void
+pan_minimap_move_point (PanMinimap *self,
+                        guint       old_x,
+                        guint       old_y,
+                        guint       x,
+                        guint       y)
+{
+    guint from, to;
+
+    g_return_if_fail (self != NULL);
+
+    if (self->stale)
+        return;
+
+    from = cell_of (self, old_x, old_y);
+    to   = cell_of (self, x, y);
+    if (from == to)
+        return;
+
+    /* A point the counts do not know about means they are out of step. */
+    if (self->counts[from] == 0) {
+        pan_minimap_invalidate (self);
+        return;
+    }
+
+    self->counts[from]--;
+    self->counts[to]++;
+    counts_changed (self);
+}
+
+/**
+ * pan_minimap_invalidate:
+ *
+ * Tells @self that points changed in a way it cannot follow, such as an
+ * undo.  The counts are redone on the next draw.
+ */
+void
+pan_minimap_invalidate (PanMinimap *self)
+{
+    g_return_if_fail (self != NULL);
+
+    self->stale = TRUE;
+    counts_changed (self);
+}
+
+gboolean
+pan_minimap_has_texture (PanMinimap *self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->texture != NULL;
+}
+
+/**
+ * pan_minimap_render:
+ * @image: the image given to pan_minimap_set_image()
+ *
+ * Makes the small copy of @image with @renderer, filtered with mipmaps.
+ * It has to be called outside of a snapshot, from an idle for instance.
+ */
+void
+pan_minimap_render (PanMinimap  *self,
+                    GskRenderer *renderer,
+                    GdkTexture  *image)
+{
+    GtkSnapshot *snapshot;
+    GskRenderNode *node;
+    graphene_rect_t bounds;
+    gfloat width, height;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (GSK_IS_RENDERER (renderer));
+    g_return_if_fail (GDK_IS_TEXTURE (image));
+
+    if (self->image_width <= 0 || self->image_height <= 0)
+        return;
+
+    map_size (self, &width, &height);
+    graphene_rect_init (&bounds, 0, 0, ceilf (width), ceilf (height));
+    snapshot = gtk_snapshot_new ();
+    gtk_snapshot_append_scaled_texture (snapshot, image, GSK_SCALING_FILTER_TRILINEAR, &bounds);
+    node = gtk_snapshot_free_to_node (snapshot);
+
+    g_clear_object (&self->texture);
+    self->texture = gsk_renderer_render_texture (renderer, node, &bounds);
+    gsk_render_node_unref (node);
+}
+
+/**
+ * pan_minimap_get_bounds:
+ * @width: the width of the canvas
+ * @height: the height of the canvas
+ * @bounds: (out): where the minimap goes, in the bottom right corner
+ *
+ * Returns: %FALSE if there is no image to show
+ */
+gboolean
+pan_minimap_get_bounds (PanMinimap      *self,
+                        gint             width,
+                        gint             height,
+                        graphene_rect_t *bounds)
+{
+    gfloat map_width, map_height;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (bounds != NULL, FALSE);
+
+    if (self->image_width <= 0 || self->image_height <= 0)
+        return FALSE;
+
+    map_size (self, &map_width, &map_height);
+    graphene_rect_init (bounds, width - map_width - MARGIN, height - map_height - MARGIN,
+                        map_width, map_height);
+
+    return TRUE;
+}
+
+/**
+ * pan_minimap_to_image:
+ * @bounds: as given by pan_minimap_get_bounds()
+ *
+ * Converts a point of the canvas over the minimap to image coordinates.
+ */
+void
+pan_minimap_to_image (PanMinimap            *self,
+                      const graphene_rect_t *bounds,
+                      gdouble                x,
+                      gdouble                y,
+                      gdouble               *image_x,
+                      gdouble               *image_y)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (bounds != NULL);
+
+    *image_x = CLAMP ((x - bounds->origin.x) / bounds->size.width, 0.0, 1.0) * self->image_width;
+    *image_y = CLAMP ((y - bounds->origin.y) / bounds->size.height, 0.0, 1.0) * self->image_height;
+}
+
+/**
+ * pan_minimap_snapshot:
+ * @viewport: the part of the image in view, in image coordinates
+ * @color: the color of the points
+ * @frame_color: the color of the viewport frame
+ */
+void
+pan_minimap_snapshot (PanMinimap            *self,
+                      GtkSnapshot           *snapshot,
+                      const graphene_rect_t *bounds,
+                      const graphene_rect_t *viewport,
+                      const GdkRGBA         *color,
+                      const GdkRGBA         *frame_color)
+{
+    static const GdkRGBA background = { 0.0, 0.0, 0.0, 0.6 };
+    GskPathBuilder *path_builder;
+    graphene_rect_t frame, map;
+    GskStroke *stroke;
+    GskPath *path;
+    gfloat scale;
+
+    g_return_if_fail (self != NULL);
+
+    if (self->image_width <= 0 || self->image_height <= 0)
+        return;
+
+    graphene_rect_init (&map, 0, 0, bounds->size.width, bounds->size.height);
+    scale = bounds->size.width / self->image_width;
+
+    gtk_snapshot_save (snapshot);
+    gtk_snapshot_translate (snapshot, &bounds->origin);
+
+    gtk_snapshot_append_color (snapshot, &background, &map);
+    if (self->texture)
+        gtk_snapshot_append_texture (snapshot, self->texture, &map);
+
+    update_density (self, map.size.width, map.size.height, color);
+    if (self->density)
+        gtk_snapshot_append_node (snapshot, self->density);
+
+    graphene_rect_init (&frame, viewport->origin.x * scale, viewport->origin.y * scale,
+                        viewport->size.width * scale, viewport->size.height * scale);
+    if (graphene_rect_intersection (&frame, &map, &frame)) {
+        path_builder = gsk_path_builder_new ();
+        gsk_path_builder_add_rect (path_builder, &frame);
+        path = gsk_path_builder_free_to_path (path_builder);
+        stroke = gsk_stroke_new (2);
+        gtk_snapshot_append_stroke (snapshot, path, stroke, frame_color);
+        gsk_path_unref (path);
+        gsk_stroke_free (stroke);
+    }
+
+    gtk_snapshot_restore (snapshot);
+}
+
+/**
+ * pan_minimap_get_size:
+ *
+ * Returns: the bytes held by the copy of the image
+ */
+gsize
+pan_minimap_get_size (PanMinimap *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    if (!self->texture)
+        return 0;
+
+    return (gsize) gdk_texture_get_width (self->texture) * gdk_texture_get_height (self->texture) * 4;
+}
+
+static void
+map_size (PanMinimap *self,
+          gfloat     *width,
+          gfloat     *height)
+{
+    gfloat scale;
+
+    scale   = (gfloat) MINIMAP_SIZE / MAX (self->image_width, self->image_height);
+    *width  = MAX (self->image_width * scale, 1);
+    *height = MAX (self->image_height * scale, 1);
+}
+
+static guint
+cell_of (PanMinimap *self,
+         guint       x,
+         guint       y)
+{
+    guint col, row;
+
+    col = MIN ((guint64) x * DENSITY_CELLS / MAX (self->image_width, 1), DENSITY_CELLS - 1);
+    row = MIN ((guint64) y * DENSITY_CELLS / MAX (self->image_height, 1), DENSITY_CELLS - 1);
+
+    return row * DENSITY_CELLS + col;
+}
+
+static void
+recount (PanMinimap *self)
+{
+    PanAnnot *annot;
+    guint n;
+
+    memset (self->counts, 0, sizeof (self->counts));
+    self->stale = FALSE;
+
+    if (!self->annots)
+        return;
+
+    n = g_list_model_get_n_items (self->annots);
+    for (guint i = 0; i < n; i++) {
+        annot = g_list_model_get_item (self->annots, i);
+        self->counts[cell_of (self, pan_annot_x (annot), pan_annot_y (annot))]++;
+        g_object_unref (annot);
+    }
+}
+
+static void
+counts_changed (PanMinimap *self)
+{
+    self->density_valid = FALSE;
+}
+
+/* Added points are counted as they come; removed ones are gone already. */
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  gpointer    user_data)
+{
+    PanMinimap *self = user_data;
+    PanAnnot *annot;
+
+    if (removed > 0) {
+        pan_minimap_invalidate (self);
+        return;
+    }
+    if (self->stale)
+        return;
+
+    for (guint i = position; i < position + added; i++) {
+        annot = g_list_model_get_item (model, i);
+        self->counts[cell_of (self, pan_annot_x (annot), pan_annot_y (annot))]++;
+        g_object_unref (annot);
+    }
+    counts_changed (self);
+}
+
+/* Cells are shaded by their share of the busiest cell. */
+static void
+update_density (PanMinimap    *self,
+                gfloat         width,
+                gfloat         height,
+                const GdkRGBA *color)
+{
+    GtkSnapshot *snapshot;
+    GdkRGBA cell_color;
+    gfloat cell_width, cell_height;
+    guint32 max = 0;
+    guint32 count;
+
+    if (self->density_valid &&
+        self->density_width == width && self->density_height == height &&
+        gdk_rgba_equal (&self->density_color, color))
+        return;
+
+    if (self->stale)
+        recount (self);
+
+    for (guint c = 0; c < DENSITY_CELLS * DENSITY_CELLS; c++)
+        max = MAX (max, self->counts[c]);
+
+    cell_width  = width / DENSITY_CELLS;
+    cell_height = height / DENSITY_CELLS;
+    cell_color  = *color;
+    snapshot = gtk_snapshot_new ();
+    for (guint row = 0; row < DENSITY_CELLS; row++) {
+        for (guint col = 0; col < DENSITY_CELLS; col++) {
+            count = self->counts[row * DENSITY_CELLS + col];
+            if (count == 0)
+                continue;
+            cell_color.alpha = 0.2 + 0.6 * count / max;
+            gtk_snapshot_append_color (snapshot, &cell_color,
+                                       &GRAPHENE_RECT_INIT (col * cell_width, row * cell_height,
+                                                            cell_width, cell_height));
+        }
+    }
+
+    g_clear_pointer (&self->density, gsk_render_node_unref);
+    self->density        = gtk_snapshot_free_to_node (snapshot);
+    self->density_valid  = TRUE;
+    self->density_width  = width;
+    self->density_height = height;
+    self->density_color  = *color;
+}
@@ -0,0 +1,67 @@
+/*
+ * pan-minimap.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PanMinimap PanMinimap;
+
+PanMinimap *pan_minimap_new         (void);
+void        pan_minimap_free        (PanMinimap            *self);
+void        pan_minimap_set_image   (PanMinimap            *self,
+                                     GdkTexture            *image);
+void        pan_minimap_set_model   (PanMinimap            *self,
+                                     GListModel            *annots);
+void        pan_minimap_move_point  (PanMinimap            *self,
+                                     guint                  old_x,
+                                     guint                  old_y,
+                                     guint                  x,
+                                     guint                  y);
+void        pan_minimap_invalidate  (PanMinimap            *self);
+gboolean    pan_minimap_has_texture (PanMinimap            *self);
+void        pan_minimap_render      (PanMinimap            *self,
+                                     GskRenderer           *renderer,
+                                     GdkTexture            *image);
+gboolean    pan_minimap_get_bounds  (PanMinimap            *self,
+                                     gint                   width,
+                                     gint                   height,
+                                     graphene_rect_t       *bounds);
+void        pan_minimap_to_image    (PanMinimap            *self,
+                                     const graphene_rect_t *bounds,
+                                     gdouble                x,
+                                     gdouble                y,
+                                     gdouble               *image_x,
+                                     gdouble               *image_y);
+void        pan_minimap_snapshot    (PanMinimap            *self,
+                                     GtkSnapshot           *snapshot,
+                                     const graphene_rect_t *bounds,
+                                     const graphene_rect_t *viewport,
+                                     const GdkRGBA         *color,
+                                     const GdkRGBA         *frame_color);
+gsize       pan_minimap_get_size    (PanMinimap            *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanMinimap, pan_minimap_free)
+
+G_END_DECLS
@@ -0,0 +1,108 @@
+/*
+ * pan-parallel.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Runs a function over independent items on a pool with one thread per
+ * processor.  Every call writes only its own slot of the result and error
+ * arrays, so nothing is shared while the pool runs and the arrays can be
+ * read as soon as pan_parallel_map() returns.
+ */
+
+#include "pan-parallel.h"
+
+typedef struct
+{
+    gpointer *items;
+    PanParallelFunc func;
+    gpointer user_data;
+    gpointer *results;
+    GError **errors;
+} Batch;
+
+static void run_item (gpointer data,
+                      gpointer user_data);
+
+static void
+run_item (gpointer data,
+          gpointer user_data)
+{
+    Batch *batch = user_data;
+    guint i;
+
+    /* Tasks are pushed as index + 1, since the pool does not take NULL. */
+    i = GPOINTER_TO_UINT (data) - 1;
+    batch->results[i] = batch->func (batch->items[i], batch->user_data, &batch->errors[i]);
+}
+
+/**
+ * pan_parallel_map:
+ * @items: (array length=n_items): the inputs
+ * @func: called once per item, from a worker thread
+ * @results: (array length=n_items) (out caller-allocates): what @func returned
+ * @errors: (array length=n_items) (out caller-allocates): zero-filled on
+ *   entry; the error set by @func, if any
+ *
+ * Calls @func on every item in parallel and waits for all of them.
+ *
+ * Returns: %TRUE if no call set an error
+ */
+gboolean
+pan_parallel_map (gpointer        *items,
+                  guint            n_items,
+                  PanParallelFunc  func,
+                  gpointer         user_data,
+                  gpointer        *results,
+                  GError         **errors)
+{
+    GThreadPool *pool;
+    GError *error = NULL;
+    Batch batch = {
+        .items     = items,
+        .func      = func,
+        .user_data = user_data,
+        .results   = results,
+        .errors    = errors,
+    };
+
+    g_return_val_if_fail (func != NULL, FALSE);
+
+    pool = g_thread_pool_new (run_item, &batch,
+                              MIN (g_get_num_processors (), MAX (n_items, 1)),
+                              FALSE, &error);
+    if (!pool) {
+        /* Without threads, run everything here. */
+        g_warning ("Could not start worker threads: %s", error->message);
+        g_error_free (error);
+        for (guint i = 0; i < n_items; i++)
+            run_item (GUINT_TO_POINTER (i + 1), &batch);
+    } else {
+        for (guint i = 0; i < n_items; i++)
+            g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+        g_thread_pool_free (pool, FALSE, TRUE);
+    }
+
+    for (guint i = 0; i < n_items; i++) {
+        if (errors[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
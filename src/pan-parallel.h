@@ -0,0 +1,40 @@
+/*
+ * pan-parallel.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef gpointer (*PanParallelFunc) (gpointer   item,
+                                     gpointer   user_data,
+                                     GError   **error);
+
+gboolean pan_parallel_map (gpointer        *items,
+                           guint            n_items,
+                           PanParallelFunc  func,
+                           gpointer         user_data,
+                           gpointer        *results,
+                           GError         **errors);
+
+G_END_DECLS
@@ -0,0 +1,191 @@
+/*
+ * pan-perf.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Counters behind the canvas debug overlay.  Each timer keeps its last
+ * and largest duration and a moving average; recording one is a couple of
+ * additions, so the counters stay on even while the overlay is hidden and
+ * can be dumped at any time.
+ */
+
+#include <json-glib/json-glib.h>
+#include "pan-perf.h"
+
+/* Weight of the newest sample in the moving average. */
+#define SMOOTHING 0.1
+
+typedef struct
+{
+    gint64 last;
+    gint64 max;
+    gdouble average;
+    guint64 count;
+} PanPerfStat;
+
+struct _PanPerf
+{
+    PanPerfStat timers[PAN_PERF_N_TIMERS];
+    guint64 counters[PAN_PERF_N_COUNTERS];
+};
+
+static const gchar *timer_names[PAN_PERF_N_TIMERS] =
+{
+    [PAN_PERF_FRAME]    = "frame",
+    [PAN_PERF_SNAPSHOT] = "snapshot",
+    [PAN_PERF_HIT_TEST] = "hit_test",
+    [PAN_PERF_DECODE]   = "decode",
+};
+
+static const gchar *counter_names[PAN_PERF_N_COUNTERS] =
+{
+    [PAN_PERF_POINTS_VISITED] = "points_visited",
+    [PAN_PERF_POINTS_DRAWN]   = "points_drawn",
+    [PAN_PERF_TEXTURE_BYTES]  = "texture_bytes",
+};
+
+PanPerf *
+pan_perf_new (void)
+{
+    return g_new0 (PanPerf, 1);
+}
+
+void
+pan_perf_free (PanPerf *self)
+{
+    g_free (self);
+}
+
+void
+pan_perf_record (PanPerf      *self,
+                 PanPerfTimer  timer,
+                 gint64        duration)
+{
+    PanPerfStat *stat;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (timer < PAN_PERF_N_TIMERS);
+
+    stat = &self->timers[timer];
+    stat->last = duration;
+    stat->max  = MAX (stat->max, duration);
+    if (stat->count == 0)
+        stat->average = duration;
+    else
+        stat->average += SMOOTHING * (duration - stat->average);
+    stat->count++;
+}
+
+void
+pan_perf_set_counter (PanPerf        *self,
+                      PanPerfCounter  counter,
+                      guint64         value)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (counter < PAN_PERF_N_COUNTERS);
+
+    self->counters[counter] = value;
+}
+
+/**
+ * pan_perf_to_string:
+ *
+ * Formats the counters for the overlay, one line each.
+ *
+ * Returns: (transfer full): the text
+ */
+gchar *
+pan_perf_to_string (PanPerf *self)
+{
+    const PanPerfStat *frame;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    frame = &self->timers[PAN_PERF_FRAME];
+
+    return g_strdup_printf ("frame     %6.2f ms  %5.1f fps\n"
+                            "snapshot  %6.2f ms  max %.2f ms\n"
+                            "hit test  %6.3f ms  max %.3f ms\n"
+                            "points    %" G_GUINT64_FORMAT " visited, %" G_GUINT64_FORMAT " drawn\n"
+                            "decode    %6.1f ms\n"
+                            "texture   %.1f MiB",
+                            frame->average / 1000.0,
+                            frame->average > 0 ? G_USEC_PER_SEC / frame->average : 0.0,
+                            self->timers[PAN_PERF_SNAPSHOT].average / 1000.0,
+                            self->timers[PAN_PERF_SNAPSHOT].max / 1000.0,
+                            self->timers[PAN_PERF_HIT_TEST].average / 1000.0,
+                            self->timers[PAN_PERF_HIT_TEST].max / 1000.0,
+                            self->counters[PAN_PERF_POINTS_VISITED],
+                            self->counters[PAN_PERF_POINTS_DRAWN],
+                            self->timers[PAN_PERF_DECODE].last / 1000.0,
+                            self->counters[PAN_PERF_TEXTURE_BYTES] / (1024.0 * 1024.0));
+}
+
+/**
+ * pan_perf_to_json:
+ *
+ * Returns: (transfer full): all timers, in microseconds, and counters as
+ *   a JSON object
+ */
+gchar *
+pan_perf_to_json (PanPerf *self)
+{
+    g_autoptr (JsonBuilder) builder = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    const PanPerfStat *stat;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    builder = json_builder_new ();
+    json_builder_begin_object (builder);
+    json_builder_set_member_name (builder, "timers");
+    json_builder_begin_object (builder);
+    for (guint i = 0; i < PAN_PERF_N_TIMERS; i++) {
+        stat = &self->timers[i];
+        json_builder_set_member_name (builder, timer_names[i]);
+        json_builder_begin_object (builder);
+        json_builder_set_member_name (builder, "last_us");
+        json_builder_add_int_value (builder, stat->last);
+        json_builder_set_member_name (builder, "average_us");
+        json_builder_add_double_value (builder, stat->average);
+        json_builder_set_member_name (builder, "max_us");
+        json_builder_add_int_value (builder, stat->max);
+        json_builder_set_member_name (builder, "count");
+        json_builder_add_int_value (builder, stat->count);
+        json_builder_end_object (builder);
+    }
+    json_builder_end_object (builder);
+    json_builder_set_member_name (builder, "counters");
+    json_builder_begin_object (builder);
+    for (guint i = 0; i < PAN_PERF_N_COUNTERS; i++) {
+        json_builder_set_member_name (builder, counter_names[i]);
+        json_builder_add_int_value (builder, self->counters[i]);
+    }
+    json_builder_end_object (builder);
+    json_builder_end_object (builder);
+
+    root = json_builder_get_root (builder);
+    generator = json_generator_new ();
+    json_generator_set_pretty (generator, TRUE);
+    json_generator_set_root (generator, root);
+
+    return json_generator_to_data (generator, NULL);
+}
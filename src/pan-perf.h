@@ -0,0 +1,60 @@
+/*
+ * pan-perf.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_PERF_FRAME,
+    PAN_PERF_SNAPSHOT,
+    PAN_PERF_HIT_TEST,
+    PAN_PERF_DECODE,
+    PAN_PERF_N_TIMERS
+} PanPerfTimer;
+
+typedef enum
+{
+    PAN_PERF_POINTS_VISITED,
+    PAN_PERF_POINTS_DRAWN,
+    PAN_PERF_TEXTURE_BYTES,
+    PAN_PERF_N_COUNTERS
+} PanPerfCounter;
+
+typedef struct _PanPerf PanPerf;
+
+PanPerf *pan_perf_new         (void);
+void     pan_perf_free        (PanPerf *self);
+void     pan_perf_record      (PanPerf      *self,
+                               PanPerfTimer  timer,
+                               gint64        duration);
+void     pan_perf_set_counter (PanPerf        *self,
+                               PanPerfCounter  counter,
+                               guint64         value);
+gchar   *pan_perf_to_string   (PanPerf *self);
+gchar   *pan_perf_to_json     (PanPerf *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanPerf, pan_perf_free)
+
+G_END_DECLS
@@ -0,0 +1,48 @@
+/*
+ * pan-profiler.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Marks for Sysprof.  Take the start time with PAN_PROFILER_CURRENT_TIME
+ * and pass it to PAN_PROFILER_ADD_MARK once the work is done; the mark
+ * then shows up next to the CPU samples of the same capture.  Without the
+ * sysprof build option both macros compile to nothing.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <glib.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+
+#define PAN_PROFILER_CURRENT_TIME SYSPROF_CAPTURE_CURRENT_TIME
+#define PAN_PROFILER_ADD_MARK(begin, name, message)                             \
+    G_STMT_START {                                                              \
+        if (sysprof_collector_is_active ())                                     \
+            sysprof_collector_mark ((begin),                                    \
+                                    SYSPROF_CAPTURE_CURRENT_TIME - (begin),     \
+                                    "Pan", (name), (message));                  \
+    } G_STMT_END
+#else
+#define PAN_PROFILER_CURRENT_TIME 0
+#define PAN_PROFILER_ADD_MARK(begin, name, message) ((void) (begin))
+#endif
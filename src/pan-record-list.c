@@ -0,0 +1,596 @@
+/*
+ * pan-record-list.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * PanRecordList is the GListModel behind a document's image list.
+ *
+ * Filenames are packed back to back into a single byte array and addressed
+ * by a 32-bit offset, so an entry costs its name plus four bytes.  PanRecord
+ * objects are only built when an item is asked for (by the list view, the
+ * canvas or the serializer) and are held with a toggle reference: once the
+ * list is the last owner and the record has nothing to undo it is dropped
+ * again, and the next request builds a fresh one from the index.  The
+ * points of a dropped record are spilled into the index as packed x, y
+ * pairs, eight bytes each instead of an annotation object.  A record kept
+ * for its history is dropped once the history budget empties it.
+ *
+ * Each entry also has room for the content hash of its image, zero until
+ * it is known, and a byte of PanRecordFlags, which is nine more bytes.
+ */
+
+#include "pan-record-list.h"
+
+struct _PanRecordList
+{
+    GObject parent;
+
+    GByteArray *names;
+    GArray *offsets;
+    GArray *hashes;
+    GArray *flags;
+    GHashTable *live;
+    GHashTable *spilled;
+};
+
+static GQuark position_quark;
+
+static void      pan_record_list_dispose          (GObject *object);
+static void      pan_record_list_finalize         (GObject *object);
+static void      pan_record_list_model_iface_init (GListModelInterface *iface);
+static GType     pan_record_list_get_item_type    (GListModel *model);
+static guint     pan_record_list_get_n_items      (GListModel *model);
+static gpointer  pan_record_list_get_item         (GListModel *model,
+                                                   guint       position);
+static void      record_toggle_notify             (gpointer  data,
+                                                   GObject  *object,
+                                                   gboolean  is_last_ref);
+static void      track_record                     (PanRecordList *self,
+                                                   PanRecord     *record,
+                                                   guint          position);
+static guint     append_name                      (PanRecordList *self,
+                                                   const gchar   *filename);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (PanRecordList, pan_record_list, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
+                                                      pan_record_list_model_iface_init))
+
+static void
+pan_record_list_class_init (PanRecordListClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->dispose  = pan_record_list_dispose;
+    object_class->finalize = pan_record_list_finalize;
+
+    position_quark = g_quark_from_static_string ("pan-record-list-position");
+}
+
+static void
+pan_record_list_init (PanRecordList *self)
+{
+    self->names   = g_byte_array_new ();
+    self->offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->hashes  = g_array_new (FALSE, TRUE, sizeof (guint64));
+    self->flags   = g_array_new (FALSE, TRUE, sizeof (guint8));
+    self->live    = g_hash_table_new (g_direct_hash, g_direct_equal);
+    self->spilled = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) g_array_unref);
+}
+
+static void
+pan_record_list_dispose (GObject *object)
+{
+    PanRecordList *self = PAN_RECORD_LIST (object);
+    GHashTableIter iter;
+    gpointer record;
+
+    g_hash_table_iter_init (&iter, self->live);
+    while (g_hash_table_iter_next (&iter, NULL, &record)) {
+        g_hash_table_iter_steal (&iter);
+        g_object_remove_toggle_ref (record, record_toggle_notify, self);
+    }
+
+    G_OBJECT_CLASS (pan_record_list_parent_class)->dispose (object);
+}
+
+static void
+pan_record_list_finalize (GObject *object)
+{
+    PanRecordList *self = PAN_RECORD_LIST (object);
+
+    g_byte_array_unref (self->names);
+    g_array_unref (self->offsets);
+    g_array_unref (self->hashes);
+    g_array_unref (self->flags);
+    g_hash_table_unref (self->live);
+    g_hash_table_unref (self->spilled);
+
+    G_OBJECT_CLASS (pan_record_list_parent_class)->finalize (object);
+}
+
+static void
+pan_record_list_model_iface_init (GListModelInterface *iface)
+{
+    iface->get_item_type = pan_record_list_get_item_type;
+    iface->get_n_items   = pan_record_list_get_n_items;
+    iface->get_item      = pan_record_list_get_item;
+}
+
+static GType
+pan_record_list_get_item_type (GListModel *model)
+{
+    return PAN_TYPE_RECORD;
+}
+
+static guint
+pan_record_list_get_n_items (GListModel *model)
+{
+    return PAN_RECORD_LIST (model)->offsets->len;
+}
+
+static gpointer
+pan_record_list_get_item (GListModel *model,
+                          guint       position)
+{
+    PanRecordList *self = PAN_RECORD_LIST (model);
+    PanRecord *record;
+    GArray *points;
+
+    if (position >= self->offsets->len)
+        return NULL;
+
+    record = g_hash_table_lookup (self->live, GUINT_TO_POINTER (position));
+    if (record)
+        return g_object_ref (record);
+
+    /* The reference from pan_record_new() is handed to the caller. */
+    record = pan_record_new (pan_record_list_get_filename (self, position));
+    pan_record_set_duplicate (record, g_array_index (self->flags, guint8, position) & PAN_RECORD_DUPLICATE);
+    if (g_hash_table_steal_extended (self->spilled, GUINT_TO_POINTER (position), NULL, (gpointer *) &points)) {
+        pan_record_add_points (record, (const guint32 *) points->data, points->len / 2);
+        g_array_unref (points);
+    }
+    track_record (self, record, position);
+
+    return record;
+}
+
+static void
+record_toggle_notify (gpointer  data,
+                      GObject  *object,
+                      gboolean  is_last_ref)
+{
+    PanRecordList *self = data;
+    PanRecord *record = PAN_RECORD (object);
+    GArray *points;
+    guint position;
+
+    /* The history points at the annotations, so they have to stay. */
+    if (!is_last_ref || pan_record_has_history (record))
+        return;
+
+    position = GPOINTER_TO_UINT (g_object_get_qdata (object, position_quark)) - 1;
+    points   = g_array_new (FALSE, FALSE, sizeof (guint32));
+    if (pan_record_copy_points (record, points) > 0)
+        g_hash_table_insert (self->spilled, GUINT_TO_POINTER (position), points);
+    else
+        g_array_unref (points);
+
+    g_hash_table_remove (self->live, GUINT_TO_POINTER (position));
+    g_object_remove_toggle_ref (object, record_toggle_notify, self);
+}
+
+static void
+track_record (PanRecordList *self,
+              PanRecord     *record,
+              guint          position)
+{
+    g_object_set_qdata (G_OBJECT (record), position_quark, GUINT_TO_POINTER (position + 1));
+    g_object_add_toggle_ref (G_OBJECT (record), record_toggle_notify, self);
+    g_hash_table_insert (self->live, GUINT_TO_POINTER (position), record);
+}
+
+static guint
+append_name (PanRecordList *self,
+             const gchar   *filename)
+{
+    guint32 offset;
+    gsize len;
+
+    len = strlen (filename) + 1;
+    g_return_val_if_fail (self->names->len + len <= G_MAXUINT32, G_MAXUINT);
+
+    offset = self->names->len;
+    g_byte_array_append (self->names, (const guint8 *) filename, len);
+    g_array_append_val (self->offsets, offset);
+    g_array_set_size (self->hashes, self->offsets->len);
+    g_array_set_size (self->flags, self->offsets->len);
+
+    return self->offsets->len - 1;
+}
+
+PanRecordList *
+pan_record_list_new (void)
+{
+    return g_object_new (PAN_TYPE_RECORD_LIST, NULL);
+}
+
+void
+pan_record_list_append (PanRecordList *self,
+                        const gchar   *filename)
+{
+    guint position;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (filename != NULL);
+
+    position = append_name (self, filename);
+    if (position == G_MAXUINT)
+        return;
+
+    g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+}
+
+void
+pan_record_list_append_record (PanRecordList *self,
+                               PanRecord     *record)
+{
+    guint position;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (PAN_IS_RECORD (record));
+
+    position = append_name (self, pan_record_filename (record));
+    if (position == G_MAXUINT)
+        return;
+
+    if (pan_record_get_duplicate (record))
+        g_array_index (self->flags, guint8, position) |= PAN_RECORD_DUPLICATE;
+
+    /*
+     * Empty records are not worth keeping, the index already has them.  The
+     * toggle reference is the list's only one, so the caller keeps its own.
+     */
+    if (!pan_record_is_empty (record))
+        track_record (self, record, position);
+
+    g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+}
+
+const gchar *
+pan_record_list_get_filename (PanRecordList *self,
+                              guint          position)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), NULL);
+    g_return_val_if_fail (position < self->offsets->len, NULL);
+
+    return (const gchar *) self->names->data + g_array_index (self->offsets, guint32, position);
+}
+
+/**
+ * pan_record_list_set_filename:
+ *
+ * Points the entry at @position to another image.  The new name is
+ * appended to the index and the old one is left unused, which is cheap
+ * as long as renames are rare, as they are when relinking a document.
+ */
+void
+pan_record_list_set_filename (PanRecordList *self,
+                              guint          position,
+                              const gchar   *filename)
+{
+    PanRecord *record;
+    guint32 offset;
+    gsize len;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (position < self->offsets->len);
+    g_return_if_fail (filename != NULL);
+
+    len = strlen (filename) + 1;
+    g_return_if_fail (self->names->len + len <= G_MAXUINT32);
+
+    offset = self->names->len;
+    g_byte_array_append (self->names, (const guint8 *) filename, len);
+    g_array_index (self->offsets, guint32, position) = offset;
+
+    record = g_hash_table_lookup (self->live, GUINT_TO_POINTER (position));
+    if (record)
+        pan_record_set_filename (record, (gchar *) filename);
+}
+
+/**
+ * pan_record_list_get_hash:
+ *
+ * Returns: the content hash of the image at @position, or %PAN_HASH_NONE
+ *   if it was never computed
+ */
+guint64
+pan_record_list_get_hash (PanRecordList *self,
+                          guint          position)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+    g_return_val_if_fail (position < self->hashes->len, 0);
+
+    return g_array_index (self->hashes, guint64, position);
+}
+
+void
+pan_record_list_set_hash (PanRecordList *self,
+                          guint          position,
+                          guint64        hash)
+{
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (position < self->hashes->len);
+
+    g_array_index (self->hashes, guint64, position) = hash;
+}
+
+PanRecordFlags
+pan_record_list_get_flags (PanRecordList *self,
+                           guint          position)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+    g_return_val_if_fail (position < self->flags->len, 0);
+
+    return g_array_index (self->flags, guint8, position);
+}
+
+/**
+ * pan_record_list_set_flags:
+ *
+ * Sets the flags of the entry at @position, and shows them on its record
+ * if it is alive.
+ */
+void
+pan_record_list_set_flags (PanRecordList  *self,
+                           guint           position,
+                           PanRecordFlags  flags)
+{
+    PanRecord *record;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (position < self->flags->len);
+
+    g_array_index (self->flags, guint8, position) = flags;
+
+    record = g_hash_table_lookup (self->live, GUINT_TO_POINTER (position));
+    if (record)
+        pan_record_set_duplicate (record, flags & PAN_RECORD_DUPLICATE);
+}
+
+/**
+ * pan_record_list_append_points:
+ * @xy: (array): @n_points x, y pairs
+ *
+ * Appends an image with points straight to the index, as if its record
+ * had been dropped, so loaders need no record for it.
+ */
+void
+pan_record_list_append_points (PanRecordList *self,
+                               const gchar   *filename,
+                               const guint32 *xy,
+                               guint          n_points)
+{
+    GArray *points;
+    guint position;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (filename != NULL);
+    g_return_if_fail (xy != NULL || n_points == 0);
+
+    position = append_name (self, filename);
+    if (position == G_MAXUINT)
+        return;
+
+    if (n_points > 0) {
+        points = g_array_sized_new (FALSE, FALSE, sizeof (guint32), 2 * n_points);
+        g_array_append_vals (points, xy, 2 * n_points);
+        g_hash_table_insert (self->spilled, GUINT_TO_POINTER (position), points);
+    }
+
+    g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+}
+
+/**
+ * pan_record_list_peek:
+ *
+ * Returns the record at @position if one is currently alive, without
+ * creating it.  Records that are not alive may still have points, which
+ * pan_record_list_copy_points() reads from the index.
+ *
+ * Returns: (transfer none) (nullable): the record
+ */
+PanRecord *
+pan_record_list_peek (PanRecordList *self,
+                      guint          position)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), NULL);
+
+    return g_hash_table_lookup (self->live, GUINT_TO_POINTER (position));
+}
+
+/**
+ * pan_record_list_copy_points:
+ *
+ * Like pan_record_copy_points() for the entry at @position, whether its
+ * record is alive or its points are spilled, without building a record.
+ *
+ * Returns: the number of points appended
+ */
+guint
+pan_record_list_copy_points (PanRecordList *self,
+                             guint          position,
+                             GArray        *points)
+{
+    PanRecord *record;
+    GArray *spilled;
+
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+    g_return_val_if_fail (points != NULL, 0);
+
+    record = g_hash_table_lookup (self->live, GUINT_TO_POINTER (position));
+    if (record)
+        return pan_record_copy_points (record, points);
+
+    spilled = g_hash_table_lookup (self->spilled, GUINT_TO_POINTER (position));
+    if (!spilled)
+        return 0;
+
+    g_array_append_vals (points, spilled->data, spilled->len);
+
+    return spilled->len / 2;
+}
+
+/**
+ * pan_record_list_dup_stems:
+ *
+ * Names every image for files derived from it: its path below the
+ * document folder, with the extension dropped and separators turned into
+ * underscores.  Fails if two images would get the same name, so that
+ * exports never write one file twice.
+ *
+ * Returns: (transfer full) (nullable): one stem per entry, in order
+ */
+gchar **
+pan_record_list_dup_stems (PanRecordList  *self,
+                           GError        **error)
+{
+    g_autoptr (GHashTable) seen = NULL;
+    gchar **stems;
+    const gchar *filename, *other;
+    gchar *dot, *sep;
+    guint n;
+
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    n     = self->offsets->len;
+    stems = g_new0 (gchar *, n + 1);
+    seen  = g_hash_table_new (g_str_hash, g_str_equal);
+    for (guint i = 0; i < n; i++) {
+        filename = pan_record_list_get_filename (self, i);
+        stems[i] = g_strdup (filename);
+
+        dot = strrchr (stems[i], '.');
+        sep = strrchr (stems[i], '/');
+        if (dot && dot > stems[i] && (!sep || dot > sep + 1))
+            *dot = '\0';
+        g_strdelimit (stems[i], "/\\", '_');
+
+        other = g_hash_table_lookup (seen, stems[i]);
+        if (other) {
+            g_set_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                         "%s and %s would both be written as %s", other, filename, stems[i]);
+            g_strfreev (stems);
+            return NULL;
+        }
+        g_hash_table_insert (seen, stems[i], (gpointer) filename);
+    }
+
+    return stems;
+}
+
+/**
+ * pan_record_list_collect_errors:
+ * @errors: (array): one slot per entry, as filled by pan_parallel_map()
+ *   over the entries; every error is freed
+ *
+ * Reduces per-image errors to one: the first, prefixed with its image
+ * and, if more failed, with how many did.
+ *
+ * Returns: the number of images that failed
+ */
+guint
+pan_record_list_collect_errors (PanRecordList  *self,
+                                GError        **errors,
+                                GError        **error)
+{
+    guint n, n_failed = 0;
+
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+    g_return_val_if_fail (errors != NULL, 0);
+
+    n = self->offsets->len;
+    for (guint i = 0; i < n; i++) {
+        if (!errors[i])
+            continue;
+        if (n_failed++ == 0)
+            g_propagate_prefixed_error (error, g_steal_pointer (&errors[i]), "%s: ",
+                                        pan_record_list_get_filename (self, i));
+        else
+            g_clear_error (&errors[i]);
+    }
+
+    if (n_failed > 1)
+        g_prefix_error (error, "%u of %u images failed, first ", n_failed, n);
+
+    return n_failed;
+}
+
+guint
+pan_record_list_get_n_live (PanRecordList *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+
+    return g_hash_table_size (self->live);
+}
+
+gsize
+pan_record_list_get_index_size (PanRecordList *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD_LIST (self), 0);
+
+    return self->names->len + self->offsets->len * (sizeof (guint32) + sizeof (guint64) + 1);
+}
+
+/**
+ * pan_record_list_account_memory:
+ *
+ * Adds the packed filename index, the spilled points and every live
+ * record to @report.
+ */
+void
+pan_record_list_account_memory (PanRecordList   *self,
+                                PanMemoryReport *report)
+{
+    GHashTableIter iter;
+    gpointer record, points;
+    gsize spilled = 0;
+
+    g_return_if_fail (PAN_IS_RECORD_LIST (self));
+    g_return_if_fail (report != NULL);
+
+    pan_memory_report_add (report, PAN_MEMORY_FILENAMES, self->names->len);
+    pan_memory_report_add (report, PAN_MEMORY_RECORDS,
+                           pan_memory_instance_size (PAN_TYPE_RECORD_LIST) +
+                           self->offsets->len * (sizeof (guint32) + sizeof (guint64) + 1));
+    pan_memory_report_add_objects (report, PAN_TYPE_RECORD_LIST, 1);
+
+    g_hash_table_iter_init (&iter, self->spilled);
+    while (g_hash_table_iter_next (&iter, NULL, &points))
+        spilled += sizeof (GArray) + ((GArray *) points)->len * sizeof (guint32);
+    pan_memory_report_add (report, PAN_MEMORY_ANNOTS, spilled);
+
+    g_hash_table_iter_init (&iter, self->live);
+    while (g_hash_table_iter_next (&iter, NULL, &record))
+        pan_record_account_memory (record, report);
+}
@@ -0,0 +1,76 @@
+/*
+ * pan-record-list.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include "pan-record.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    PAN_RECORD_DUPLICATE = 1 << 0,
+} PanRecordFlags;
+
+#define PAN_TYPE_RECORD_LIST pan_record_list_get_type ()
+G_DECLARE_FINAL_TYPE (PanRecordList, pan_record_list, PAN, RECORD_LIST, GObject)
+
+PanRecordList *pan_record_list_new           (void);
+void           pan_record_list_append        (PanRecordList *self,
+                                              const gchar   *filename);
+void           pan_record_list_append_record (PanRecordList *self,
+                                              PanRecord     *record);
+void           pan_record_list_append_points (PanRecordList *self,
+                                              const gchar   *filename,
+                                              const guint32 *xy,
+                                              guint          n_points);
+const gchar   *pan_record_list_get_filename  (PanRecordList *self,
+                                              guint          position);
+void           pan_record_list_set_filename  (PanRecordList *self,
+                                              guint          position,
+                                              const gchar   *filename);
+guint64        pan_record_list_get_hash      (PanRecordList *self,
+                                              guint          position);
+void           pan_record_list_set_hash      (PanRecordList *self,
+                                              guint          position,
+                                              guint64        hash);
+PanRecordFlags pan_record_list_get_flags     (PanRecordList *self,
+                                              guint          position);
+void           pan_record_list_set_flags     (PanRecordList *self,
+                                              guint          position,
+                                              PanRecordFlags flags);
+PanRecord     *pan_record_list_peek          (PanRecordList *self,
+                                              guint          position);
+guint          pan_record_list_copy_points   (PanRecordList *self,
+                                              guint          position,
+                                              GArray        *points);
+gchar        **pan_record_list_dup_stems     (PanRecordList  *self,
+                                              GError        **error);
+guint          pan_record_list_collect_errors (PanRecordList  *self,
+                                               GError        **errors,
+                                               GError        **error);
+guint          pan_record_list_get_n_live    (PanRecordList *self);
+gsize          pan_record_list_get_index_size (PanRecordList *self);
+void           pan_record_list_account_memory (PanRecordList   *self,
+                                               PanMemoryReport *report);
+
+G_END_DECLS
@@ -22,12 +22,17 @@
 #include <json-glib/json-glib.h>
 #include "pan-record.h"
 
+/* A GListStore keeps each item in a GSequence node of about this size. */
+#define STORE_NODE_SIZE (5 * sizeof (gpointer))
+
 struct _PanRecord
 {
     GObject parent;
 
     gchar *filename;
     GListStore *annots;
+    PanHistory *history;
+    gboolean duplicate;
 };
 
 enum
@@ -35,6 +40,7 @@ enum
     PROP_ZERO,
     PROP_FILENAME,
     PROP_ANNOTS,
+    PROP_DUPLICATE,
     N_PROPS
 };
 
@@ -60,6 +66,7 @@ static JsonNode    *pan_record_serialize_property      (JsonSerializable* serial
 
 static void         pan_record_dispose                 (GObject *object);
 static void         pan_record_finalize                (GObject *object);
+static void         history_released                   (gpointer user_data);
 
 static GParamSpec *pan_record_properties[N_PROPS] = {NULL, };
 
@@ -83,6 +90,11 @@ pan_record_class_init (PanRecordClass *klass)
     pan_record_properties[PROP_ANNOTS] =
         g_param_spec_object ("annots", NULL, NULL, G_TYPE_LIST_STORE, G_PARAM_READWRITE);
 
+    /* Set on images that look like an earlier one; only written when set. */
+    pan_record_properties[PROP_DUPLICATE] =
+        g_param_spec_boolean ("duplicate", NULL, NULL, FALSE,
+                              G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
     g_object_class_install_properties (object_class, N_PROPS, pan_record_properties);
 }
 
@@ -108,6 +120,9 @@ pan_record_get_properties (GObject    *object,
     case PROP_ANNOTS:
         g_value_set_object (value, g_object_ref (record->annots));
         break;
+    case PROP_DUPLICATE:
+        g_value_set_boolean (value, record->duplicate);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -133,6 +148,9 @@ pan_record_set_properties (GObject      *object,
             g_object_unref (record->annots);
         record->annots = g_object_ref (g_value_get_object (value));
         break;
+    case PROP_DUPLICATE:
+        pan_record_set_duplicate (record, g_value_get_boolean (value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -154,6 +172,7 @@ pan_record_finalize (GObject *object)
     PanRecord *record = PAN_RECORD (object);
 
     g_free (record->filename);
+    g_clear_pointer (&record->history, pan_history_free);
     G_OBJECT_CLASS (pan_record_parent_class)->finalize (object);
 }
 
@@ -204,6 +223,151 @@ pan_record_set_annots (PanRecord *self,
     g_object_set (self, "annots", annots, NULL);
 }
 
+/**
+ * pan_record_get_duplicate:
+ *
+ * Returns: whether the image looks the same as an earlier one of its
+ *   document, see pan_similar_flag()
+ */
+gboolean
+pan_record_get_duplicate (PanRecord *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD (self), FALSE);
+
+    return self->duplicate;
+}
+
+void
+pan_record_set_duplicate (PanRecord *self,
+                          gboolean   duplicate)
+{
+    g_return_if_fail (PAN_IS_RECORD (self));
+
+    duplicate = !!duplicate;
+    if (self->duplicate == duplicate)
+        return;
+
+    self->duplicate = duplicate;
+    g_object_notify_by_pspec (G_OBJECT (self), pan_record_properties[PROP_DUPLICATE]);
+}
+
+gboolean
+pan_record_is_empty (PanRecord *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD (self), TRUE);
+
+    if (pan_record_has_history (self))
+        return FALSE;
+
+    return g_list_model_get_n_items (G_LIST_MODEL (self->annots)) == 0;
+}
+
+/**
+ * pan_record_has_history:
+ *
+ * Returns: whether anything can be undone or redone on the record
+ */
+gboolean
+pan_record_has_history (PanRecord *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD (self), FALSE);
+
+    return self->history &&
+           (pan_history_can_undo (self->history) || pan_history_can_redo (self->history));
+}
+
+/**
+ * pan_record_copy_points:
+ * @points: an array of #guint32
+ *
+ * Appends the position of every annotation to @points as an x, y pair,
+ * for code that works on plain coordinates, often off the main thread.
+ *
+ * Returns: the number of points appended
+ */
+guint
+pan_record_copy_points (PanRecord *self,
+                        GArray    *points)
+{
+    GListModel *annots;
+    PanAnnot *annot;
+    guint32 point[2];
+    guint n_annots, x, y;
+
+    g_return_val_if_fail (PAN_IS_RECORD (self), 0);
+    g_return_val_if_fail (points != NULL, 0);
+
+    annots   = G_LIST_MODEL (self->annots);
+    n_annots = g_list_model_get_n_items (annots);
+    for (guint i = 0; i < n_annots; i++) {
+        annot = g_list_model_get_item (annots, i);
+        pan_annot_get_pos (annot, &x, &y);
+        g_object_unref (annot);
+        point[0] = x;
+        point[1] = y;
+        g_array_append_vals (points, point, 2);
+    }
+
+    return n_annots;
+}
+
+/**
+ * pan_record_add_points:
+ * @xy: (array): @n_points x, y pairs
+ *
+ * Appends an annotation for every point, the reverse of
+ * pan_record_copy_points().
+ */
+void
+pan_record_add_points (PanRecord     *self,
+                       const guint32 *xy,
+                       guint          n_points)
+{
+    g_autoptr (GPtrArray) annots = NULL;
+
+    g_return_if_fail (PAN_IS_RECORD (self));
+    g_return_if_fail (xy != NULL || n_points == 0);
+
+    annots = g_ptr_array_new_full (n_points, g_object_unref);
+    for (guint i = 0; i < n_points; i++)
+        g_ptr_array_add (annots, pan_annot_new (xy[2 * i], xy[2 * i + 1]));
+
+    g_list_store_splice (self->annots, g_list_model_get_n_items (G_LIST_MODEL (self->annots)), 0,
+                         annots->pdata, annots->len);
+}
+
+/**
+ * pan_record_get_history:
+ *
+ * Returns the undo history of the record, creating an empty one on first
+ * use.  The history lives as long as the record, so it survives switching
+ * to other records.
+ *
+ * Returns: (transfer none): the history
+ */
+PanHistory *
+pan_record_get_history (PanRecord *self)
+{
+    g_return_val_if_fail (PAN_IS_RECORD (self), NULL);
+
+    if (!self->history) {
+        self->history = pan_history_new ();
+        pan_history_set_release_func (self->history, history_released, self);
+    }
+
+    return self->history;
+}
+
+/*
+ * The budget emptied the history.  Dropping a temporary reference lets a
+ * record list that holds the record by a toggle reference release it.
+ */
+static void
+history_released (gpointer user_data)
+{
+    g_object_unref (g_object_ref (user_data));
+}
+
 static gboolean
 pan_record_deserialize_property (JsonSerializable *serializable,
                                  const gchar      *property_name,
@@ -257,6 +421,32 @@ pan_record_serialize_property (JsonSerializable *serializable,
         return node;
     }
 
+    if (!g_strcmp0 (property_name, "duplicate") && !g_value_get_boolean (value))
+        return NULL;
+
     return json_serializable_default_serialize_property (serializable, property_name, value, pspec);
 }
 
+void
+pan_record_account_memory (PanRecord       *self,
+                           PanMemoryReport *report)
+{
+    guint n_annots;
+
+    g_return_if_fail (PAN_IS_RECORD (self));
+    g_return_if_fail (report != NULL);
+
+    n_annots = g_list_model_get_n_items (G_LIST_MODEL (self->annots));
+
+    pan_memory_report_add (report, PAN_MEMORY_RECORDS,
+                           pan_memory_instance_size (PAN_TYPE_RECORD) +
+                           pan_memory_instance_size (G_TYPE_LIST_STORE));
+    pan_memory_report_add (report, PAN_MEMORY_FILENAMES, strlen (self->filename) + 1);
+    pan_memory_report_add (report, PAN_MEMORY_ANNOTS,
+                           n_annots * (pan_memory_instance_size (PAN_TYPE_ANNOT) + STORE_NODE_SIZE));
+    pan_memory_report_add_objects (report, PAN_TYPE_RECORD, 1);
+    pan_memory_report_add_objects (report, PAN_TYPE_ANNOT, n_annots);
+
+    if (self->history)
+        pan_history_account_memory (self->history, report);
+}
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "pan-annot.h"
+#include "pan-history.h"
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
@@ -29,11 +30,24 @@ G_BEGIN_DECLS
 #define PAN_TYPE_RECORD pan_record_get_type ()
 G_DECLARE_FINAL_TYPE (PanRecord, pan_record, PAN, RECORD, GObject)
 
-PanRecord  *pan_record_new          (const gchar *file_name);
-gchar      *pan_record_filename     (PanRecord *self);
-GListStore *pan_record_annots       (PanRecord *self);
-void        pan_record_set_filename (PanRecord *self, gchar *filename);
-void        pan_record_set_annots   (PanRecord *self, GListStore *annots);
+PanRecord  *pan_record_new           (const gchar *file_name);
+gchar      *pan_record_filename      (PanRecord *self);
+GListStore *pan_record_annots        (PanRecord *self);
+void        pan_record_set_filename  (PanRecord *self, gchar *filename);
+void        pan_record_set_annots    (PanRecord *self, GListStore *annots);
+gboolean    pan_record_get_duplicate (PanRecord *self);
+void        pan_record_set_duplicate (PanRecord *self,
+                                      gboolean   duplicate);
+gboolean    pan_record_is_empty      (PanRecord *self);
+gboolean    pan_record_has_history   (PanRecord *self);
+guint       pan_record_copy_points   (PanRecord *self,
+                                      GArray    *points);
+void        pan_record_add_points    (PanRecord     *self,
+                                      const guint32 *xy,
+                                      guint          n_points);
+PanHistory *pan_record_get_history   (PanRecord *self);
+void        pan_record_account_memory (PanRecord       *self,
+                                       PanMemoryReport *report);
 
 G_END_DECLS
 
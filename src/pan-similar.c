@@ -0,0 +1,503 @@
+/*
+ * pan-similar.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Flags images that look the same as an earlier image of their document,
+ * such as the frames of a burst.
+ *
+ * Each image gets a 64-bit difference hash: it is decoded straight to at
+ * most SAMPLE_SIZE pixels a side, which the JPEG loader does by decoding
+ * at a fraction of the scale, then averaged down to 9 x 8 grey cells.
+ * Every bit tells whether a cell is darker than its right neighbour, so
+ * images that only differ in noise, exposure or compression have hashes a
+ * few bits apart.
+ *
+ * The hashes go into a BK-tree, a tree keyed on Hamming distance where a
+ * search within d bits of a hash only has to visit the children whose edge
+ * is within d of the node's distance to it.  Images are added in order,
+ * and one that finds an earlier image close enough is a duplicate of that
+ * image's group.
+ */
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "pan-similar.h"
+#include "pan-parallel.h"
+
+/* Images are decoded to at most this many pixels a side before hashing. */
+#define SAMPLE_SIZE 64
+
+#define HASH_WIDTH  9
+#define HASH_HEIGHT 8
+
+typedef struct
+{
+    guint64 hash;
+    guint item;
+    guint first_child;
+    guint next_sibling;
+    guint edge;
+} Node;
+
+struct _PanBkTree
+{
+    GArray *nodes;
+};
+
+typedef struct
+{
+    guint position;
+    gchar *name;
+    gchar *path;
+    guint64 hash;
+    gboolean hashed;
+} HashJob;
+
+typedef struct
+{
+    GPtrArray *jobs;
+    guint distance;
+    guint *groups;
+} Pass;
+
+static gpointer hash_job      (gpointer      item,
+                               gpointer      user_data,
+                               GError      **error);
+static void     hash_job_free (HashJob      *job);
+static void     pass_free     (Pass         *pass);
+static Pass    *pass_new      (PanDocument  *document,
+                               guint         distance);
+static void     pass_run      (Pass         *pass);
+static guint    pass_apply    (Pass         *pass,
+                               PanDocument  *document);
+static void     flag_thread   (GTask        *task,
+                               gpointer      source_object,
+                               gpointer      task_data,
+                               GCancellable *cancellable);
+
+/**
+ * pan_similar_hash_file:
+ * @hash: (out): the difference hash of the image at @path
+ *
+ * Returns: %TRUE if the image could be decoded
+ */
+gboolean
+pan_similar_hash_file (const gchar  *path,
+                       guint64      *hash,
+                       GError      **error)
+{
+    g_autoptr (GdkPixbuf) pixbuf = NULL;
+    guint32 sums[HASH_HEIGHT][HASH_WIDTH] = { { 0 } };
+    guint32 counts[HASH_HEIGHT][HASH_WIDTH] = { { 0 } };
+    guint32 grey[HASH_HEIGHT][HASH_WIDTH];
+    const guint8 *pixels, *row, *pixel;
+    gint width, height, stride, channels;
+    guint cx, cy;
+    guint64 bits = 0;
+
+    g_return_val_if_fail (path != NULL, FALSE);
+    g_return_val_if_fail (hash != NULL, FALSE);
+
+    pixbuf = gdk_pixbuf_new_from_file_at_size (path, SAMPLE_SIZE, SAMPLE_SIZE, error);
+    if (!pixbuf)
+        return FALSE;
+
+    width    = gdk_pixbuf_get_width (pixbuf);
+    height   = gdk_pixbuf_get_height (pixbuf);
+    stride   = gdk_pixbuf_get_rowstride (pixbuf);
+    channels = gdk_pixbuf_get_n_channels (pixbuf);
+    pixels   = gdk_pixbuf_read_pixels (pixbuf);
+
+    /* Box filter: every pixel is added to the cell it falls in. */
+    for (gint y = 0; y < height; y++) {
+        row = pixels + (gsize) y * stride;
+        cy  = (guint) y * HASH_HEIGHT / height;
+        for (gint x = 0; x < width; x++) {
+            pixel = row + x * channels;
+            cx = (guint) x * HASH_WIDTH / width;
+            sums[cy][cx]   += 77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2];
+            counts[cy][cx] += 1;
+        }
+    }
+
+    /* Images narrower than the grid leave cells empty; they take the left one. */
+    for (guint y = 0; y < HASH_HEIGHT; y++) {
+        for (guint x = 0; x < HASH_WIDTH; x++) {
+            if (counts[y][x] > 0)
+                grey[y][x] = sums[y][x] / counts[y][x];
+            else
+                grey[y][x] = x > 0 ? grey[y][x - 1] : y > 0 ? grey[y - 1][x] : 0;
+        }
+    }
+
+    for (guint y = 0; y < HASH_HEIGHT; y++) {
+        for (guint x = 0; x + 1 < HASH_WIDTH; x++)
+            bits = bits << 1 | (grey[y][x] < grey[y][x + 1]);
+    }
+
+    *hash = bits;
+
+    return TRUE;
+}
+
+guint
+pan_similar_distance (guint64 a,
+                      guint64 b)
+{
+    guint64 bits = a ^ b;
+
+    bits = bits - ((bits >> 1) & G_GUINT64_CONSTANT (0x5555555555555555));
+    bits = (bits & G_GUINT64_CONSTANT (0x3333333333333333)) +
+           ((bits >> 2) & G_GUINT64_CONSTANT (0x3333333333333333));
+    bits = (bits + (bits >> 4)) & G_GUINT64_CONSTANT (0x0f0f0f0f0f0f0f0f);
+
+    return (bits * G_GUINT64_CONSTANT (0x0101010101010101)) >> 56;
+}
+
+PanBkTree *
+pan_bk_tree_new (void)
+{
+    PanBkTree *self;
+
+    self = g_new0 (PanBkTree, 1);
+    self->nodes = g_array_new (FALSE, FALSE, sizeof (Node));
+
+    return self;
+}
+
+void
+pan_bk_tree_free (PanBkTree *self)
+{
+    g_return_if_fail (self != NULL);
+
+    g_array_unref (self->nodes);
+    g_free (self);
+}
+
+/* Children are kept in a list per node; index 0 is the root, so it ends one. */
+void
+pan_bk_tree_insert (PanBkTree *self,
+                    guint64    hash,
+                    guint      item)
+{
+    Node node = { .hash = hash, .item = item };
+    Node *parent;
+    guint current = 0, child, edge;
+
+    g_return_if_fail (self != NULL);
+
+    if (self->nodes->len == 0) {
+        g_array_append_val (self->nodes, node);
+        return;
+    }
+
+    for (;;) {
+        parent = &g_array_index (self->nodes, Node, current);
+        edge   = pan_similar_distance (parent->hash, hash);
+        for (child = parent->first_child; child != 0; child = g_array_index (self->nodes, Node, child).next_sibling) {
+            if (g_array_index (self->nodes, Node, child).edge == edge)
+                break;
+        }
+        if (child == 0)
+            break;
+        current = child;
+    }
+
+    node.edge         = edge;
+    node.next_sibling = parent->first_child;
+    parent->first_child = self->nodes->len;
+    g_array_append_val (self->nodes, node);
+}
+
+/**
+ * pan_bk_tree_query:
+ * @items: (element-type guint): where the items of the hashes within
+ *   @distance of @hash are appended
+ */
+void
+pan_bk_tree_query (PanBkTree *self,
+                   guint64    hash,
+                   guint      distance,
+                   GArray    *items)
+{
+    g_autoptr (GArray) stack = NULL;
+    const Node *node, *child;
+    guint current, d;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (items != NULL);
+
+    if (self->nodes->len == 0)
+        return;
+
+    stack = g_array_new (FALSE, FALSE, sizeof (guint));
+    current = 0;
+    g_array_append_val (stack, current);
+    while (stack->len > 0) {
+        current = g_array_index (stack, guint, stack->len - 1);
+        g_array_set_size (stack, stack->len - 1);
+
+        node = &g_array_index (self->nodes, Node, current);
+        d = pan_similar_distance (node->hash, hash);
+        if (d <= distance)
+            g_array_append_val (items, node->item);
+
+        for (guint c = node->first_child; c != 0; c = child->next_sibling) {
+            child = &g_array_index (self->nodes, Node, c);
+            if (child->edge + distance >= d && child->edge <= d + distance)
+                g_array_append_val (stack, c);
+        }
+    }
+}
+
+/**
+ * pan_similar_cluster:
+ * @hashes: (array length=n_hashes): difference hashes, %PAN_HASH_NONE
+ *   for images that could not be read
+ * @distance: how many bits two hashes may differ in
+ *
+ * Groups the hashes in order.  Each one joins the group of the earliest
+ * hash within @distance, or starts a group of its own.
+ *
+ * Returns: (transfer full) (array length=n_hashes): for each hash, the
+ *   first hash of its group, or %G_MAXUINT for images that were not read
+ */
+guint *
+pan_similar_cluster (const guint64 *hashes,
+                     guint          n_hashes,
+                     guint          distance)
+{
+    g_autoptr (PanBkTree) tree = NULL;
+    g_autoptr (GArray) found = NULL;
+    guint *groups;
+    guint first;
+
+    groups = g_new (guint, MAX (n_hashes, 1));
+    tree   = pan_bk_tree_new ();
+    found  = g_array_new (FALSE, FALSE, sizeof (guint));
+    for (guint i = 0; i < n_hashes; i++) {
+        groups[i] = G_MAXUINT;
+        if (hashes[i] == 0)
+            continue;
+
+        g_array_set_size (found, 0);
+        pan_bk_tree_query (tree, hashes[i], distance, found);
+
+        first = i;
+        for (guint j = 0; j < found->len; j++)
+            first = MIN (first, groups[g_array_index (found, guint, j)]);
+        groups[i] = first;
+
+        /* A group is represented by its first image only, so it cannot drift. */
+        if (first == i)
+            pan_bk_tree_insert (tree, hashes[i], i);
+    }
+
+    return groups;
+}
+
+static gpointer
+hash_job (gpointer   item,
+          gpointer   user_data,
+          GError   **error)
+{
+    HashJob *job = item;
+
+    job->hashed = pan_similar_hash_file (job->path, &job->hash, NULL);
+
+    return job;
+}
+
+static void
+hash_job_free (HashJob *job)
+{
+    g_free (job->name);
+    g_free (job->path);
+    g_free (job);
+}
+
+static Pass *
+pass_new (PanDocument *document,
+          guint        distance)
+{
+    PanRecordList *records;
+    const gchar *root;
+    HashJob *job;
+    Pass *pass;
+    guint n_records;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    root      = pan_document_get_root_path (document);
+
+    pass = g_new0 (Pass, 1);
+    pass->distance = distance;
+    pass->jobs     = g_ptr_array_new_with_free_func ((GDestroyNotify) hash_job_free);
+    for (guint i = 0; i < n_records; i++) {
+        job = g_new0 (HashJob, 1);
+        job->position = i;
+        job->name     = g_strdup (pan_record_list_get_filename (records, i));
+        job->path     = g_build_filename (root ? root : ".", job->name, NULL);
+        g_ptr_array_add (pass->jobs, job);
+    }
+
+    return pass;
+}
+
+static void
+pass_free (Pass *pass)
+{
+    g_ptr_array_unref (pass->jobs);
+    g_free (pass->groups);
+    g_free (pass);
+}
+
+/* Safe to run on any thread; it only touches the pass. */
+static void
+pass_run (Pass *pass)
+{
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+    g_autofree guint64 *hashes = NULL;
+    HashJob *job;
+    guint n = pass->jobs->len;
+
+    if (n == 0)
+        return;
+
+    results = g_new0 (gpointer, n);
+    errors  = g_new0 (GError *, n);
+    pan_parallel_map (pass->jobs->pdata, n, hash_job, NULL, results, errors);
+
+    /* Zero is kept for unreadable images; a flat image that hashes to it is moved. */
+    hashes = g_new (guint64, n);
+    for (guint i = 0; i < n; i++) {
+        job = g_ptr_array_index (pass->jobs, i);
+        hashes[i] = !job->hashed ? 0 : job->hash ? job->hash : 1;
+    }
+
+    pass->groups = pan_similar_cluster (hashes, n, pass->distance);
+}
+
+/* Records renamed in the meantime keep their flags. */
+static guint
+pass_apply (Pass        *pass,
+            PanDocument *document)
+{
+    PanRecordList *records;
+    PanRecordFlags flags;
+    HashJob *job;
+    guint n_records, n_flagged = 0;
+
+    if (!pass->groups)
+        return 0;
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    for (guint i = 0; i < pass->jobs->len; i++) {
+        job = g_ptr_array_index (pass->jobs, i);
+        if (job->position >= n_records ||
+            g_strcmp0 (pan_record_list_get_filename (records, job->position), job->name))
+            continue;
+
+        flags = pan_record_list_get_flags (records, job->position) & ~PAN_RECORD_DUPLICATE;
+        if (pass->groups[i] != G_MAXUINT && pass->groups[i] != i) {
+            flags |= PAN_RECORD_DUPLICATE;
+            n_flagged++;
+        }
+        pan_record_list_set_flags (records, job->position, flags);
+    }
+
+    return n_flagged;
+}
+
+/**
+ * pan_similar_flag:
+ * @distance: how many of the 64 bits two images may differ in
+ *
+ * Hashes every image of @document on all cores and flags each image that
+ * looks like an earlier one with %PAN_RECORD_DUPLICATE.  The flags of the
+ * other images are cleared.
+ *
+ * Returns: the number of images flagged
+ */
+guint
+pan_similar_flag (PanDocument *document,
+                  guint        distance)
+{
+    Pass *pass;
+    guint n_flagged;
+
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), 0);
+
+    pass = pass_new (document, distance);
+    pass_run (pass);
+    n_flagged = pass_apply (pass, document);
+    pass_free (pass);
+
+    return n_flagged;
+}
+
+static void
+flag_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+    pass_run (task_data);
+    g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * pan_similar_flag_async:
+ *
+ * Like pan_similar_flag(), but decodes the images on a thread.  The flags
+ * are set when the operation is finished.
+ */
+void
+pan_similar_flag_async (PanDocument         *document,
+                        guint                distance,
+                        GCancellable        *cancellable,
+                        GAsyncReadyCallback  callback,
+                        gpointer             user_data)
+{
+    g_autoptr (GTask) task = NULL;
+
+    g_return_if_fail (PAN_IS_DOCUMENT (document));
+
+    task = g_task_new (document, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_similar_flag_async);
+    g_task_set_task_data (task, pass_new (document, distance), (GDestroyNotify) pass_free);
+    g_task_run_in_thread (task, flag_thread);
+}
+
+guint
+pan_similar_flag_finish (PanDocument   *document,
+                         GAsyncResult  *result,
+                         GError       **error)
+{
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), 0);
+    g_return_val_if_fail (g_task_is_valid (result, document), 0);
+
+    if (!g_task_propagate_boolean (G_TASK (result), error))
+        return 0;
+
+    return pass_apply (g_task_get_task_data (G_TASK (result)), document);
+}
@@ -0,0 +1,62 @@
+/*
+ * pan-similar.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include "pan-document.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PanBkTree PanBkTree;
+
+gboolean   pan_similar_hash_file     (const gchar          *path,
+                                      guint64              *hash,
+                                      GError              **error);
+guint      pan_similar_distance      (guint64               a,
+                                      guint64               b);
+guint     *pan_similar_cluster       (const guint64        *hashes,
+                                      guint                 n_hashes,
+                                      guint                 distance);
+guint      pan_similar_flag          (PanDocument          *document,
+                                      guint                 distance);
+void       pan_similar_flag_async    (PanDocument          *document,
+                                      guint                 distance,
+                                      GCancellable         *cancellable,
+                                      GAsyncReadyCallback   callback,
+                                      gpointer              user_data);
+guint      pan_similar_flag_finish   (PanDocument          *document,
+                                      GAsyncResult         *result,
+                                      GError              **error);
+
+PanBkTree *pan_bk_tree_new           (void);
+void       pan_bk_tree_free          (PanBkTree            *self);
+void       pan_bk_tree_insert        (PanBkTree            *self,
+                                      guint64               hash,
+                                      guint                 item);
+void       pan_bk_tree_query         (PanBkTree            *self,
+                                      guint64               hash,
+                                      guint                 distance,
+                                      GArray               *items);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanBkTree, pan_bk_tree_free)
+
+G_END_DECLS
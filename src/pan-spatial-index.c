@@ -0,0 +1,400 @@
+/*
+ * pan-spatial-index.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * A uniform grid over the annotations of one record, used for hit testing
+ * and for box and lasso selection.
+ *
+ * The grid is stored in compressed form: the entries are sorted by cell,
+ * and cell_start[c] is the index of the first entry of cell c, so a cell is
+ * the range [cell_start[c], cell_start[c + 1]).  Building it is two passes
+ * over the store and a query only looks at the cells it overlaps.
+ *
+ * The index does not follow the store.  It is marked stale whenever the
+ * annotations change and rebuilt on the next query.
+ */
+
+#include "pan-spatial-index.h"
+#include "pan-annot.h"
+
+#define CELL_SIZE 64
+#define MAX_CELLS 1024
+
+typedef struct
+{
+    guint32 x;
+    guint32 y;
+    guint32 pos;
+} Entry;
+
+struct _PanSpatialIndex
+{
+    GListModel *annots;
+    gboolean stale;
+
+    guint cell_width;
+    guint cell_height;
+    guint n_cols;
+    guint n_rows;
+
+    guint32 *cell_start;
+    Entry *entries;
+    guint n_entries;
+};
+
+static void     rebuild          (PanSpatialIndex *self);
+static void     ensure_built     (PanSpatialIndex *self);
+static gboolean clip_cells       (PanSpatialIndex *self,
+                                  guint            x0,
+                                  guint            y0,
+                                  guint            x1,
+                                  guint            y1,
+                                  guint           *col0,
+                                  guint           *row0,
+                                  guint           *col1,
+                                  guint           *row1);
+static gboolean point_in_polygon (const graphene_point_t *points,
+                                  guint                   n_points,
+                                  gfloat                  x,
+                                  gfloat                  y);
+
+static void
+rebuild (PanSpatialIndex *self)
+{
+    Entry *unsorted;
+    gpointer annot;
+    guint max_x = 0, max_y = 0;
+    guint n_cells;
+    guint cell;
+    guint n;
+
+    g_clear_pointer (&self->cell_start, g_free);
+    g_clear_pointer (&self->entries, g_free);
+    self->n_entries = 0;
+    self->n_cols    = 0;
+    self->n_rows    = 0;
+    self->stale     = FALSE;
+
+    if (!self->annots)
+        return;
+
+    n = g_list_model_get_n_items (self->annots);
+    if (n == 0)
+        return;
+
+    unsorted = g_new (Entry, n);
+    for (guint i = 0; i < n; i++) {
+        annot = g_list_model_get_item (self->annots, i);
+        unsorted[i].x   = pan_annot_x (annot);
+        unsorted[i].y   = pan_annot_y (annot);
+        unsorted[i].pos = i;
+        max_x = MAX (max_x, unsorted[i].x);
+        max_y = MAX (max_y, unsorted[i].y);
+        g_object_unref (annot);
+    }
+
+    /* Grow the cells rather than the grid for very large coordinates. */
+    self->cell_width  = MAX (CELL_SIZE, max_x / MAX_CELLS + 1);
+    self->cell_height = MAX (CELL_SIZE, max_y / MAX_CELLS + 1);
+    self->n_cols      = max_x / self->cell_width + 1;
+    self->n_rows      = max_y / self->cell_height + 1;
+    n_cells = self->n_cols * self->n_rows;
+
+    self->cell_start = g_new0 (guint32, n_cells + 1);
+    for (guint i = 0; i < n; i++) {
+        cell = (unsorted[i].y / self->cell_height) * self->n_cols + unsorted[i].x / self->cell_width;
+        self->cell_start[cell + 1]++;
+    }
+    for (guint c = 0; c < n_cells; c++)
+        self->cell_start[c + 1] += self->cell_start[c];
+
+    /* Scatter in store order, so entries within a cell stay sorted. */
+    self->entries = g_new (Entry, n);
+    for (guint i = 0; i < n; i++) {
+        cell = (unsorted[i].y / self->cell_height) * self->n_cols + unsorted[i].x / self->cell_width;
+        self->entries[self->cell_start[cell]++] = unsorted[i];
+    }
+    for (guint c = n_cells; c > 0; c--)
+        self->cell_start[c] = self->cell_start[c - 1];
+    self->cell_start[0] = 0;
+
+    self->n_entries = n;
+    g_free (unsorted);
+}
+
+static void
+ensure_built (PanSpatialIndex *self)
+{
+    if (self->stale)
+        rebuild (self);
+}
+
+static gboolean
+clip_cells (PanSpatialIndex *self,
+            guint            x0,
+            guint            y0,
+            guint            x1,
+            guint            y1,
+            guint           *col0,
+            guint           *row0,
+            guint           *col1,
+            guint           *row1)
+{
+    if (self->n_entries == 0 || x0 > x1 || y0 > y1)
+        return FALSE;
+
+    *col0 = x0 / self->cell_width;
+    *row0 = y0 / self->cell_height;
+    if (*col0 >= self->n_cols || *row0 >= self->n_rows)
+        return FALSE;
+
+    *col1 = MIN (x1 / self->cell_width, self->n_cols - 1);
+    *row1 = MIN (y1 / self->cell_height, self->n_rows - 1);
+
+    return TRUE;
+}
+
+/* Even-odd rule, points on the boundary may fall either way. */
+static gboolean
+point_in_polygon (const graphene_point_t *points,
+                  guint                   n_points,
+                  gfloat                  x,
+                  gfloat                  y)
+{
+    gboolean inside = FALSE;
+    const graphene_point_t *a, *b;
+
+    for (guint i = 0, j = n_points - 1; i < n_points; j = i++) {
+        a = &points[i];
+        b = &points[j];
+        if ((a->y > y) != (b->y > y) &&
+            x < (b->x - a->x) * (y - a->y) / (b->y - a->y) + a->x)
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+PanSpatialIndex *
+pan_spatial_index_new (void)
+{
+    return g_new0 (PanSpatialIndex, 1);
+}
+
+void
+pan_spatial_index_free (PanSpatialIndex *self)
+{
+    if (!self)
+        return;
+
+    g_clear_object (&self->annots);
+    g_free (self->cell_start);
+    g_free (self->entries);
+    g_free (self);
+}
+
+gsize
+pan_spatial_index_get_size (PanSpatialIndex *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    if (!self->cell_start)
+        return sizeof (PanSpatialIndex);
+
+    return sizeof (PanSpatialIndex) +
+           (self->n_cols * self->n_rows + 1) * sizeof (guint32) +
+           self->n_entries * sizeof (Entry);
+}
+
+/**
+ * pan_spatial_index_set_model:
+ * @self: a #PanSpatialIndex
+ * @annots: (nullable): a list of #PanAnnot
+ *
+ * Makes @self index @annots.  The grid is built on the first query.
+ */
+void
+pan_spatial_index_set_model (PanSpatialIndex *self,
+                             GListModel      *annots)
+{
+    g_return_if_fail (self != NULL);
+
+    g_set_object (&self->annots, annots);
+    self->stale = TRUE;
+}
+
+/**
+ * pan_spatial_index_invalidate:
+ *
+ * Tells @self that annotations were added, removed or moved.
+ */
+void
+pan_spatial_index_invalidate (PanSpatialIndex *self)
+{
+    g_return_if_fail (self != NULL);
+
+    self->stale = TRUE;
+}
+
+/**
+ * pan_spatial_index_pick:
+ *
+ * Finds the annotation closest to (@x, @y) that is no further than
+ * @radius away.
+ *
+ * Returns: its position, or %GTK_INVALID_LIST_POSITION
+ */
+guint
+pan_spatial_index_pick (PanSpatialIndex *self,
+                        guint            x,
+                        guint            y,
+                        guint            radius)
+{
+    guint col0, row0, col1, row1;
+    guint best = GTK_INVALID_LIST_POSITION;
+    guint64 best_dist, dist;
+    gint64 dx, dy;
+    const Entry *entry;
+
+    g_return_val_if_fail (self != NULL, GTK_INVALID_LIST_POSITION);
+
+    ensure_built (self);
+    if (!clip_cells (self, x > radius ? x - radius : 0, y > radius ? y - radius : 0,
+                     x + radius, y + radius, &col0, &row0, &col1, &row1))
+        return GTK_INVALID_LIST_POSITION;
+
+    best_dist = (guint64) radius * radius;
+    for (guint row = row0; row <= row1; row++) {
+        for (guint col = col0; col <= col1; col++) {
+            guint cell = row * self->n_cols + col;
+
+            for (guint i = self->cell_start[cell]; i < self->cell_start[cell + 1]; i++) {
+                entry = &self->entries[i];
+                dx = (gint64) entry->x - x;
+                dy = (gint64) entry->y - y;
+                dist = dx * dx + dy * dy;
+                if (dist < best_dist || (dist == best_dist && entry->pos < best)) {
+                    best_dist = dist;
+                    best = entry->pos;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+/**
+ * pan_spatial_index_query_rect:
+ * @result: the set the positions are added to
+ *
+ * Adds the positions of all annotations inside the rectangle from
+ * (@x0, @y0) to (@x1, @y1), both inclusive, to @result.
+ *
+ * Returns: the number of entries looked at in the overlapping cells
+ */
+guint
+pan_spatial_index_query_rect (PanSpatialIndex *self,
+                              guint            x0,
+                              guint            y0,
+                              guint            x1,
+                              guint            y1,
+                              GtkBitset       *result)
+{
+    guint col0, row0, col1, row1;
+    const Entry *entry;
+    guint visited = 0;
+
+    g_return_val_if_fail (self != NULL, 0);
+    g_return_val_if_fail (result != NULL, 0);
+
+    ensure_built (self);
+    if (!clip_cells (self, x0, y0, x1, y1, &col0, &row0, &col1, &row1))
+        return 0;
+
+    for (guint row = row0; row <= row1; row++) {
+        for (guint col = col0; col <= col1; col++) {
+            guint cell = row * self->n_cols + col;
+
+            visited += self->cell_start[cell + 1] - self->cell_start[cell];
+            for (guint i = self->cell_start[cell]; i < self->cell_start[cell + 1]; i++) {
+                entry = &self->entries[i];
+                if (entry->x >= x0 && entry->x <= x1 && entry->y >= y0 && entry->y <= y1)
+                    gtk_bitset_add (result, entry->pos);
+            }
+        }
+    }
+
+    return visited;
+}
+
+/**
+ * pan_spatial_index_query_polygon:
+ * @points: (array length=n_points): the outline, implicitly closed
+ * @result: the set the positions are added to
+ *
+ * Adds the positions of all annotations inside the polygon to @result.
+ * Only the cells under its bounding box are looked at.
+ */
+void
+pan_spatial_index_query_polygon (PanSpatialIndex        *self,
+                                 const graphene_point_t *points,
+                                 guint                   n_points,
+                                 GtkBitset              *result)
+{
+    gfloat min_x, min_y, max_x, max_y;
+    guint col0, row0, col1, row1;
+    const Entry *entry;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (result != NULL);
+
+    if (n_points < 3)
+        return;
+
+    min_x = max_x = points[0].x;
+    min_y = max_y = points[0].y;
+    for (guint i = 1; i < n_points; i++) {
+        min_x = MIN (min_x, points[i].x);
+        min_y = MIN (min_y, points[i].y);
+        max_x = MAX (max_x, points[i].x);
+        max_y = MAX (max_y, points[i].y);
+    }
+    if (max_x < 0 || max_y < 0)
+        return;
+
+    ensure_built (self);
+    if (!clip_cells (self, MAX (min_x, 0), MAX (min_y, 0), max_x, max_y,
+                     &col0, &row0, &col1, &row1))
+        return;
+
+    for (guint row = row0; row <= row1; row++) {
+        for (guint col = col0; col <= col1; col++) {
+            guint cell = row * self->n_cols + col;
+
+            for (guint i = self->cell_start[cell]; i < self->cell_start[cell + 1]; i++) {
+                entry = &self->entries[i];
+                if (point_in_polygon (points, n_points, entry->x, entry->y))
+                    gtk_bitset_add (result, entry->pos);
+            }
+        }
+    }
+}
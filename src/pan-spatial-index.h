@@ -0,0 +1,53 @@
+/*
+ * pan-spatial-index.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PanSpatialIndex PanSpatialIndex;
+
+PanSpatialIndex *pan_spatial_index_new           (void);
+void             pan_spatial_index_free          (PanSpatialIndex *self);
+void             pan_spatial_index_set_model     (PanSpatialIndex *self,
+                                                  GListModel      *annots);
+void             pan_spatial_index_invalidate    (PanSpatialIndex *self);
+gsize            pan_spatial_index_get_size      (PanSpatialIndex *self);
+guint            pan_spatial_index_pick          (PanSpatialIndex *self,
+                                                  guint            x,
+                                                  guint            y,
+                                                  guint            radius);
+guint            pan_spatial_index_query_rect    (PanSpatialIndex *self,
+                                                  guint            x0,
+                                                  guint            y0,
+                                                  guint            x1,
+                                                  guint            y1,
+                                                  GtkBitset       *result);
+void             pan_spatial_index_query_polygon (PanSpatialIndex        *self,
+                                                  const graphene_point_t *points,
+                                                  guint                   n_points,
+                                                  GtkBitset              *result);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanSpatialIndex, pan_spatial_index_free)
+
+G_END_DECLS
@@ -0,0 +1,721 @@
+/*
+ * pan-stats.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Per-image summaries of a document, for the statistics dialog and
+ * --stats.  Summaries are computed on the worker pool and kept until the
+ * record they describe is edited, so after the first pass only the images
+ * touched since are looked at again.
+ *
+ * A complete set is written to a cache file next to the other caches
+ * whenever the document is saved.  It is keyed by the path of the
+ * document and only trusted while the file still has the modification
+ * time and size it had then, so reopening an unchanged document needs
+ * neither its images nor, from the command line, the document itself.
+ * All integers in the cache are little endian:
+ *
+ *   "PANS" version mtime:64 size:64 n_records
+ *   { name_len name summary } * n_records
+ *
+ * where a summary is its 32-bit fields in order.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <json-glib/json-glib.h>
+#include "pan-stats.h"
+#include "pan-document.h"
+#include "pan-parallel.h"
+
+#define MAGIC   "PANS"
+#define VERSION 1
+
+#define N_FIELDS (sizeof (PanRecordSummary) / sizeof (guint32))
+
+struct _PanStats
+{
+    GPtrArray *names;
+    GArray *summaries;
+    GByteArray *fresh;
+    GArray *stamps;
+    guint n_fresh;
+};
+
+typedef struct
+{
+    guint position;
+    guint32 stamp;
+    gchar *path;
+    GArray *points;
+    PanRecordSummary summary;
+} Job;
+
+struct _PanStatsPass
+{
+    GPtrArray *jobs;
+};
+
+static void      job_free       (Job         *job);
+static gpointer  summarize      (gpointer     item,
+                                 gpointer     user_data,
+                                 GError     **error);
+static void      resize         (PanStats    *self,
+                                 guint        n_records);
+static gchar    *cache_path     (const gchar *path);
+static gboolean  file_signature (const gchar *path,
+                                 gint64      *mtime,
+                                 gint64      *size);
+
+static void
+job_free (Job *job)
+{
+    g_free (job->path);
+    g_array_unref (job->points);
+    g_free (job);
+}
+
+/* Points past the edges of the image, or of an unreadable one, widen the grid. */
+static gpointer
+summarize (gpointer   item,
+           gpointer   user_data,
+           GError   **error)
+{
+    Job *job = item;
+    PanRecordSummary *summary = &job->summary;
+    const guint32 *xy = (const guint32 *) job->points->data;
+    guint n = job->points->len / 2;
+    guint64 extent_x, extent_y;
+    gint width, height;
+    guint col, row;
+
+    memset (summary, 0, sizeof *summary);
+    summary->n_points = n;
+    if (job->path && gdk_pixbuf_get_file_info (job->path, &width, &height)) {
+        summary->width  = width;
+        summary->height = height;
+    }
+    if (n == 0)
+        return job;
+
+    summary->min_x = summary->min_y = G_MAXUINT32;
+    for (guint i = 0; i < n; i++) {
+        summary->min_x = MIN (summary->min_x, xy[2 * i]);
+        summary->min_y = MIN (summary->min_y, xy[2 * i + 1]);
+        summary->max_x = MAX (summary->max_x, xy[2 * i]);
+        summary->max_y = MAX (summary->max_y, xy[2 * i + 1]);
+    }
+
+    extent_x = MAX ((guint64) summary->width, (guint64) summary->max_x + 1);
+    extent_y = MAX ((guint64) summary->height, (guint64) summary->max_y + 1);
+    for (guint i = 0; i < n; i++) {
+        col = xy[2 * i] * (guint64) PAN_STATS_GRID / extent_x;
+        row = xy[2 * i + 1] * (guint64) PAN_STATS_GRID / extent_y;
+        summary->grid[row * PAN_STATS_GRID + col]++;
+    }
+
+    return job;
+}
+
+static void
+resize (PanStats *self,
+        guint     n_records)
+{
+    guint old = self->fresh->len;
+
+    if (n_records == old)
+        return;
+
+    for (guint i = n_records; i < old; i++)
+        self->n_fresh -= self->fresh->data[i];
+
+    g_ptr_array_set_size (self->names, n_records);
+    g_array_set_size (self->summaries, n_records);
+    g_byte_array_set_size (self->fresh, n_records);
+    g_array_set_size (self->stamps, n_records);
+    if (n_records > old)
+        memset (self->fresh->data + old, 0, n_records - old);
+}
+
+static gchar *
+cache_path (const gchar *path)
+{
+    g_autofree gchar *canonical = NULL;
+    g_autofree gchar *checksum = NULL;
+    g_autofree gchar *basename = NULL;
+
+    canonical = g_canonicalize_filename (path, NULL);
+    checksum  = g_compute_checksum_for_string (G_CHECKSUM_SHA1, canonical, -1);
+    basename  = g_strconcat (checksum, ".stats", NULL);
+
+    return g_build_filename (g_get_user_cache_dir (), "pan", "stats", basename, NULL);
+}
+
+static gboolean
+file_signature (const gchar *path,
+                gint64      *mtime,
+                gint64      *size)
+{
+    GStatBuf buf;
+
+    if (g_stat (path, &buf) != 0)
+        return FALSE;
+
+    *mtime = buf.st_mtime;
+    *size  = buf.st_size;
+
+    return TRUE;
+}
+
+PanStats *
+pan_stats_new (void)
+{
+    PanStats *self;
+
+    self = g_new0 (PanStats, 1);
+    self->names     = g_ptr_array_new_with_free_func (g_free);
+    self->summaries = g_array_new (FALSE, TRUE, sizeof (PanRecordSummary));
+    self->fresh     = g_byte_array_new ();
+    self->stamps    = g_array_new (FALSE, TRUE, sizeof (guint32));
+
+    return self;
+}
+
+void
+pan_stats_free (PanStats *self)
+{
+    if (!self)
+        return;
+
+    g_ptr_array_unref (self->names);
+    g_array_unref (self->summaries);
+    g_byte_array_unref (self->fresh);
+    g_array_unref (self->stamps);
+    g_free (self);
+}
+
+/**
+ * pan_stats_invalidate:
+ *
+ * Tells @self that the points of the record at @position changed.  Its
+ * summary is recomputed on the next pan_stats_update(), and a summary
+ * still being computed by a pass is dropped when the pass finishes.
+ */
+void
+pan_stats_invalidate (PanStats *self,
+                      guint     position)
+{
+    g_return_if_fail (self != NULL);
+
+    if (position >= self->fresh->len)
+        return;
+
+    g_array_index (self->stamps, guint32, position)++;
+    if (!self->fresh->data[position])
+        return;
+
+    self->fresh->data[position] = FALSE;
+    self->n_fresh--;
+}
+
+/**
+ * pan_stats_begin:
+ *
+ * Copies the points of every record of @document that has no summary
+ * yet, so that they can be summarized away from the main thread with
+ * pan_stats_pass_run().
+ *
+ * Returns: (transfer full) (nullable): the pass, or %NULL if every
+ *   record has a summary
+ */
+PanStatsPass *
+pan_stats_begin (PanStats    *self,
+                 PanDocument *document)
+{
+    PanStatsPass *pass;
+    PanRecordList *records;
+    const gchar *root, *name;
+    guint n_records;
+    Job *job;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (PAN_IS_DOCUMENT (document), NULL);
+
+    records   = pan_document_records (document);
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (records));
+    resize (self, n_records);
+    if (self->n_fresh == n_records)
+        return NULL;
+
+    root = pan_document_get_root_path (document);
+    pass = g_new0 (PanStatsPass, 1);
+    pass->jobs = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+    for (guint i = 0; i < n_records; i++) {
+        if (self->fresh->data[i])
+            continue;
+
+        name = pan_record_list_get_filename (records, i);
+        if (g_strcmp0 (g_ptr_array_index (self->names, i), name) != 0) {
+            g_free (g_ptr_array_index (self->names, i));
+            g_ptr_array_index (self->names, i) = g_strdup (name);
+        }
+
+        job = g_new0 (Job, 1);
+        job->position = i;
+        job->stamp    = g_array_index (self->stamps, guint32, i);
+        job->path     = root && *root ? g_build_filename (root, name, NULL) : NULL;
+        job->points   = g_array_new (FALSE, FALSE, sizeof (guint32));
+        pan_record_list_copy_points (records, i, job->points);
+
+        g_ptr_array_add (pass->jobs, job);
+    }
+
+    return pass;
+}
+
+/**
+ * pan_stats_pass_run:
+ * @parallel: whether to use the worker pool, %FALSE when the caller
+ *   already runs on it
+ *
+ * Computes the summaries of @pass, which also reads the size of each
+ * image from its header.  It does not touch the document and can run on
+ * any thread.
+ */
+void
+pan_stats_pass_run (PanStatsPass *pass,
+                    gboolean      parallel)
+{
+    g_autofree gpointer *results = NULL;
+    g_autofree GError **errors = NULL;
+
+    g_return_if_fail (pass != NULL);
+
+    /* Summarizing cannot fail; an unreadable image only lacks a size. */
+    if (parallel) {
+        results = g_new0 (gpointer, pass->jobs->len);
+        errors  = g_new0 (GError *, pass->jobs->len);
+        pan_parallel_map (pass->jobs->pdata, pass->jobs->len, summarize, NULL, results, errors);
+    } else {
+        for (guint i = 0; i < pass->jobs->len; i++)
+            summarize (g_ptr_array_index (pass->jobs, i), NULL, NULL);
+    }
+}
+
+/**
+ * pan_stats_finish:
+ *
+ * Stores the summaries computed by @pass.  Those of records invalidated
+ * or removed since pan_stats_begin() are dropped.
+ */
+void
+pan_stats_finish (PanStats     *self,
+                  PanStatsPass *pass)
+{
+    Job *job;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (pass != NULL);
+
+    for (guint i = 0; i < pass->jobs->len; i++) {
+        job = g_ptr_array_index (pass->jobs, i);
+        if (job->position >= self->fresh->len ||
+            self->fresh->data[job->position] ||
+            g_array_index (self->stamps, guint32, job->position) != job->stamp)
+            continue;
+
+        g_array_index (self->summaries, PanRecordSummary, job->position) = job->summary;
+        self->fresh->data[job->position] = TRUE;
+        self->n_fresh++;
+    }
+}
+
+void
+pan_stats_pass_free (PanStatsPass *pass)
+{
+    if (!pass)
+        return;
+
+    g_ptr_array_unref (pass->jobs);
+    g_free (pass);
+}
+
+/**
+ * pan_stats_update:
+ * @parallel: whether to use the worker pool, %FALSE when the caller
+ *   already runs on it
+ *
+ * Summarizes every record of @document that has no summary yet.
+ */
+void
+pan_stats_update (PanStats    *self,
+                  PanDocument *document,
+                  gboolean     parallel)
+{
+    g_autoptr (PanStatsPass) pass = NULL;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (PAN_IS_DOCUMENT (document));
+
+    pass = pan_stats_begin (self, document);
+    if (!pass)
+        return;
+
+    pan_stats_pass_run (pass, parallel);
+    pan_stats_finish (self, pass);
+}
+
+gboolean
+pan_stats_is_complete (PanStats *self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    return self->n_fresh == self->fresh->len;
+}
+
+guint
+pan_stats_get_n_records (PanStats *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->fresh->len;
+}
+
+const gchar *
+pan_stats_get_filename (PanStats *self,
+                        guint     position)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (position < self->names->len, NULL);
+
+    return g_ptr_array_index (self->names, position);
+}
+
+/**
+ * pan_stats_get_summary:
+ *
+ * Returns: (nullable): the summary of the record at @position, or %NULL
+ *   if it changed since the last update
+ */
+const PanRecordSummary *
+pan_stats_get_summary (PanStats *self,
+                       guint     position)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (position < self->fresh->len, NULL);
+
+    if (!self->fresh->data[position])
+        return NULL;
+
+    return &g_array_index (self->summaries, PanRecordSummary, position);
+}
+
+/**
+ * pan_stats_get_totals:
+ *
+ * Adds up the summaries.  The grids are summed cell by cell, which gives
+ * where in the frame points tend to be across images of any size.
+ */
+void
+pan_stats_get_totals (PanStats       *self,
+                      PanStatsTotals *totals)
+{
+    const PanRecordSummary *summary;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (totals != NULL);
+
+    memset (totals, 0, sizeof *totals);
+    totals->n_records  = self->fresh->len;
+    totals->min_points = self->fresh->len > 0 ? G_MAXUINT : 0;
+    for (guint i = 0; i < self->fresh->len; i++) {
+        summary = pan_stats_get_summary (self, i);
+        if (!summary)
+            continue;
+
+        totals->n_annotated += summary->n_points > 0;
+        totals->n_points    += summary->n_points;
+        totals->min_points   = MIN (totals->min_points, summary->n_points);
+        totals->max_points   = MAX (totals->max_points, summary->n_points);
+        for (guint c = 0; c < PAN_STATS_GRID * PAN_STATS_GRID; c++)
+            totals->grid[c] += summary->grid[c];
+    }
+    if (totals->min_points == G_MAXUINT)
+        totals->min_points = 0;
+}
+
+/**
+ * pan_stats_to_json:
+ * @document: (nullable): the path reported as "document"
+ *
+ * Returns: (transfer full): the totals followed by one entry per image
+ */
+gchar *
+pan_stats_to_json (PanStats    *self,
+                   const gchar *document)
+{
+    g_autoptr (JsonBuilder) builder = NULL;
+    g_autoptr (JsonGenerator) generator = NULL;
+    g_autoptr (JsonNode) root = NULL;
+    const PanRecordSummary *summary;
+    PanStatsTotals totals;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    pan_stats_get_totals (self, &totals);
+
+    builder = json_builder_new ();
+    json_builder_begin_object (builder);
+    if (document) {
+        json_builder_set_member_name (builder, "document");
+        json_builder_add_string_value (builder, document);
+    }
+    json_builder_set_member_name (builder, "images");
+    json_builder_add_int_value (builder, totals.n_records);
+    json_builder_set_member_name (builder, "annotated");
+    json_builder_add_int_value (builder, totals.n_annotated);
+    json_builder_set_member_name (builder, "points");
+    json_builder_add_int_value (builder, totals.n_points);
+    json_builder_set_member_name (builder, "min_points");
+    json_builder_add_int_value (builder, totals.min_points);
+    json_builder_set_member_name (builder, "max_points");
+    json_builder_add_int_value (builder, totals.max_points);
+    json_builder_set_member_name (builder, "grid");
+    json_builder_begin_array (builder);
+    for (guint c = 0; c < PAN_STATS_GRID * PAN_STATS_GRID; c++)
+        json_builder_add_int_value (builder, totals.grid[c]);
+    json_builder_end_array (builder);
+
+    json_builder_set_member_name (builder, "per_image");
+    json_builder_begin_array (builder);
+    for (guint i = 0; i < self->fresh->len; i++) {
+        summary = pan_stats_get_summary (self, i);
+        if (!summary)
+            continue;
+
+        json_builder_begin_object (builder);
+        json_builder_set_member_name (builder, "filename");
+        json_builder_add_string_value (builder, pan_stats_get_filename (self, i));
+        json_builder_set_member_name (builder, "points");
+        json_builder_add_int_value (builder, summary->n_points);
+        if (summary->width > 0) {
+            json_builder_set_member_name (builder, "size");
+            json_builder_begin_array (builder);
+            json_builder_add_int_value (builder, summary->width);
+            json_builder_add_int_value (builder, summary->height);
+            json_builder_end_array (builder);
+        }
+        if (summary->n_points > 0) {
+            json_builder_set_member_name (builder, "bbox");
+            json_builder_begin_array (builder);
+            json_builder_add_int_value (builder, summary->min_x);
+            json_builder_add_int_value (builder, summary->min_y);
+            json_builder_add_int_value (builder, summary->max_x);
+            json_builder_add_int_value (builder, summary->max_y);
+            json_builder_end_array (builder);
+        }
+        json_builder_end_object (builder);
+    }
+    json_builder_end_array (builder);
+    json_builder_end_object (builder);
+
+    root = json_builder_get_root (builder);
+    generator = json_generator_new ();
+    json_generator_set_root (generator, root);
+
+    return json_generator_to_data (generator, NULL);
+}
+
+/**
+ * pan_stats_to_string:
+ *
+ * Returns: (transfer full): the totals and the summed grid as shaded
+ *   blocks, for a monospace font
+ */
+gchar *
+pan_stats_to_string (PanStats *self)
+{
+    static const gchar *shades[] = { "·", "░", "▒", "▓", "█" };
+    PanStatsTotals totals;
+    GString *string;
+    guint64 peak = 0;
+    guint shade;
+
+    g_return_val_if_fail (self != NULL, NULL);
+
+    pan_stats_get_totals (self, &totals);
+    for (guint c = 0; c < PAN_STATS_GRID * PAN_STATS_GRID; c++)
+        peak = MAX (peak, totals.grid[c]);
+
+    string = g_string_new (NULL);
+    g_string_append_printf (string, "%-12s %u\n", "Images", totals.n_records);
+    g_string_append_printf (string, "%-12s %u (%.1f%%)\n", "Annotated", totals.n_annotated,
+                            totals.n_records ? 100.0 * totals.n_annotated / totals.n_records : 0.0);
+    g_string_append_printf (string, "%-12s %" G_GUINT64_FORMAT "\n", "Points", totals.n_points);
+    g_string_append_printf (string, "%-12s %u / %.1f / %u\n", "Min/mean/max",
+                            totals.min_points,
+                            totals.n_records ? (gdouble) totals.n_points / totals.n_records : 0.0,
+                            totals.max_points);
+
+    g_string_append_c (string, '\n');
+    for (guint row = 0; row < PAN_STATS_GRID; row++) {
+        for (guint col = 0; col < PAN_STATS_GRID; col++) {
+            shade = peak ? (guint) ((totals.grid[row * PAN_STATS_GRID + col] * 4 + peak - 1) / peak) : 0;
+            g_string_append (string, shades[shade]);
+            g_string_append (string, shades[shade]);
+        }
+        g_string_append_c (string, '\n');
+    }
+
+    return g_string_free (string, FALSE);
+}
+
+/**
+ * pan_stats_load_cache:
+ * @path: the document file
+ *
+ * Returns: (transfer full) (nullable): the summaries cached for @path,
+ *   or %NULL if there are none or the file changed since
+ */
+PanStats *
+pan_stats_load_cache (const gchar *path)
+{
+    g_autoptr (GMappedFile) file = NULL;
+    g_autoptr (PanStats) self = NULL;
+    g_autofree gchar *cache = NULL;
+    const guint8 *data;
+    gsize left;
+    guint32 header[2], len;
+    gint64 signature[2], mtime, size;
+    PanRecordSummary *summary;
+    guint32 *fields;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    cache = cache_path (path);
+    file  = g_mapped_file_new (cache, FALSE, NULL);
+    if (!file || !file_signature (path, &mtime, &size))
+        return NULL;
+
+    data = (const guint8 *) g_mapped_file_get_contents (file);
+    left = g_mapped_file_get_length (file);
+    if (left < 4 + sizeof signature + sizeof header || memcmp (data, MAGIC, 4) != 0)
+        return NULL;
+
+    memcpy (&header[0], data + 4, sizeof header[0]);
+    memcpy (signature, data + 8, sizeof signature);
+    memcpy (&header[1], data + 8 + sizeof signature, sizeof header[1]);
+    if (GUINT32_FROM_LE (header[0]) != VERSION ||
+        GINT64_FROM_LE (signature[0]) != mtime || GINT64_FROM_LE (signature[1]) != size)
+        return NULL;
+    data += 4 + sizeof signature + sizeof header;
+    left -= 4 + sizeof signature + sizeof header;
+    if (GUINT32_FROM_LE (header[1]) > left / (sizeof len + sizeof (PanRecordSummary)))
+        return NULL;
+
+    self = pan_stats_new ();
+    resize (self, GUINT32_FROM_LE (header[1]));
+    for (guint i = 0; i < self->fresh->len; i++) {
+        if (left < sizeof len)
+            return NULL;
+        memcpy (&len, data, sizeof len);
+        len = GUINT32_FROM_LE (len);
+        data += sizeof len;
+        left -= sizeof len;
+        if (left < (gsize) len + sizeof (PanRecordSummary))
+            return NULL;
+
+        g_ptr_array_index (self->names, i) = g_strndup ((const gchar *) data, len);
+        data += len;
+        left -= len;
+
+        summary = &g_array_index (self->summaries, PanRecordSummary, i);
+        memcpy (summary, data, sizeof *summary);
+        fields = (guint32 *) summary;
+        for (guint f = 0; f < N_FIELDS; f++)
+            fields[f] = GUINT32_FROM_LE (fields[f]);
+        data += sizeof *summary;
+        left -= sizeof *summary;
+
+        self->fresh->data[i] = TRUE;
+    }
+    self->n_fresh = self->fresh->len;
+
+    return g_steal_pointer (&self);
+}
+
+/**
+ * pan_stats_save_cache:
+ * @path: the document file, as just saved
+ *
+ * Caches the summaries for @path.  Only complete statistics are cached.
+ */
+gboolean
+pan_stats_save_cache (PanStats     *self,
+                      const gchar  *path,
+                      GError      **error)
+{
+    g_autoptr (GByteArray) out = NULL;
+    g_autofree gchar *cache = NULL;
+    g_autofree gchar *dir = NULL;
+    PanRecordSummary summary;
+    const gchar *name;
+    guint32 value;
+    gint64 signature[2];
+    guint32 *fields;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (pan_stats_is_complete (self), FALSE);
+
+    if (!file_signature (path, &signature[0], &signature[1])) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s does not exist", path);
+        return FALSE;
+    }
+    signature[0] = GINT64_TO_LE (signature[0]);
+    signature[1] = GINT64_TO_LE (signature[1]);
+
+    out = g_byte_array_new ();
+    g_byte_array_append (out, (const guint8 *) MAGIC, 4);
+    value = GUINT32_TO_LE (VERSION);
+    g_byte_array_append (out, (const guint8 *) &value, sizeof value);
+    g_byte_array_append (out, (const guint8 *) signature, sizeof signature);
+    value = GUINT32_TO_LE (self->fresh->len);
+    g_byte_array_append (out, (const guint8 *) &value, sizeof value);
+
+    for (guint i = 0; i < self->fresh->len; i++) {
+        name  = g_ptr_array_index (self->names, i);
+        value = GUINT32_TO_LE (name ? strlen (name) : 0);
+        g_byte_array_append (out, (const guint8 *) &value, sizeof value);
+        g_byte_array_append (out, (const guint8 *) name, name ? strlen (name) : 0);
+
+        summary = g_array_index (self->summaries, PanRecordSummary, i);
+        fields  = (guint32 *) &summary;
+        for (guint f = 0; f < N_FIELDS; f++)
+            fields[f] = GUINT32_TO_LE (fields[f]);
+        g_byte_array_append (out, (const guint8 *) &summary, sizeof summary);
+    }
+
+    cache = cache_path (path);
+    dir   = g_path_get_dirname (cache);
+    g_mkdir_with_parents (dir, 0700);
+
+    return g_file_set_contents (cache, (const gchar *) out->data, out->len, error);
+}
@@ -0,0 +1,96 @@
+/*
+ * pan-stats.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define PAN_STATS_GRID 8
+
+typedef struct _PanDocument PanDocument;
+
+/*
+ * What is known about the points of one image.  The bounding box is only
+ * meaningful when there are points, and the size is zero when the image
+ * could not be read.  grid counts the points over the image in
+ * PAN_STATS_GRID by PAN_STATS_GRID cells, rows first.
+ */
+typedef struct
+{
+    guint32 n_points;
+    guint32 min_x;
+    guint32 min_y;
+    guint32 max_x;
+    guint32 max_y;
+    guint32 width;
+    guint32 height;
+    guint32 grid[PAN_STATS_GRID * PAN_STATS_GRID];
+} PanRecordSummary;
+
+typedef struct
+{
+    guint n_records;
+    guint n_annotated;
+    guint64 n_points;
+    guint min_points;
+    guint max_points;
+    guint64 grid[PAN_STATS_GRID * PAN_STATS_GRID];
+} PanStatsTotals;
+
+typedef struct _PanStats PanStats;
+typedef struct _PanStatsPass PanStatsPass;
+
+PanStats               *pan_stats_new          (void);
+void                    pan_stats_free         (PanStats       *self);
+void                    pan_stats_invalidate   (PanStats       *self,
+                                                guint           position);
+void                    pan_stats_update       (PanStats       *self,
+                                                PanDocument    *document,
+                                                gboolean        parallel);
+PanStatsPass           *pan_stats_begin        (PanStats       *self,
+                                                PanDocument    *document);
+void                    pan_stats_pass_run     (PanStatsPass   *pass,
+                                                gboolean        parallel);
+void                    pan_stats_finish       (PanStats       *self,
+                                                PanStatsPass   *pass);
+void                    pan_stats_pass_free    (PanStatsPass   *pass);
+gboolean                pan_stats_is_complete  (PanStats       *self);
+guint                   pan_stats_get_n_records (PanStats      *self);
+const gchar            *pan_stats_get_filename (PanStats       *self,
+                                                guint           position);
+const PanRecordSummary *pan_stats_get_summary  (PanStats       *self,
+                                                guint           position);
+void                    pan_stats_get_totals   (PanStats       *self,
+                                                PanStatsTotals *totals);
+gchar                  *pan_stats_to_json      (PanStats       *self,
+                                                const gchar    *document);
+gchar                  *pan_stats_to_string    (PanStats       *self);
+PanStats               *pan_stats_load_cache   (const gchar    *path);
+gboolean                pan_stats_save_cache   (PanStats       *self,
+                                                const gchar    *path,
+                                                GError        **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanStats, pan_stats_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PanStatsPass, pan_stats_pass_free)
+
+G_END_DECLS
@@ -0,0 +1,402 @@
+/*
+ * pan-thumbnailer.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Thumbnails for the file list.
+ *
+ * Images are decoded at a reduced scale on a pool of worker threads and
+ * the result is kept in the shared thumbnail cache of the freedesktop
+ * thumbnail specification, ~/.cache/thumbnails/normal or large, as a PNG
+ * named after the MD5 of the image URI.  A cached thumbnail is used as long
+ * as the modification time recorded in it matches the image.
+ *
+ * Requests are served newest first, since those are the rows on screen,
+ * and a request whose cancellable fires before a worker picks it up is
+ * dropped without touching the disk.  The last MEMORY_CACHE_SIZE textures
+ * are also kept in memory so rows scrolled back into view show at once.
+ */
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include "pan-thumbnailer.h"
+
+#define MEMORY_CACHE_SIZE 1024
+
+struct _PanThumbnailer
+{
+    GObject parent_instance;
+
+    guint size;
+    gchar *cache_dir;
+
+    /* Path to Entry, and the entries from least to most recently used. */
+    GHashTable *memory;
+    GQueue recent;
+};
+
+typedef struct
+{
+    gchar *path;
+    GdkTexture *texture;
+    GList link;
+} Entry;
+
+typedef struct
+{
+    gchar *path;
+    guint64 serial;
+} Job;
+
+G_DEFINE_FINAL_TYPE (PanThumbnailer, pan_thumbnailer, G_TYPE_OBJECT)
+
+/*
+ * Shared by every thumbnailer and never freed: a worker may drop the last
+ * reference to the thumbnailer it served, so it must not own the pool.
+ */
+static GThreadPool *pool;
+static guint64 serial;
+
+static void        pan_thumbnailer_finalize (GObject        *object);
+static void        entry_free               (Entry          *entry);
+static void        job_free                 (Job            *job);
+static gint        job_compare              (gconstpointer   a,
+                                             gconstpointer   b,
+                                             gpointer        user_data);
+static void        worker                   (gpointer        data,
+                                             gpointer        user_data);
+static GdkTexture *load_thumbnail           (PanThumbnailer *self,
+                                             const gchar    *path,
+                                             GError        **error);
+static gboolean    is_current               (GdkPixbuf      *thumbnail,
+                                             const gchar    *uri,
+                                             const gchar    *mtime);
+static void        save_thumbnail           (GdkPixbuf      *thumbnail,
+                                             const gchar    *thumbnail_path,
+                                             const gchar    *uri,
+                                             const gchar    *mtime);
+static GdkTexture *texture_for_pixbuf       (GdkPixbuf      *pixbuf);
+static void        remember                 (PanThumbnailer *self,
+                                             const gchar    *path,
+                                             GdkTexture     *texture);
+
+static void
+pan_thumbnailer_class_init (PanThumbnailerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = pan_thumbnailer_finalize;
+
+    pool = g_thread_pool_new (worker, NULL, MAX (g_get_num_processors () / 2, 1), FALSE, NULL);
+    g_thread_pool_set_sort_function (pool, job_compare, NULL);
+}
+
+static void
+pan_thumbnailer_init (PanThumbnailer *self)
+{
+    self->memory = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) entry_free);
+    g_queue_init (&self->recent);
+}
+
+static void
+pan_thumbnailer_finalize (GObject *object)
+{
+    PanThumbnailer *self = PAN_THUMBNAILER (object);
+
+    g_hash_table_unref (self->memory);
+    g_free (self->cache_dir);
+
+    G_OBJECT_CLASS (pan_thumbnailer_parent_class)->finalize (object);
+}
+
+/**
+ * pan_thumbnailer_new:
+ * @size: the largest side of a thumbnail, 128 or 256 to share the cache
+ *   with other applications
+ */
+PanThumbnailer *
+pan_thumbnailer_new (guint size)
+{
+    PanThumbnailer *self;
+
+    self = g_object_new (PAN_TYPE_THUMBNAILER, NULL);
+    self->size      = size;
+    self->cache_dir = g_build_filename (g_get_user_cache_dir (), "thumbnails",
+                                        size <= 128 ? "normal" : "large", NULL);
+
+    return self;
+}
+
+static void
+entry_free (Entry *entry)
+{
+    g_free (entry->path);
+    g_object_unref (entry->texture);
+    g_free (entry);
+}
+
+static void
+job_free (Job *job)
+{
+    g_free (job->path);
+    g_free (job);
+}
+
+static gint
+job_compare (gconstpointer a,
+             gconstpointer b,
+             gpointer      user_data)
+{
+    Job *job_a = g_task_get_task_data ((GTask *) a);
+    Job *job_b = g_task_get_task_data ((GTask *) b);
+
+    return job_a->serial < job_b->serial ? 1 : job_a->serial > job_b->serial ? -1 : 0;
+}
+
+/**
+ * pan_thumbnailer_lookup:
+ *
+ * Returns: (transfer none) (nullable): the thumbnail of @path if it was
+ *   made recently, without going to the disk
+ */
+GdkTexture *
+pan_thumbnailer_lookup (PanThumbnailer *self,
+                        const gchar    *path)
+{
+    Entry *entry;
+
+    g_return_val_if_fail (PAN_IS_THUMBNAILER (self), NULL);
+    g_return_val_if_fail (path != NULL, NULL);
+
+    entry = g_hash_table_lookup (self->memory, path);
+    if (!entry)
+        return NULL;
+
+    g_queue_unlink (&self->recent, &entry->link);
+    g_queue_push_tail_link (&self->recent, &entry->link);
+
+    return entry->texture;
+}
+
+static void
+remember (PanThumbnailer *self,
+          const gchar    *path,
+          GdkTexture     *texture)
+{
+    Entry *entry;
+    GList *oldest;
+
+    if (pan_thumbnailer_lookup (self, path))
+        return;
+
+    entry = g_new0 (Entry, 1);
+    entry->path      = g_strdup (path);
+    entry->texture   = g_object_ref (texture);
+    entry->link.data = entry;
+    g_hash_table_insert (self->memory, entry->path, entry);
+    g_queue_push_tail_link (&self->recent, &entry->link);
+
+    while (self->recent.length > MEMORY_CACHE_SIZE) {
+        oldest = g_queue_pop_head_link (&self->recent);
+        g_hash_table_remove (self->memory, ((Entry *) oldest->data)->path);
+    }
+}
+
+/**
+ * pan_thumbnailer_load_async:
+ *
+ * Makes or reads the thumbnail of the image at @path on a worker thread.
+ * Cancel @cancellable as soon as the thumbnail is no longer wanted; a
+ * request still waiting for a worker then costs nothing.
+ */
+void
+pan_thumbnailer_load_async (PanThumbnailer      *self,
+                            const gchar         *path,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+    GTask *task;
+    Job *job;
+
+    g_return_if_fail (PAN_IS_THUMBNAILER (self));
+    g_return_if_fail (path != NULL);
+
+    job = g_new0 (Job, 1);
+    job->path   = g_strdup (path);
+    job->serial = ++serial;
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, pan_thumbnailer_load_async);
+    g_task_set_task_data (task, job, (GDestroyNotify) job_free);
+
+    /* The pool owns the task until a worker has returned it. */
+    g_thread_pool_push (pool, task, NULL);
+}
+
+/**
+ * pan_thumbnailer_load_finish:
+ *
+ * Returns: (transfer full): the thumbnail, or %NULL if the image could not
+ *   be read or the request was cancelled
+ */
+GdkTexture *
+pan_thumbnailer_load_finish (PanThumbnailer  *self,
+                             GAsyncResult    *result,
+                             GError         **error)
+{
+    GdkTexture *texture;
+    Job *job;
+
+    g_return_val_if_fail (PAN_IS_THUMBNAILER (self), NULL);
+    g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+
+    texture = g_task_propagate_pointer (G_TASK (result), error);
+    if (texture) {
+        job = g_task_get_task_data (G_TASK (result));
+        remember (self, job->path, texture);
+    }
+
+    return texture;
+}
+
+static void
+worker (gpointer data,
+        gpointer user_data)
+{
+    g_autoptr (GTask) task = data;
+    PanThumbnailer *self = g_task_get_source_object (task);
+    GError *error = NULL;
+    GdkTexture *texture;
+    Job *job;
+
+    if (g_task_return_error_if_cancelled (task))
+        return;
+
+    job = g_task_get_task_data (task);
+    texture = load_thumbnail (self, job->path, &error);
+    if (texture)
+        g_task_return_pointer (task, texture, g_object_unref);
+    else
+        g_task_return_error (task, error);
+}
+
+static GdkTexture *
+load_thumbnail (PanThumbnailer  *self,
+                const gchar     *path,
+                GError         **error)
+{
+    g_autoptr (GdkPixbuf) thumbnail = NULL;
+    g_autofree gchar *uri = NULL;
+    g_autofree gchar *checksum = NULL;
+    g_autofree gchar *basename = NULL;
+    g_autofree gchar *thumbnail_path = NULL;
+    g_autofree gchar *mtime = NULL;
+    GStatBuf buf;
+    gint saved_errno;
+
+    if (g_stat (path, &buf) != 0) {
+        saved_errno = errno;
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                     "%s: %s", path, g_strerror (saved_errno));
+        return NULL;
+    }
+
+    uri = g_filename_to_uri (path, NULL, error);
+    if (!uri)
+        return NULL;
+
+    mtime          = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) buf.st_mtime);
+    checksum       = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+    basename       = g_strconcat (checksum, ".png", NULL);
+    thumbnail_path = g_build_filename (self->cache_dir, basename, NULL);
+
+    thumbnail = gdk_pixbuf_new_from_file (thumbnail_path, NULL);
+    if (thumbnail && is_current (thumbnail, uri, mtime))
+        return texture_for_pixbuf (thumbnail);
+
+    g_clear_object (&thumbnail);
+    thumbnail = gdk_pixbuf_new_from_file_at_size (path, self->size, self->size, error);
+    if (!thumbnail)
+        return NULL;
+
+    save_thumbnail (thumbnail, thumbnail_path, uri, mtime);
+
+    return texture_for_pixbuf (thumbnail);
+}
+
+static gboolean
+is_current (GdkPixbuf   *thumbnail,
+            const gchar *uri,
+            const gchar *mtime)
+{
+    return g_strcmp0 (gdk_pixbuf_get_option (thumbnail, "tEXt::Thumb::URI"), uri) == 0 &&
+           g_strcmp0 (gdk_pixbuf_get_option (thumbnail, "tEXt::Thumb::MTime"), mtime) == 0;
+}
+
+/*
+ * Written to a temporary file and renamed, as the specification asks, so
+ * that other readers of the cache never see half a thumbnail.  The cache
+ * is only an optimization, so failures are not reported.
+ */
+static void
+save_thumbnail (GdkPixbuf   *thumbnail,
+                const gchar *thumbnail_path,
+                const gchar *uri,
+                const gchar *mtime)
+{
+    g_autofree gchar *directory = NULL;
+    g_autofree gchar *tmp_path = NULL;
+    GError *error = NULL;
+
+    directory = g_path_get_dirname (thumbnail_path);
+    if (g_mkdir_with_parents (directory, 0700) != 0)
+        return;
+
+    tmp_path = g_strdup_printf ("%s.%u.tmp", thumbnail_path, g_random_int ());
+    if (!gdk_pixbuf_save (thumbnail, tmp_path, "png", &error,
+                          "tEXt::Thumb::URI", uri,
+                          "tEXt::Thumb::MTime", mtime,
+                          "tEXt::Software", "Pan",
+                          NULL)) {
+        g_debug ("Could not write thumbnail %s: %s", thumbnail_path, error->message);
+        g_error_free (error);
+        g_unlink (tmp_path);
+        return;
+    }
+
+    g_chmod (tmp_path, 0600);
+    if (g_rename (tmp_path, thumbnail_path) != 0)
+        g_unlink (tmp_path);
+}
+
+static GdkTexture *
+texture_for_pixbuf (GdkPixbuf *pixbuf)
+{
+    g_autoptr (GBytes) bytes = NULL;
+
+    bytes = gdk_pixbuf_read_pixel_bytes (pixbuf);
+
+    return gdk_memory_texture_new (gdk_pixbuf_get_width (pixbuf),
+                                   gdk_pixbuf_get_height (pixbuf),
+                                   gdk_pixbuf_get_has_alpha (pixbuf) ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R8G8B8,
+                                   bytes,
+                                   gdk_pixbuf_get_rowstride (pixbuf));
+}
@@ -0,0 +1,44 @@
+/*
+ * pan-thumbnailer.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define PAN_TYPE_THUMBNAILER pan_thumbnailer_get_type ()
+G_DECLARE_FINAL_TYPE (PanThumbnailer, pan_thumbnailer, PAN, THUMBNAILER, GObject)
+
+PanThumbnailer *pan_thumbnailer_new         (guint                size);
+GdkTexture     *pan_thumbnailer_lookup      (PanThumbnailer      *self,
+                                             const gchar         *path);
+void            pan_thumbnailer_load_async  (PanThumbnailer      *self,
+                                             const gchar         *path,
+                                             GCancellable        *cancellable,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data);
+GdkTexture     *pan_thumbnailer_load_finish (PanThumbnailer      *self,
+                                             GAsyncResult        *result,
+                                             GError             **error);
+
+G_END_DECLS
@@ -24,8 +24,15 @@
 
 #include "pan-document.h"
 #include "pan-canvas.h"
+#include "pan-history.h"
 #include "pan-window.h"
 #include "pan-annot-view.h"
+#include "pan-agreement.h"
+#include "pan-similar.h"
+#include "pan-thumbnailer.h"
+
+/* Side of the thumbnails in the file list, in logical pixels. */
+#define THUMBNAIL_ROW_SIZE 48
 
 struct _PanWindow
 {
@@ -40,6 +47,15 @@ struct _PanWindow
     GtkScale *radius_scale;
     GtkScale *alpha_scale;
 
+    GtkScale *brightness_scale;
+    GtkScale *contrast_scale;
+    GtkScale *gamma_scale;
+    GtkScale *level_scale;
+    GtkScale *window_scale;
+    GtkDropDown *channel_dropdown;
+    GtkSwitch *auto_levels_switch;
+    GtkWidget *reset_adjustments_button;
+
     AdwWindowTitle *window_title;
 
     GtkWidget *zoom_in_button;
@@ -56,6 +72,15 @@ struct _PanWindow
     GtkColumnView *annot_column_view;
 
     PanCanvas *canvas;
+
+    /* Findings of the last duplicate search, and the one shown last. */
+    GArray *duplicates;
+    guint duplicate_cursor;
+
+    /* The document compared against, shown over the canvas. */
+    PanDocument *reference;
+
+    PanThumbnailer *thumbnailer;
 };
 
 static void pan_window_dispose                (GObject *object);
@@ -83,23 +108,118 @@ static void pan_window_folder_opened          (GObject      *source,
 static void pan_window_save_dialog_cb         (GObject      *source,
                                                GAsyncResult *result,
                                                gpointer      user_data);
+static void pan_window_save_as_dialog_cb      (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
 static void pan_window_undo_action            (GSimpleAction *action,
                                                GVariant      *parameters,
                                                gpointer       user_data);
 static void pan_window_redo_action            (GSimpleAction *action,
                                                GVariant      *parameters,
                                                gpointer       user_data);
+static void pan_window_delete_annot_action    (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_clear_annots_action    (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_dump_perf_action       (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_memory_report_action   (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_statistics_action      (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void stats_computed_cb                 (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void pan_window_find_duplicates_action (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void duplicates_found_cb               (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void pan_window_next_duplicate_action  (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_prev_duplicate_action  (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_merge_duplicates_action (GSimpleAction *action,
+                                                GVariant      *parameters,
+                                                gpointer       user_data);
+static void pan_window_duplicates_dialog_cb   (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void show_duplicate                    (PanWindow *window);
+static void pan_window_compare_action         (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_stop_compare_action    (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_reference_opened       (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void reference_compared_cb             (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void pan_window_relink_action          (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void pan_window_relink_folder_cb       (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void relinked_cb                       (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void images_hashed_cb                  (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
+static void pan_window_flag_similar_action    (GSimpleAction *action,
+                                               GVariant      *parameters,
+                                               gpointer       user_data);
+static void similar_flagged_cb                (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
 static void file_list_selection_changed_cb    (GtkSelectionModel *selection_model,
                                                guint              position,
                                                gint               n_items,
                                                gpointer           user_data);
+static void document_loaded                   (PanWindow *window);
 static void record_changed                    (PanWindow          *self,
                                                GtkSingleSelection *selection_model);
+static void file_list_setup_cb                (GtkSignalListItemFactory *factory,
+                                               GtkListItem              *item,
+                                               gpointer                  user_data);
+static void file_list_bind_cb                 (GtkSignalListItemFactory *factory,
+                                               GtkListItem              *item,
+                                               gpointer                  user_data);
+static void file_list_unbind_cb               (GtkSignalListItemFactory *factory,
+                                               GtkListItem              *item,
+                                               gpointer                  user_data);
+static void thumbnail_loaded_cb               (GObject      *source,
+                                               GAsyncResult *result,
+                                               gpointer      user_data);
 
 static void load_settings                     (PanWindow *self);
+static void bind_adjustments                  (PanWindow *self);
+static void reset_adjustments                 (PanWindow *self);
+static void history_settings_changed_cb       (GSettings   *settings,
+                                               const gchar *key,
+                                               gpointer     user_data);
 static void set_enable_action                 (PanWindow   *window,
                                                const gchar *action_name,
                                                gboolean     value);
+static void add_file_filter                   (GListStore  *filters,
+                                               const gchar *name,
+                                               const gchar *mime_type,
+                                               const gchar *pattern);
+static void show_error                        (PanWindow    *window,
+                                               const gchar  *heading,
+                                               const GError *error);
 static gboolean pan_window_close_request      (GtkWindow *window);
 
 G_DEFINE_FINAL_TYPE (PanWindow, pan_window, ADW_TYPE_APPLICATION_WINDOW)
@@ -111,7 +231,20 @@ static GActionEntry window_actions[] =
     {"save",    pan_window_save_action   },
     {"save_as", pan_window_save_as_action},
     {"undo",    pan_window_undo_action,  },
-    {"redo",    pan_window_redo_action   }
+    {"redo",    pan_window_redo_action   },
+    {"delete_annot", pan_window_delete_annot_action},
+    {"clear_annots", pan_window_clear_annots_action},
+    {"dump_perf",    pan_window_dump_perf_action},
+    {"memory_report", pan_window_memory_report_action},
+    {"statistics",    pan_window_statistics_action},
+    {"find_duplicates",  pan_window_find_duplicates_action},
+    {"next_duplicate",   pan_window_next_duplicate_action},
+    {"prev_duplicate",   pan_window_prev_duplicate_action},
+    {"merge_duplicates", pan_window_merge_duplicates_action},
+    {"compare",          pan_window_compare_action},
+    {"stop_compare",     pan_window_stop_compare_action},
+    {"relink",           pan_window_relink_action},
+    {"flag_similar",     pan_window_flag_similar_action}
 };
 
 static void
@@ -134,6 +267,15 @@ pan_window_class_init (PanWindowClass *klass)
     gtk_widget_class_bind_template_child (widget_class, PanWindow, radius_scale);
     gtk_widget_class_bind_template_child (widget_class, PanWindow, alpha_scale);
 
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, brightness_scale);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, contrast_scale);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, gamma_scale);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, level_scale);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, window_scale);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, channel_dropdown);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, auto_levels_switch);
+    gtk_widget_class_bind_template_child (widget_class, PanWindow, reset_adjustments_button);
+
     gtk_widget_class_bind_template_child (widget_class, PanWindow, zoom_in_button);
     gtk_widget_class_bind_template_child (widget_class, PanWindow, zoom_out_button);
     gtk_widget_class_bind_template_child (widget_class, PanWindow, zoom_fit_button);
@@ -153,9 +295,21 @@ pan_window_class_init (PanWindowClass *klass)
 static void
 pan_window_init (PanWindow *self)
 {
+    GtkListItemFactory *factory;
+
     g_type_ensure (PAN_TYPE_CANVAS);
     gtk_widget_init_template (GTK_WIDGET (self));
 
+    /* Thumbnails of the normal size are shared with other applications. */
+    self->thumbnailer = pan_thumbnailer_new (128);
+
+    factory = gtk_signal_list_item_factory_new ();
+    g_signal_connect (factory, "setup", G_CALLBACK (file_list_setup_cb), self);
+    g_signal_connect (factory, "bind", G_CALLBACK (file_list_bind_cb), self);
+    g_signal_connect (factory, "unbind", G_CALLBACK (file_list_unbind_cb), self);
+    gtk_list_view_set_factory (self->file_list_view, factory);
+    g_object_unref (factory);
+
     g_action_map_add_action_entries (G_ACTION_MAP (self), window_actions,
                                      G_N_ELEMENTS (window_actions), self);
 
@@ -171,10 +325,25 @@ pan_window_init (PanWindow *self)
     g_signal_connect_swapped (self->prev_button, "clicked", G_CALLBACK (pan_canvas_prev), self->canvas);
     g_signal_connect_swapped (self->next_button, "clicked", G_CALLBACK (pan_canvas_next), self->canvas);
     g_signal_connect_swapped (self->last_button, "clicked", G_CALLBACK (pan_canvas_last), self->canvas);
+    g_signal_connect_swapped (self->reset_adjustments_button, "clicked", G_CALLBACK (reset_adjustments), self);
+
+    bind_adjustments (self);
 
     set_enable_action (self, "undo", FALSE);
     set_enable_action (self, "redo", FALSE);
+    set_enable_action (self, "delete_annot", FALSE);
+    set_enable_action (self, "clear_annots", FALSE);
     set_enable_action (self, "save", FALSE);
+    set_enable_action (self, "save_as", FALSE);
+    set_enable_action (self, "statistics", FALSE);
+    set_enable_action (self, "find_duplicates", FALSE);
+    set_enable_action (self, "next_duplicate", FALSE);
+    set_enable_action (self, "prev_duplicate", FALSE);
+    set_enable_action (self, "merge_duplicates", FALSE);
+    set_enable_action (self, "compare", FALSE);
+    set_enable_action (self, "stop_compare", FALSE);
+    set_enable_action (self, "relink", FALSE);
+    set_enable_action (self, "flag_similar", FALSE);
 
     gtk_widget_set_sensitive (self->next_button, FALSE);
     gtk_widget_set_sensitive (self->prev_button, FALSE);
@@ -197,6 +366,9 @@ pan_window_dispose (GObject *object)
 
     g_clear_object (&window->document);
     g_clear_object (&window->settings);
+    g_clear_pointer (&window->duplicates, g_array_unref);
+    g_clear_object (&window->reference);
+    g_clear_object (&window->thumbnailer);
 
     G_OBJECT_CLASS (pan_window_parent_class)->dispose (object);
 }
@@ -218,6 +390,15 @@ load_settings (PanWindow *self)
     g_object_get (self->alpha_scale, "adjustment", &adjustment, NULL);
     g_settings_bind (self->settings, "alpha", adjustment, "value", G_SETTINGS_BIND_DEFAULT);
 
+    /* PAN_PERF_OVERLAY forces the overlay on regardless of the setting. */
+    if (!g_getenv ("PAN_PERF_OVERLAY"))
+        g_settings_bind (self->settings, "perf-overlay", self->canvas, "perf-overlay", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "skip-similar-images", self->canvas, "skip-similar", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "show-minimap", self->canvas, "show-minimap", G_SETTINGS_BIND_GET);
+
+    g_signal_connect (self->settings, "changed", G_CALLBACK (history_settings_changed_cb), NULL);
+    history_settings_changed_cb (self->settings, NULL, NULL);
+
     color_value = g_settings_get_value (self->settings, "color");
     g_variant_get (color_value, "(ddd)", &r, &g, &b);
     color.red   = CLAMP (r, 0.0, 1.0);
@@ -232,6 +413,19 @@ load_settings (PanWindow *self)
     pan_canvas_set_color (self->canvas, &color);
 }
 
+static void
+history_settings_changed_cb (GSettings   *settings,
+                             const gchar *key,
+                             gpointer     user_data)
+{
+    if (key && !g_str_has_prefix (key, "history-"))
+        return;
+
+    pan_history_set_limits (g_settings_get_uint (settings, "history-depth"),
+                            g_settings_get_uint64 (settings, "history-budget"),
+                            g_settings_get_uint (settings, "history-merge-window"));
+}
+
 static void
 file_list_selection_changed_cb (GtkSelectionModel *selection_model,
                                 guint              position,
@@ -257,6 +451,153 @@ record_changed (PanWindow          *self,
 
 }
 
+/* The adjustments only change how the image is drawn, so they are not saved. */
+static void
+bind_adjustments (PanWindow *self)
+{
+    g_object_bind_property (gtk_range_get_adjustment (GTK_RANGE (self->brightness_scale)), "value",
+                            self->canvas, "brightness", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (gtk_range_get_adjustment (GTK_RANGE (self->contrast_scale)), "value",
+                            self->canvas, "contrast", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (gtk_range_get_adjustment (GTK_RANGE (self->gamma_scale)), "value",
+                            self->canvas, "gamma", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (gtk_range_get_adjustment (GTK_RANGE (self->level_scale)), "value",
+                            self->canvas, "level", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (gtk_range_get_adjustment (GTK_RANGE (self->window_scale)), "value",
+                            self->canvas, "window", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (self->channel_dropdown, "selected",
+                            self->canvas, "channel", G_BINDING_SYNC_CREATE);
+    g_object_bind_property (self->auto_levels_switch, "active",
+                            self->canvas, "auto-levels", G_BINDING_SYNC_CREATE);
+
+#if !GTK_CHECK_VERSION (4, 20, 0)
+    gtk_widget_set_sensitive (GTK_WIDGET (self->gamma_scale), FALSE);
+    gtk_widget_set_tooltip_text (GTK_WIDGET (self->gamma_scale), _("Gamma needs GTK 4.20 or newer"));
+#endif
+}
+
+static void
+reset_adjustments (PanWindow *self)
+{
+    gtk_range_set_value (GTK_RANGE (self->brightness_scale), 0.0);
+    gtk_range_set_value (GTK_RANGE (self->contrast_scale), 1.0);
+    gtk_range_set_value (GTK_RANGE (self->gamma_scale), 1.0);
+    gtk_range_set_value (GTK_RANGE (self->level_scale), 0.5);
+    gtk_range_set_value (GTK_RANGE (self->window_scale), 1.0);
+    gtk_drop_down_set_selected (self->channel_dropdown, 0);
+    gtk_switch_set_active (self->auto_levels_switch, FALSE);
+}
+
+/* Rows are a thumbnail, the filename and the mark of a similar image. */
+static void
+file_list_setup_cb (GtkSignalListItemFactory *factory,
+                    GtkListItem              *item,
+                    gpointer                  user_data)
+{
+    GtkWidget *box, *thumbnail, *label, *duplicate;
+
+    box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+
+    thumbnail = gtk_image_new ();
+    gtk_image_set_pixel_size (GTK_IMAGE (thumbnail), THUMBNAIL_ROW_SIZE);
+    gtk_box_append (GTK_BOX (box), thumbnail);
+
+    label = gtk_label_new (NULL);
+    gtk_label_set_xalign (GTK_LABEL (label), 0);
+    gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_MIDDLE);
+    gtk_widget_set_hexpand (label, TRUE);
+    gtk_box_append (GTK_BOX (box), label);
+
+    duplicate = gtk_image_new_from_icon_name ("edit-copy-symbolic");
+    gtk_widget_set_tooltip_text (duplicate, _("Looks like an earlier image"));
+    gtk_box_append (GTK_BOX (box), duplicate);
+
+    gtk_list_item_set_child (item, box);
+}
+
+/*
+ * Only rows on screen are bound, so this is where thumbnails are asked
+ * for.  The request is cancelled again when the row is unbound.
+ */
+static void
+file_list_bind_cb (GtkSignalListItemFactory *factory,
+                   GtkListItem              *item,
+                   gpointer                  user_data)
+{
+    PanWindow *window = user_data;
+    g_autofree gchar *path = NULL;
+    GtkWidget *thumbnail, *label, *duplicate;
+    GCancellable *cancellable;
+    GdkTexture *texture;
+    PanRecord *record;
+    const gchar *root;
+
+    record    = gtk_list_item_get_item (item);
+    thumbnail = gtk_widget_get_first_child (gtk_list_item_get_child (item));
+    label     = gtk_widget_get_next_sibling (thumbnail);
+    duplicate = gtk_widget_get_next_sibling (label);
+
+    g_object_set_data (G_OBJECT (item), "filename-binding",
+                       g_object_bind_property (record, "filename", label, "label",
+                                               G_BINDING_SYNC_CREATE));
+    g_object_set_data (G_OBJECT (item), "duplicate-binding",
+                       g_object_bind_property (record, "duplicate", duplicate, "visible",
+                                               G_BINDING_SYNC_CREATE));
+
+    root = window->document ? pan_document_get_root_path (window->document) : NULL;
+    path = g_build_filename (root ? root : ".", pan_record_filename (record), NULL);
+
+    texture = pan_thumbnailer_lookup (window->thumbnailer, path);
+    if (texture) {
+        gtk_image_set_from_paintable (GTK_IMAGE (thumbnail), GDK_PAINTABLE (texture));
+        return;
+    }
+
+    gtk_image_set_from_icon_name (GTK_IMAGE (thumbnail), "image-x-generic-symbolic");
+    cancellable = g_cancellable_new ();
+    g_object_set_data_full (G_OBJECT (item), "thumbnail-cancellable", cancellable, g_object_unref);
+    pan_thumbnailer_load_async (window->thumbnailer, path, cancellable,
+                                thumbnail_loaded_cb, g_object_ref (thumbnail));
+}
+
+static void
+file_list_unbind_cb (GtkSignalListItemFactory *factory,
+                     GtkListItem              *item,
+                     gpointer                  user_data)
+{
+    GCancellable *cancellable;
+
+    cancellable = g_object_get_data (G_OBJECT (item), "thumbnail-cancellable");
+    if (cancellable) {
+        g_cancellable_cancel (cancellable);
+        g_object_set_data (G_OBJECT (item), "thumbnail-cancellable", NULL);
+    }
+
+    g_binding_unbind (g_object_get_data (G_OBJECT (item), "filename-binding"));
+    g_binding_unbind (g_object_get_data (G_OBJECT (item), "duplicate-binding"));
+}
+
+/* @user_data is a reference to the image of the row, still bound unless cancelled. */
+static void
+thumbnail_loaded_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+    g_autoptr (GtkImage) thumbnail = user_data;
+    g_autoptr (GdkTexture) texture = NULL;
+    GError *error = NULL;
+
+    texture = pan_thumbnailer_load_finish (PAN_THUMBNAILER (source), result, &error);
+    if (texture) {
+        gtk_image_set_from_paintable (thumbnail, GDK_PAINTABLE (texture));
+        return;
+    }
+
+    if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        gtk_image_set_from_icon_name (thumbnail, "image-missing-symbolic");
+    g_error_free (error);
+}
+
 static void
 pan_window_color_set_cb (GtkColorButton *self, gpointer user_data)
 {
@@ -287,6 +628,40 @@ pan_window_alpha_change_value_cb (GtkRange *range, gpointer user_data)
     pan_canvas_set_alpha (canvas, gtk_range_get_value (range));
 }
 
+/* Enables what needs a document once one is opened or created. */
+static void
+document_loaded (PanWindow *window)
+{
+    set_enable_action (window, "undo", TRUE);
+    set_enable_action (window, "redo", TRUE);
+    set_enable_action (window, "save", TRUE);
+    set_enable_action (window, "save_as", TRUE);
+    set_enable_action (window, "statistics", TRUE);
+    set_enable_action (window, "find_duplicates", TRUE);
+    set_enable_action (window, "next_duplicate", FALSE);
+    set_enable_action (window, "prev_duplicate", FALSE);
+    set_enable_action (window, "merge_duplicates", FALSE);
+    g_clear_pointer (&window->duplicates, g_array_unref);
+    set_enable_action (window, "compare", TRUE);
+    set_enable_action (window, "stop_compare", window->reference != NULL);
+    set_enable_action (window, "relink", TRUE);
+    set_enable_action (window, "flag_similar", TRUE);
+    set_enable_action (window, "delete_annot", TRUE);
+    set_enable_action (window, "clear_annots", TRUE);
+
+    gtk_widget_set_sensitive (window->next_button, TRUE);
+    gtk_widget_set_sensitive (window->prev_button, TRUE);
+    gtk_widget_set_sensitive (window->first_button, TRUE);
+    gtk_widget_set_sensitive (window->last_button, TRUE);
+    gtk_widget_set_sensitive (window->zoom_in_button, TRUE);
+    gtk_widget_set_sensitive (window->zoom_out_button, TRUE);
+    gtk_widget_set_sensitive (window->zoom_original_button, TRUE);
+    gtk_widget_set_sensitive (window->zoom_fit_button, TRUE);
+
+    /* Fingerprints for relinking, read in the background. */
+    pan_document_hash_images_async (window->document, NULL, images_hashed_cb, NULL);
+}
+
 static void
 pan_window_folder_opened (GObject      *source,
                           GAsyncResult *result,
@@ -314,19 +689,11 @@ pan_window_folder_opened (GObject      *source,
     gtk_list_view_set_model (window->file_list_view, GTK_SELECTION_MODEL (record_selection));
 
     record_changed (window, record_selection);
-
-    set_enable_action (window, "undo", TRUE);
-    set_enable_action (window, "redo", TRUE);
-    set_enable_action (window, "save", TRUE);
-
-    gtk_widget_set_sensitive (window->next_button, TRUE);
-    gtk_widget_set_sensitive (window->prev_button, TRUE);
-    gtk_widget_set_sensitive (window->first_button, TRUE);
-    gtk_widget_set_sensitive (window->last_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_in_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_out_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_original_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_fit_button, TRUE);
+    document_loaded (window);
+    if (g_settings_get_boolean (window->settings, "flag-similar-images"))
+        pan_similar_flag_async (window->document,
+                                g_settings_get_uint (window->settings, "similar-image-distance"),
+                                NULL, similar_flagged_cb, NULL);
 }
 
 static void
@@ -337,6 +704,7 @@ pan_window_file_opened (GObject      *source,
     GFile *file;
     GError *error = NULL;
     PanWindow *window;
+    PanDocument *document;
     gchar *path;
     GtkSingleSelection *record_selection;
     window = user_data;
@@ -349,7 +717,16 @@ pan_window_file_opened (GObject      *source,
     }
 
     path = g_file_get_path (file);
-    window->document = pan_document_open (path);
+    document = pan_document_load_file (path, &error);
+    g_object_unref (file);
+    g_free (path);
+    if (!document) {
+        show_error (window, _("Could Not Open"), error);
+        g_error_free (error);
+        return;
+    }
+
+    window->document = document;
     pan_canvas_set_document (window->canvas, window->document);
     record_selection = pan_canvas_get_record_selection_model (window->canvas);
     g_signal_connect (GTK_SELECTION_MODEL (record_selection), "selection-changed",
@@ -357,18 +734,7 @@ pan_window_file_opened (GObject      *source,
     gtk_list_view_set_model (window->file_list_view, GTK_SELECTION_MODEL (record_selection));
 
     record_changed (window, record_selection);
-    set_enable_action (window, "undo", TRUE);
-    set_enable_action (window, "redo", TRUE);
-    set_enable_action (window, "save", TRUE);
-
-    gtk_widget_set_sensitive (window->next_button, TRUE);
-    gtk_widget_set_sensitive (window->prev_button, TRUE);
-    gtk_widget_set_sensitive (window->first_button, TRUE);
-    gtk_widget_set_sensitive (window->last_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_in_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_out_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_original_button, TRUE);
-    gtk_widget_set_sensitive (window->zoom_fit_button, TRUE);
+    document_loaded (window);
 }
 
 static void
@@ -402,6 +768,8 @@ pan_window_open_action (GSimpleAction *action,
     gtk_file_filter_add_suffix (json_filter, "json");
 
     g_list_store_append (filters, json_filter);
+    add_file_filter (filters, _("CSV"), "text/csv", "*.csv");
+    add_file_filter (filters, _("Binary"), NULL, "*.bin");
 
     file_dialog = gtk_file_dialog_new ();
     gtk_file_dialog_set_filters (file_dialog, G_LIST_MODEL (filters));
@@ -437,12 +805,32 @@ pan_window_save_action (GSimpleAction *action,
     g_object_unref (save_dialog);
 }
 
+/*
+ * The format follows from the name typed, as in pan_document_save_file(),
+ * so the filters only help finding files of one kind.
+ */
 static void
 pan_window_save_as_action (GSimpleAction *action,
                            GVariant      *parameters,
                            gpointer       user_data)
 {
-    g_print ("save as action activated");
+    GtkFileDialog *save_dialog;
+    GListStore *filters;
+
+    filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+    add_file_filter (filters, _("JSON"), "text/json", "*.json");
+    add_file_filter (filters, _("COCO Keypoints"), NULL, "*.coco.json");
+    add_file_filter (filters, _("CSV"), "text/csv", "*.csv");
+    add_file_filter (filters, _("Binary"), NULL, "*.bin");
+
+    save_dialog = gtk_file_dialog_new ();
+    gtk_file_dialog_set_title (save_dialog, _("Save As"));
+    gtk_file_dialog_set_filters (save_dialog, G_LIST_MODEL (filters));
+    gtk_file_dialog_set_initial_name (save_dialog, "annotations.json");
+    gtk_file_dialog_save (save_dialog, GTK_WINDOW (user_data), NULL,
+                          pan_window_save_as_dialog_cb, user_data);
+    g_object_unref (save_dialog);
+    g_object_unref (filters);
 }
 
 static void
@@ -464,6 +852,632 @@ static void pan_window_redo_action (GSimpleAction *action,
     pan_canvas_redo (window->canvas);
 }
 
+static void
+pan_window_delete_annot_action (GSimpleAction *action,
+                                GVariant      *parameters,
+                                gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    pan_canvas_delete_selected (window->canvas);
+}
+
+static void
+pan_window_clear_annots_action (GSimpleAction *action,
+                                GVariant      *parameters,
+                                gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    pan_canvas_clear_annots (window->canvas);
+}
+
+/* Writes the canvas counters to a JSON file in the user cache directory. */
+static void
+pan_window_dump_perf_action (GSimpleAction *action,
+                             GVariant      *parameters,
+                             gpointer       user_data)
+{
+    PanWindow *window = user_data;
+    g_autofree gchar *report = NULL;
+    g_autofree gchar *dir = NULL;
+    g_autofree gchar *basename = NULL;
+    g_autofree gchar *path = NULL;
+    GError *error = NULL;
+
+    report   = pan_canvas_get_perf_report (window->canvas);
+    dir      = g_build_filename (g_get_user_cache_dir (), "pan", NULL);
+    basename = g_strdup_printf ("perf-%" G_GINT64_FORMAT ".json", g_get_real_time () / G_USEC_PER_SEC);
+    path     = g_build_filename (dir, basename, NULL);
+
+    g_mkdir_with_parents (dir, 0700);
+    if (!g_file_set_contents (path, report, -1, &error)) {
+        g_warning ("Could not write the performance report: %s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    g_message ("Performance report written to %s", path);
+}
+
+static void
+pan_window_memory_report_action (GSimpleAction *action,
+                                 GVariant      *parameters,
+                                 gpointer       user_data)
+{
+    PanWindow *window = user_data;
+    g_autoptr (PanMemoryReport) report = NULL;
+    g_autofree gchar *text = NULL;
+    g_autofree gchar *markup = NULL;
+    AdwDialog *dialog;
+
+    report = pan_memory_report_new ();
+    pan_window_account_memory (window, report);
+    text   = pan_memory_report_to_string (report);
+    markup = g_markup_printf_escaped ("<tt>%s</tt>", text);
+
+    dialog = adw_alert_dialog_new (_("Memory Usage"), NULL);
+    adw_alert_dialog_set_body_use_markup (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_alert_dialog_set_body (ADW_ALERT_DIALOG (dialog), markup);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_alert_dialog_set_prefer_wide_layout (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
+static void
+add_file_filter (GListStore  *filters,
+                 const gchar *name,
+                 const gchar *mime_type,
+                 const gchar *pattern)
+{
+    GtkFileFilter *filter;
+
+    filter = gtk_file_filter_new ();
+    gtk_file_filter_set_name (filter, name);
+    if (mime_type)
+        gtk_file_filter_add_mime_type (filter, mime_type);
+    gtk_file_filter_add_pattern (filter, pattern);
+
+    g_list_store_append (filters, filter);
+    g_object_unref (filter);
+}
+
+static void
+show_error (PanWindow    *window,
+            const gchar  *heading,
+            const GError *error)
+{
+    AdwDialog *dialog;
+
+    dialog = adw_alert_dialog_new (heading, error->message);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
+/* Only records edited since the last time are summarized again. */
+static void
+pan_window_statistics_action (GSimpleAction *action,
+                              GVariant      *parameters,
+                              gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    if (!window->document)
+        return;
+
+    set_enable_action (window, "statistics", FALSE);
+    pan_document_get_stats_async (window->document, NULL, stats_computed_cb, g_object_ref (window));
+}
+
+static void
+stats_computed_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+    g_autoptr (PanWindow) window = user_data;
+    g_autofree gchar *text = NULL;
+    g_autofree gchar *markup = NULL;
+    GError *error = NULL;
+    AdwDialog *dialog;
+    PanStats *stats;
+
+    stats = pan_document_get_stats_finish (PAN_DOCUMENT (source), result, &error);
+    set_enable_action (window, "statistics", window->document != NULL);
+    if (PAN_DOCUMENT (source) != window->document) {
+        g_clear_error (&error);
+        return;
+    }
+    if (!stats) {
+        show_error (window, _("Could Not Compute Statistics"), error);
+        g_error_free (error);
+        return;
+    }
+
+    text   = pan_stats_to_string (stats);
+    markup = g_markup_printf_escaped ("<tt>%s</tt>", text);
+
+    dialog = adw_alert_dialog_new (_("Statistics"), NULL);
+    adw_alert_dialog_set_body_use_markup (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_alert_dialog_set_body (ADW_ALERT_DIALOG (dialog), markup);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_alert_dialog_set_prefer_wide_layout (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
+static void
+pan_window_find_duplicates_action (GSimpleAction *action,
+                                   GVariant      *parameters,
+                                   gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    if (!window->document)
+        return;
+
+    set_enable_action (window, "find_duplicates", FALSE);
+    set_enable_action (window, "next_duplicate", FALSE);
+    set_enable_action (window, "prev_duplicate", FALSE);
+    set_enable_action (window, "merge_duplicates", FALSE);
+    g_clear_pointer (&window->duplicates, g_array_unref);
+    pan_duplicates_find_async (window->document,
+                               g_settings_get_uint (window->settings, "duplicate-distance"),
+                               NULL, duplicates_found_cb, g_object_ref (window));
+}
+
+static void
+duplicates_found_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+    g_autoptr (PanWindow) window = user_data;
+    g_autoptr (GHashTable) records = NULL;
+    g_autoptr (GArray) duplicates = NULL;
+    g_autofree gchar *body = NULL;
+    GError *error = NULL;
+    AdwDialog *dialog;
+    PanDuplicate *duplicate;
+    guint distance;
+    gboolean found;
+
+    duplicates = pan_duplicates_find_finish (PAN_DOCUMENT (source), result, &error);
+    set_enable_action (window, "find_duplicates", window->document != NULL);
+    if (PAN_DOCUMENT (source) != window->document) {
+        g_clear_error (&error);
+        return;
+    }
+    if (!duplicates) {
+        show_error (window, _("Could Not Find Duplicates"), error);
+        g_error_free (error);
+        return;
+    }
+
+    distance = g_settings_get_uint (window->settings, "duplicate-distance");
+    window->duplicates = g_steal_pointer (&duplicates);
+    window->duplicate_cursor = G_MAXUINT;
+
+    records = g_hash_table_new (NULL, NULL);
+    for (guint i = 0; i < window->duplicates->len; i++) {
+        duplicate = &g_array_index (window->duplicates, PanDuplicate, i);
+        g_hash_table_add (records, GUINT_TO_POINTER (duplicate->record + 1));
+    }
+
+    found = window->duplicates->len > 0;
+    set_enable_action (window, "next_duplicate", found);
+    set_enable_action (window, "prev_duplicate", found);
+    set_enable_action (window, "merge_duplicates", found);
+
+    if (found)
+        body = g_strdup_printf (_("%u pairs of points are closer than %u px, in %u images."),
+                                window->duplicates->len, distance,
+                                g_hash_table_size (records));
+    else
+        body = g_strdup_printf (_("No points are closer than %u px."), distance);
+
+    dialog = adw_alert_dialog_new (_("Duplicate Points"), body);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    if (found) {
+        adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "review", _("_Review"));
+        adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "merge", _("_Merge All"));
+        adw_alert_dialog_set_response_appearance (ADW_ALERT_DIALOG (dialog), "merge",
+                                                  ADW_RESPONSE_DESTRUCTIVE);
+        adw_alert_dialog_set_default_response (ADW_ALERT_DIALOG (dialog), "review");
+    }
+    adw_alert_dialog_choose (ADW_ALERT_DIALOG (dialog), GTK_WIDGET (window), NULL,
+                             pan_window_duplicates_dialog_cb, window);
+}
+
+static void
+pan_window_duplicates_dialog_cb (GObject      *source,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+    PanWindow *window = user_data;
+    const gchar *response;
+
+    response = adw_alert_dialog_choose_finish (ADW_ALERT_DIALOG (source), result);
+    if (!window->duplicates)
+        return;
+
+    if (g_str_equal (response, "review")) {
+        window->duplicate_cursor = 0;
+        show_duplicate (window);
+    } else if (g_str_equal (response, "merge")) {
+        pan_canvas_merge_duplicates (window->canvas,
+                                     (const PanDuplicate *) window->duplicates->data,
+                                     window->duplicates->len);
+        g_clear_pointer (&window->duplicates, g_array_unref);
+        set_enable_action (window, "next_duplicate", FALSE);
+        set_enable_action (window, "prev_duplicate", FALSE);
+        set_enable_action (window, "merge_duplicates", FALSE);
+    }
+}
+
+static void
+pan_window_next_duplicate_action (GSimpleAction *action,
+                                  GVariant      *parameters,
+                                  gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    if (!window->duplicates || window->duplicates->len == 0)
+        return;
+
+    if (window->duplicate_cursor + 1 >= window->duplicates->len)
+        window->duplicate_cursor = 0;
+    else
+        window->duplicate_cursor++;
+    show_duplicate (window);
+}
+
+static void
+pan_window_prev_duplicate_action (GSimpleAction *action,
+                                  GVariant      *parameters,
+                                  gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    if (!window->duplicates || window->duplicates->len == 0)
+        return;
+
+    if (window->duplicate_cursor == 0 || window->duplicate_cursor >= window->duplicates->len)
+        window->duplicate_cursor = window->duplicates->len - 1;
+    else
+        window->duplicate_cursor--;
+    show_duplicate (window);
+}
+
+/*
+ * Merges the findings in the image being shown and drops them from the
+ * list.  Findings of other images keep their positions, since merging
+ * only changes the image it is done in.
+ */
+static void
+pan_window_merge_duplicates_action (GSimpleAction *action,
+                                    GVariant      *parameters,
+                                    gpointer       user_data)
+{
+    PanWindow *window = user_data;
+    GtkSingleSelection *record_selection;
+    PanDuplicate *duplicate;
+    guint current, start, end;
+
+    if (!window->duplicates)
+        return;
+
+    record_selection = pan_canvas_get_record_selection_model (window->canvas);
+    current = gtk_single_selection_get_selected (record_selection);
+    g_object_unref (record_selection);
+
+    for (start = 0; start < window->duplicates->len; start++) {
+        duplicate = &g_array_index (window->duplicates, PanDuplicate, start);
+        if (duplicate->record == current)
+            break;
+    }
+    for (end = start; end < window->duplicates->len; end++) {
+        duplicate = &g_array_index (window->duplicates, PanDuplicate, end);
+        if (duplicate->record != current)
+            break;
+    }
+    if (start == end)
+        return;
+
+    pan_canvas_merge_duplicates (window->canvas,
+                                 &g_array_index (window->duplicates, PanDuplicate, start),
+                                 end - start);
+    g_array_remove_range (window->duplicates, start, end - start);
+    window->duplicate_cursor = start > 0 ? start - 1 : G_MAXUINT;
+
+    if (window->duplicates->len == 0) {
+        g_clear_pointer (&window->duplicates, g_array_unref);
+        set_enable_action (window, "next_duplicate", FALSE);
+        set_enable_action (window, "prev_duplicate", FALSE);
+        set_enable_action (window, "merge_duplicates", FALSE);
+    }
+}
+
+/* Opens the image of the current finding with both of its points selected. */
+static void
+show_duplicate (PanWindow *window)
+{
+    GtkSingleSelection *record_selection;
+    GtkSelectionModel *annot_selection;
+    PanDuplicate *duplicate;
+    guint n_annots;
+
+    duplicate = &g_array_index (window->duplicates, PanDuplicate, window->duplicate_cursor);
+
+    record_selection = pan_canvas_get_record_selection_model (window->canvas);
+    gtk_single_selection_set_selected (record_selection, duplicate->record);
+    g_object_unref (record_selection);
+
+    annot_selection = pan_canvas_get_annot_selection_model (window->canvas);
+    if (!annot_selection)
+        return;
+
+    n_annots = g_list_model_get_n_items (G_LIST_MODEL (annot_selection));
+    if (duplicate->first >= n_annots || duplicate->second >= n_annots)
+        return;
+
+    gtk_selection_model_select_item (annot_selection, duplicate->first, TRUE);
+    gtk_selection_model_select_item (annot_selection, duplicate->second, FALSE);
+}
+
+static void
+pan_window_compare_action (GSimpleAction *action,
+                           GVariant      *parameters,
+                           gpointer       user_data)
+{
+    GtkFileDialog *file_dialog;
+    GListStore *filters;
+
+    filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+    add_file_filter (filters, _("JSON"), "text/json", "*.json");
+    add_file_filter (filters, _("CSV"), "text/csv", "*.csv");
+    add_file_filter (filters, _("Binary"), NULL, "*.bin");
+
+    file_dialog = gtk_file_dialog_new ();
+    gtk_file_dialog_set_title (file_dialog, _("Compare With"));
+    gtk_file_dialog_set_filters (file_dialog, G_LIST_MODEL (filters));
+    gtk_file_dialog_open (file_dialog, GTK_WINDOW (user_data),
+                          NULL, pan_window_reference_opened, user_data);
+    g_object_unref (filters);
+    g_object_unref (file_dialog);
+}
+
+/*
+ * Scores the open document against the chosen one, which is taken as the
+ * reference, and keeps showing the matching on the canvas.  The reference
+ * is loaded and compared on a thread.
+ */
+static void
+pan_window_reference_opened (GObject      *source,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+    PanWindow *window = user_data;
+    g_autoptr (GFile) file = NULL;
+    g_autofree gchar *path = NULL;
+    GError *error = NULL;
+
+    file = gtk_file_dialog_open_finish (GTK_FILE_DIALOG (source), result, &error);
+    if (!file) {
+        g_error_free (error);
+        return;
+    }
+    if (!window->document)
+        return;
+
+    path = g_file_get_path (file);
+    set_enable_action (window, "compare", FALSE);
+    pan_agreement_compare_file_async (path, window->document,
+                                      g_settings_get_uint (window->settings, "match-distance"),
+                                      NULL, reference_compared_cb, g_object_ref (window));
+}
+
+static void
+reference_compared_cb (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+    g_autoptr (PanWindow) window = user_data;
+    g_autoptr (PanAgreement) agreement = NULL;
+    g_autofree gchar *text = NULL;
+    g_autofree gchar *markup = NULL;
+    PanDocument *reference = NULL;
+    GError *error = NULL;
+    AdwDialog *dialog;
+
+    agreement = pan_agreement_compare_file_finish (PAN_DOCUMENT (source), result, &reference, &error);
+    set_enable_action (window, "compare", window->document != NULL);
+    if (PAN_DOCUMENT (source) != window->document) {
+        g_clear_object (&reference);
+        g_clear_error (&error);
+        return;
+    }
+    if (!agreement) {
+        show_error (window, _("Could Not Open"), error);
+        g_error_free (error);
+        return;
+    }
+
+    g_clear_object (&window->reference);
+    window->reference = reference;
+    pan_canvas_set_reference (window->canvas, reference, pan_agreement_get_distance (agreement));
+    set_enable_action (window, "stop_compare", TRUE);
+
+    text   = pan_agreement_to_string (agreement);
+    markup = g_markup_printf_escaped ("<tt>%s</tt>", text);
+
+    dialog = adw_alert_dialog_new (_("Agreement"), NULL);
+    adw_alert_dialog_set_body_use_markup (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_alert_dialog_set_body (ADW_ALERT_DIALOG (dialog), markup);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_alert_dialog_set_prefer_wide_layout (ADW_ALERT_DIALOG (dialog), TRUE);
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
+static void
+pan_window_stop_compare_action (GSimpleAction *action,
+                                GVariant      *parameters,
+                                gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    g_clear_object (&window->reference);
+    pan_canvas_set_reference (window->canvas, NULL, 0);
+    set_enable_action (window, "stop_compare", FALSE);
+}
+
+static void
+images_hashed_cb (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+    GError *error = NULL;
+
+    pan_document_hash_images_finish (PAN_DOCUMENT (source), result, &error);
+    if (error) {
+        g_warning ("Could not hash the images: %s", error->message);
+        g_error_free (error);
+    }
+}
+
+static void
+pan_window_relink_action (GSimpleAction *action,
+                          GVariant      *parameters,
+                          gpointer       user_data)
+{
+    GtkFileDialog *file_dialog;
+
+    file_dialog = gtk_file_dialog_new ();
+    gtk_file_dialog_set_title (file_dialog, _("Find Images In"));
+    gtk_file_dialog_select_folder (file_dialog, GTK_WINDOW (user_data),
+                                   NULL, pan_window_relink_folder_cb, user_data);
+    g_object_unref (file_dialog);
+}
+
+static void
+pan_window_relink_folder_cb (GObject      *source,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+    PanWindow *window = user_data;
+    g_autoptr (GFile) file = NULL;
+    g_autofree gchar *path = NULL;
+    GError *error = NULL;
+
+    file = gtk_file_dialog_select_folder_finish (GTK_FILE_DIALOG (source), result, &error);
+    if (!file) {
+        g_error_free (error);
+        return;
+    }
+    if (!window->document)
+        return;
+
+    path = g_file_get_path (file);
+    set_enable_action (window, "relink", FALSE);
+    g_object_set_data_full (G_OBJECT (window), "relink-path", g_steal_pointer (&path), g_free);
+    pan_document_relink_async (window->document,
+                               g_object_get_data (G_OBJECT (window), "relink-path"),
+                               NULL, relinked_cb, g_object_ref (window));
+}
+
+static void
+relinked_cb (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+    g_autoptr (PanWindow) window = user_data;
+    PanDocument *document = PAN_DOCUMENT (source);
+    g_autofree gchar *body = NULL;
+    const gchar *path;
+    GError *error = NULL;
+    AdwDialog *dialog;
+    guint n_found, n_records;
+
+    n_found = pan_document_relink_finish (document, result, &error);
+    set_enable_action (window, "relink", window->document != NULL);
+    if (document != window->document) {
+        g_clear_error (&error);
+        return;
+    }
+    if (error) {
+        show_error (window, _("Could Not Relink"), error);
+        g_error_free (error);
+        return;
+    }
+
+    path      = g_object_get_data (G_OBJECT (window), "relink-path");
+    n_records = g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (document)));
+    if (n_found > 0) {
+        pan_canvas_reload (window->canvas);
+        body = g_strdup_printf (_("Found %u of %u images in %s."), n_found, n_records, path);
+    } else {
+        body = g_strdup_printf (_("None of the %u images were found in %s."), n_records, path);
+    }
+
+    dialog = adw_alert_dialog_new (_("Relink Images"), body);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
+static void
+pan_window_flag_similar_action (GSimpleAction *action,
+                                GVariant      *parameters,
+                                gpointer       user_data)
+{
+    PanWindow *window = user_data;
+
+    if (!window->document)
+        return;
+
+    set_enable_action (window, "flag_similar", FALSE);
+    pan_similar_flag_async (window->document,
+                            g_settings_get_uint (window->settings, "similar-image-distance"),
+                            NULL, similar_flagged_cb, g_object_ref (window));
+}
+
+/* @user_data is a reference to the window to report to, or %NULL for
+ * the pass run on open. */
+static void
+similar_flagged_cb (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+    g_autoptr (PanWindow) window = user_data;
+    g_autofree gchar *body = NULL;
+    GError *error = NULL;
+    AdwDialog *dialog;
+    guint n_flagged;
+
+    n_flagged = pan_similar_flag_finish (PAN_DOCUMENT (source), result, &error);
+    if (!window) {
+        if (error) {
+            g_warning ("Could not compare the images: %s", error->message);
+            g_error_free (error);
+        }
+        return;
+    }
+
+    set_enable_action (window, "flag_similar", window->document != NULL);
+    if (error) {
+        show_error (window, _("Could Not Compare Images"), error);
+        g_error_free (error);
+        return;
+    }
+
+    if (n_flagged > 0)
+        body = g_strdup_printf (ngettext ("%u image looks like an earlier one and is marked in the list.",
+                                          "%u images look like an earlier one and are marked in the list.",
+                                          n_flagged), n_flagged);
+    else
+        body = g_strdup (_("No two images look alike."));
+
+    dialog = adw_alert_dialog_new (_("Similar Images"), body);
+    adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "close", _("Close"));
+    adw_dialog_present (dialog, GTK_WIDGET (window));
+}
+
 static void
 set_enable_action (PanWindow   *window,
                    const gchar *action_name,
@@ -494,6 +1508,25 @@ pan_window_save_dialog_cb (GObject       *source,
     g_free (path);
 }
 
+static void
+pan_window_save_as_dialog_cb (GObject      *source,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+    PanWindow *window = user_data;
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree gchar *path = NULL;
+
+    file = gtk_file_dialog_save_finish (GTK_FILE_DIALOG (source), result, NULL);
+    if (!file)
+        return;
+
+    path = g_file_get_path (file);
+    if (!pan_document_save_file (window->document, path, &error))
+        show_error (window, _("Could Not Save"), error);
+}
+
 static void
 alert_dialog_cb (AdwAlertDialog *dialog,
                  gchar          *response,
@@ -522,6 +1555,23 @@ pan_window_close (PanWindow *self)
     adw_dialog_present (dialog, GTK_WIDGET (self));
 }
 
+/**
+ * pan_window_account_memory:
+ *
+ * Adds the open document, its undo histories and the canvas to @report.
+ */
+void
+pan_window_account_memory (PanWindow       *self,
+                           PanMemoryReport *report)
+{
+    g_return_if_fail (PAN_IS_WINDOW (self));
+    g_return_if_fail (report != NULL);
+
+    if (self->document)
+        pan_document_account_memory (self->document, report);
+    pan_canvas_account_memory (self->canvas, report);
+}
+
 static gboolean
 pan_window_close_request (GtkWindow *window)
 {
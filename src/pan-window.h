@@ -22,13 +22,16 @@
 #pragma once
 
 #include <adwaita.h>
+#include "pan-memory.h"
 
 G_BEGIN_DECLS
 
 #define PAN_TYPE_WINDOW (pan_window_get_type ())
 G_DECLARE_FINAL_TYPE (PanWindow, pan_window, PAN, WINDOW, AdwApplicationWindow)
 
-void pan_window_close (PanWindow *self);
+void pan_window_close          (PanWindow *self);
+void pan_window_account_memory (PanWindow       *self,
+                                PanMemoryReport *report);
 
 G_END_DECLS
 
@@ -0,0 +1,146 @@
+/*
+ * pan-writer.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Buffered output for the text formats.  Writers append to the buffer and
+ * call pan_writer_check() now and then; it is written out whenever it
+ * fills, so a file of any size passes through a small, fixed amount of
+ * memory.  The file replaces the old one only if everything was written.
+ */
+
+#include "pan-writer.h"
+
+#define BUFFER_SIZE (64 * 1024)
+
+struct _PanWriter
+{
+    GFileOutputStream *stream;
+    GString *buffer;
+    GError *error;
+};
+
+static void flush (PanWriter *self);
+
+/**
+ * pan_writer_new:
+ *
+ * Starts replacing the file at @path.
+ *
+ * Returns: (transfer full) (nullable): a writer, to be finished with
+ *   pan_writer_finish()
+ */
+PanWriter *
+pan_writer_new (const gchar  *path,
+                GError      **error)
+{
+    g_autoptr (GFile) file = NULL;
+    GFileOutputStream *stream;
+    PanWriter *self;
+
+    g_return_val_if_fail (path != NULL, NULL);
+
+    file   = g_file_new_for_path (path);
+    stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, NULL, error);
+    if (!stream)
+        return NULL;
+
+    self = g_new0 (PanWriter, 1);
+    self->stream = stream;
+    self->buffer = g_string_sized_new (BUFFER_SIZE);
+
+    return self;
+}
+
+/**
+ * pan_writer_get_buffer:
+ *
+ * Returns: (transfer none): the buffer to append output to
+ */
+GString *
+pan_writer_get_buffer (PanWriter *self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    return self->buffer;
+}
+
+static void
+flush (PanWriter *self)
+{
+    if (!self->error)
+        g_output_stream_write_all (G_OUTPUT_STREAM (self->stream), self->buffer->str, self->buffer->len,
+                                   NULL, NULL, &self->error);
+    g_string_truncate (self->buffer, 0);
+}
+
+/**
+ * pan_writer_check:
+ *
+ * Writes the buffer out if it is full.
+ *
+ * Returns: %FALSE once a write has failed, so there is no point going on
+ */
+gboolean
+pan_writer_check (PanWriter *self)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (self->buffer->len >= BUFFER_SIZE)
+        flush (self);
+
+    return self->error == NULL;
+}
+
+/**
+ * pan_writer_finish:
+ *
+ * Writes out what is left and closes the file, and frees @self.  After a
+ * failed write the close is cancelled, which leaves the file that was
+ * there before untouched.
+ *
+ * Returns: %TRUE if the whole file was written
+ */
+gboolean
+pan_writer_finish (PanWriter  *self,
+                   GError    **error)
+{
+    g_autoptr (GCancellable) cancellable = NULL;
+    gboolean written;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    flush (self);
+    if (!self->error) {
+        written = g_output_stream_close (G_OUTPUT_STREAM (self->stream), NULL, error);
+    } else {
+        cancellable = g_cancellable_new ();
+        g_cancellable_cancel (cancellable);
+        g_output_stream_close (G_OUTPUT_STREAM (self->stream), cancellable, NULL);
+        g_propagate_error (error, g_steal_pointer (&self->error));
+        written = FALSE;
+    }
+
+    g_object_unref (self->stream);
+    g_string_free (self->buffer, TRUE);
+    g_free (self);
+
+    return written;
+}
@@ -0,0 +1,38 @@
+/*
+ * pan-writer.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PanWriter PanWriter;
+
+PanWriter *pan_writer_new        (const gchar  *path,
+                                  GError      **error);
+GString   *pan_writer_get_buffer (PanWriter    *self);
+gboolean   pan_writer_check      (PanWriter    *self);
+gboolean   pan_writer_finish     (PanWriter    *self,
+                                  GError      **error);
+
+G_END_DECLS
@@ -0,0 +1,220 @@
+/*
+ * test-coco.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/*
+ * Loads and saves COCO files through pan_coco_load() and pan_coco_save():
+ * string escapes, annotations that come before their images, members the
+ * pull parser has to skip, the round trip of awkward names, and files it
+ * has to refuse.
+ */
+
+#include <glib/gstdio.h>
+#include "pan-coco.h"
+
+static gchar *
+write_temp (const gchar *contents)
+{
+    g_autoptr (GError) error = NULL;
+    gchar *path;
+    gint fd;
+
+    fd = g_file_open_tmp ("pan-test-XXXXXX.json", &path, &error);
+    g_assert_no_error (error);
+    g_close (fd, NULL);
+
+    g_file_set_contents (path, contents, -1, &error);
+    g_assert_no_error (error);
+
+    return path;
+}
+
+static PanDocument *
+load_string (const gchar  *contents,
+             GError      **error)
+{
+    g_autofree gchar *path = NULL;
+    PanDocument *document;
+
+    path     = write_temp (contents);
+    document = pan_coco_load (path, error);
+    g_unlink (path);
+
+    return document;
+}
+
+static void
+assert_record (PanDocument   *document,
+               guint          position,
+               const gchar   *filename,
+               const guint32 *xy,
+               guint          n_points)
+{
+    g_autoptr (GArray) points = NULL;
+    PanRecordList *records;
+
+    records = pan_document_records (document);
+    points  = g_array_new (FALSE, FALSE, sizeof (guint32));
+    g_assert_cmpstr (pan_record_list_get_filename (records, position), ==, filename);
+    g_assert_cmpuint (pan_record_list_copy_points (records, position, points), ==, n_points);
+    if (n_points > 0)
+        g_assert_cmpmem (points->data, points->len * sizeof (guint32),
+                         xy, 2 * n_points * sizeof (guint32));
+}
+
+static void
+test_coco_escapes (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanDocument) document = NULL;
+
+    document = load_string ("{\"info\":{\"root\":\"\\/data\\/set\"},\n"
+                            " \"images\":[{\"id\":1,\"file_name\":\"caf\\u00e9 \\ud83d\\ude00\\/x\\ty.png\"},\n"
+                            "             {\"id\":2,\"file_name\":\"q\\\"b\\\\c\\n.png\"}],\n"
+                            " \"annotations\":[]}",
+                            &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (document);
+
+    g_assert_cmpstr (pan_document_get_root_path (document), ==, "/data/set");
+    assert_record (document, 0, "caf\xc3\xa9 \xf0\x9f\x98\x80/x\ty.png", NULL, 0);
+    assert_record (document, 1, "q\"b\\c\n.png", NULL, 0);
+}
+
+static void
+test_coco_annotations_first (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanDocument) document = NULL;
+    g_autofree gchar *path = NULL;
+    g_autofree gchar *folder = NULL;
+    static const guint32 first[]  = { 1, 2, 5, 6, 13, 23 };
+    static const guint32 second[] = { 100, 200 };
+
+    path = write_temp ("{\"annotations\":[\n"
+                       "  {\"id\":1,\"image_id\":3,\"keypoints\":[1.4,2,2,9,9,0,5,6,1],\n"
+                       "   \"segmentation\":[[1,2,3,4]],\"extra\":{\"k\":[true,null,{\"z\":\"]}\"}]}},\n"
+                       "  {\"id\":2,\"image_id\":7,\"keypoints\":[100,200,2]},\n"
+                       "  {\"id\":3,\"image_id\":3,\"bbox\":[10,20,5,5]}],\n"
+                       " \"categories\":[{\"id\":1,\"name\":\"point\",\"keypoints\":[\"point\"]}],\n"
+                       " \"images\":[{\"id\":7,\"file_name\":\"b.png\",\"width\":640},\n"
+                       "             {\"id\":3,\"file_name\":\"a.png\"},\n"
+                       "             {\"id\":9,\"file_name\":\"c.png\"}]}");
+    document = pan_coco_load (path, &error);
+    g_unlink (path);
+    g_assert_no_error (error);
+    g_assert_nonnull (document);
+
+    /* Images are in the order they were first referred to. */
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (document))), ==, 3);
+    assert_record (document, 0, "a.png", first, 3);
+    assert_record (document, 1, "b.png", second, 1);
+    assert_record (document, 2, "c.png", NULL, 0);
+
+    /* Without a root in "info", it is the folder of the file. */
+    folder = g_path_get_dirname (path);
+    g_assert_cmpstr (pan_document_get_root_path (document), ==, folder);
+}
+
+static void
+test_coco_round_trip (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanDocument) document = NULL;
+    g_autoptr (PanDocument) loaded = NULL;
+    g_autoptr (GPtrArray) names = NULL;
+    g_autoptr (GPtrArray) points = NULL;
+    g_autofree gchar *path = NULL;
+    static const gchar *filenames[] = {
+        "plain.png", "q\"b\\c.png", "tab\tnew\nline.png", "caf\xc3\xa9.png", "empty.png",
+    };
+    static const guint32 xy[][4] = { { 1, 2, 3, 4 }, { 5, 6 }, { 0, 4294967295u }, { 7, 8 }, { 0 } };
+    static const guint n_points[] = { 2, 1, 1, 1, 0 };
+    GArray *coords;
+
+    names  = g_ptr_array_new_with_free_func (g_free);
+    points = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+    for (guint i = 0; i < G_N_ELEMENTS (filenames); i++) {
+        coords = g_array_new (FALSE, FALSE, sizeof (guint32));
+        g_array_append_vals (coords, xy[i], 2 * n_points[i]);
+        g_ptr_array_add (names, g_strdup (filenames[i]));
+        g_ptr_array_add (points, coords);
+    }
+    document = pan_document_new_from_points ("/data/my \"set\"", names, points);
+
+    path = write_temp ("");
+    pan_coco_save (document, path, &error);
+    g_assert_no_error (error);
+    g_assert_true (pan_coco_sniff (path));
+
+    loaded = pan_coco_load (path, &error);
+    g_unlink (path);
+    g_assert_no_error (error);
+
+    g_assert_cmpstr (pan_document_get_root_path (loaded), ==, "/data/my \"set\"");
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (loaded))), ==,
+                      G_N_ELEMENTS (filenames));
+    for (guint i = 0; i < G_N_ELEMENTS (filenames); i++)
+        assert_record (loaded, i, filenames[i], xy[i], n_points[i]);
+}
+
+static void
+test_coco_malformed (void)
+{
+    static const gchar *files[] = {
+        "",
+        "[]",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a.png\"}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a.png\"},]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a\\x.png\"}]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"\\ud83d.png\"}]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"\\u12g4.png\"}]}",
+        "{\"images\":[{\"id\":1}]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a.png\"}],\"annotations\":[{\"keypoints\":[1,2,2]}]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a.png\"}],\"annotations\":[{\"image_id\":1,\"keypoints\":[1,\"2\",2]}]}",
+        "{\"images\":[{\"id\":1,\"file_name\":\"a.png\"}],\"annotations\":[{\"image_id\":2,\"keypoints\":[1,2,2]}]}",
+        "{\"info\":{\"root\":\"/x\"} \"images\":[]}",
+        "{\"other\":{\"a\":[1,2}",
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS (files); i++) {
+        g_autoptr (GError) error = NULL;
+        g_autoptr (PanDocument) document = NULL;
+
+        document = load_string (files[i], &error);
+        g_assert_null (document);
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/coco/escapes", test_coco_escapes);
+    g_test_add_func ("/coco/annotations-first", test_coco_annotations_first);
+    g_test_add_func ("/coco/round-trip", test_coco_round_trip);
+    g_test_add_func ("/coco/malformed", test_coco_malformed);
+
+    return g_test_run ();
+}
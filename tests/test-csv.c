@@ -0,0 +1,198 @@
+/*
+ * test-csv.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/*
+ * Loads and saves CSV files through pan_csv_load() and pan_csv_save():
+ * the RFC 4180 quoting that split_row() has to undo, the round trip of
+ * names that need it, and the rows a load has to refuse.
+ */
+
+#include <glib/gstdio.h>
+#include "pan-csv.h"
+
+static gchar *
+write_temp (const gchar *contents)
+{
+    g_autoptr (GError) error = NULL;
+    gchar *path;
+    gint fd;
+
+    fd = g_file_open_tmp ("pan-test-XXXXXX.csv", &path, &error);
+    g_assert_no_error (error);
+    g_close (fd, NULL);
+
+    g_file_set_contents (path, contents, -1, &error);
+    g_assert_no_error (error);
+
+    return path;
+}
+
+static PanDocument *
+load_string (const gchar  *contents,
+             GError      **error)
+{
+    g_autofree gchar *path = NULL;
+    PanDocument *document;
+
+    path     = write_temp (contents);
+    document = pan_csv_load (path, error);
+    g_unlink (path);
+
+    return document;
+}
+
+static void
+assert_record (PanDocument   *document,
+               guint          position,
+               const gchar   *filename,
+               const guint32 *xy,
+               guint          n_points)
+{
+    g_autoptr (GArray) points = NULL;
+    PanRecordList *records;
+
+    records = pan_document_records (document);
+    points  = g_array_new (FALSE, FALSE, sizeof (guint32));
+    g_assert_cmpstr (pan_record_list_get_filename (records, position), ==, filename);
+    g_assert_cmpuint (pan_record_list_copy_points (records, position, points), ==, n_points);
+    if (n_points > 0)
+        g_assert_cmpmem (points->data, points->len * sizeof (guint32),
+                         xy, 2 * n_points * sizeof (guint32));
+}
+
+static void
+test_csv_quoted (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanDocument) document = NULL;
+    static const guint32 commas[] = { 10, 20, 30, 40 };
+    static const guint32 plain[]  = { 1, 3 };
+    static const guint32 quoted[] = { 7, 8 };
+
+    document = load_string ("filename,x,y\n"
+                            "\"a,b.png\",10,20\n"
+                            "\"say \"\"hi\"\".png\",,\n"
+                            "plain.png,1.4,2.6\n"
+                            "\"a,b.png\",30,40\n"
+                            "\"q.png\",\"7\",\"8\"\r\n",
+                            &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (document);
+
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (document))), ==, 4);
+    assert_record (document, 0, "a,b.png", commas, 2);
+    assert_record (document, 1, "say \"hi\".png", NULL, 0);
+    assert_record (document, 2, "plain.png", plain, 1);
+    assert_record (document, 3, "q.png", quoted, 1);
+}
+
+static void
+test_csv_round_trip (void)
+{
+    g_autoptr (GError) error = NULL;
+    g_autoptr (PanDocument) document = NULL;
+    g_autoptr (PanDocument) loaded = NULL;
+    g_autoptr (GPtrArray) names = NULL;
+    g_autoptr (GPtrArray) points = NULL;
+    g_autofree gchar *path = NULL;
+    g_autofree gchar *contents = NULL;
+    g_autofree gchar *folder = NULL;
+    static const gchar *filenames[] = { "a,b.png", "say \"hi\".png", "sub/plain.png", "empty.png" };
+    static const guint32 xy[][4] = { { 1, 2, 3, 4 }, { 5, 6 }, { 0, 4294967295u }, { 0 } };
+    static const guint n_points[] = { 2, 1, 1, 0 };
+    GArray *coords;
+
+    names  = g_ptr_array_new_with_free_func (g_free);
+    points = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+    for (guint i = 0; i < G_N_ELEMENTS (filenames); i++) {
+        coords = g_array_new (FALSE, FALSE, sizeof (guint32));
+        g_array_append_vals (coords, xy[i], 2 * n_points[i]);
+        g_ptr_array_add (names, g_strdup (filenames[i]));
+        g_ptr_array_add (points, coords);
+    }
+    document = pan_document_new_from_points ("/images", names, points);
+
+    path = write_temp ("");
+    pan_csv_save (document, path, &error);
+    g_assert_no_error (error);
+
+    g_file_get_contents (path, &contents, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_cmpstr (contents, ==,
+                     "filename,x,y\n"
+                     "\"a,b.png\",1,2\n"
+                     "\"a,b.png\",3,4\n"
+                     "\"say \"\"hi\"\".png\",5,6\n"
+                     "sub/plain.png,0,4294967295\n"
+                     "empty.png,,\n");
+
+    loaded = pan_csv_load (path, &error);
+    g_unlink (path);
+    g_assert_no_error (error);
+
+    /* There is no place for the root, so it is the folder of the file. */
+    folder = g_path_get_dirname (path);
+    g_assert_cmpstr (pan_document_get_root_path (loaded), ==, folder);
+
+    g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (pan_document_records (loaded))), ==,
+                      G_N_ELEMENTS (filenames));
+    for (guint i = 0; i < G_N_ELEMENTS (filenames); i++)
+        assert_record (loaded, i, filenames[i], xy[i], n_points[i]);
+}
+
+static void
+test_csv_malformed (void)
+{
+    static const gchar *rows[] = {
+        "filename,x,y\n\"open.png,1,2\n",
+        "\"a\"b.png,1,2\n",
+        "a.png,\"1\"2,3\n",
+        "a.png,1\n",
+        "a.png,1,2,3\n",
+        "a.png,x,2\n",
+        "a.png,-1,2\n",
+        "a.png,1,\n",
+        "a.png,1,5000000000\n",
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS (rows); i++) {
+        g_autoptr (GError) error = NULL;
+        g_autoptr (PanDocument) document = NULL;
+
+        document = load_string (rows[i], &error);
+        g_assert_null (document);
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/csv/quoted", test_csv_quoted);
+    g_test_add_func ("/csv/round-trip", test_csv_round_trip);
+    g_test_add_func ("/csv/malformed", test_csv_malformed);
+
+    return g_test_run ();
+}